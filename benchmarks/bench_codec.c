@@ -0,0 +1,228 @@
+/* Throughput of the binary codec and the generic type handling for
+ * representative builtin and structured types.
+ *
+ * Usage: bench_codec [iterations] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ua_types.h"
+#include "ua_types_generated.h"
+#include "ua_types_encoding_binary.h"
+#include "ua_nodeids.h"
+#include "ua_util.h"
+#include "benchmark.h"
+
+/* Decoded and copied values are kept in batches, so that the deleteMembers
+   can be measured separately */
+#define BATCHSIZE 256
+
+static volatile size_t sink;
+
+static void
+benchmarkType(const char *name, const UA_DataType *type, void *value, size_t iterations) {
+    size_t bytes = UA_calcSizeBinary(value, type);
+    UA_ByteString buf;
+    if(UA_ByteString_allocBuffer(&buf, bytes) != UA_STATUSCODE_GOOD)
+        return;
+    UA_Byte *batch = UA_malloc(type->memSize * BATCHSIZE);
+    if(!batch) {
+        UA_ByteString_deleteMembers(&buf);
+        return;
+    }
+
+    BenchmarkTimer timer;
+    Benchmark_init(&timer);
+    Benchmark_start(&timer);
+    for(size_t i = 0; i < iterations; i++)
+        sink = UA_calcSizeBinary(value, type);
+    Benchmark_pause(&timer);
+    Benchmark_report(&timer, name, "calcSize", iterations, bytes);
+
+    size_t offset = 0;
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    Benchmark_init(&timer);
+    Benchmark_start(&timer);
+    for(size_t i = 0; i < iterations; i++) {
+        offset = 0;
+        retval |= UA_encodeBinary(value, type, &buf, &offset);
+    }
+    Benchmark_pause(&timer);
+    Benchmark_report(&timer, name, "encode", iterations, bytes);
+
+    BenchmarkTimer decodeTimer, deleteTimer;
+    Benchmark_init(&decodeTimer);
+    Benchmark_init(&deleteTimer);
+    for(size_t done = 0; done < iterations; done += BATCHSIZE) {
+        size_t count = iterations - done < BATCHSIZE ? iterations - done : BATCHSIZE;
+        Benchmark_start(&decodeTimer);
+        for(size_t j = 0; j < count; j++) {
+            offset = 0;
+            retval |= UA_decodeBinary(&buf, &offset, &batch[j * type->memSize], type, 0, NULL);
+        }
+        Benchmark_pause(&decodeTimer);
+        Benchmark_start(&deleteTimer);
+        for(size_t j = 0; j < count; j++)
+            UA_deleteMembers(&batch[j * type->memSize], type);
+        Benchmark_pause(&deleteTimer);
+    }
+    Benchmark_report(&decodeTimer, name, "decode", iterations, bytes);
+    Benchmark_report(&deleteTimer, name, "deleteMembers", iterations, bytes);
+
+    BenchmarkTimer copyTimer;
+    Benchmark_init(&copyTimer);
+    for(size_t done = 0; done < iterations; done += BATCHSIZE) {
+        size_t count = iterations - done < BATCHSIZE ? iterations - done : BATCHSIZE;
+        Benchmark_start(&copyTimer);
+        for(size_t j = 0; j < count; j++)
+            retval |= UA_copy(value, &batch[j * type->memSize], type);
+        Benchmark_pause(&copyTimer);
+        for(size_t j = 0; j < count; j++)
+            UA_deleteMembers(&batch[j * type->memSize], type);
+    }
+    Benchmark_report(&copyTimer, name, "copy", iterations, bytes);
+
+    if(retval != UA_STATUSCODE_GOOD)
+        fprintf(stderr, "Benchmark %s failed with statuscode 0x%08x\n", name, retval);
+    UA_free(batch);
+    UA_ByteString_deleteMembers(&buf);
+}
+
+/* Scale down the iterations for large values so that every benchmark
+   processes a similar amount of data */
+static size_t
+scaledIterations(size_t iterations, void *value, const UA_DataType *type) {
+    size_t bytes = UA_calcSizeBinary(value, type);
+    size_t scaled = iterations / (1 + (bytes / 256));
+    return scaled > 0 ? scaled : 1;
+}
+
+static void
+run(const char *name, const UA_DataType *type, void *value, size_t iterations) {
+    benchmarkType(name, type, value, scaledIterations(iterations, value, type));
+    UA_delete(value, type);
+}
+
+/*******************/
+/* Benchmark Cases */
+/*******************/
+
+static void
+setDataValue(UA_DataValue *dv, UA_Double d) {
+    UA_Variant_setScalarCopy(&dv->value, &d, &UA_TYPES[UA_TYPES_DOUBLE]);
+    dv->hasValue = true;
+    dv->status = UA_STATUSCODE_GOOD;
+    dv->hasStatus = true;
+    dv->sourceTimestamp = UA_DateTime_now();
+    dv->hasSourceTimestamp = true;
+    dv->serverTimestamp = dv->sourceTimestamp;
+    dv->hasServerTimestamp = true;
+}
+
+static UA_Variant *
+variantDoubleArray(size_t length) {
+    UA_Variant *v = UA_Variant_new();
+    UA_Double *d = UA_Array_new(length, &UA_TYPES[UA_TYPES_DOUBLE]);
+    for(size_t i = 0; i < length; i++)
+        d[i] = (UA_Double)i * 0.5;
+    UA_Variant_setArray(v, d, length, &UA_TYPES[UA_TYPES_DOUBLE]);
+    return v;
+}
+
+static UA_Variant *
+variantStringArray(size_t length) {
+    UA_Variant *v = UA_Variant_new();
+    UA_String *s = UA_Array_new(length, &UA_TYPES[UA_TYPES_STRING]);
+    for(size_t i = 0; i < length; i++)
+        s[i] = UA_STRING_ALLOC("a typical string value");
+    UA_Variant_setArray(v, s, length, &UA_TYPES[UA_TYPES_STRING]);
+    return v;
+}
+
+static UA_ReadResponse *
+readResponse(size_t results) {
+    UA_ReadResponse *r = UA_ReadResponse_new();
+    r->responseHeader.timestamp = UA_DateTime_now();
+    r->results = UA_Array_new(results, &UA_TYPES[UA_TYPES_DATAVALUE]);
+    r->resultsSize = results;
+    for(size_t i = 0; i < results; i++)
+        setDataValue(&r->results[i], (UA_Double)i);
+    return r;
+}
+
+static UA_BrowseResponse *
+browseResponse(size_t references) {
+    UA_BrowseResponse *r = UA_BrowseResponse_new();
+    r->responseHeader.timestamp = UA_DateTime_now();
+    r->results = UA_BrowseResult_new();
+    r->resultsSize = 1;
+    UA_BrowseResult *br = r->results;
+    br->references = UA_Array_new(references, &UA_TYPES[UA_TYPES_REFERENCEDESCRIPTION]);
+    br->referencesSize = references;
+    for(size_t i = 0; i < references; i++) {
+        UA_ReferenceDescription *rd = &br->references[i];
+        rd->referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+        rd->isForward = true;
+        rd->nodeId.nodeId = UA_NODEID_NUMERIC(1, (UA_UInt32)(1000 + i));
+        rd->browseName = UA_QUALIFIEDNAME_ALLOC(1, "BrowseName");
+        rd->displayName = UA_LOCALIZEDTEXT_ALLOC("en_US", "DisplayName");
+        rd->nodeClass = UA_NODECLASS_VARIABLE;
+        rd->typeDefinition.nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE);
+    }
+    return r;
+}
+
+static UA_PublishResponse *
+publishResponse(size_t notifications) {
+    UA_PublishResponse *r = UA_PublishResponse_new();
+    r->responseHeader.timestamp = UA_DateTime_now();
+    r->subscriptionId = 1;
+    r->notificationMessage.sequenceNumber = 1;
+    r->notificationMessage.publishTime = r->responseHeader.timestamp;
+    UA_DataChangeNotification *dcn = UA_DataChangeNotification_new();
+    dcn->monitoredItems = UA_Array_new(notifications, &UA_TYPES[UA_TYPES_MONITOREDITEMNOTIFICATION]);
+    dcn->monitoredItemsSize = notifications;
+    for(size_t i = 0; i < notifications; i++) {
+        dcn->monitoredItems[i].clientHandle = (UA_UInt32)i;
+        setDataValue(&dcn->monitoredItems[i].value, (UA_Double)i);
+    }
+    r->notificationMessage.notificationData = UA_ExtensionObject_new();
+    r->notificationMessage.notificationDataSize = 1;
+    r->notificationMessage.notificationData->encoding = UA_EXTENSIONOBJECT_DECODED;
+    r->notificationMessage.notificationData->content.decoded.type =
+        &UA_TYPES[UA_TYPES_DATACHANGENOTIFICATION];
+    r->notificationMessage.notificationData->content.decoded.data = dcn;
+    return r;
+}
+
+int main(int argc, char **argv) {
+    size_t iterations = 100000;
+    if(argc > 1)
+        iterations = (size_t)strtoul(argv[1], NULL, 10);
+
+    Benchmark_begin("codec", iterations);
+
+    UA_Int32 *i32 = UA_Int32_new();
+    *i32 = 42;
+    run("Int32", &UA_TYPES[UA_TYPES_INT32], i32, iterations);
+
+    UA_String *s = UA_String_new();
+    *s = UA_STRING_ALLOC("a typical string value");
+    run("String", &UA_TYPES[UA_TYPES_STRING], s, iterations);
+
+    UA_NodeId *n = UA_NodeId_new();
+    *n = UA_NODEID_STRING_ALLOC(1, "Demo.Static.Scalar.Double");
+    run("NodeId.String", &UA_TYPES[UA_TYPES_NODEID], n, iterations);
+
+    UA_DataValue *dv = UA_DataValue_new();
+    setDataValue(dv, 3.14);
+    run("DataValue", &UA_TYPES[UA_TYPES_DATAVALUE], dv, iterations);
+
+    run("Variant.Double[1000]", &UA_TYPES[UA_TYPES_VARIANT], variantDoubleArray(1000), iterations);
+    run("Variant.String[100]", &UA_TYPES[UA_TYPES_VARIANT], variantStringArray(100), iterations);
+    run("ReadResponse[100]", &UA_TYPES[UA_TYPES_READRESPONSE], readResponse(100), iterations);
+    run("BrowseResponse[50]", &UA_TYPES[UA_TYPES_BROWSERESPONSE], browseResponse(50), iterations);
+    run("PublishResponse[100]", &UA_TYPES[UA_TYPES_PUBLISHRESPONSE], publishResponse(100), iterations);
+
+    Benchmark_end();
+    return 0;
+}
@@ -0,0 +1,145 @@
+/* Insert, lookup and removal in the nodestore. The benchmark is built once for
+ * every single-threaded nodestore implementation (bench_nodestore_hash,
+ * bench_nodestore_swisstable) so that the results can be compared.
+ *
+ * Usage: bench_nodestore [nodes] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ua_types.h"
+#include "server/ua_nodestore.h"
+#include "ua_util.h"
+#include "benchmark.h"
+
+#ifdef BENCHMARK_NODESTORE_SWISSTABLE
+# define NODESTORE "swisstable"
+#else
+# define NODESTORE "hash"
+#endif
+
+static UA_UInt32 rngState = 0x12345678;
+
+/* xorshift32 is sufficient to shuffle the lookup order */
+static UA_UInt32 nextRandom(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static void shuffle(UA_NodeId *ids, size_t count) {
+    for(size_t i = count - 1; i > 0; i--) {
+        size_t j = nextRandom() % (i + 1);
+        UA_NodeId tmp = ids[i];
+        ids[i] = ids[j];
+        ids[j] = tmp;
+    }
+}
+
+static void
+benchmarkNodeStore(const char *keys, UA_NodeId *ids, UA_NodeId *missing, size_t count) {
+    char name[64];
+    snprintf(name, sizeof(name), "%s.%s[%lu]", NODESTORE, keys, (unsigned long)count);
+    UA_NodeStore *ns = UA_NodeStore_new();
+    BenchmarkTimer timer;
+
+    /* Insert (includes the allocation of the node and the nodeid) */
+    Benchmark_init(&timer);
+    Benchmark_start(&timer);
+    for(size_t i = 0; i < count; i++) {
+        UA_Node *node = UA_NodeStore_newNode(ns, UA_NODECLASS_VARIABLE);
+        UA_NodeId_copy(&ids[i], &node->nodeId);
+        UA_NodeStore_insert(ns, node);
+    }
+    Benchmark_pause(&timer);
+    /* Report the memory per node (all nodes are variables) */
+    UA_NodeStoreStatistics stats;
+    UA_NodeStore_getStatistics(ns, UA_NODECLASS_VARIABLE, &stats);
+    Benchmark_report(&timer, name, "insert", count, stats.bytes / count);
+
+    /* Lookup of existing nodes in random order */
+    shuffle(ids, count);
+    size_t found = 0;
+    Benchmark_init(&timer);
+    Benchmark_start(&timer);
+    for(size_t round = 0; round < 4; round++) {
+        for(size_t i = 0; i < count; i++)
+            found += (UA_NodeStore_get(ns, &ids[i]) != NULL);
+    }
+    Benchmark_pause(&timer);
+    Benchmark_report(&timer, name, "get", 4 * count, 0);
+
+    /* Lookup of missing nodes */
+    Benchmark_init(&timer);
+    Benchmark_start(&timer);
+    for(size_t round = 0; round < 4; round++) {
+        for(size_t i = 0; i < count; i++)
+            found += (UA_NodeStore_get(ns, &missing[i]) != NULL);
+    }
+    Benchmark_pause(&timer);
+    Benchmark_report(&timer, name, "getMissing", 4 * count, 0);
+
+    if(found != 4 * count)
+        fprintf(stderr, "Benchmark %s found %lu nodes instead of %lu\n", name,
+                (unsigned long)found, (unsigned long)(4 * count));
+
+    /* Remove half of the nodes and look up the others (the probe sequences
+       now contain removed entries) */
+    Benchmark_init(&timer);
+    Benchmark_start(&timer);
+    for(size_t i = 0; i < count / 2; i++)
+        UA_NodeStore_remove(ns, &ids[i]);
+    Benchmark_pause(&timer);
+    Benchmark_report(&timer, name, "remove", count / 2, 0);
+
+    Benchmark_init(&timer);
+    Benchmark_start(&timer);
+    for(size_t round = 0; round < 4; round++) {
+        for(size_t i = count / 2; i < count; i++)
+            found += (UA_NodeStore_get(ns, &ids[i]) != NULL);
+    }
+    Benchmark_pause(&timer);
+    Benchmark_report(&timer, name, "getAfterRemove", 4 * (count - count / 2), 0);
+
+    UA_NodeStore_delete(ns);
+}
+
+int main(int argc, char **argv) {
+    size_t count = 100000;
+    if(argc > 1)
+        count = (size_t)strtoul(argv[1], NULL, 10);
+    if(count < 2)
+        count = 2;
+
+    UA_NodeId *ids = UA_Array_new(count, &UA_TYPES[UA_TYPES_NODEID]);
+    UA_NodeId *missing = UA_Array_new(count, &UA_TYPES[UA_TYPES_NODEID]);
+    if(!ids || !missing)
+        return EXIT_FAILURE;
+
+    Benchmark_begin("nodestore", count);
+
+    /* Numeric nodeids (as in namespace zero) */
+    for(size_t i = 0; i < count; i++) {
+        ids[i] = UA_NODEID_NUMERIC(1, (UA_UInt32)(i + 1));
+        missing[i] = UA_NODEID_NUMERIC(1, (UA_UInt32)(count + i + 1));
+    }
+    benchmarkNodeStore("numeric", ids, missing, count);
+
+    /* String nodeids (typical for information models) */
+    char buf[64];
+    for(size_t i = 0; i < count; i++) {
+        snprintf(buf, sizeof(buf), "Plant.Line%lu.Sensor%lu.Value",
+                 (unsigned long)(i % 97), (unsigned long)i);
+        ids[i] = UA_NODEID_STRING_ALLOC(2, buf);
+        snprintf(buf, sizeof(buf), "Plant.Line%lu.Sensor%lu.Missing",
+                 (unsigned long)(i % 97), (unsigned long)i);
+        missing[i] = UA_NODEID_STRING_ALLOC(2, buf);
+    }
+    benchmarkNodeStore("string", ids, missing, count);
+
+    Benchmark_end();
+
+    UA_Array_delete(ids, count, &UA_TYPES[UA_TYPES_NODEID]);
+    UA_Array_delete(missing, count, &UA_TYPES[UA_TYPES_NODEID]);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,470 @@
+/* Load test of the subscriptions. In-process clients on the dummy connections
+ * of the tests create sessions with a subscription each and monitor a share of
+ * the variables. Variables are changed at a fixed rate while the server runs.
+ * The requests and responses go through the binary protocol.
+ *
+ * Every other variable is a data source. Its items are sampled by the server.
+ * The other variables are written and notify their items right away.
+ *
+ * Reported are the creation of the monitored items (with the heap bytes per
+ * item), the delivered notifications, the jitter of the sampling intervals and
+ * the latency from sampling a value to receiving it in a publish response.
+ *
+ * The server allows up to 1000 sessions on 100 SecureChannels.
+ *
+ * Usage: bench_subscriptions [sessions] [itemsPerSession] [variables]
+ *                            [changesPerSecond] [seconds] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ua_types.h"
+#include "ua_server.h"
+#include "ua_config_standard.h"
+#include "ua_nodeids.h"
+#include "ua_types_encoding_binary.h"
+#include "ua_securechannel.h"
+#include "server/ua_server_internal.h"
+#include "server/ua_services.h"
+#include "testing_networklayers.h"
+#include "benchmark.h"
+
+#define SESSIONS_PER_CHANNEL 16
+#define PUBLISHING_INTERVAL 100.0 // [ms]
+#define SAMPLING_INTERVAL 50.0 // [ms]
+#define PUBLISH_REQUESTS 3 // outstanding per session
+#define ITEMS_PER_REQUEST 256
+#define MAX_ACKS 16
+#define MAX_SAMPLES (1 << 24)
+
+typedef struct {
+    UA_NodeId authenticationToken;
+    UA_UInt32 subscriptionId;
+    size_t outstanding; // publish requests without a response
+    size_t acksSize;
+    UA_SubscriptionAcknowledgement acks[MAX_ACKS];
+} LoadSession;
+
+typedef struct {
+    UA_Server *server;
+    UA_Connection connection; // of the server, receives the responses
+    UA_Connection toServer; // the server processes the requests right away
+    UA_SecureChannel channel; // of the client
+    UA_UInt32 requestId;
+    void *response; // the expected response during the setup
+    const UA_DataType *responseType;
+    size_t sessionsSize;
+    LoadSession sessions[SESSIONS_PER_CHANNEL];
+} LoadClient;
+
+typedef struct {
+    size_t size;
+    size_t capacity;
+    UA_DateTime *samples;
+} Samples;
+
+static Samples latencies;
+static Samples jitter;
+static size_t notifications;
+
+/* The current values of the data sources and when they were last read */
+static UA_Int32 *values;
+static UA_DateTime *lastRead;
+
+static void
+addSample(Samples *s, UA_DateTime sample) {
+    if(s->size == s->capacity) {
+        if(s->capacity >= MAX_SAMPLES)
+            return;
+        size_t capacity = s->capacity ? s->capacity * 2 : 1024;
+        UA_DateTime *samples = realloc(s->samples, capacity * sizeof(UA_DateTime));
+        if(!samples)
+            return;
+        s->samples = samples;
+        s->capacity = capacity;
+    }
+    s->samples[s->size++] = sample;
+}
+
+static UA_StatusCode
+readValue(void *handle, const UA_NodeId nodeid, UA_Boolean sourceTimeStamp,
+          const UA_NumericRange *range, UA_DataValue *dataValue) {
+    size_t i = (size_t)(uintptr_t)handle;
+    UA_DateTime now = UA_DateTime_nowMonotonic();
+    if(lastRead[i] != 0) {
+        UA_DateTime deviation = now - lastRead[i] -
+            (UA_DateTime)(SAMPLING_INTERVAL * UA_MSEC_TO_DATETIME);
+        addSample(&jitter, deviation < 0 ? -deviation : deviation);
+    }
+    lastRead[i] = now;
+    UA_Variant_setScalarCopy(&dataValue->value, &values[i], &UA_TYPES[UA_TYPES_INT32]);
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+addVariables(UA_Server *server, size_t count) {
+    char buf[64];
+    for(size_t i = 0; i < count; i++) {
+        snprintf(buf, sizeof(buf), "Load.Var%lu", (unsigned long)i);
+        UA_VariableAttributes attr;
+        UA_VariableAttributes_init(&attr);
+        attr.displayName = UA_LOCALIZEDTEXT("en_US", buf);
+        UA_NodeId nodeId = UA_NODEID_NUMERIC(1, (UA_UInt32)i + 1);
+        UA_NodeId parent = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
+        UA_NodeId reference = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+        UA_QualifiedName browseName = UA_QUALIFIEDNAME(1, buf);
+        if(i % 2 == 0) {
+            UA_Variant_setScalar(&attr.value, &values[i], &UA_TYPES[UA_TYPES_INT32]);
+            UA_Server_addVariableNode(server, nodeId, parent, reference, browseName,
+                                      UA_NODEID_NULL, attr, NULL, NULL);
+        } else {
+            UA_DataSource source = {.handle = (void*)(uintptr_t)i, .read = readValue, .write = NULL};
+            UA_Server_addDataSourceVariableNode(server, nodeId, parent, reference, browseName,
+                                                UA_NODEID_NULL, attr, source, NULL);
+        }
+    }
+}
+
+/* Every notification is stamped when the server took the sample */
+static void
+receivePublishResponse(LoadClient *client, const UA_ByteString *msg, size_t offset) {
+    UA_DateTime now = UA_DateTime_now();
+    UA_PublishResponse response;
+    if(UA_decodeBinary(msg, &offset, &response, &UA_TYPES[UA_TYPES_PUBLISHRESPONSE],
+                       0, NULL) != UA_STATUSCODE_GOOD)
+        return;
+    UA_UInt32 handle = response.responseHeader.requestHandle;
+    if(handle < client->sessionsSize) {
+        LoadSession *session = &client->sessions[handle];
+        session->outstanding--;
+        if(response.notificationMessage.notificationDataSize > 0 && session->acksSize < MAX_ACKS) {
+            session->acks[session->acksSize].subscriptionId = response.subscriptionId;
+            session->acks[session->acksSize].sequenceNumber =
+                response.notificationMessage.sequenceNumber;
+            session->acksSize++;
+        }
+    }
+    for(size_t i = 0; i < response.notificationMessage.notificationDataSize; i++) {
+        UA_ExtensionObject *data = &response.notificationMessage.notificationData[i];
+        if(data->encoding < UA_EXTENSIONOBJECT_DECODED ||
+           data->content.decoded.type != &UA_TYPES[UA_TYPES_DATACHANGENOTIFICATION])
+            continue;
+        UA_DataChangeNotification *dcn = data->content.decoded.data;
+        for(size_t j = 0; j < dcn->monitoredItemsSize; j++) {
+            notifications++;
+            if(dcn->monitoredItems[j].value.hasServerTimestamp)
+                addSample(&latencies, now - dcn->monitoredItems[j].value.serverTimestamp);
+        }
+    }
+    UA_PublishResponse_deleteMembers(&response);
+}
+
+static UA_StatusCode
+receiveResponse(UA_Connection *connection, UA_ByteString *buf) {
+    LoadClient *client = connection->handle;
+    size_t offset = 24; // after the headers
+    UA_NodeId typeId;
+    UA_StatusCode retval = UA_decodeBinary(buf, &offset, &typeId, &UA_TYPES[UA_TYPES_NODEID], 0, NULL);
+    if(retval == UA_STATUSCODE_GOOD && typeId.identifierType == UA_NODEIDTYPE_NUMERIC) {
+        UA_UInt32 id = typeId.identifier.numeric - UA_ENCODINGOFFSET_BINARY;
+        if(id == UA_NS0ID_PUBLISHRESPONSE) {
+            receivePublishResponse(client, buf, offset);
+        } else if(id == UA_NS0ID_SERVICEFAULT && client->response) {
+            UA_ServiceFault fault;
+            if(UA_decodeBinary(buf, &offset, &fault, &UA_TYPES[UA_TYPES_SERVICEFAULT],
+                               0, NULL) == UA_STATUSCODE_GOOD) {
+                ((UA_ResponseHeader*)client->response)->serviceResult =
+                    fault.responseHeader.serviceResult;
+                UA_ServiceFault_deleteMembers(&fault);
+            }
+        } else if(client->responseType && id == client->responseType->typeId.identifier.numeric) {
+            retval = UA_decodeBinary(buf, &offset, client->response, client->responseType, 0, NULL);
+            if(retval != UA_STATUSCODE_GOOD)
+                ((UA_ResponseHeader*)client->response)->serviceResult = retval;
+        }
+    }
+    UA_ByteString_deleteMembers(buf);
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+forwardRequest(UA_Connection *connection, UA_ByteString *buf) {
+    LoadClient *client = connection->handle;
+    UA_Server_processBinaryMessage(client->server, &client->connection, buf);
+    UA_ByteString_deleteMembers(buf);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* The response is decoded into the given response before the function
+   returns. Publish responses are handled separately. */
+static void
+sendRequest(LoadClient *client, const void *request, const UA_DataType *requestType,
+            void *response, const UA_DataType *responseType) {
+    client->response = response;
+    client->responseType = responseType;
+    UA_SecureChannel_sendBinaryMessage(&client->channel, ++client->requestId,
+                                       request, requestType);
+    client->response = NULL;
+    client->responseType = NULL;
+}
+
+static UA_StatusCode
+openClient(LoadClient *client, UA_Server *server) {
+    client->server = server;
+    client->requestId = 0;
+    client->response = NULL;
+    client->responseType = NULL;
+    client->sessionsSize = 0;
+    client->connection = createDummyConnection();
+    client->connection.handle = client;
+    client->connection.send = receiveResponse;
+    client->connection.remoteConf.recvBufferSize = 1 << 18; // for large publish responses
+    client->toServer = createDummyConnection();
+    client->toServer.handle = client;
+    client->toServer.send = forwardRequest;
+    client->toServer.remoteConf.recvBufferSize = 1 << 18;
+
+    UA_OpenSecureChannelRequest request;
+    UA_OpenSecureChannelRequest_init(&request);
+    request.requestType = UA_SECURITYTOKENREQUESTTYPE_ISSUE;
+    request.securityMode = UA_MESSAGESECURITYMODE_NONE;
+    UA_OpenSecureChannelResponse response;
+    UA_OpenSecureChannelResponse_init(&response);
+    Service_OpenSecureChannel(server, &client->connection, &request, &response);
+    UA_StatusCode retval = response.responseHeader.serviceResult;
+    UA_SecureChannel_init(&client->channel);
+    client->channel.connection = &client->toServer;
+    client->channel.securityToken = response.securityToken;
+    UA_OpenSecureChannelResponse_deleteMembers(&response);
+    return retval;
+}
+
+static UA_StatusCode
+createSession(LoadClient *client, LoadSession *session) {
+    session->outstanding = 0;
+    session->acksSize = 0;
+    UA_CreateSessionRequest request;
+    UA_CreateSessionRequest_init(&request);
+    request.requestedSessionTimeout = 3600000;
+    UA_CreateSessionResponse response;
+    UA_CreateSessionResponse_init(&response);
+    sendRequest(client, &request, &UA_TYPES[UA_TYPES_CREATESESSIONREQUEST],
+                &response, &UA_TYPES[UA_TYPES_CREATESESSIONRESPONSE]);
+    UA_StatusCode retval = response.responseHeader.serviceResult;
+    if(retval == UA_STATUSCODE_GOOD && UA_NodeId_isNull(&response.authenticationToken))
+        retval = UA_STATUSCODE_BADUNEXPECTEDERROR;
+    UA_NodeId_copy(&response.authenticationToken, &session->authenticationToken);
+    UA_CreateSessionResponse_deleteMembers(&response);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    UA_AnonymousIdentityToken identity;
+    UA_AnonymousIdentityToken_init(&identity);
+    UA_ActivateSessionRequest activate;
+    UA_ActivateSessionRequest_init(&activate);
+    activate.requestHeader.authenticationToken = session->authenticationToken;
+    activate.userIdentityToken.encoding = UA_EXTENSIONOBJECT_DECODED_NODELETE;
+    activate.userIdentityToken.content.decoded.type = &UA_TYPES[UA_TYPES_ANONYMOUSIDENTITYTOKEN];
+    activate.userIdentityToken.content.decoded.data = &identity;
+    UA_ActivateSessionResponse activated;
+    UA_ActivateSessionResponse_init(&activated);
+    sendRequest(client, &activate, &UA_TYPES[UA_TYPES_ACTIVATESESSIONREQUEST],
+                &activated, &UA_TYPES[UA_TYPES_ACTIVATESESSIONRESPONSE]);
+    retval = activated.responseHeader.serviceResult;
+    UA_ActivateSessionResponse_deleteMembers(&activated);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    UA_CreateSubscriptionRequest subscribe;
+    UA_CreateSubscriptionRequest_init(&subscribe);
+    subscribe.requestHeader.authenticationToken = session->authenticationToken;
+    subscribe.requestedPublishingInterval = PUBLISHING_INTERVAL;
+    subscribe.requestedLifetimeCount = 1000;
+    subscribe.requestedMaxKeepAliveCount = 10;
+    subscribe.publishingEnabled = true;
+    UA_CreateSubscriptionResponse subscribed;
+    UA_CreateSubscriptionResponse_init(&subscribed);
+    sendRequest(client, &subscribe, &UA_TYPES[UA_TYPES_CREATESUBSCRIPTIONREQUEST],
+                &subscribed, &UA_TYPES[UA_TYPES_CREATESUBSCRIPTIONRESPONSE]);
+    retval = subscribed.responseHeader.serviceResult;
+    session->subscriptionId = subscribed.subscriptionId;
+    UA_CreateSubscriptionResponse_deleteMembers(&subscribed);
+    return retval;
+}
+
+/* The items of consecutive sessions overlap on the variables */
+static size_t
+createMonitoredItems(LoadClient *client, LoadSession *session, size_t first,
+                     size_t count, size_t variables) {
+    UA_MonitoredItemCreateRequest items[ITEMS_PER_REQUEST];
+    size_t created = 0;
+    for(size_t done = 0; done < count; done += ITEMS_PER_REQUEST) {
+        size_t batch = count - done < ITEMS_PER_REQUEST ? count - done : ITEMS_PER_REQUEST;
+        for(size_t i = 0; i < batch; i++) {
+            UA_MonitoredItemCreateRequest *item = &items[i];
+            UA_MonitoredItemCreateRequest_init(item);
+            item->itemToMonitor.nodeId =
+                UA_NODEID_NUMERIC(1, (UA_UInt32)((first + done + i) % variables) + 1);
+            item->itemToMonitor.attributeId = UA_ATTRIBUTEID_VALUE;
+            item->monitoringMode = UA_MONITORINGMODE_REPORTING;
+            item->requestedParameters.clientHandle = (UA_UInt32)(done + i);
+            item->requestedParameters.samplingInterval = SAMPLING_INTERVAL;
+            item->requestedParameters.queueSize = 1;
+            item->requestedParameters.discardOldest = true;
+        }
+        UA_CreateMonitoredItemsRequest request;
+        UA_CreateMonitoredItemsRequest_init(&request);
+        request.requestHeader.authenticationToken = session->authenticationToken;
+        request.subscriptionId = session->subscriptionId;
+        request.itemsToCreate = items;
+        request.itemsToCreateSize = batch;
+        UA_CreateMonitoredItemsResponse response;
+        UA_CreateMonitoredItemsResponse_init(&response);
+        sendRequest(client, &request, &UA_TYPES[UA_TYPES_CREATEMONITOREDITEMSREQUEST],
+                    &response, &UA_TYPES[UA_TYPES_CREATEMONITOREDITEMSRESPONSE]);
+        for(size_t i = 0; i < response.resultsSize; i++)
+            created += response.results[i].statusCode == UA_STATUSCODE_GOOD;
+        UA_CreateMonitoredItemsResponse_deleteMembers(&response);
+    }
+    return created;
+}
+
+static void
+sendPublish(LoadClient *client, UA_UInt32 index) {
+    LoadSession *session = &client->sessions[index];
+    UA_PublishRequest request;
+    UA_PublishRequest_init(&request);
+    request.requestHeader.authenticationToken = session->authenticationToken;
+    request.requestHeader.requestHandle = index;
+    request.subscriptionAcknowledgements = session->acks;
+    request.subscriptionAcknowledgementsSize = session->acksSize;
+    session->acksSize = 0;
+    session->outstanding++; // a late subscription responds right away
+    sendRequest(client, &request, &UA_TYPES[UA_TYPES_PUBLISHREQUEST], NULL, NULL);
+}
+
+static void
+changeValue(UA_Server *server, size_t i) {
+    values[i]++;
+    if(i % 2 == 1)
+        return; // sampled by the server
+    UA_Variant v;
+    UA_Variant_setScalar(&v, &values[i], &UA_TYPES[UA_TYPES_INT32]);
+    UA_Server_writeValue(server, UA_NODEID_NUMERIC(1, (UA_UInt32)i + 1), v);
+}
+
+int main(int argc, char **argv) {
+    size_t sessions = 100, itemsPerSession = 100, variables = 1000;
+    size_t changesPerSecond = 10000, seconds = 5;
+    if(argc > 1)
+        sessions = (size_t)strtoul(argv[1], NULL, 10);
+    if(argc > 2)
+        itemsPerSession = (size_t)strtoul(argv[2], NULL, 10);
+    if(argc > 3)
+        variables = (size_t)strtoul(argv[3], NULL, 10);
+    if(argc > 4)
+        changesPerSecond = (size_t)strtoul(argv[4], NULL, 10);
+    if(argc > 5)
+        seconds = (size_t)strtoul(argv[5], NULL, 10);
+    if(sessions == 0 || variables == 0)
+        return EXIT_FAILURE;
+
+    size_t clientsSize = (sessions + SESSIONS_PER_CHANNEL - 1) / SESSIONS_PER_CHANNEL;
+    LoadClient *clients = calloc(clientsSize, sizeof(LoadClient));
+    values = calloc(variables, sizeof(UA_Int32));
+    lastRead = calloc(variables, sizeof(UA_DateTime));
+    if(!clients || !values || !lastRead)
+        return EXIT_FAILURE;
+
+    UA_ServerConfig config = UA_ServerConfig_standard;
+    config.logger = NULL;
+    UA_Server *server = UA_Server_new(config);
+    addVariables(server, variables);
+    UA_Server_run_startup(server);
+
+    /* Set up the sessions. Only the monitored items are measured. */
+    size_t createdSessions = 0, items = 0;
+    BenchmarkTimer createTimer;
+    Benchmark_init(&createTimer);
+    size_t heapBefore = Benchmark_heapSize();
+    for(size_t c = 0; c < clientsSize; c++) {
+        LoadClient *client = &clients[c];
+        if(openClient(client, server) != UA_STATUSCODE_GOOD)
+            break;
+        for(size_t s = 0; s < SESSIONS_PER_CHANNEL && createdSessions < sessions; s++) {
+            LoadSession *session = &client->sessions[client->sessionsSize];
+            if(createSession(client, session) != UA_STATUSCODE_GOOD) {
+                UA_NodeId_deleteMembers(&session->authenticationToken);
+                break;
+            }
+            client->sessionsSize++;
+            Benchmark_start(&createTimer);
+            items += createMonitoredItems(client, session, createdSessions * itemsPerSession / 2,
+                                          itemsPerSession, variables);
+            Benchmark_pause(&createTimer);
+            createdSessions++;
+        }
+    }
+    size_t heapAfter = Benchmark_heapSize();
+    if(createdSessions < sessions)
+        fprintf(stderr, "Created %lu of %lu sessions\n",
+                (unsigned long)createdSessions, (unsigned long)sessions);
+
+    /* Keep the publish requests outstanding and change the values at the
+       given rate */
+    memset(lastRead, 0, variables * sizeof(UA_DateTime));
+    jitter.size = 0;
+    BenchmarkTimer runTimer;
+    Benchmark_init(&runTimer);
+    Benchmark_start(&runTimer);
+    UA_DateTime start = UA_DateTime_nowMonotonic();
+    UA_DateTime end = start + (UA_DateTime)seconds * UA_SEC_TO_DATETIME;
+    size_t changes = 0, nextVariable = 0;
+    for(UA_DateTime now = start; now < end; now = UA_DateTime_nowMonotonic()) {
+        size_t due = (size_t)((double)(now - start) * (double)changesPerSecond /
+                              (double)UA_SEC_TO_DATETIME);
+        for(; changes < due; changes++) {
+            changeValue(server, nextVariable);
+            nextVariable = (nextVariable + 1) % variables;
+        }
+        UA_Server_run_iterate(server, false);
+        for(size_t c = 0; c < clientsSize; c++) {
+            LoadClient *client = &clients[c];
+            for(UA_UInt32 s = 0; s < client->sessionsSize; s++) {
+                while(client->sessions[s].outstanding < PUBLISH_REQUESTS)
+                    sendPublish(client, s);
+            }
+        }
+    }
+    Benchmark_pause(&runTimer);
+
+    Benchmark_begin("subscriptions", items);
+    size_t bytesPerItem = 0;
+    if(items > 0 && heapAfter > heapBefore)
+        bytesPerItem = (heapAfter - heapBefore) / items;
+    Benchmark_report(&createTimer, "monitoredItems", "create", items, bytesPerItem);
+    Benchmark_report(&runTimer, "values", "change", changes, 0);
+    Benchmark_report(&runTimer, "notifications", "deliver", notifications, 0);
+    Benchmark_reportDistribution("sampling", "jitter", jitter.samples, jitter.size);
+    Benchmark_reportDistribution("publish", "latency", latencies.samples, latencies.size);
+    Benchmark_end();
+
+    UA_Server_run_shutdown(server);
+    UA_Server_delete(server);
+    for(size_t c = 0; c < clientsSize; c++) {
+        LoadClient *client = &clients[c];
+        for(size_t s = 0; s < client->sessionsSize; s++)
+            UA_NodeId_deleteMembers(&client->sessions[s].authenticationToken);
+        client->channel.connection = NULL;
+        UA_SecureChannel_deleteMembersCleanup(&client->channel);
+        UA_Connection_deleteMembers(&client->connection);
+        UA_Connection_deleteMembers(&client->toServer);
+    }
+    free(clients);
+    free(values);
+    free(lastRead);
+    free(latencies.samples);
+    free(jitter.samples);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "benchmark.h"
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+# include <malloc.h>
+# define BENCHMARK_HEAPSIZE
+#endif
+
+#define BENCHMARK_STRINGIFY(x) #x
+#define BENCHMARK_TOSTRING(x) BENCHMARK_STRINGIFY(x)
+
+static size_t allocations = 0;
+static UA_Boolean firstResult = true;
+
+#ifdef BENCHMARK_COUNT_ALLOCATIONS
+/* The linker redirects all calls to the allocator functions here
+   (-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc) */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t num, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t num, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t num, size_t size) {
+    allocations++;
+    return __real_calloc(num, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    allocations++;
+    return __real_realloc(ptr, size);
+}
+#endif
+
+void Benchmark_init(BenchmarkTimer *timer) {
+    timer->start = 0;
+    timer->elapsed = 0;
+    timer->startAllocations = 0;
+    timer->allocations = 0;
+}
+
+void Benchmark_start(BenchmarkTimer *timer) {
+    timer->startAllocations = allocations;
+    timer->start = UA_DateTime_nowMonotonic();
+}
+
+void Benchmark_pause(BenchmarkTimer *timer) {
+    timer->elapsed += UA_DateTime_nowMonotonic() - timer->start;
+    timer->allocations += allocations - timer->startAllocations;
+}
+
+void Benchmark_report(const BenchmarkTimer *timer, const char *name, const char *operation,
+                      size_t operations, size_t bytesPerOp) {
+    if(operations == 0)
+        operations = 1;
+    /* UA_DateTime has a resolution of 100ns */
+    double nsPerOp = ((double)timer->elapsed * 100.0) / (double)operations;
+    printf("%s\n    {\"name\": \"%s\", \"operation\": \"%s\", \"operations\": %lu, "
+           "\"ns_per_op\": %.2f, \"bytes_per_op\": %lu, ",
+           firstResult ? "" : ",", name, operation, (unsigned long)operations,
+           nsPerOp, (unsigned long)bytesPerOp);
+#ifdef BENCHMARK_COUNT_ALLOCATIONS
+    printf("\"allocs_per_op\": %.2f}", (double)timer->allocations / (double)operations);
+#else
+    printf("\"allocs_per_op\": null}");
+#endif
+    firstResult = false;
+}
+
+static int
+compareDateTime(const void *a, const void *b) {
+    UA_DateTime x = *(const UA_DateTime*)a;
+    UA_DateTime y = *(const UA_DateTime*)b;
+    return (x > y) - (x < y);
+}
+
+static double
+percentile(const UA_DateTime *sorted, size_t size, size_t percent) {
+    if(size == 0)
+        return 0.0;
+    /* UA_DateTime has a resolution of 100ns */
+    return (double)sorted[(size - 1) * percent / 100] / 10.0;
+}
+
+void Benchmark_reportDistribution(const char *name, const char *measure,
+                                  UA_DateTime *samples, size_t samplesSize) {
+    qsort(samples, samplesSize, sizeof(UA_DateTime), compareDateTime);
+    printf("%s\n    {\"name\": \"%s\", \"operation\": \"%s\", \"samples\": %lu, "
+           "\"p50_us\": %.1f, \"p90_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f}",
+           firstResult ? "" : ",", name, measure, (unsigned long)samplesSize,
+           percentile(samples, samplesSize, 50), percentile(samples, samplesSize, 90),
+           percentile(samples, samplesSize, 99), percentile(samples, samplesSize, 100));
+    firstResult = false;
+}
+
+size_t Benchmark_heapSize(void) {
+#ifdef BENCHMARK_HEAPSIZE
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+void Benchmark_begin(const char *suite, size_t iterations) {
+    firstResult = true;
+    printf("{\n  \"suite\": \"%s\",\n", suite);
+#ifdef VERSION
+    printf("  \"version\": \"%s\",\n", BENCHMARK_TOSTRING(VERSION));
+#endif
+    printf("  \"iterations\": %lu,\n  \"results\": [", (unsigned long)iterations);
+}
+
+void Benchmark_end(void) {
+    printf("\n  ]\n}\n");
+    fflush(stdout);
+}
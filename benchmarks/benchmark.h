@@ -0,0 +1,48 @@
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include "ua_types.h"
+
+/**
+ * Benchmark Helpers
+ * =================
+ * Timing, allocation counting and JSON output shared by the benchmarks. The
+ * results are printed to stdout as a JSON document so that they can be
+ * compared between releases.
+ *
+ * The allocations are only counted if the allocator functions are wrapped at
+ * link time (BENCHMARK_COUNT_ALLOCATIONS). Otherwise, they are reported as
+ * null. */
+
+/* The timer accumulates the time and allocations between start and pause. So
+ * setup and cleanup work can be excluded from the measurement. */
+typedef struct {
+    UA_DateTime start;
+    UA_DateTime elapsed;
+    size_t startAllocations;
+    size_t allocations;
+} BenchmarkTimer;
+
+void Benchmark_init(BenchmarkTimer *timer);
+void Benchmark_start(BenchmarkTimer *timer);
+void Benchmark_pause(BenchmarkTimer *timer);
+
+/* Prints the result for one operation. The accumulated time and allocations
+ * are divided by the number of operations. */
+void Benchmark_report(const BenchmarkTimer *timer, const char *name, const char *operation,
+                      size_t operations, size_t bytesPerOp);
+
+/* Prints the median, percentiles and maximum of measured durations, e.g.
+ * latencies. The samples are sorted in place. */
+void Benchmark_reportDistribution(const char *name, const char *measure,
+                                  UA_DateTime *samples, size_t samplesSize);
+
+/* The bytes allocated on the heap. Zero if the allocator cannot tell (only
+ * glibc is supported). */
+size_t Benchmark_heapSize(void);
+
+/* Begin and end the JSON document. Results must be printed in between. */
+void Benchmark_begin(const char *suite, size_t iterations);
+void Benchmark_end(void);
+
+#endif /* BENCHMARK_H_ */
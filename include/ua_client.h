@@ -42,6 +42,8 @@ typedef struct UA_ClientConfig {
     UA_Logger logger;
     UA_ConnectionConfig localConnectionConfig;
     UA_ConnectClientConnection connectionFunc;
+    size_t customDataTypesSize; // custom types (outside of ns0) decoded from extensionobjects
+    const UA_DataType *customDataTypes;
 } UA_ClientConfig;
 
 /**
@@ -107,6 +107,10 @@ typedef struct {
     size_t usernamePasswordLoginsSize;
     UA_UsernamePasswordLogin* usernamePasswordLogins;
 
+    /* Custom DataTypes (outside of ns0) that are decoded from ExtensionObjects */
+    size_t customDataTypesSize;
+    const UA_DataType *customDataTypes;
+
     /* Limits for subscription settings */
     UA_BoundedUInt32 publishingIntervalLimits;
     UA_BoundedUInt32 lifeTimeCountLimits;
@@ -114,6 +118,11 @@ typedef struct {
     UA_BoundedUInt32 notificationsPerPublishLimits;
     UA_BoundedUInt32 samplingIntervalLimits;
     UA_BoundedUInt32 queueSizeLimits;
+    UA_UInt32 maxPublishRequestsPerSession; // queued until notifications are ready
+    /* Notifications are retained for republishing until they are acknowledged.
+       The oldest are dropped when a budget (encoded bytes) is exceeded. */
+    size_t maxRetransmissionQueueBytes; // per subscription
+    size_t maxRetransmissionBytes; // for all subscriptions
 } UA_ServerConfig;
 
 /**
@@ -173,6 +182,31 @@ UA_StatusCode UA_EXPORT UA_Server_removeRepeatedJob(UA_Server *server, UA_Guid j
 /* Add a new namespace to the server. Returns the index of the new namespace */
 UA_UInt16 UA_EXPORT UA_Server_addNamespace(UA_Server *server, const char* name);
 
+#ifdef UA_ENABLE_NODESTORE_SNAPSHOT
+/* Write a binary image of the information model and the namespace array to a
+ * file. Callbacks, handles and data sources are not stored.
+ *
+ * @param server The server object.
+ * @param path The file to write.
+ * @return Returns UA_STATUSCODE_BADNOTSUPPORTED if a value has a custom
+ *         datatype. */
+UA_StatusCode UA_EXPORT UA_Server_writeSnapshot(UA_Server *server, const char *path);
+
+/* Map a snapshot into the information model. Nodes with the same NodeId are
+ * replaced, except nodes with a data source, value or method callbacks, an
+ * instance handle or lifecycle callbacks. The mapped nodes are copied when they
+ * are modified. Namespaces that are only in the snapshot are added to the
+ * server.
+ *
+ * @param server The server object.
+ * @param path The file to load.
+ * @return Returns UA_STATUSCODE_BADDECODINGERROR if the file was written by a
+ *         build with a different memory layout or is corrupt. Returns
+ *         UA_STATUSCODE_BADINVALIDSTATE if the namespaces of the server and the
+ *         snapshot differ. */
+UA_StatusCode UA_EXPORT UA_Server_loadSnapshot(UA_Server *server, const char *path);
+#endif
+
 /**
  * Node Management
  * ---------------
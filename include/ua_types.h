@@ -691,6 +691,11 @@ typedef struct {
                                      For arrays this is the padding before the size_t
                                      lenght member. (No padding between size_t and the
                                      following ptr.) */
+    UA_Byte   overlayableRun;     /* How many members starting with this one have the
+                                     identical layout in memory and on the binary
+                                     stream? They are de- and encoded with a single
+                                     memcpy. Zero if there is no such run. */
+    UA_UInt16 overlayableBytes;   /* The length of the run in bytes */
     UA_Boolean namespaceZero : 1; /* The type of the member is defined in namespace zero.
                                      In this implementation, types from custom namespace
                                      may contain members from the same namespace or ns0
@@ -703,6 +708,9 @@ struct UA_DataType {
     const char *typeName;
 #endif
     UA_NodeId  typeId;           /* The nodeid of the type */
+    UA_UInt32  binaryEncodingId; /* Numeric nodeid of the binary encoding in the
+                                    namespace of the typeId. If zero, typeId +
+                                    UA_ENCODINGOFFSET_BINARY is used. */
     UA_UInt16  memSize;          /* Size of the struct in memory */
     UA_UInt16  typeIndex;        /* Index of the type in the datatypetable */
     UA_Byte    membersSize;      /* How many members does the type have? */
@@ -740,6 +748,16 @@ UA_init(void *p, const UA_DataType *type) {
  * @return Indicates whether the operation succeeded or returns an error code */
 UA_StatusCode UA_EXPORT UA_copy(const void *src, void *dst, const UA_DataType *type);
 
+/* Compares two variables of the same type member by member. Floating point
+ * values are compared bitwise. Timestamps and other optional fields of a
+ * DataValue are compared only if they are set.
+ *
+ * @param p1 The memory location of the first variable
+ * @param p2 The memory location of the second variable
+ * @param type The datatype description
+ * @return Returns true if the variables have the same content */
+UA_Boolean UA_EXPORT UA_equal(const void *p1, const void *p2, const UA_DataType *type);
+
 /* Deletes the dynamically allocated content of a variable (e.g. resets all arrays to
  * undefined arrays). Afterwards, the variable can be safely deleted without causing
  * memory leaks. But the variable is not initialized and may contain old data that is not
@@ -43,13 +43,19 @@ const UA_ServerConfig UA_ServerConfig_standard = {
     .enableUsernamePasswordLogin = true,
     .usernamePasswordLogins = usernamePasswords,
     .usernamePasswordLoginsSize = 2,
-    
+
+    .customDataTypesSize = 0,
+    .customDataTypes = NULL,
+
     .publishingIntervalLimits = { .max = 10000, .min = 0, .current = 0 },
     .lifeTimeCountLimits = { .max = 15000, .min = 0, .current = 0 },
     .keepAliveCountLimits = { .max = 100, .min = 0, .current = 0 },
     .notificationsPerPublishLimits = { .max = 1000, .min = 1, .current = 0 },
     .samplingIntervalLimits = { .max = 1000, .min = 5, .current = 0 },
-    .queueSizeLimits = { .max = 100, .min = 0, .current = 0 }
+    .queueSizeLimits = { .max = 100, .min = 0, .current = 0 },
+    .maxPublishRequestsPerSession = 10,
+    .maxRetransmissionQueueBytes = 65536,
+    .maxRetransmissionBytes = 4194304
 };
 
 const UA_EXPORT UA_ClientConfig UA_ClientConfig_standard = {
@@ -62,4 +68,6 @@ const UA_EXPORT UA_ClientConfig UA_ClientConfig_standard = {
         .recvBufferSize  = 65536,
         .maxMessageSize = 65536,
         .maxChunkCount = 1 },
-    .connectionFunc = UA_ClientConnectionTCP };
+    .connectionFunc = UA_ClientConnectionTCP,
+    .customDataTypesSize = 0,
+    .customDataTypes = NULL };
@@ -711,11 +711,13 @@ void __UA_Client_Service(UA_Client *client, const void *r, const UA_DataType *re
                          responseId.namespaceIndex, responseId.identifier.numeric);
             respHeader->serviceResult = UA_STATUSCODE_BADINTERNALERROR;
         } else
-            retval = UA_decodeBinary(&reply, &offset, respHeader, &UA_TYPES[UA_TYPES_SERVICEFAULT]);
+            retval = UA_decodeBinary(&reply, &offset, respHeader, &UA_TYPES[UA_TYPES_SERVICEFAULT],
+                                     client->config.customDataTypesSize, client->config.customDataTypes);
         goto finish;
     } 
     
-    retval = UA_decodeBinary(&reply, &offset, response, responseType);
+    retval = UA_decodeBinary(&reply, &offset, response, responseType,
+                             client->config.customDataTypesSize, client->config.customDataTypes);
     if(retval == UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED)
         retval = UA_STATUSCODE_BADRESPONSETOOLARGE;
 
@@ -1,13 +1,506 @@
 #include "ua_nodes.h"
 #include "ua_util.h"
+#include "ua_nodestore_hash.h"
+
+/********************/
+/* String Interning */
+/********************/
+
+#define UA_INTERN_MINSIZE 64
+
+/* The string content follows the entry. Interned strings point to it. */
+typedef struct UA_InternEntry {
+    struct UA_InternEntry *next;
+    UA_UInt32 hash;
+    UA_UInt32 refCount;
+    size_t length;
+    UA_Byte data[];
+} UA_InternEntry;
+
+struct UA_InternTable {
+    UA_InternEntry **buckets;
+    size_t size; /* power of two */
+    size_t count;
+};
+
+UA_InternTable * UA_InternTable_new(void) {
+    return UA_calloc(1, sizeof(UA_InternTable));
+}
+
+void UA_InternTable_delete(UA_InternTable *t) {
+    if(!t)
+        return;
+    for(size_t i = 0; i < t->size; i++) {
+        UA_InternEntry *e = t->buckets[i];
+        while(e) {
+            UA_InternEntry *next = e->next;
+            UA_free(e);
+            e = next;
+        }
+    }
+    UA_free(t->buckets);
+    UA_free(t);
+}
+
+size_t UA_InternTable_count(const UA_InternTable *t) {
+    return t ? t->count : 0;
+}
+
+/* FNV-1a */
+static UA_UInt32
+internHash(const UA_Byte *data, size_t length) {
+    UA_UInt32 h = 2166136261u;
+    for(size_t i = 0; i < length; i++) {
+        h ^= data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static UA_InternEntry **
+internBucket(UA_InternTable *t, UA_UInt32 hash) {
+    return &t->buckets[hash & (t->size - 1)];
+}
+
+/* Doubles the number of buckets. The table continues with the old buckets if
+   the allocation fails. */
+static void
+internGrow(UA_InternTable *t) {
+    size_t nsize = t->size * 2;
+    UA_InternEntry **nbuckets = UA_calloc(nsize, sizeof(UA_InternEntry*));
+    if(!nbuckets)
+        return;
+    for(size_t i = 0; i < t->size; i++) {
+        UA_InternEntry *e = t->buckets[i];
+        while(e) {
+            UA_InternEntry *next = e->next;
+            e->next = nbuckets[e->hash & (nsize - 1)];
+            nbuckets[e->hash & (nsize - 1)] = e;
+            e = next;
+        }
+    }
+    UA_free(t->buckets);
+    t->buckets = nbuckets;
+    t->size = nsize;
+}
+
+static UA_InternEntry *
+internFind(UA_InternTable *t, const UA_Byte *data, size_t length, UA_UInt32 hash) {
+    for(UA_InternEntry *e = *internBucket(t, hash); e; e = e->next) {
+        if(e->hash == hash && e->length == length &&
+           (e->data == data || memcmp(e->data, data, length) == 0))
+            return e;
+    }
+    return NULL;
+}
+
+void UA_String_intern(UA_String *s, UA_InternTable *t) {
+    if(!t || s->length == 0 || !s->data || s->data == UA_EMPTY_ARRAY_SENTINEL)
+        return;
+    if(!t->buckets) {
+        t->buckets = UA_calloc(UA_INTERN_MINSIZE, sizeof(UA_InternEntry*));
+        if(!t->buckets)
+            return;
+        t->size = UA_INTERN_MINSIZE;
+    }
+
+    UA_UInt32 hash = internHash(s->data, s->length);
+    UA_InternEntry *e = internFind(t, s->data, s->length, hash);
+    if(e) {
+        /* Already interned. E.g. an edited copy with references that were
+           added to it is interned again when it replaces the original. */
+        if(e->data == s->data)
+            return;
+        UA_free(s->data);
+        s->data = e->data;
+        e->refCount++;
+        return;
+    }
+
+    e = UA_malloc(sizeof(UA_InternEntry) + s->length);
+    if(!e)
+        return; /* The string stays a private copy */
+    e->hash = hash;
+    e->refCount = 1;
+    e->length = s->length;
+    memcpy(e->data, s->data, s->length);
+    UA_InternEntry **bucket = internBucket(t, hash);
+    e->next = *bucket;
+    *bucket = e;
+    UA_free(s->data);
+    s->data = e->data;
+    t->count++;
+    if(t->count > t->size)
+        internGrow(t);
+}
+
+void UA_String_releaseInterned(UA_String *s, UA_InternTable *t) {
+    if(!t || s->length == 0 || !t->buckets)
+        return;
+    UA_UInt32 hash = internHash(s->data, s->length);
+    UA_InternEntry **prev = internBucket(t, hash);
+    for(UA_InternEntry *e = *prev; e; prev = &e->next, e = e->next) {
+        if(e->data != s->data)
+            continue;
+        s->data = NULL;
+        s->length = 0;
+        e->refCount--;
+        if(e->refCount > 0)
+            return;
+        *prev = e->next;
+        UA_free(e);
+        t->count--;
+        if(t->count == 0) {
+            UA_free(t->buckets);
+            t->buckets = NULL;
+            t->size = 0;
+        }
+        return;
+    }
+}
+
+/* Points dst to the interned copy of src, if there is one. Spares the
+   allocation of a private copy that is interned right away. */
+static UA_Boolean
+internShare(const UA_String *src, UA_String *dst, UA_InternTable *t) {
+    if(!t || src->length == 0 || !t->buckets)
+        return false;
+    UA_InternEntry *e = internFind(t, src->data, src->length, internHash(src->data, src->length));
+    if(!e)
+        return false;
+    dst->length = src->length;
+    dst->data = e->data;
+    e->refCount++;
+    return true;
+}
+
+void UA_NodeId_intern(UA_NodeId *id, UA_InternTable *t) {
+    if(id->identifierType == UA_NODEIDTYPE_STRING ||
+       id->identifierType == UA_NODEIDTYPE_BYTESTRING)
+        UA_String_intern(&id->identifier.string, t);
+}
+
+/* Copies the NodeId into an interned string right away. The string is shared
+   without an allocation if it is interned already. */
+static UA_StatusCode
+nodeIdCopyInterned(const UA_NodeId *src, UA_NodeId *dst, UA_InternTable *t) {
+    if((src->identifierType == UA_NODEIDTYPE_STRING ||
+        src->identifierType == UA_NODEIDTYPE_BYTESTRING) &&
+       internShare(&src->identifier.string, &dst->identifier.string, t)) {
+        dst->namespaceIndex = src->namespaceIndex;
+        dst->identifierType = src->identifierType;
+        return UA_STATUSCODE_GOOD;
+    }
+    UA_StatusCode retval = UA_NodeId_copy(src, dst);
+    if(retval == UA_STATUSCODE_GOOD)
+        UA_NodeId_intern(dst, t);
+    return retval;
+}
+
+void UA_NodeId_releaseInterned(UA_NodeId *id, UA_InternTable *t) {
+    if(id->identifierType == UA_NODEIDTYPE_STRING ||
+       id->identifierType == UA_NODEIDTYPE_BYTESTRING)
+        UA_String_releaseInterned(&id->identifier.string, t);
+}
+
+void UA_Node_intern(UA_Node *node, UA_InternTable *t) {
+    if(!t)
+        return;
+    UA_NodeId_intern(&node->nodeId, t);
+    UA_String_intern(&node->browseName.name, t);
+    for(size_t i = 0; i < node->referencesSize; i++) {
+        UA_NodeReferenceKind *rk = &node->references[i];
+        UA_NodeId_intern(&rk->referenceTypeId, t);
+        for(size_t j = 0; j < rk->targetIdsSize; j++)
+            UA_NodeId_intern(&rk->targetIds[j].nodeId, t);
+    }
+}
+
+void UA_Node_releaseInterned(UA_Node *node, UA_InternTable *t) {
+    if(!t)
+        return;
+    UA_NodeId_releaseInterned(&node->nodeId, t);
+    UA_String_releaseInterned(&node->browseName.name, t);
+    for(size_t i = 0; i < node->referencesSize; i++) {
+        UA_NodeReferenceKind *rk = &node->references[i];
+        UA_NodeId_releaseInterned(&rk->referenceTypeId, t);
+        for(size_t j = 0; j < rk->targetIdsSize; j++)
+            UA_NodeId_releaseInterned(&rk->targetIds[j].nodeId, t);
+    }
+}
+
+/**************/
+/* References */
+/**************/
+
+/* Kinds with at least this many targets get an index */
+#define UA_REFERENCEKIND_INDEXMIN 16
+
+/* The targets array has room for a power of two (at least four) targets. So
+   appending does not need to realloc every time. */
+static size_t
+targetsCapacity(size_t size) {
+    size_t capacity = 4;
+    while(capacity < size)
+        capacity *= 2;
+    return capacity;
+}
+
+static void
+deleteReferenceKind(UA_NodeReferenceKind *rk) {
+    UA_NodeId_deleteMembers(&rk->referenceTypeId);
+    UA_Array_delete(rk->targetIds, rk->targetIdsSize, &UA_TYPES[UA_TYPES_EXPANDEDNODEID]);
+    rk->targetIds = NULL;
+    rk->targetIdsSize = 0;
+    UA_free(rk->targetIndex);
+    rk->targetIndex = NULL;
+    rk->targetIndexSize = 0;
+}
+
+/* Returns the slot of the target or of the empty slot where the probing ends */
+static size_t
+indexSlot(const UA_NodeReferenceKind *rk, const UA_NodeId *targetId) {
+    size_t mask = rk->targetIndexSize - 1;
+    size_t slot = UA_NodeId_hash(targetId) & mask;
+    while(rk->targetIndex[slot] != 0) {
+        if(UA_NodeId_equal(&rk->targetIds[rk->targetIndex[slot] - 1].nodeId, targetId))
+            return slot;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/* Rebuild the index with a load factor of at most one quarter for the expected
+   number of targets */
+static UA_StatusCode
+indexRebuild(UA_NodeReferenceKind *rk, size_t expected) {
+    size_t size = 16;
+    while(size < expected * 4)
+        size *= 2;
+    size_t *index = UA_calloc(size, sizeof(size_t));
+    if(!index)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_free(rk->targetIndex);
+    rk->targetIndex = index;
+    rk->targetIndexSize = size;
+    for(size_t i = 0; i < rk->targetIdsSize; i++)
+        index[indexSlot(rk, &rk->targetIds[i].nodeId)] = i + 1;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Backward-shift deletion for linear probing */
+static void
+indexRemove(UA_NodeReferenceKind *rk, size_t slot) {
+    size_t mask = rk->targetIndexSize - 1;
+    size_t next = slot;
+    while(true) {
+        next = (next + 1) & mask;
+        size_t pos = rk->targetIndex[next];
+        if(pos == 0)
+            break;
+        size_t home = UA_NodeId_hash(&rk->targetIds[pos - 1].nodeId) & mask;
+        /* Move the entry back unless its home lies cyclically in (slot, next] */
+        if(((next - home) & mask) >= ((next - slot) & mask)) {
+            rk->targetIndex[slot] = pos;
+            slot = next;
+        }
+    }
+    rk->targetIndex[slot] = 0;
+}
+
+const UA_NodeReferenceKind *
+UA_Node_findReferenceKind(const UA_Node *node, const UA_NodeId *referenceTypeId,
+                          UA_Boolean isInverse) {
+    for(size_t i = 0; i < node->referencesSize; i++) {
+        const UA_NodeReferenceKind *rk = &node->references[i];
+        if(rk->isInverse == isInverse && UA_NodeId_equal(&rk->referenceTypeId, referenceTypeId))
+            return rk;
+    }
+    return NULL;
+}
+
+size_t
+UA_NodeReferenceKind_findTarget(const UA_NodeReferenceKind *rk, const UA_NodeId *targetId) {
+    if(rk->targetIndex) {
+        size_t pos = rk->targetIndex[indexSlot(rk, targetId)];
+        return pos > 0 ? pos - 1 : rk->targetIdsSize;
+    }
+    for(size_t i = 0; i < rk->targetIdsSize; i++) {
+        if(UA_NodeId_equal(&rk->targetIds[i].nodeId, targetId))
+            return i;
+    }
+    return rk->targetIdsSize;
+}
+
+/* Returns the kind of the reference type and direction. A missing kind is
+   added. */
+static UA_StatusCode
+getReferenceKind(UA_Node *node, const UA_NodeId *referenceTypeId, UA_Boolean isInverse,
+                 UA_InternTable *interned, UA_NodeReferenceKind **kind) {
+    *kind = (UA_NodeReferenceKind*)(uintptr_t)
+        UA_Node_findReferenceKind(node, referenceTypeId, isInverse);
+    if(*kind)
+        return UA_STATUSCODE_GOOD;
+    UA_NodeReferenceKind *refs =
+        UA_realloc(node->references, sizeof(UA_NodeReferenceKind) * (node->referencesSize + 1));
+    if(!refs)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    node->references = refs;
+    UA_NodeReferenceKind *rk = &refs[node->referencesSize];
+    memset(rk, 0, sizeof(UA_NodeReferenceKind));
+    UA_StatusCode retval = UA_NodeId_copy(referenceTypeId, &rk->referenceTypeId);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    UA_NodeId_intern(&rk->referenceTypeId, interned);
+    rk->isInverse = isInverse;
+    node->referencesSize++;
+    *kind = rk;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Returns true if the target is referenced already. Otherwise, slot is set to
+   the index slot of the new target (if the kind is indexed). */
+static UA_Boolean
+findNewTarget(const UA_NodeReferenceKind *rk, const UA_NodeId *targetId, size_t *slot) {
+    if(!rk->targetIndex)
+        return UA_NodeReferenceKind_findTarget(rk, targetId) < rk->targetIdsSize;
+    *slot = indexSlot(rk, targetId);
+    return rk->targetIndex[*slot] != 0;
+}
+
+/* Copies the target behind the last target. The caller makes room for it. */
+static UA_StatusCode
+appendTarget(UA_NodeReferenceKind *rk, const UA_ExpandedNodeId *targetId,
+             UA_InternTable *interned) {
+    UA_ExpandedNodeId *target = &rk->targetIds[rk->targetIdsSize];
+    UA_StatusCode retval = nodeIdCopyInterned(&targetId->nodeId, &target->nodeId, interned);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    retval = UA_String_copy(&targetId->namespaceUri, &target->namespaceUri);
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_NodeId_releaseInterned(&target->nodeId, interned);
+        UA_NodeId_deleteMembers(&target->nodeId);
+        return retval;
+    }
+    target->serverIndex = targetId->serverIndex;
+    rk->targetIdsSize++;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Removes the index if it cannot grow. The kind is then searched linearly. */
+static void
+indexGrow(UA_NodeReferenceKind *rk, size_t expected) {
+    if(expected < UA_REFERENCEKIND_INDEXMIN || expected * 2 <= rk->targetIndexSize)
+        return;
+    if(indexRebuild(rk, expected) != UA_STATUSCODE_GOOD) {
+        UA_free(rk->targetIndex);
+        rk->targetIndex = NULL;
+        rk->targetIndexSize = 0;
+    }
+}
+
+UA_StatusCode
+UA_Node_addReference(UA_Node *node, const UA_NodeId *referenceTypeId,
+                     const UA_ExpandedNodeId *targetId, UA_Boolean isInverse,
+                     UA_InternTable *interned) {
+    UA_NodeReferenceKind *rk;
+    UA_StatusCode retval = getReferenceKind(node, referenceTypeId, isInverse, interned, &rk);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    size_t slot = 0;
+    if(findNewTarget(rk, &targetId->nodeId, &slot))
+        return UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED;
+
+    /* Append the target */
+    size_t size = rk->targetIdsSize;
+    if(size == 0 || size == targetsCapacity(size)) {
+        UA_ExpandedNodeId *targets =
+            UA_realloc(rk->targetIds, sizeof(UA_ExpandedNodeId) * targetsCapacity(size + 1));
+        if(!targets)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        rk->targetIds = targets;
+    }
+    retval = appendTarget(rk, targetId, interned);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    /* Update the index. The probe above ended at the slot of the target. */
+    if(rk->targetIdsSize * 2 > rk->targetIndexSize)
+        indexGrow(rk, rk->targetIdsSize);
+    else
+        rk->targetIndex[slot] = rk->targetIdsSize;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_Node_deleteReference(UA_Node *node, const UA_NodeId *referenceTypeId,
+                        const UA_NodeId *targetId, UA_Boolean isInverse,
+                        UA_InternTable *interned) {
+    UA_NodeReferenceKind *rk = (UA_NodeReferenceKind*)(uintptr_t)
+        UA_Node_findReferenceKind(node, referenceTypeId, isInverse);
+    if(!rk)
+        return UA_STATUSCODE_UNCERTAINREFERENCENOTDELETED;
+    size_t pos = UA_NodeReferenceKind_findTarget(rk, targetId);
+    if(pos == rk->targetIdsSize)
+        return UA_STATUSCODE_UNCERTAINREFERENCENOTDELETED;
+
+    /* Move the last target into the gap */
+    size_t last = rk->targetIdsSize - 1;
+    if(rk->targetIndex) {
+        indexRemove(rk, indexSlot(rk, targetId));
+        if(pos != last)
+            rk->targetIndex[indexSlot(rk, &rk->targetIds[last].nodeId)] = pos + 1;
+    }
+    UA_NodeId_releaseInterned(&rk->targetIds[pos].nodeId, interned);
+    UA_ExpandedNodeId_deleteMembers(&rk->targetIds[pos]);
+    rk->targetIds[pos] = rk->targetIds[last];
+    rk->targetIdsSize--;
+    if(rk->targetIdsSize > 0)
+        return UA_STATUSCODE_GOOD;
+
+    /* Remove the empty kind */
+    UA_NodeId_releaseInterned(&rk->referenceTypeId, interned);
+    deleteReferenceKind(rk);
+    *rk = node->references[node->referencesSize - 1];
+    node->referencesSize--;
+    if(node->referencesSize == 0) {
+        UA_free(node->references);
+        node->references = NULL;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+copyReferenceKind(const UA_NodeReferenceKind *src, UA_NodeReferenceKind *dst) {
+    memset(dst, 0, sizeof(UA_NodeReferenceKind));
+    UA_StatusCode retval = UA_NodeId_copy(&src->referenceTypeId, &dst->referenceTypeId);
+    dst->isInverse = src->isInverse;
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    dst->targetIds = UA_malloc(sizeof(UA_ExpandedNodeId) * targetsCapacity(src->targetIdsSize));
+    if(!dst->targetIds)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    for(size_t i = 0; i < src->targetIdsSize; i++) {
+        retval = UA_ExpandedNodeId_copy(&src->targetIds[i], &dst->targetIds[i]);
+        if(retval != UA_STATUSCODE_GOOD)
+            return retval;
+        dst->targetIdsSize++;
+    }
+    if(dst->targetIdsSize >= UA_REFERENCEKIND_INDEXMIN)
+        retval = indexRebuild(dst, dst->targetIdsSize);
+    return retval;
+}
 
 void UA_Node_deleteMembersAnyNodeClass(UA_Node *node) {
+
     /* delete standard content */
     UA_NodeId_deleteMembers(&node->nodeId);
     UA_QualifiedName_deleteMembers(&node->browseName);
     UA_LocalizedText_deleteMembers(&node->displayName);
     UA_LocalizedText_deleteMembers(&node->description);
-    UA_Array_delete(node->references, node->referencesSize, &UA_TYPES[UA_TYPES_REFERENCENODE]);
+    for(size_t i = 0; i < node->referencesSize; i++)
+        deleteReferenceKind(&node->references[i]);
+    UA_free(node->references);
     node->references = NULL;
     node->referencesSize = 0;
 
@@ -133,13 +626,20 @@ UA_StatusCode UA_Node_copyAnyNodeClass(const UA_Node *src, UA_Node *dst) {
     	UA_Node_deleteMembersAnyNodeClass(dst);
         return retval;
     }
-	retval |= UA_Array_copy(src->references, src->referencesSize, (void**)&dst->references,
-                            &UA_TYPES[UA_TYPES_REFERENCENODE]);
-	if(retval != UA_STATUSCODE_GOOD) {
-    	UA_Node_deleteMembersAnyNodeClass(dst);
-        return retval;
+    if(src->referencesSize > 0) {
+        dst->references = UA_calloc(src->referencesSize, sizeof(UA_NodeReferenceKind));
+        if(!dst->references) {
+            UA_Node_deleteMembersAnyNodeClass(dst);
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+        dst->referencesSize = src->referencesSize;
+        for(size_t i = 0; i < src->referencesSize && retval == UA_STATUSCODE_GOOD; i++)
+            retval = copyReferenceKind(&src->references[i], &dst->references[i]);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_Node_deleteMembersAnyNodeClass(dst);
+            return retval;
+        }
     }
-    dst->referencesSize = src->referencesSize;
 
     /* copy unique content of the nodeclass */
     switch(src->nodeClass) {
@@ -174,3 +674,42 @@ UA_StatusCode UA_Node_copyAnyNodeClass(const UA_Node *src, UA_Node *dst) {
     	UA_Node_deleteMembersAnyNodeClass(dst);
     return retval;
 }
+
+/****************/
+/* NodeId Order */
+/****************/
+
+static int
+compareBytes(const UA_String *s1, const UA_String *s2) {
+    if(s1->length != s2->length)
+        return s1->length < s2->length ? -1 : 1;
+    if(s1->length == 0 || s1->data == s2->data)
+        return 0;
+    return memcmp(s1->data, s2->data, s1->length);
+}
+
+int UA_NodeId_compare(const UA_NodeId *n1, const UA_NodeId *n2) {
+    if(n1->namespaceIndex != n2->namespaceIndex)
+        return n1->namespaceIndex < n2->namespaceIndex ? -1 : 1;
+    if(n1->identifierType != n2->identifierType)
+        return n1->identifierType < n2->identifierType ? -1 : 1;
+    switch(n1->identifierType) {
+    case UA_NODEIDTYPE_NUMERIC:
+        if(n1->identifier.numeric == n2->identifier.numeric)
+            return 0;
+        return n1->identifier.numeric < n2->identifier.numeric ? -1 : 1;
+    case UA_NODEIDTYPE_GUID: {
+        const UA_Guid *g1 = &n1->identifier.guid;
+        const UA_Guid *g2 = &n2->identifier.guid;
+        if(g1->data1 != g2->data1)
+            return g1->data1 < g2->data1 ? -1 : 1;
+        if(g1->data2 != g2->data2)
+            return g1->data2 < g2->data2 ? -1 : 1;
+        if(g1->data3 != g2->data3)
+            return g1->data3 < g2->data3 ? -1 : 1;
+        return memcmp(g1->data4, g2->data4, sizeof(g1->data4));
+    }
+    default:
+        return compareBytes(&n1->identifier.string, &n2->identifier.string);
+    }
+}
@@ -11,6 +11,23 @@
  * UA_ObjectNode, and so on.
  */
 
+/*
+ * The references of a node are grouped by their reference type and direction.
+ * So a filtered browse only visits the matching targets. The targets of a kind
+ * are stored in the order they were added (removal moves the last target into
+ * the gap). Kinds with many targets are indexed by a hash table of positions
+ * for duplicate checks and removal. Kinds without index (e.g. of static nodes)
+ * are searched linearly.
+ */
+typedef struct {
+    UA_NodeId referenceTypeId;
+    UA_Boolean isInverse;
+    size_t targetIdsSize;
+    UA_ExpandedNodeId *targetIds;
+    size_t targetIndexSize; /* power of two or zero if there is no index */
+    size_t *targetIndex;    /* position in targetIds + 1, zero for empty slots */
+} UA_NodeReferenceKind;
+
 #define UA_STANDARD_NODEMEMBERS                 \
     UA_NodeId nodeId;                           \
     UA_NodeClass nodeClass;                     \
@@ -20,15 +37,72 @@
     UA_UInt32 writeMask;                        \
     UA_UInt32 userWriteMask;                    \
     size_t referencesSize;                      \
-    UA_ReferenceNode *references;
+    UA_NodeReferenceKind *references;
 
 typedef struct {
     UA_STANDARD_NODEMEMBERS
 } UA_Node;
 
+/*
+ * The single-threaded nodestores intern the string and bytestring NodeIds and
+ * the browse names of the stored nodes. Equal strings then point to a single
+ * reference-counted copy in the intern table of the nodestore. So duplicates
+ * are stored once and UA_String_equal reduces to a pointer comparison for them.
+ * Every nodestore has its own table. Nodes are interned with the table of the
+ * nodestore they are stored in.
+ *
+ * Interned strings are released before the deleteMembers functions are called
+ * on them. The release functions leave strings untouched that are not interned
+ * in the table. Interning an interned string again does nothing. With a NULL
+ * table (e.g. for the multithreaded nodestore), the functions do nothing.
+ */
+struct UA_InternTable;
+typedef struct UA_InternTable UA_InternTable;
+
+UA_InternTable * UA_InternTable_new(void);
+void UA_InternTable_delete(UA_InternTable *t);
+size_t UA_InternTable_count(const UA_InternTable *t);
+
+void UA_String_intern(UA_String *s, UA_InternTable *t);
+void UA_String_releaseInterned(UA_String *s, UA_InternTable *t);
+void UA_NodeId_intern(UA_NodeId *id, UA_InternTable *t);
+void UA_NodeId_releaseInterned(UA_NodeId *id, UA_InternTable *t);
+void UA_Node_intern(UA_Node *node, UA_InternTable *t);
+void UA_Node_releaseInterned(UA_Node *node, UA_InternTable *t);
+
 void UA_Node_deleteMembersAnyNodeClass(UA_Node *node);
 UA_StatusCode UA_Node_copyAnyNodeClass(const UA_Node *src, UA_Node *dst);
 
+/* Returns the references of the given type and direction or NULL */
+const UA_NodeReferenceKind *
+UA_Node_findReferenceKind(const UA_Node *node, const UA_NodeId *referenceTypeId,
+                          UA_Boolean isInverse);
+
+/* Returns the position of the target in targetIds or targetIdsSize if the
+   target is not found */
+size_t
+UA_NodeReferenceKind_findTarget(const UA_NodeReferenceKind *rk, const UA_NodeId *targetId);
+
+/* Returns UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED if the reference
+   exists already. The new NodeIds are interned in the table of the nodestore
+   that holds (or will hold) the node. */
+UA_StatusCode
+UA_Node_addReference(UA_Node *node, const UA_NodeId *referenceTypeId,
+                     const UA_ExpandedNodeId *targetId, UA_Boolean isInverse,
+                     UA_InternTable *interned);
+
+/* Returns UA_STATUSCODE_UNCERTAINREFERENCENOTDELETED if the reference does not
+   exist */
+UA_StatusCode
+UA_Node_deleteReference(UA_Node *node, const UA_NodeId *referenceTypeId,
+                        const UA_NodeId *targetId, UA_Boolean isInverse,
+                        UA_InternTable *interned);
+
+/* Total order of NodeIds. Returns a negative number, zero or a positive number
+ * if n1 is less than, equal to or greater than n2. Sorts by namespace,
+ * identifier type and identifier. */
+int UA_NodeId_compare(const UA_NodeId *n1, const UA_NodeId *n2);
+
 /**************/
 /* ObjectNode */
 /**************/
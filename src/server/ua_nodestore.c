@@ -1,6 +1,7 @@
 #include <stdio.h>
 
 #include "ua_nodestore.h"
+#include "ua_nodestore_hash.h"
 #include "ua_util.h"
 
 #define UA_NODESTORE_MINSIZE 64
@@ -10,14 +11,30 @@ typedef struct UA_NodeStoreEntry {
     UA_Node node;
 } UA_NodeStoreEntry;
 
+#include "ua_nodestore_slab.inc"
+#include "ua_nodestore_static.inc"
+
+static hash_t mod(hash_t h, hash_t size) { return h % size; }
+static hash_t mod2(hash_t h, hash_t size) { return 1 + (h % (size - 2)); }
+
+/* The origin of editable copies of static nodes */
+static UA_NodeStoreEntry staticOrigin;
+
 struct UA_NodeStore {
     UA_NodeStoreEntry **entries;
     UA_UInt32 size;
     UA_UInt32 count;
+    UA_UInt32 deleted; /* tombstones */
     UA_UInt32 sizePrimeIndex;
+    UA_NodeStoreStatic statics;
+    UA_NodeSlabPool slabPools[UA_NODECLASSES];
+    UA_InternTable *interned;
 };
 
-#include "ua_nodestore_hash.inc"
+/* Removed entries are replaced by a tombstone. Otherwise, the probe sequences
+   leading past the removed entry would be cut short. */
+static UA_NodeStoreEntry tombstone;
+#define ISENTRY(E) ((E) && (E) != &tombstone)
 
 /* The size of the hash-map is always a prime number. They are chosen to be
    close to the next power of 2. So the size ca. doubles with each prime. */
@@ -42,7 +59,7 @@ static UA_UInt16 higher_prime_index(hash_t n) {
     return low;
 }
 
-static UA_NodeStoreEntry * instantiateEntry(UA_NodeClass nodeClass) {
+static UA_NodeStoreEntry * instantiateEntry(UA_NodeStore *ns, UA_NodeClass nodeClass) {
     size_t size = sizeof(UA_NodeStoreEntry) - sizeof(UA_Node);
     switch(nodeClass) {
     case UA_NODECLASS_OBJECT:
@@ -72,51 +89,45 @@ static UA_NodeStoreEntry * instantiateEntry(UA_NodeClass nodeClass) {
     default:
         return NULL;
     }
-    UA_NodeStoreEntry *entry = UA_calloc(1, size);
+    UA_NodeStoreEntry *entry = slabAlloc(ns->slabPools, nodeClass, size);
     if(!entry)
         return NULL;
     entry->node.nodeClass = nodeClass;
     return entry;
 }
 
-static void deleteEntry(UA_NodeStoreEntry *entry) {
+static void deleteEntry(UA_NodeStore *ns, UA_NodeStoreEntry *entry) {
+    UA_Node_releaseInterned(&entry->node, ns->interned);
     UA_Node_deleteMembersAnyNodeClass(&entry->node);
-    UA_free(entry);
+    slabFree(entry);
 }
 
 /* Returns true if an entry was found under the nodeid. Otherwise, returns
-   false and sets slot to a pointer to the next free slot. */
+   false and sets slot to a pointer to the first free slot (empty or
+   tombstone). */
 static UA_Boolean
 containsNodeId(const UA_NodeStore *ns, const UA_NodeId *nodeid, UA_NodeStoreEntry ***entry) {
-    hash_t h = hash(nodeid);
+    hash_t h = UA_NodeId_hash(nodeid);
     UA_UInt32 size = ns->size;
     hash_t idx = mod(h, size);
-    UA_NodeStoreEntry *e = ns->entries[idx];
-
-    if(!e) {
-        *entry = &ns->entries[idx];
-        return false;
-    }
-
-    if(UA_NodeId_equal(&e->node.nodeId, nodeid)) {
-        *entry = &ns->entries[idx];
-        return true;
-    }
-
     hash_t hash2 = mod2(h, size);
+    UA_NodeStoreEntry **firstFree = NULL;
     for(;;) {
-        idx += hash2;
-        if(idx >= size)
-            idx -= size;
-        e = ns->entries[idx];
+        UA_NodeStoreEntry *e = ns->entries[idx];
         if(!e) {
-            *entry = &ns->entries[idx];
+            *entry = firstFree ? firstFree : &ns->entries[idx];
             return false;
         }
-        if(UA_NodeId_equal(&e->node.nodeId, nodeid)) {
+        if(e == &tombstone) {
+            if(!firstFree)
+                firstFree = &ns->entries[idx];
+        } else if(UA_NodeId_equal(&e->node.nodeId, nodeid)) {
             *entry = &ns->entries[idx];
             return true;
         }
+        idx += hash2;
+        if(idx >= size)
+            idx -= size;
     }
 
     /* NOTREACHED */
@@ -128,7 +139,7 @@ static UA_StatusCode expand(UA_NodeStore *ns) {
     UA_UInt32 osize = ns->size;
     UA_UInt32 count = ns->count;
     /* Resize only when table after removal of unused elements is either too full or too empty  */
-    if(count * 2 < osize && (count * 8 > osize || osize <= UA_NODESTORE_MINSIZE))
+    if((count + ns->deleted) * 2 < osize && (count * 8 > osize || osize <= UA_NODESTORE_MINSIZE))
         return UA_STATUSCODE_GOOD;
 
     UA_NodeStoreEntry **oentries = ns->entries;
@@ -140,11 +151,12 @@ static UA_StatusCode expand(UA_NodeStore *ns) {
 
     ns->entries = nentries;
     ns->size = nsize;
+    ns->deleted = 0;
     ns->sizePrimeIndex = nindex;
 
     /* recompute the position of every entry and insert the pointer */
     for(size_t i = 0, j = 0; i < osize && j < count; i++) {
-        if(!oentries[i])
+        if(!ISENTRY(oentries[i]))
             continue;
         UA_NodeStoreEntry **e;
         containsNodeId(ns, &oentries[i]->node.nodeId, &e);  /* We know this returns an empty entry here */
@@ -167,7 +179,15 @@ UA_NodeStore * UA_NodeStore_new(void) {
     ns->sizePrimeIndex = higher_prime_index(UA_NODESTORE_MINSIZE);
     ns->size = primes[ns->sizePrimeIndex];
     ns->count = 0;
+    ns->deleted = 0;
+    memset(&ns->statics, 0, sizeof(ns->statics));
+    memset(ns->slabPools, 0, sizeof(ns->slabPools));
+    if(!(ns->interned = UA_InternTable_new())) {
+        UA_free(ns);
+        return NULL;
+    }
     if(!(ns->entries = UA_calloc(ns->size, sizeof(UA_NodeStoreEntry*)))) {
+        UA_InternTable_delete(ns->interned);
         UA_free(ns);
         return NULL;
     }
@@ -178,26 +198,39 @@ void UA_NodeStore_delete(UA_NodeStore *ns) {
     UA_UInt32 size = ns->size;
     UA_NodeStoreEntry **entries = ns->entries;
     for(UA_UInt32 i = 0; i < size; i++) {
-        if(entries[i])
-            deleteEntry(entries[i]);
+        if(ISENTRY(entries[i]))
+            deleteEntry(ns, entries[i]);
     }
+    staticDelete(&ns->statics);
+    slabPoolsDelete(ns->slabPools);
+    UA_InternTable_delete(ns->interned);
     UA_free(ns->entries);
     UA_free(ns);
 }
 
-UA_Node * UA_NodeStore_newNode(UA_NodeClass class) {
-    UA_NodeStoreEntry *entry = instantiateEntry(class);
+UA_Node * UA_NodeStore_newNode(UA_NodeStore *ns, UA_NodeClass class) {
+    UA_NodeStoreEntry *entry = instantiateEntry(ns, class);
     if(!entry)
         return NULL;
     return (UA_Node*)&entry->node;
 }
 
-void UA_NodeStore_deleteNode(UA_Node *node) {
-    deleteEntry(container_of(node, UA_NodeStoreEntry, node));
+void UA_NodeStore_deleteNode(UA_NodeStore *ns, UA_Node *node) {
+    deleteEntry(ns, container_of(node, UA_NodeStoreEntry, node));
+}
+
+UA_InternTable * UA_NodeStore_internTable(UA_NodeStore *ns) {
+    return ns->interned;
+}
+
+UA_StatusCode
+UA_NodeStore_getStatistics(UA_NodeStore *ns, UA_NodeClass nodeClass,
+                           UA_NodeStoreStatistics *stats) {
+    return slabStatistics(ns->slabPools, nodeClass, stats);
 }
 
 UA_StatusCode UA_NodeStore_insert(UA_NodeStore *ns, UA_Node *node) {
-    if(ns->size * 3 <= ns->count * 4) {
+    if(ns->size * 3 <= (ns->count + ns->deleted) * 4) {
         if(expand(ns) != UA_STATUSCODE_GOOD)
             return UA_STATUSCODE_BADINTERNALERROR;
     }
@@ -215,19 +248,24 @@ UA_StatusCode UA_NodeStore_insert(UA_NodeStore *ns, UA_Node *node) {
         hash_t increase = mod2(identifier, size);
         while(true) {
             node->nodeId.identifier.numeric = identifier;
-            if(!containsNodeId(ns, &node->nodeId, &entry))
+            if(!containsNodeId(ns, &node->nodeId, &entry) &&
+               !staticGet(&ns->statics, &node->nodeId))
                 break;
             identifier += increase;
             if(identifier >= size)
                 identifier -= size;
         }
     } else {
-        if(containsNodeId(ns, &node->nodeId, &entry)) {
-            deleteEntry(container_of(node, UA_NodeStoreEntry, node));
+        if(containsNodeId(ns, &node->nodeId, &entry) ||
+           staticGet(&ns->statics, &node->nodeId)) {
+            deleteEntry(ns, container_of(node, UA_NodeStoreEntry, node));
             return UA_STATUSCODE_BADNODEIDEXISTS;
         }
     }
 
+    if(*entry == &tombstone)
+        ns->deleted--;
+    UA_Node_intern(node, ns->interned);
     *entry = container_of(node, UA_NodeStoreEntry, node);
     ns->count++;
     return UA_STATUSCODE_GOOD;
@@ -235,48 +273,108 @@ UA_StatusCode UA_NodeStore_insert(UA_NodeStore *ns, UA_Node *node) {
 
 UA_StatusCode
 UA_NodeStore_replace(UA_NodeStore *ns, UA_Node *node) {
+    UA_NodeStoreEntry *newEntry = container_of(node, UA_NodeStoreEntry, node);
+    UA_Boolean *shadowed = staticFind(&ns->statics, &node->nodeId, NULL);
+    if(shadowed) {
+        if(newEntry->orig != &staticOrigin) {
+            deleteEntry(ns, newEntry);
+            return UA_STATUSCODE_BADINTERNALERROR;
+        }
+        /* Shadow the static node and store the replacement */
+        newEntry->orig = NULL;
+        *shadowed = true;
+        UA_StatusCode retval = UA_NodeStore_insert(ns, node);
+        if(retval != UA_STATUSCODE_GOOD)
+            *shadowed = false;
+        return retval;
+    }
+
     UA_NodeStoreEntry **entry;
-    if(!containsNodeId(ns, &node->nodeId, &entry))
+    if(!containsNodeId(ns, &node->nodeId, &entry)) {
+        deleteEntry(ns, newEntry);
         return UA_STATUSCODE_BADNODEIDUNKNOWN;
-    UA_NodeStoreEntry *newEntry = container_of(node, UA_NodeStoreEntry, node);
+    }
     if(*entry != newEntry->orig) {
-        deleteEntry(newEntry);
+        deleteEntry(ns, newEntry);
         return UA_STATUSCODE_BADINTERNALERROR; // the node was replaced since the copy was made
     }
-    deleteEntry(*entry);
+    UA_Node_intern(node, ns->interned);
+    deleteEntry(ns, *entry);
     *entry = newEntry;
     return UA_STATUSCODE_GOOD;
 }
 
+/* A NodeId is either stored in the hash-map or visible in a static layer. The
+   static layers are searched only after a miss. */
 const UA_Node * UA_NodeStore_get(UA_NodeStore *ns, const UA_NodeId *nodeid) {
     UA_NodeStoreEntry **entry;
-    if(!containsNodeId(ns, nodeid, &entry))
-        return NULL;
-    return (const UA_Node*)&(*entry)->node;
+    if(containsNodeId(ns, nodeid, &entry))
+        return (const UA_Node*)&(*entry)->node;
+    return staticGet(&ns->statics, nodeid);
 }
 
 UA_Node * UA_NodeStore_getCopy(UA_NodeStore *ns, const UA_NodeId *nodeid) {
+    UA_NodeStoreEntry *entry = &staticOrigin;
+    const UA_Node *node;
     UA_NodeStoreEntry **slot;
-    if(!containsNodeId(ns, nodeid, &slot))
-        return NULL;
-    UA_NodeStoreEntry *entry = *slot;
-    UA_NodeStoreEntry *new = instantiateEntry(entry->node.nodeClass);
+    if(containsNodeId(ns, nodeid, &slot)) {
+        entry = *slot;
+        node = &entry->node;
+    } else {
+        node = staticGet(&ns->statics, nodeid);
+        if(!node)
+            return NULL;
+    }
+    UA_NodeStoreEntry *new = instantiateEntry(ns, node->nodeClass);
     if(!new)
         return NULL;
-    if(UA_Node_copyAnyNodeClass(&entry->node, &new->node) != UA_STATUSCODE_GOOD) {
-        deleteEntry(new);
+    if(UA_Node_copyAnyNodeClass(node, &new->node) != UA_STATUSCODE_GOOD) {
+        deleteEntry(ns, new);
         return NULL;
     }
     new->orig = entry;
     return &new->node;
 }
 
+UA_StatusCode
+UA_NodeStore_linkStatic(UA_NodeStore *ns, const UA_Node * const *nodes, size_t nodesSize,
+                        UA_NodeStore_resolveStatic resolve, UA_NodeStore_releaseStatic release,
+                        void *handle) {
+    UA_StatusCode retval = staticLink(&ns->statics, nodes, nodesSize, resolve, release, handle);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    /* Remove the nodes that are replaced by the new layer */
+    const UA_NodeStoreStaticLayer *l = &ns->statics.layers[ns->statics.layersSize - 1];
+    for(UA_UInt32 i = 0; i < ns->size; i++) {
+        UA_NodeStoreEntry *entry = ns->entries[i];
+        if(!ISENTRY(entry) || staticIndex(l, &entry->node.nodeId) == l->nodesSize)
+            continue;
+        deleteEntry(ns, entry);
+        ns->entries[i] = &tombstone;
+        ns->deleted++;
+        ns->count--;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_Boolean UA_NodeStore_isStatic(UA_NodeStore *ns, const UA_Node *node) {
+    return staticContains(&ns->statics, node);
+}
+
 UA_StatusCode UA_NodeStore_remove(UA_NodeStore *ns, const UA_NodeId *nodeid) {
+    UA_Boolean *shadowed = staticFind(&ns->statics, nodeid, NULL);
+    if(shadowed) {
+        *shadowed = true;
+        return UA_STATUSCODE_GOOD;
+    }
+
     UA_NodeStoreEntry **slot;
     if(!containsNodeId(ns, nodeid, &slot))
         return UA_STATUSCODE_BADNODEIDUNKNOWN;
-    deleteEntry(*slot);
-    *slot = NULL;
+    deleteEntry(ns, *slot);
+    *slot = &tombstone;
+    ns->deleted++;
     ns->count--;
     /* Downsize the hashmap if it is very empty */
     if(ns->count * 8 < ns->size && ns->size > 32)
@@ -284,9 +382,25 @@ UA_StatusCode UA_NodeStore_remove(UA_NodeStore *ns, const UA_NodeId *nodeid) {
     return UA_STATUSCODE_GOOD;
 }
 
-void UA_NodeStore_iterate(UA_NodeStore *ns, UA_NodeStore_nodeVisitor visitor) {
-    for(UA_UInt32 i = 0; i < ns->size; i++) {
-        if(ns->entries[i])
-            visitor((UA_Node*)&ns->entries[i]->node);
+void UA_NodeStore_iterate(UA_NodeStore *ns, UA_NodeStore_nodeVisitor visitor, void *context) {
+    UA_NodeStore_iteratePartition(ns, 0, 1, visitor, context);
+}
+
+void UA_NodeStore_iteratePartition(UA_NodeStore *ns, size_t partition, size_t partitions,
+                                   UA_NodeStore_nodeVisitor visitor, void *context) {
+    if(partition >= partitions)
+        return;
+    staticIterate(&ns->statics, partition, partitions, visitor, context);
+    size_t begin, end;
+    partitionRange(ns->size, partition, partitions, &begin, &end);
+    for(size_t i = begin; i < end; i++) {
+        if(ISENTRY(ns->entries[i]))
+            visitor(context, (UA_Node*)&ns->entries[i]->node);
     }
 }
+
+void UA_NodeStore_iterateParallel(UA_NodeStore *ns, size_t partitions,
+                                  UA_NodeStore_nodeVisitor visitor, void **contexts) {
+    for(size_t i = 0; i < partitions; i++)
+        UA_NodeStore_iteratePartition(ns, i, partitions, visitor, contexts[i]);
+}
@@ -33,20 +33,27 @@ void UA_NodeStore_delete(UA_NodeStore *ns);
  * The following definitions are used to create empty nodes of the different
  * node types. The memory is managed by the nodestore. Therefore, the node has
  * to be removed via a special deleteNode function. (If the new node is not
- * added to the nodestore.) */
+ * added to the nodestore.) A node is inserted into the nodestore that created
+ * it. Editable nodes have to be inserted or deleted before the nodestore is
+ * deleted. */
 /* Create an editable node of the given NodeClass. */
-UA_Node * UA_NodeStore_newNode(UA_NodeClass nodeClass);
-#define UA_NodeStore_newObjectNode() (UA_ObjectNode*)UA_NodeStore_newNode(UA_NODECLASS_OBJECT)
-#define UA_NodeStore_newVariableNode() (UA_VariableNode*)UA_NodeStore_newNode(UA_NODECLASS_VARIABLE)
-#define UA_NodeStore_newMethodNode() (UA_MethodNode*)UA_NodeStore_newNode(UA_NODECLASS_METHOD)
-#define UA_NodeStore_newObjectTypeNode() (UA_ObjectTypeNode*)UA_NodeStore_newNode(UA_NODECLASS_OBJECTTYPE)
-#define UA_NodeStore_newVariableTypeNode() (UA_VariableTypeNode*)UA_NodeStore_newNode(UA_NODECLASS_VARIABLETYPE)
-#define UA_NodeStore_newReferenceTypeNode() (UA_ReferenceTypeNode*)UA_NodeStore_newNode(UA_NODECLASS_REFERENCETYPE)
-#define UA_NodeStore_newDataTypeNode() (UA_DataTypeNode*)UA_NodeStore_newNode(UA_NODECLASS_DATATYPE)
-#define UA_NodeStore_newViewNode() (UA_ViewNode*)UA_NodeStore_newNode(UA_NODECLASS_VIEW)
-
-/* Delete an editable node. */
-void UA_NodeStore_deleteNode(UA_Node *node);
+UA_Node * UA_NodeStore_newNode(UA_NodeStore *ns, UA_NodeClass nodeClass);
+#define UA_NodeStore_newObjectNode(ns) (UA_ObjectNode*)UA_NodeStore_newNode(ns, UA_NODECLASS_OBJECT)
+#define UA_NodeStore_newVariableNode(ns) (UA_VariableNode*)UA_NodeStore_newNode(ns, UA_NODECLASS_VARIABLE)
+#define UA_NodeStore_newMethodNode(ns) (UA_MethodNode*)UA_NodeStore_newNode(ns, UA_NODECLASS_METHOD)
+#define UA_NodeStore_newObjectTypeNode(ns) (UA_ObjectTypeNode*)UA_NodeStore_newNode(ns, UA_NODECLASS_OBJECTTYPE)
+#define UA_NodeStore_newVariableTypeNode(ns) (UA_VariableTypeNode*)UA_NodeStore_newNode(ns, UA_NODECLASS_VARIABLETYPE)
+#define UA_NodeStore_newReferenceTypeNode(ns) (UA_ReferenceTypeNode*)UA_NodeStore_newNode(ns, UA_NODECLASS_REFERENCETYPE)
+#define UA_NodeStore_newDataTypeNode(ns) (UA_DataTypeNode*)UA_NodeStore_newNode(ns, UA_NODECLASS_DATATYPE)
+#define UA_NodeStore_newViewNode(ns) (UA_ViewNode*)UA_NodeStore_newNode(ns, UA_NODECLASS_VIEW)
+
+/* Delete an editable node of the nodestore. */
+void UA_NodeStore_deleteNode(UA_NodeStore *ns, UA_Node *node);
+
+/* The intern table for the strings of the nodes in the nodestore. Strings that
+   are added to stored nodes in place are interned with it. Returns NULL for the
+   multithreaded nodestore. */
+UA_InternTable * UA_NodeStore_internTable(UA_NodeStore *ns);
 
 /**
  * Insert / Get / Replace / Remove
@@ -73,13 +80,94 @@ UA_StatusCode UA_NodeStore_replace(UA_NodeStore *ns, UA_Node *node);
 /* Remove a node in the nodestore. */
 UA_StatusCode UA_NodeStore_remove(UA_NodeStore *ns, const UA_NodeId *nodeid);
 
+/**
+ * Static Nodes
+ * ------------
+ * Static nodes are read-only nodes that are generated at build time (e.g.
+ * namespace zero) or mapped from a snapshot. They are linked into the nodestore
+ * without copying and can be shared between nodestores. The nodes must be
+ * sorted with UA_NodeId_compare. Nodes with the same NodeId that are already
+ * in the nodestore are replaced. A static node can be replaced and removed as
+ * usual; the nodestore then stores the modified node on top of it.
+ *
+ * The resolve callback (if not NULL) is called with the handle and a node
+ * before the node is handed out for the first time. It completes the parts of
+ * the node that depend on the process (e.g. the datatype pointers of a mapped
+ * snapshot). The release callback (if not NULL) is called with the handle when
+ * the nodestore is deleted. Until then, the nodes must not be freed. The
+ * multithreaded nodestore resolves and inserts copies of the nodes and releases
+ * them right away. */
+typedef void (*UA_NodeStore_resolveStatic)(void *handle, const UA_Node *node);
+typedef void (*UA_NodeStore_releaseStatic)(void *handle);
+
+UA_StatusCode
+UA_NodeStore_linkStatic(UA_NodeStore *ns, const UA_Node * const *nodes, size_t nodesSize,
+                        UA_NodeStore_resolveStatic resolve, UA_NodeStore_releaseStatic release,
+                        void *handle);
+
+/* Returns true if the node is a linked static node. Static nodes must not be
+   edited in place. */
+UA_Boolean UA_NodeStore_isStatic(UA_NodeStore *ns, const UA_Node *node);
+
+/**
+ * Memory Statistics
+ * -----------------
+ * The single-threaded nodestores allocate the nodes from slabs per NodeClass.
+ * Every nodestore has its own slabs. */
+typedef struct {
+    size_t nodes;    /* Nodes in use (including editable nodes that are not
+                        inserted) */
+    size_t capacity; /* Nodes that fit into the allocated slabs */
+    size_t slabs;    /* Number of slabs */
+    size_t bytes;    /* Memory allocated for the slabs */
+} UA_NodeStoreStatistics;
+
+/* Returns UA_STATUSCODE_BADNOTSUPPORTED for the multithreaded nodestore. */
+UA_StatusCode
+UA_NodeStore_getStatistics(UA_NodeStore *ns, UA_NodeClass nodeClass,
+                           UA_NodeStoreStatistics *stats);
+
 /**
  * Iteration
  * ---------
  * The following definitions are used to call a callback for every node in the
- * nodestore. */
-typedef void (*UA_NodeStore_nodeVisitor)(const UA_Node *node);
-void UA_NodeStore_iterate(UA_NodeStore *ns, UA_NodeStore_nodeVisitor visitor);
+ * nodestore. The visitor gets the context pointer and must not modify the
+ * nodestore.
+ *
+ * The nodes can be split into disjoint partitions. Together, the partitions
+ * 0 to partitions-1 visit every node once. Nothing is visited for a partition
+ * index that is not below partitions (and for zero partitions). iterateParallel visits every
+ * partition with its own context, e.g. an accumulator that is merged after the
+ * call returns. With multithreading, the partitions are visited in separate
+ * threads and the calling thread has to hold the RCU read lock. Otherwise, they
+ * are visited one after the other. */
+typedef void (*UA_NodeStore_nodeVisitor)(void *context, const UA_Node *node);
+
+void UA_NodeStore_iterate(UA_NodeStore *ns, UA_NodeStore_nodeVisitor visitor, void *context);
+
+void UA_NodeStore_iteratePartition(UA_NodeStore *ns, size_t partition, size_t partitions,
+                                   UA_NodeStore_nodeVisitor visitor, void *context);
+
+/* contexts is an array with one context per partition */
+void UA_NodeStore_iterateParallel(UA_NodeStore *ns, size_t partitions,
+                                  UA_NodeStore_nodeVisitor visitor, void **contexts);
+
+#ifdef UA_ENABLE_NODESTORE_SNAPSHOT
+/**
+ * Snapshots
+ * ---------
+ * A snapshot is a relocatable binary image of all nodes in the nodestore and
+ * the namespace array. It is mapped and linked as static nodes. Callbacks,
+ * handles and data sources are not stored. Nodes that are bound to callbacks,
+ * handles or data sources and are already in the nodestore are kept when a
+ * snapshot is loaded. The namespace array has to agree with the stored array on
+ * the common prefix. The namespaces that are only in the snapshot are appended
+ * to the array. */
+UA_StatusCode UA_NodeStore_writeSnapshot(UA_NodeStore *ns, const char *path,
+                                         const UA_String *namespaces, size_t namespacesSize);
+UA_StatusCode UA_NodeStore_loadSnapshot(UA_NodeStore *ns, const char *path,
+                                        UA_String **namespaces, size_t *namespacesSize);
+#endif
 
 #ifdef __cplusplus
 } // extern "C"
@@ -1,5 +1,7 @@
+#include <pthread.h>
 #include "ua_util.h"
 #include "ua_nodestore.h"
+#include "ua_nodestore_hash.h"
 
 struct nodeEntry {
     struct cds_lfht_node htn; ///< Contains the next-ptr for urcu-hashmap
@@ -8,8 +10,6 @@ struct nodeEntry {
     UA_Node node; ///< Might be cast from any _bigger_ UA_Node* type. Allocate enough memory!
 };
 
-#include "ua_nodestore_hash.inc"
-
 static struct nodeEntry * instantiateEntry(UA_NodeClass class) {
     size_t size = sizeof(struct nodeEntry) - sizeof(UA_Node);
     switch(class) {
@@ -84,18 +84,23 @@ void UA_NodeStore_delete(UA_NodeStore *ns) {
     UA_free(ns);
 }
 
-UA_Node * UA_NodeStore_newNode(UA_NodeClass class) {
+UA_Node * UA_NodeStore_newNode(UA_NodeStore *ns, UA_NodeClass class) {
     struct nodeEntry *entry = instantiateEntry(class);
     if(!entry)
         return NULL;
     return (UA_Node*)&entry->node;
 }
 
-void UA_NodeStore_deleteNode(UA_Node *node) {
+void UA_NodeStore_deleteNode(UA_NodeStore *ns, UA_Node *node) {
     struct nodeEntry *entry = container_of(node, struct nodeEntry, node);
     deleteEntry(&entry->rcu_head);
 }
 
+/* Readers access the nodes without a lock. So the strings are not interned. */
+UA_InternTable * UA_NodeStore_internTable(UA_NodeStore *ns) {
+    return NULL;
+}
+
 UA_StatusCode UA_NodeStore_insert(UA_NodeStore *ns, UA_Node *node) {
     UA_ASSERT_RCU_LOCKED();
     struct nodeEntry *entry = container_of(node, struct nodeEntry, node);
@@ -107,7 +112,7 @@ UA_StatusCode UA_NodeStore_insert(UA_NodeStore *ns, UA_Node *node) {
     tempNodeid = node->nodeId;
     tempNodeid.namespaceIndex = 0;
     if(!UA_NodeId_isNull(&tempNodeid)) {
-        hash_t h = hash(&node->nodeId);
+        hash_t h = UA_NodeId_hash(&node->nodeId);
         result = cds_lfht_add_unique(ht, h, compare, &node->nodeId, &entry->htn);
         /* If the nodeid exists already */
         if(result != &entry->htn) {
@@ -127,7 +132,7 @@ UA_StatusCode UA_NodeStore_insert(UA_NodeStore *ns, UA_Node *node) {
 
         node->nodeId.identifier.numeric = (UA_UInt32)identifier;
         while(true) {
-            hash_t h = hash(&node->nodeId);
+            hash_t h = UA_NodeId_hash(&node->nodeId);
             result = cds_lfht_add_unique(ht, h, compare, &node->nodeId, &entry->htn);
             if(result == &entry->htn)
                 break;
@@ -143,7 +148,7 @@ UA_StatusCode UA_NodeStore_replace(UA_NodeStore *ns, UA_Node *node) {
     struct cds_lfht *ht = (struct cds_lfht*)ns;
 
     /* Get the current version */
-    hash_t h = hash(&node->nodeId);
+    hash_t h = UA_NodeId_hash(&node->nodeId);
     struct cds_lfht_iter iter;
     cds_lfht_lookup(ht, h, compare, &node->nodeId, &iter);
     if(!iter.node)
@@ -169,7 +174,7 @@ UA_StatusCode UA_NodeStore_replace(UA_NodeStore *ns, UA_Node *node) {
 UA_StatusCode UA_NodeStore_remove(UA_NodeStore *ns, const UA_NodeId *nodeid) {
     UA_ASSERT_RCU_LOCKED();
     struct cds_lfht *ht = (struct cds_lfht*)ns;
-    hash_t h = hash(nodeid);
+    hash_t h = UA_NodeId_hash(nodeid);
     struct cds_lfht_iter iter;
     cds_lfht_lookup(ht, h, compare, nodeid, &iter);
     if(!iter.node || cds_lfht_del(ht, iter.node) != 0)
@@ -182,7 +187,7 @@ UA_StatusCode UA_NodeStore_remove(UA_NodeStore *ns, const UA_NodeId *nodeid) {
 const UA_Node * UA_NodeStore_get(UA_NodeStore *ns, const UA_NodeId *nodeid) {
     UA_ASSERT_RCU_LOCKED();
     struct cds_lfht *ht = (struct cds_lfht*)ns;
-    hash_t h = hash(nodeid);
+    hash_t h = UA_NodeId_hash(nodeid);
     struct cds_lfht_iter iter;
     cds_lfht_lookup(ht, h, compare, nodeid, &iter);
     struct nodeEntry *found_entry = (struct nodeEntry*)iter.node;
@@ -194,7 +199,7 @@ const UA_Node * UA_NodeStore_get(UA_NodeStore *ns, const UA_NodeId *nodeid) {
 UA_Node * UA_NodeStore_getCopy(UA_NodeStore *ns, const UA_NodeId *nodeid) {
     UA_ASSERT_RCU_LOCKED();
     struct cds_lfht *ht = (struct cds_lfht*)ns;
-    hash_t h = hash(nodeid);
+    hash_t h = UA_NodeId_hash(nodeid);
     struct cds_lfht_iter iter;
     cds_lfht_lookup(ht, h, compare, nodeid, &iter);
     struct nodeEntry *entry = (struct nodeEntry*)iter.node;
@@ -211,14 +216,147 @@ UA_Node * UA_NodeStore_getCopy(UA_NodeStore *ns, const UA_NodeId *nodeid) {
     return &new->node;
 }
 
-void UA_NodeStore_iterate(UA_NodeStore *ns, UA_NodeStore_nodeVisitor visitor) {
+/* Nodes are replaced concurrently. So the static nodes are inserted as copies. */
+UA_StatusCode
+UA_NodeStore_linkStatic(UA_NodeStore *ns, const UA_Node * const *nodes, size_t nodesSize,
+                        UA_NodeStore_resolveStatic resolve, UA_NodeStore_releaseStatic release,
+                        void *handle) {
     UA_ASSERT_RCU_LOCKED();
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    for(size_t i = 0; i < nodesSize && retval == UA_STATUSCODE_GOOD; i++) {
+        if(resolve)
+            resolve(handle, nodes[i]);
+        UA_Node *node = UA_NodeStore_newNode(ns, nodes[i]->nodeClass);
+        if(!node) {
+            retval = UA_STATUSCODE_BADOUTOFMEMORY;
+            break;
+        }
+        retval = UA_Node_copyAnyNodeClass(nodes[i], node);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_NodeStore_deleteNode(ns, node);
+            break;
+        }
+        UA_NodeStore_remove(ns, &node->nodeId);
+        retval = UA_NodeStore_insert(ns, node);
+    }
+    if(retval == UA_STATUSCODE_GOOD && release)
+        release(handle);
+    return retval;
+}
+
+UA_Boolean UA_NodeStore_isStatic(UA_NodeStore *ns, const UA_Node *node) {
+    return false;
+}
+
+void UA_NodeStore_iterate(UA_NodeStore *ns, UA_NodeStore_nodeVisitor visitor, void *context) {
+    UA_NodeStore_iteratePartition(ns, 0, 1, visitor, context);
+}
+
+/* The hash-map cannot be split up by bucket. The partitions are index ranges
+   in the order of iteration. The entries are counted first and the walk stops
+   at the end of the range. */
+void UA_NodeStore_iteratePartition(UA_NodeStore *ns, size_t partition, size_t partitions,
+                                   UA_NodeStore_nodeVisitor visitor, void *context) {
+    UA_ASSERT_RCU_LOCKED();
+    if(partition >= partitions)
+        return;
     struct cds_lfht *ht = (struct cds_lfht*)ns;
     struct cds_lfht_iter iter;
-    cds_lfht_first(ht, &iter);
-    while(iter.node != NULL) {
-        struct nodeEntry *found_entry = (struct nodeEntry*)iter.node;
-        visitor(&found_entry->node);
-        cds_lfht_next(ht, &iter);
+    size_t begin = 0, end = (size_t)-1;
+    if(partitions > 1) {
+        size_t size = 0;
+        for(cds_lfht_first(ht, &iter); iter.node != NULL; cds_lfht_next(ht, &iter))
+            size++;
+        begin = size * partition / partitions;
+        end = size * (partition + 1) / partitions;
     }
+    size_t i = 0;
+    for(cds_lfht_first(ht, &iter); iter.node != NULL && i < end; cds_lfht_next(ht, &iter)) {
+        if(i >= begin)
+            visitor(context, &((struct nodeEntry*)iter.node)->node);
+        i++;
+    }
+}
+
+typedef struct {
+    const UA_Node **nodes;
+    size_t begin;
+    size_t end;
+    UA_NodeStore_nodeVisitor visitor;
+    void *context;
+    pthread_t thread;
+    UA_Boolean started;
+} UA_NodeStoreIteration;
+
+static void
+iterateRange(UA_NodeStoreIteration *it) {
+    for(size_t i = it->begin; i < it->end; i++)
+        it->visitor(it->context, it->nodes[i]);
+}
+
+static void *
+iterateThread(void *data) {
+    UA_NodeStoreIteration *it = data;
+    rcu_register_thread();
+    rcu_read_lock();
+    iterateRange(it);
+    rcu_read_unlock();
+    rcu_unregister_thread();
+    return NULL;
+}
+
+/* The nodes are collected in a single walk. They stay valid while the calling
+   thread holds the RCU read lock. The threads visit index ranges. */
+void UA_NodeStore_iterateParallel(UA_NodeStore *ns, size_t partitions,
+                                  UA_NodeStore_nodeVisitor visitor, void **contexts) {
+    UA_ASSERT_RCU_LOCKED();
+    if(partitions == 0)
+        return;
+    struct cds_lfht *ht = (struct cds_lfht*)ns;
+    struct cds_lfht_iter iter;
+    size_t size = 0;
+    for(cds_lfht_first(ht, &iter); iter.node != NULL; cds_lfht_next(ht, &iter))
+        size++;
+    const UA_Node **nodes = UA_malloc(sizeof(UA_Node*) * (size + 1));
+    UA_NodeStoreIteration *its = UA_calloc(partitions, sizeof(UA_NodeStoreIteration));
+    if(!nodes || !its) {
+        UA_free(nodes);
+        UA_free(its);
+        for(size_t i = 0; i < partitions; i++)
+            UA_NodeStore_iteratePartition(ns, i, partitions, visitor, contexts[i]);
+        return;
+    }
+    /* Nodes that were inserted after counting are not visited */
+    size_t collected = 0;
+    for(cds_lfht_first(ht, &iter); iter.node != NULL && collected < size;
+        cds_lfht_next(ht, &iter))
+        nodes[collected++] = &((struct nodeEntry*)iter.node)->node;
+
+    for(size_t i = 0; i < partitions; i++) {
+        its[i].nodes = nodes;
+        its[i].begin = collected * i / partitions;
+        its[i].end = collected * (i + 1) / partitions;
+        its[i].visitor = visitor;
+        its[i].context = contexts[i];
+        if(i > 0)
+            its[i].started = (pthread_create(&its[i].thread, NULL, iterateThread, &its[i]) == 0);
+    }
+
+    /* The calling thread takes the first partition and those that could not be
+       started in a thread */
+    iterateRange(&its[0]);
+    for(size_t i = 1; i < partitions; i++) {
+        if(its[i].started)
+            pthread_join(its[i].thread, NULL);
+        else
+            iterateRange(&its[i]);
+    }
+    UA_free(its);
+    UA_free(nodes);
+}
+
+UA_StatusCode
+UA_NodeStore_getStatistics(UA_NodeStore *ns, UA_NodeClass nodeClass,
+                           UA_NodeStoreStatistics *stats) {
+    return UA_STATUSCODE_BADNOTSUPPORTED;
 }
@@ -1,7 +1,5 @@
-typedef UA_UInt32 hash_t;
-
-static hash_t mod(hash_t h, hash_t size) { return h % size; }
-static hash_t mod2(hash_t h, hash_t size) { return 1 + (h % (size - 2)); }
+#include "ua_nodestore_hash.h"
+#include "ua_util.h"
 
 /* Based on Murmur-Hash 3 by Austin Appleby (public domain, freely usable) */
 static hash_t hash_array(const UA_Byte *data, UA_UInt32 len, UA_UInt32 seed) {
@@ -40,8 +38,10 @@ static hash_t hash_array(const UA_Byte *data, UA_UInt32 len, UA_UInt32 seed) {
     switch(len & 3) {
     case 3:
         k1 ^= (uint32_t)(tail[2] << 16);
+        /* fallthrough */
     case 2:
         k1 ^= (uint32_t)(tail[1] << 8);
+        /* fallthrough */
     case 1:
         k1   ^= tail[0];
         k1   *= c1;
@@ -59,7 +59,7 @@ static hash_t hash_array(const UA_Byte *data, UA_UInt32 len, UA_UInt32 seed) {
     return hash;
 }
 
-static hash_t hash(const UA_NodeId *n) {
+hash_t UA_NodeId_hash(const UA_NodeId *n) {
     switch(n->identifierType) {
     case UA_NODEIDTYPE_NUMERIC:
         /*  Knuth's multiplicative hashing */
@@ -0,0 +1,12 @@
+#ifndef UA_NODESTORE_HASH_H_
+#define UA_NODESTORE_HASH_H_
+
+#include "ua_types.h"
+
+typedef UA_UInt32 hash_t;
+
+/* Hash of the NodeId for the hash-maps of the server. Equal NodeIds have the
+   same hash. */
+hash_t UA_NodeId_hash(const UA_NodeId *n);
+
+#endif /* UA_NODESTORE_HASH_H_ */
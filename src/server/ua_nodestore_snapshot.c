@@ -0,0 +1,1211 @@
+#include "ua_nodestore.h"
+#include "ua_util.h"
+#include <stdio.h>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+/**
+ * Nodestore Snapshot
+ * ==================
+ * A snapshot is a binary image of the nodes with their references and strings.
+ * The image is mapped at startup and linked into the nodestore as a layer of
+ * static nodes. Modified nodes are copied into the nodestore on write (see
+ * UA_NodeStore_linkStatic).
+ *
+ * The pointers in the image are prelinked for a preferred base address. If the
+ * image is mapped elsewhere, the loader adds the difference to every pointer in
+ * the base relocation table. Otherwise, the pages stay untouched and are shared
+ * with the file cache. The pointers to the datatypes of variants and extension
+ * objects are stored as the index in UA_TYPES (plus one, zero is NULL). They
+ * are resolved when a node is accessed for the first time. Callbacks and
+ * handles are not stored. The namespace array of the server is stored with the
+ * nodes, as the NodeIds refer to it.
+ *
+ * Every record is validated before the nodes are linked. Pointers have to be
+ * in the base relocation table and point into the image, datatype indices have
+ * to be in the type relocation table. */
+
+#define SNAPSHOT_MAGIC 0x504E5355 /* "USNP" */
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_ALIGN 8
+#define SNAPSHOT_MAXDEPTH 100 /* nesting of variants, extension objects, ... */
+
+#if UINTPTR_MAX > 0xffffffff
+# define SNAPSHOT_BASE ((uintptr_t)0x300000000000)
+#else
+# define SNAPSHOT_BASE ((uintptr_t)0x60000000)
+#endif
+
+typedef struct {
+    UA_UInt32 magic;
+    UA_UInt32 version;
+    UA_UInt32 layout;
+    UA_UInt32 padding;
+    UA_UInt64 base;
+    UA_UInt64 size;
+    UA_UInt64 nodesOffset; /* array of node pointers */
+    UA_UInt64 nodesSize;
+    UA_UInt64 baseRelocsOffset; /* array of UA_UInt64 offsets */
+    UA_UInt64 baseRelocsSize;
+    UA_UInt64 typeRelocsOffset; /* array of UA_UInt64 offsets */
+    UA_UInt64 typeRelocsSize;
+    UA_UInt64 namespacesOffset; /* array of UA_String */
+    UA_UInt64 namespacesSize;
+} SnapshotHeader;
+
+/* Fingerprint of the memory layout. Images are only loaded by a build with the
+   same layout. */
+static UA_UInt32 snapshotLayout(void) {
+    const size_t sizes[] = {sizeof(void*), sizeof(size_t), sizeof(UA_NodeId),
+                            sizeof(UA_Variant), sizeof(UA_ObjectNode),
+                            sizeof(UA_ObjectTypeNode), sizeof(UA_VariableNode),
+                            sizeof(UA_VariableTypeNode), sizeof(UA_ReferenceTypeNode),
+                            sizeof(UA_MethodNode), sizeof(UA_ViewNode),
+                            sizeof(UA_DataTypeNode), UA_TYPES_COUNT};
+    UA_UInt32 h = 2166136261u;
+    for(size_t i = 0; i < sizeof(sizes) / sizeof(size_t); i++) {
+        h ^= (UA_UInt32)sizes[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static size_t nodeSize(UA_NodeClass nodeClass) {
+    switch(nodeClass) {
+    case UA_NODECLASS_OBJECT: return sizeof(UA_ObjectNode);
+    case UA_NODECLASS_VARIABLE: return sizeof(UA_VariableNode);
+    case UA_NODECLASS_METHOD: return sizeof(UA_MethodNode);
+    case UA_NODECLASS_OBJECTTYPE: return sizeof(UA_ObjectTypeNode);
+    case UA_NODECLASS_VARIABLETYPE: return sizeof(UA_VariableTypeNode);
+    case UA_NODECLASS_REFERENCETYPE: return sizeof(UA_ReferenceTypeNode);
+    case UA_NODECLASS_DATATYPE: return sizeof(UA_DataTypeNode);
+    case UA_NODECLASS_VIEW: return sizeof(UA_ViewNode);
+    default: return 0;
+    }
+}
+
+/**********/
+/* Writer */
+/**********/
+
+typedef struct {
+    UA_Byte *data;
+    size_t size;
+    size_t capacity;
+    UA_UInt64 *baseRelocs;
+    size_t baseRelocsSize;
+    size_t baseRelocsCapacity;
+    UA_UInt64 *typeRelocs;
+    size_t typeRelocsSize;
+    size_t typeRelocsCapacity;
+    UA_StatusCode retval;
+} SnapshotWriter;
+
+/* Returns the offset of zeroed and aligned memory in the image */
+static size_t
+writerAlloc(SnapshotWriter *w, size_t size) {
+    size_t offset = (w->size + SNAPSHOT_ALIGN - 1) & ~(size_t)(SNAPSHOT_ALIGN - 1);
+    if(offset + size > w->capacity) {
+        size_t capacity = w->capacity > 0 ? w->capacity : 4096;
+        while(offset + size > capacity)
+            capacity *= 2;
+        UA_Byte *data = UA_realloc(w->data, capacity);
+        if(!data) {
+            w->retval = UA_STATUSCODE_BADOUTOFMEMORY;
+            return 0;
+        }
+        w->data = data;
+        w->capacity = capacity;
+    }
+    memset(&w->data[w->size], 0, offset + size - w->size);
+    w->size = offset + size;
+    return offset;
+}
+
+static void
+writerReloc(SnapshotWriter *w, UA_UInt64 **relocs, size_t *relocsSize,
+            size_t *capacity, size_t offset) {
+    if(*relocsSize == *capacity) {
+        size_t newCapacity = *capacity > 0 ? *capacity * 2 : 256;
+        UA_UInt64 *newRelocs = UA_realloc(*relocs, newCapacity * sizeof(UA_UInt64));
+        if(!newRelocs) {
+            w->retval = UA_STATUSCODE_BADOUTOFMEMORY;
+            return;
+        }
+        *relocs = newRelocs;
+        *capacity = newCapacity;
+    }
+    (*relocs)[*relocsSize] = offset;
+    (*relocsSize)++;
+}
+
+/* Sets the pointer at offset to the target offset in the image */
+static void
+writePointer(SnapshotWriter *w, size_t offset, size_t target) {
+    uintptr_t p = SNAPSHOT_BASE + target;
+    memcpy(&w->data[offset], &p, sizeof(uintptr_t));
+    writerReloc(w, &w->baseRelocs, &w->baseRelocsSize, &w->baseRelocsCapacity, offset);
+}
+
+/* Replaces the datatype pointer at offset with its index in UA_TYPES plus one */
+static void
+writeType(SnapshotWriter *w, size_t offset, const UA_DataType *type) {
+    if(!type || type < UA_TYPES || type >= &UA_TYPES[UA_TYPES_COUNT]) {
+        w->retval = UA_STATUSCODE_BADNOTSUPPORTED;
+        return;
+    }
+    uintptr_t index = (uintptr_t)type->typeIndex + 1;
+    memcpy(&w->data[offset], &index, sizeof(uintptr_t));
+    writerReloc(w, &w->typeRelocs, &w->typeRelocsSize, &w->typeRelocsCapacity, offset);
+}
+
+static void
+writeValue(SnapshotWriter *w, const void *src, size_t offset, const UA_DataType *type);
+
+/* Writes the array and sets the pointer at offset. The value at offset is
+   already a copy of the (NULL or sentinel) pointer. */
+static void
+writeArray(SnapshotWriter *w, size_t offset, const void *array, size_t size,
+           const UA_DataType *type) {
+    if(w->retval != UA_STATUSCODE_GOOD || !array || array == UA_EMPTY_ARRAY_SENTINEL)
+        return;
+    size_t arrayOffset = writerAlloc(w, type->memSize * size);
+    if(w->retval != UA_STATUSCODE_GOOD)
+        return;
+    memcpy(&w->data[arrayOffset], array, type->memSize * size);
+    if(!type->fixedSize) {
+        uintptr_t ptr = (uintptr_t)array;
+        for(size_t i = 0; i < size; i++) {
+            writeValue(w, (const void*)ptr, arrayOffset + (i * type->memSize), type);
+            ptr += type->memSize;
+        }
+    }
+    writePointer(w, offset, arrayOffset);
+}
+
+static void
+writeString(SnapshotWriter *w, const UA_String *s, size_t offset) {
+    writeArray(w, offset + offsetof(UA_String, data), s->data, s->length,
+               &UA_TYPES[UA_TYPES_BYTE]);
+}
+
+static void
+writeNodeId(SnapshotWriter *w, const UA_NodeId *id, size_t offset) {
+    if(id->identifierType == UA_NODEIDTYPE_STRING ||
+       id->identifierType == UA_NODEIDTYPE_BYTESTRING)
+        writeString(w, &id->identifier.string, offset + offsetof(UA_NodeId, identifier));
+}
+
+static void
+writeVariant(SnapshotWriter *w, const UA_Variant *v, size_t offset) {
+    if(!v->type)
+        return;
+    writeType(w, offset + offsetof(UA_Variant, type), v->type);
+    size_t size = v->arrayLength;
+    if(UA_Variant_isScalar(v))
+        size = 1;
+    writeArray(w, offset + offsetof(UA_Variant, data), v->data, size, v->type);
+    writeArray(w, offset + offsetof(UA_Variant, arrayDimensions), v->arrayDimensions,
+               v->arrayDimensionsSize, &UA_TYPES[UA_TYPES_INT32]);
+    /* The image is never freed member by member */
+    ((UA_Variant*)&w->data[offset])->storageType = UA_VARIANT_DATA_NODELETE;
+}
+
+static void
+writeExtensionObject(SnapshotWriter *w, const UA_ExtensionObject *eo, size_t offset) {
+    if(eo->encoding == UA_EXTENSIONOBJECT_DECODED ||
+       eo->encoding == UA_EXTENSIONOBJECT_DECODED_NODELETE) {
+        size_t typeOffset = offset + offsetof(UA_ExtensionObject, content.decoded.type);
+        writeType(w, typeOffset, eo->content.decoded.type);
+        if(w->retval == UA_STATUSCODE_GOOD)
+            writeArray(w, offset + offsetof(UA_ExtensionObject, content.decoded.data),
+                       eo->content.decoded.data, 1, eo->content.decoded.type);
+        ((UA_ExtensionObject*)&w->data[offset])->encoding = UA_EXTENSIONOBJECT_DECODED_NODELETE;
+        return;
+    }
+    writeNodeId(w, &eo->content.encoded.typeId,
+                offset + offsetof(UA_ExtensionObject, content.encoded.typeId));
+    writeString(w, &eo->content.encoded.body,
+                offset + offsetof(UA_ExtensionObject, content.encoded.body));
+}
+
+static void
+writeDiagnosticInfo(SnapshotWriter *w, const UA_DiagnosticInfo *di, size_t offset) {
+    writeString(w, &di->additionalInfo, offset + offsetof(UA_DiagnosticInfo, additionalInfo));
+    if(di->hasInnerDiagnosticInfo)
+        writeArray(w, offset + offsetof(UA_DiagnosticInfo, innerDiagnosticInfo),
+                   di->innerDiagnosticInfo, 1, &UA_TYPES[UA_TYPES_DIAGNOSTICINFO]);
+}
+
+/* Fixes the pointers of a value that is already copied to offset. Mirrors the
+   copy functions in ua_types.c. */
+static void
+writeValue(SnapshotWriter *w, const void *src, size_t offset, const UA_DataType *type) {
+    if(type->fixedSize || w->retval != UA_STATUSCODE_GOOD)
+        return;
+    if(type->builtin) {
+        switch(type->typeIndex) {
+        case UA_TYPES_STRING:
+        case UA_TYPES_BYTESTRING:
+        case UA_TYPES_XMLELEMENT:
+            writeString(w, src, offset);
+            return;
+        case UA_TYPES_NODEID:
+            writeNodeId(w, src, offset);
+            return;
+        case UA_TYPES_EXPANDEDNODEID:
+            writeNodeId(w, &((const UA_ExpandedNodeId*)src)->nodeId,
+                        offset + offsetof(UA_ExpandedNodeId, nodeId));
+            writeString(w, &((const UA_ExpandedNodeId*)src)->namespaceUri,
+                        offset + offsetof(UA_ExpandedNodeId, namespaceUri));
+            return;
+        case UA_TYPES_LOCALIZEDTEXT:
+            writeString(w, &((const UA_LocalizedText*)src)->locale,
+                        offset + offsetof(UA_LocalizedText, locale));
+            writeString(w, &((const UA_LocalizedText*)src)->text,
+                        offset + offsetof(UA_LocalizedText, text));
+            return;
+        case UA_TYPES_EXTENSIONOBJECT:
+            writeExtensionObject(w, src, offset);
+            return;
+        case UA_TYPES_DATAVALUE:
+            writeVariant(w, &((const UA_DataValue*)src)->value,
+                         offset + offsetof(UA_DataValue, value));
+            return;
+        case UA_TYPES_VARIANT:
+            writeVariant(w, src, offset);
+            return;
+        case UA_TYPES_DIAGNOSTICINFO:
+            writeDiagnosticInfo(w, src, offset);
+            return;
+        default:
+            break; /* QualifiedName is handled as a structure */
+        }
+    }
+
+    uintptr_t ptr = (uintptr_t)src;
+    size_t off = offset;
+    for(size_t i = 0; i < type->membersSize; i++) {
+        const UA_DataTypeMember *member = &type->members[i];
+        const UA_DataType *typelists[2] = { UA_TYPES, &type[-type->typeIndex] };
+        const UA_DataType *memberType = &typelists[!member->namespaceZero][member->memberTypeIndex];
+        ptr += member->padding;
+        off += member->padding;
+        if(!member->isArray) {
+            writeValue(w, (const void*)ptr, off, memberType);
+            ptr += memberType->memSize;
+            off += memberType->memSize;
+        } else {
+            const size_t size = *((const size_t*)ptr);
+            ptr += sizeof(size_t);
+            off += sizeof(size_t);
+            writeArray(w, off, *(void* const*)ptr, size, memberType);
+            ptr += sizeof(void*);
+            off += sizeof(void*);
+        }
+    }
+}
+
+/* The target index of the reference kinds is not stored. The kinds of static
+   nodes are searched linearly. */
+static void
+writeReferences(SnapshotWriter *w, const UA_Node *node, size_t offset) {
+    if(node->referencesSize == 0)
+        return;
+    size_t size = sizeof(UA_NodeReferenceKind) * node->referencesSize;
+    size_t refsOffset = writerAlloc(w, size);
+    if(w->retval != UA_STATUSCODE_GOOD)
+        return;
+    memcpy(&w->data[refsOffset], node->references, size);
+    for(size_t i = 0; i < node->referencesSize; i++) {
+        const UA_NodeReferenceKind *rk = &node->references[i];
+        size_t rkOffset = refsOffset + (i * sizeof(UA_NodeReferenceKind));
+        UA_NodeReferenceKind *copy = (UA_NodeReferenceKind*)&w->data[rkOffset];
+        copy->targetIndex = NULL;
+        copy->targetIndexSize = 0;
+        writeNodeId(w, &rk->referenceTypeId, rkOffset + offsetof(UA_NodeReferenceKind, referenceTypeId));
+        writeArray(w, rkOffset + offsetof(UA_NodeReferenceKind, targetIds), rk->targetIds,
+                   rk->targetIdsSize, &UA_TYPES[UA_TYPES_EXPANDEDNODEID]);
+    }
+    writePointer(w, offset + offsetof(UA_Node, references), refsOffset);
+}
+
+/* Returns the offset of the node in the image */
+static size_t
+writeNode(SnapshotWriter *w, const UA_Node *node) {
+    size_t size = nodeSize(node->nodeClass);
+    if(size == 0) {
+        w->retval = UA_STATUSCODE_BADINTERNALERROR;
+        return 0;
+    }
+    size_t offset = writerAlloc(w, size);
+    if(w->retval != UA_STATUSCODE_GOOD)
+        return 0;
+    memcpy(&w->data[offset], node, size);
+    UA_Node *copy = (UA_Node*)&w->data[offset];
+
+    /* Remove callbacks and handles. They are not valid in another process. */
+    switch(node->nodeClass) {
+    case UA_NODECLASS_OBJECT:
+        ((UA_ObjectNode*)copy)->instanceHandle = NULL;
+        break;
+    case UA_NODECLASS_OBJECTTYPE:
+        memset(&((UA_ObjectTypeNode*)copy)->lifecycleManagement, 0,
+               sizeof(UA_ObjectLifecycleManagement));
+        break;
+    case UA_NODECLASS_METHOD:
+        ((UA_MethodNode*)copy)->methodHandle = NULL;
+        ((UA_MethodNode*)copy)->attachedMethod = NULL;
+        break;
+    case UA_NODECLASS_VARIABLE:
+    case UA_NODECLASS_VARIABLETYPE: {
+        /* Variables and VariableTypes are identical up to the value */
+        UA_VariableNode *vcopy = (UA_VariableNode*)copy;
+        const UA_VariableNode *vnode = (const UA_VariableNode*)node;
+        memset(&vcopy->value, 0, sizeof(vcopy->value));
+        vcopy->valueSource = UA_VALUESOURCE_VARIANT;
+        if(vnode->valueSource == UA_VALUESOURCE_VARIANT) {
+            memcpy(&vcopy->value.variant.value, &vnode->value.variant.value, sizeof(UA_Variant));
+            writeVariant(w, &vnode->value.variant.value,
+                         offset + offsetof(UA_VariableNode, value.variant.value));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    writeNodeId(w, &node->nodeId, offset + offsetof(UA_Node, nodeId));
+    writeValue(w, &node->browseName, offset + offsetof(UA_Node, browseName),
+               &UA_TYPES[UA_TYPES_QUALIFIEDNAME]);
+    writeValue(w, &node->displayName, offset + offsetof(UA_Node, displayName),
+               &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    writeValue(w, &node->description, offset + offsetof(UA_Node, description),
+               &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    writeReferences(w, node, offset);
+    if(node->nodeClass == UA_NODECLASS_REFERENCETYPE)
+        writeValue(w, &((const UA_ReferenceTypeNode*)node)->inverseName,
+                   offset + offsetof(UA_ReferenceTypeNode, inverseName),
+                   &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    return offset;
+}
+
+typedef struct {
+    const UA_Node **nodes;
+    size_t nodesSize;
+    size_t nodesCapacity;
+    UA_Boolean failed;
+} NodeCollection;
+
+static void collectNode(void *context, const UA_Node *node) {
+    NodeCollection *c = context;
+    if(c->nodesSize == c->nodesCapacity) {
+        size_t capacity = c->nodesCapacity > 0 ? c->nodesCapacity * 2 : 1024;
+        const UA_Node **nodes = UA_realloc(c->nodes, capacity * sizeof(UA_Node*));
+        if(!nodes) {
+            c->failed = true;
+            return;
+        }
+        c->nodes = nodes;
+        c->nodesCapacity = capacity;
+    }
+    c->nodes[c->nodesSize] = node;
+    c->nodesSize++;
+}
+
+static int compareNodes(const void *a, const void *b) {
+    const UA_Node *n1 = *(const UA_Node * const *)a;
+    const UA_Node *n2 = *(const UA_Node * const *)b;
+    return UA_NodeId_compare(&n1->nodeId, &n2->nodeId);
+}
+
+static UA_StatusCode
+writeImage(SnapshotWriter *w, const UA_Node **nodes, size_t nodesSize,
+           const UA_String *namespaces, size_t namespacesSize) {
+    size_t headerOffset = writerAlloc(w, sizeof(SnapshotHeader));
+    size_t namespacesOffset = writerAlloc(w, namespacesSize * sizeof(UA_String));
+    for(size_t i = 0; i < namespacesSize && w->retval == UA_STATUSCODE_GOOD; i++) {
+        size_t offset = namespacesOffset + (i * sizeof(UA_String));
+        memcpy(&w->data[offset], &namespaces[i], sizeof(UA_String));
+        writeString(w, &namespaces[i], offset);
+    }
+    size_t nodesOffset = writerAlloc(w, nodesSize * sizeof(void*));
+    for(size_t i = 0; i < nodesSize && w->retval == UA_STATUSCODE_GOOD; i++) {
+        size_t offset = writeNode(w, nodes[i]);
+        if(w->retval == UA_STATUSCODE_GOOD)
+            writePointer(w, nodesOffset + (i * sizeof(void*)), offset);
+    }
+    size_t baseRelocsOffset = writerAlloc(w, w->baseRelocsSize * sizeof(UA_UInt64));
+    size_t typeRelocsOffset = writerAlloc(w, w->typeRelocsSize * sizeof(UA_UInt64));
+    if(w->retval != UA_STATUSCODE_GOOD)
+        return w->retval;
+    memcpy(&w->data[baseRelocsOffset], w->baseRelocs, w->baseRelocsSize * sizeof(UA_UInt64));
+    memcpy(&w->data[typeRelocsOffset], w->typeRelocs, w->typeRelocsSize * sizeof(UA_UInt64));
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(SnapshotHeader));
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.layout = snapshotLayout();
+    header.base = SNAPSHOT_BASE;
+    header.size = w->size;
+    header.nodesOffset = nodesOffset;
+    header.nodesSize = nodesSize;
+    header.baseRelocsOffset = baseRelocsOffset;
+    header.baseRelocsSize = w->baseRelocsSize;
+    header.typeRelocsOffset = typeRelocsOffset;
+    header.typeRelocsSize = w->typeRelocsSize;
+    header.namespacesOffset = namespacesOffset;
+    header.namespacesSize = namespacesSize;
+    memcpy(&w->data[headerOffset], &header, sizeof(SnapshotHeader));
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_NodeStore_writeSnapshot(UA_NodeStore *ns, const char *path,
+                           const UA_String *namespaces, size_t namespacesSize) {
+    NodeCollection c;
+    memset(&c, 0, sizeof(NodeCollection));
+    UA_NodeStore_iterate(ns, collectNode, &c);
+    const UA_Node **nodes = c.nodes;
+    size_t nodesSize = c.nodesSize;
+    if(c.failed) {
+        UA_free(nodes);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    qsort(nodes, nodesSize, sizeof(UA_Node*), compareNodes);
+
+    SnapshotWriter w;
+    memset(&w, 0, sizeof(SnapshotWriter));
+    UA_StatusCode retval = writeImage(&w, nodes, nodesSize, namespaces, namespacesSize);
+    UA_free(nodes);
+    UA_free(w.baseRelocs);
+    UA_free(w.typeRelocs);
+    if(retval == UA_STATUSCODE_GOOD) {
+        FILE *f = fopen(path, "wb");
+        if(!f) {
+            retval = UA_STATUSCODE_BADINTERNALERROR;
+        } else {
+            if(fwrite(w.data, 1, w.size, f) != w.size)
+                retval = UA_STATUSCODE_BADINTERNALERROR;
+            if(fclose(f) != 0)
+                retval = UA_STATUSCODE_BADINTERNALERROR;
+        }
+    }
+    UA_free(w.data);
+    return retval;
+}
+
+/**********/
+/* Loader */
+/**********/
+
+typedef struct {
+    UA_Byte *data;
+    size_t size;
+} SnapshotImage;
+
+static void releaseImage(void *handle) {
+    SnapshotImage *image = handle;
+#ifndef _WIN32
+    munmap(image->data, image->size);
+#else
+    UA_free(image->data);
+#endif
+    UA_free(image);
+}
+
+/* Bitmaps with one bit for every pointer-sized word of the image */
+static UA_Boolean
+bitGet(const UA_Byte *map, size_t offset) {
+    size_t word = offset / sizeof(uintptr_t);
+    return (map[word / 8] >> (word % 8)) & 1;
+}
+
+static void
+bitSet(UA_Byte *map, size_t offset) {
+    size_t word = offset / sizeof(uintptr_t);
+    map[word / 8] |= (UA_Byte)(1u << (word % 8));
+}
+
+typedef struct {
+    UA_Byte *data;
+    size_t dataEnd; /* the relocation tables follow the records */
+    size_t mapSize;
+    UA_Byte *pointers; /* words in the base relocation table */
+    UA_Byte *types; /* words in the type relocation table */
+    UA_Byte *visited; /* words reached from the nodes and namespaces */
+    size_t depth;
+} SnapshotChecker;
+
+static UA_Boolean
+checkArea(const SnapshotChecker *c, size_t offset, size_t size) {
+    return offset >= sizeof(SnapshotHeader) && offset <= c->dataEnd &&
+        size <= c->dataEnd - offset;
+}
+
+static UA_Boolean
+validRelocs(const SnapshotHeader *h, UA_UInt64 offset, UA_UInt64 size) {
+    return offset >= sizeof(SnapshotHeader) && offset <= h->size &&
+        offset % sizeof(UA_UInt64) == 0 && size <= (h->size - offset) / sizeof(UA_UInt64);
+}
+
+static UA_Boolean
+validRelocOffset(const SnapshotChecker *c, UA_UInt64 offset) {
+    return offset >= sizeof(SnapshotHeader) && offset <= c->dataEnd - sizeof(uintptr_t) &&
+        offset % sizeof(uintptr_t) == 0;
+}
+
+/* Applies the base relocations if the image is not mapped at the preferred
+   address. The relocation tables are recorded in the bitmaps of the checker. */
+static UA_StatusCode
+relocateImage(SnapshotChecker *c, const SnapshotHeader *h) {
+    if(!validRelocs(h, h->baseRelocsOffset, h->baseRelocsSize) ||
+       !validRelocs(h, h->typeRelocsOffset, h->typeRelocsSize))
+        return UA_STATUSCODE_BADDECODINGERROR;
+    UA_UInt64 dataEnd = h->baseRelocsOffset;
+    if(h->typeRelocsOffset < dataEnd)
+        dataEnd = h->typeRelocsOffset;
+    if(dataEnd < sizeof(SnapshotHeader) + sizeof(uintptr_t))
+        return UA_STATUSCODE_BADDECODINGERROR;
+    c->dataEnd = (size_t)dataEnd;
+    c->mapSize = (c->dataEnd / sizeof(uintptr_t) + 7) / 8;
+    c->pointers = UA_calloc(3, c->mapSize);
+    if(!c->pointers)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    c->types = &c->pointers[c->mapSize];
+    c->visited = &c->types[c->mapSize];
+
+    uintptr_t delta = (uintptr_t)c->data - (uintptr_t)h->base;
+    const UA_UInt64 *relocs = (const UA_UInt64*)&c->data[h->baseRelocsOffset];
+    for(size_t i = 0; i < h->baseRelocsSize; i++) {
+        if(!validRelocOffset(c, relocs[i]) || bitGet(c->pointers, (size_t)relocs[i]))
+            return UA_STATUSCODE_BADDECODINGERROR;
+        bitSet(c->pointers, (size_t)relocs[i]);
+        uintptr_t *p = (uintptr_t*)&c->data[relocs[i]];
+        if(*p - (uintptr_t)h->base >= c->dataEnd)
+            return UA_STATUSCODE_BADDECODINGERROR;
+        /* Don't touch the page (and copy it) if the pointer is already valid */
+        if(delta != 0)
+            *p += delta;
+    }
+
+    relocs = (const UA_UInt64*)&c->data[h->typeRelocsOffset];
+    for(size_t i = 0; i < h->typeRelocsSize; i++) {
+        if(!validRelocOffset(c, relocs[i]) || bitGet(c->pointers, (size_t)relocs[i]) ||
+           bitGet(c->types, (size_t)relocs[i]))
+            return UA_STATUSCODE_BADDECODINGERROR;
+        bitSet(c->types, (size_t)relocs[i]);
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Checks the pointer at offset to an array of size elements. Returns the offset
+   of the array, or zero for NULL and the empty array sentinel. Every array is
+   referenced only once. */
+static UA_Boolean
+checkPointer(SnapshotChecker *c, size_t offset, size_t size, size_t memSize,
+             size_t *target) {
+    *target = 0;
+    uintptr_t p = *(const uintptr_t*)&c->data[offset];
+    if(p == 0 || p == (uintptr_t)UA_EMPTY_ARRAY_SENTINEL)
+        return size == 0;
+    if(!bitGet(c->pointers, offset) || bitGet(c->visited, offset) ||
+       p < (uintptr_t)c->data || (memSize > 0 && size > c->dataEnd / memSize))
+        return false;
+    bitSet(c->visited, offset);
+    size_t t = (size_t)(p - (uintptr_t)c->data);
+    if(t % SNAPSHOT_ALIGN != 0 || !checkArea(c, t, size * memSize))
+        return false;
+    *target = t;
+    return true;
+}
+
+/* Checks the datatype index at offset. Returns the datatype or NULL. */
+static UA_Boolean
+checkType(SnapshotChecker *c, size_t offset, const UA_DataType **type) {
+    *type = NULL;
+    uintptr_t index = *(const uintptr_t*)&c->data[offset];
+    if(index == 0)
+        return !bitGet(c->types, offset);
+    if(!bitGet(c->types, offset) || index > UA_TYPES_COUNT)
+        return false;
+    bitSet(c->visited, offset);
+    *type = &UA_TYPES[index - 1];
+    return true;
+}
+
+static UA_Boolean
+checkValue(SnapshotChecker *c, size_t offset, const UA_DataType *type);
+
+static UA_Boolean
+checkArray(SnapshotChecker *c, size_t offset, size_t size, const UA_DataType *type) {
+    size_t arrayOffset;
+    if(!checkPointer(c, offset, size, type->memSize, &arrayOffset))
+        return false;
+    if(arrayOffset == 0 || type->fixedSize)
+        return true;
+    for(size_t i = 0; i < size; i++) {
+        if(!checkValue(c, arrayOffset + (i * type->memSize), type))
+            return false;
+    }
+    return true;
+}
+
+static UA_Boolean
+checkString(SnapshotChecker *c, size_t offset) {
+    const UA_String *s = (const UA_String*)&c->data[offset];
+    size_t target;
+    return checkPointer(c, offset + offsetof(UA_String, data), s->length, 1, &target);
+}
+
+static UA_Boolean
+checkNodeId(SnapshotChecker *c, size_t offset) {
+    switch(((const UA_NodeId*)&c->data[offset])->identifierType) {
+    case UA_NODEIDTYPE_NUMERIC:
+    case UA_NODEIDTYPE_GUID:
+        return true;
+    case UA_NODEIDTYPE_STRING:
+    case UA_NODEIDTYPE_BYTESTRING:
+        return checkString(c, offset + offsetof(UA_NodeId, identifier));
+    default:
+        return false;
+    }
+}
+
+static UA_Boolean
+checkVariant(SnapshotChecker *c, size_t offset) {
+    const UA_Variant *v = (const UA_Variant*)&c->data[offset];
+    const UA_DataType *type;
+    if(!checkType(c, offset + offsetof(UA_Variant, type), &type))
+        return false;
+    size_t size = v->arrayLength;
+    if(UA_Variant_isScalar(v))
+        size = 1;
+    size_t target;
+    if(!type)
+        return checkPointer(c, offset + offsetof(UA_Variant, data), size, 1, &target) &&
+            checkPointer(c, offset + offsetof(UA_Variant, arrayDimensions),
+                         v->arrayDimensionsSize, sizeof(UA_Int32), &target);
+    if(v->storageType != UA_VARIANT_DATA_NODELETE ||
+       !checkArray(c, offset + offsetof(UA_Variant, data), size, type) ||
+       !checkPointer(c, offset + offsetof(UA_Variant, arrayDimensions),
+                     v->arrayDimensionsSize, sizeof(UA_Int32), &target))
+        return false;
+
+    /* The dimensions are used to index into the array */
+    if(v->arrayDimensionsSize == 0)
+        return true;
+    const UA_Int32 *dims = (const UA_Int32*)&c->data[target];
+    size_t total = 1;
+    for(size_t i = 0; i < v->arrayDimensionsSize; i++) {
+        if(dims[i] <= 0 || (size_t)dims[i] > v->arrayLength / total)
+            return false;
+        total *= (size_t)dims[i];
+    }
+    return total == v->arrayLength;
+}
+
+static UA_Boolean
+checkExtensionObject(SnapshotChecker *c, size_t offset) {
+    const UA_ExtensionObject *eo = (const UA_ExtensionObject*)&c->data[offset];
+    switch(eo->encoding) {
+    case UA_EXTENSIONOBJECT_ENCODED_NOBODY:
+    case UA_EXTENSIONOBJECT_ENCODED_BYTESTRING:
+    case UA_EXTENSIONOBJECT_ENCODED_XML:
+        return checkNodeId(c, offset + offsetof(UA_ExtensionObject, content.encoded.typeId)) &&
+            checkString(c, offset + offsetof(UA_ExtensionObject, content.encoded.body));
+    case UA_EXTENSIONOBJECT_DECODED_NODELETE: {
+        const UA_DataType *type;
+        if(!checkType(c, offset + offsetof(UA_ExtensionObject, content.decoded.type), &type) ||
+           !type)
+            return false;
+        return checkArray(c, offset + offsetof(UA_ExtensionObject, content.decoded.data),
+                          1, type);
+    }
+    default:
+        return false;
+    }
+}
+
+static UA_Boolean
+checkDiagnosticInfo(SnapshotChecker *c, size_t offset) {
+    const UA_DiagnosticInfo *di = (const UA_DiagnosticInfo*)&c->data[offset];
+    if(!checkString(c, offset + offsetof(UA_DiagnosticInfo, additionalInfo)))
+        return false;
+    size_t innerOffset = offset + offsetof(UA_DiagnosticInfo, innerDiagnosticInfo);
+    if(!di->hasInnerDiagnosticInfo) {
+        size_t target;
+        return checkPointer(c, innerOffset, 0, 0, &target);
+    }
+    return checkArray(c, innerOffset, 1, &UA_TYPES[UA_TYPES_DIAGNOSTICINFO]);
+}
+
+static UA_Boolean
+checkMembers(SnapshotChecker *c, size_t offset, const UA_DataType *type) {
+    if(type->builtin) {
+        switch(type->typeIndex) {
+        case UA_TYPES_STRING:
+        case UA_TYPES_BYTESTRING:
+        case UA_TYPES_XMLELEMENT:
+            return checkString(c, offset);
+        case UA_TYPES_NODEID:
+            return checkNodeId(c, offset);
+        case UA_TYPES_EXPANDEDNODEID:
+            return checkNodeId(c, offset + offsetof(UA_ExpandedNodeId, nodeId)) &&
+                checkString(c, offset + offsetof(UA_ExpandedNodeId, namespaceUri));
+        case UA_TYPES_LOCALIZEDTEXT:
+            return checkString(c, offset + offsetof(UA_LocalizedText, locale)) &&
+                checkString(c, offset + offsetof(UA_LocalizedText, text));
+        case UA_TYPES_EXTENSIONOBJECT:
+            return checkExtensionObject(c, offset);
+        case UA_TYPES_DATAVALUE:
+            return checkVariant(c, offset + offsetof(UA_DataValue, value));
+        case UA_TYPES_VARIANT:
+            return checkVariant(c, offset);
+        case UA_TYPES_DIAGNOSTICINFO:
+            return checkDiagnosticInfo(c, offset);
+        default:
+            break; /* QualifiedName is handled as a structure */
+        }
+    }
+
+    size_t off = offset;
+    for(size_t i = 0; i < type->membersSize; i++) {
+        const UA_DataTypeMember *member = &type->members[i];
+        const UA_DataType *typelists[2] = { UA_TYPES, &type[-type->typeIndex] };
+        const UA_DataType *memberType = &typelists[!member->namespaceZero][member->memberTypeIndex];
+        off += member->padding;
+        if(!member->isArray) {
+            if(!checkValue(c, off, memberType))
+                return false;
+            off += memberType->memSize;
+        } else {
+            const size_t size = *((const size_t*)&c->data[off]);
+            off += sizeof(size_t);
+            if(!checkArray(c, off, size, memberType))
+                return false;
+            off += sizeof(void*);
+        }
+    }
+    return true;
+}
+
+/* Mirrors writeValue. The nesting is limited, so that the resolution of the
+   datatypes cannot recurse without bounds. */
+static UA_Boolean
+checkValue(SnapshotChecker *c, size_t offset, const UA_DataType *type) {
+    if(type->fixedSize)
+        return true;
+    if(c->depth >= SNAPSHOT_MAXDEPTH)
+        return false;
+    c->depth++;
+    UA_Boolean valid = checkMembers(c, offset, type);
+    c->depth--;
+    return valid;
+}
+
+static UA_Boolean
+checkReferences(SnapshotChecker *c, size_t offset) {
+    const UA_Node *node = (const UA_Node*)&c->data[offset];
+    size_t refsOffset;
+    if(!checkPointer(c, offset + offsetof(UA_Node, references), node->referencesSize,
+                     sizeof(UA_NodeReferenceKind), &refsOffset))
+        return false;
+    for(size_t i = 0; i < node->referencesSize; i++) {
+        size_t rkOffset = refsOffset + (i * sizeof(UA_NodeReferenceKind));
+        const UA_NodeReferenceKind *rk = (const UA_NodeReferenceKind*)&c->data[rkOffset];
+        if(rk->targetIndex || rk->targetIndexSize != 0 ||
+           !checkNodeId(c, rkOffset + offsetof(UA_NodeReferenceKind, referenceTypeId)) ||
+           !checkArray(c, rkOffset + offsetof(UA_NodeReferenceKind, targetIds),
+                       rk->targetIdsSize, &UA_TYPES[UA_TYPES_EXPANDEDNODEID]))
+            return false;
+    }
+    return true;
+}
+
+/* Checks the node behind the pointer at offset. Mirrors writeNode. */
+static UA_Boolean
+checkNode(SnapshotChecker *c, size_t offset) {
+    size_t nodeOffset;
+    if(!checkPointer(c, offset, 1, sizeof(UA_Node), &nodeOffset) || nodeOffset == 0)
+        return false;
+    const UA_Node *node = (const UA_Node*)&c->data[nodeOffset];
+    size_t size = nodeSize(node->nodeClass);
+    if(size == 0 || !checkArea(c, nodeOffset, size) ||
+       !checkNodeId(c, nodeOffset + offsetof(UA_Node, nodeId)) ||
+       !checkValue(c, nodeOffset + offsetof(UA_Node, browseName),
+                   &UA_TYPES[UA_TYPES_QUALIFIEDNAME]) ||
+       !checkValue(c, nodeOffset + offsetof(UA_Node, displayName),
+                   &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]) ||
+       !checkValue(c, nodeOffset + offsetof(UA_Node, description),
+                   &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]) ||
+       !checkReferences(c, nodeOffset))
+        return false;
+
+    /* Callbacks and handles are not stored */
+    switch(node->nodeClass) {
+    case UA_NODECLASS_OBJECT:
+        return !((const UA_ObjectNode*)node)->instanceHandle;
+    case UA_NODECLASS_OBJECTTYPE: {
+        const UA_ObjectLifecycleManagement *olm =
+            &((const UA_ObjectTypeNode*)node)->lifecycleManagement;
+        return !olm->constructor && !olm->destructor;
+    }
+    case UA_NODECLASS_METHOD: {
+        const UA_MethodNode *m = (const UA_MethodNode*)node;
+        return !m->methodHandle && !m->attachedMethod;
+    }
+    case UA_NODECLASS_VARIABLE:
+    case UA_NODECLASS_VARIABLETYPE: {
+        const UA_VariableNode *v = (const UA_VariableNode*)node;
+        if(v->valueSource != UA_VALUESOURCE_VARIANT || v->value.variant.callback.handle ||
+           v->value.variant.callback.onRead || v->value.variant.callback.onWrite)
+            return false;
+        return checkVariant(c, nodeOffset + offsetof(UA_VariableNode, value.variant.value));
+    }
+    case UA_NODECLASS_REFERENCETYPE:
+        return checkValue(c, nodeOffset + offsetof(UA_ReferenceTypeNode, inverseName),
+                          &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    default:
+        return true;
+    }
+}
+
+/* Walks all records that are reachable from the header. Every relocation has
+   to be reached exactly once. */
+static UA_Boolean
+checkImage(SnapshotChecker *c, const SnapshotHeader *h) {
+    if(h->namespacesSize > c->dataEnd / sizeof(UA_String) ||
+       h->namespacesOffset % SNAPSHOT_ALIGN != 0 || h->namespacesOffset > c->dataEnd ||
+       !checkArea(c, (size_t)h->namespacesOffset, (size_t)h->namespacesSize * sizeof(UA_String)))
+        return false;
+    for(size_t i = 0; i < h->namespacesSize; i++) {
+        if(!checkString(c, (size_t)h->namespacesOffset + (i * sizeof(UA_String))))
+            return false;
+    }
+    if(h->nodesSize > c->dataEnd / sizeof(void*) ||
+       h->nodesOffset % SNAPSHOT_ALIGN != 0 || h->nodesOffset > c->dataEnd ||
+       !checkArea(c, (size_t)h->nodesOffset, (size_t)h->nodesSize * sizeof(void*)))
+        return false;
+    for(size_t i = 0; i < h->nodesSize; i++) {
+        if(!checkNode(c, (size_t)h->nodesOffset + (i * sizeof(void*))))
+            return false;
+    }
+    for(size_t i = 0; i < c->mapSize; i++) {
+        if((c->pointers[i] | c->types[i]) != c->visited[i])
+            return false;
+    }
+    return true;
+}
+
+/* Relocates and validates the image in memory */
+static UA_StatusCode
+prepareImage(UA_Byte *data, const SnapshotHeader *h) {
+    SnapshotChecker c;
+    memset(&c, 0, sizeof(SnapshotChecker));
+    c.data = data;
+    UA_StatusCode retval = relocateImage(&c, h);
+    if(retval == UA_STATUSCODE_GOOD && !checkImage(&c, h))
+        retval = UA_STATUSCODE_BADDECODINGERROR;
+    UA_free(c.pointers);
+    return retval;
+}
+
+#ifndef _WIN32
+
+/* Maps the image at the preferred address if possible. The mapping is private
+   and writable for the relocations and the resolution of the datatypes. Only
+   the pages that are written to are copied. */
+static UA_StatusCode
+mapImage(const char *path, SnapshotImage *image, SnapshotHeader *h) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return UA_STATUSCODE_BADNOTFOUND;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotHeader) ||
+       read(fd, h, sizeof(SnapshotHeader)) != (ssize_t)sizeof(SnapshotHeader) ||
+       h->magic != SNAPSHOT_MAGIC || h->version != SNAPSHOT_VERSION ||
+       h->layout != snapshotLayout() || h->size != (UA_UInt64)st.st_size) {
+        close(fd);
+        return UA_STATUSCODE_BADDECODINGERROR;
+    }
+    image->size = (size_t)h->size;
+    void *data = mmap((void*)(uintptr_t)h->base, image->size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    image->data = data;
+    UA_StatusCode retval = prepareImage(image->data, h);
+    if(retval != UA_STATUSCODE_GOOD)
+        munmap(image->data, image->size);
+    return retval;
+}
+
+#else
+
+static UA_StatusCode
+mapImage(const char *path, SnapshotImage *image, SnapshotHeader *h) {
+    FILE *f = fopen(path, "rb");
+    if(!f)
+        return UA_STATUSCODE_BADNOTFOUND;
+    if(fread(h, sizeof(SnapshotHeader), 1, f) != 1 ||
+       h->magic != SNAPSHOT_MAGIC || h->version != SNAPSHOT_VERSION ||
+       h->layout != snapshotLayout() || h->size < sizeof(SnapshotHeader)) {
+        fclose(f);
+        return UA_STATUSCODE_BADDECODINGERROR;
+    }
+    image->size = (size_t)h->size;
+    image->data = UA_malloc(image->size);
+    if(!image->data) {
+        fclose(f);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    memcpy(image->data, h, sizeof(SnapshotHeader));
+    size_t rest = image->size - sizeof(SnapshotHeader);
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    if(fread(&image->data[sizeof(SnapshotHeader)], 1, rest, f) != rest ||
+       fgetc(f) != EOF)
+        retval = UA_STATUSCODE_BADDECODINGERROR;
+    fclose(f);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = prepareImage(image->data, h);
+    if(retval != UA_STATUSCODE_GOOD)
+        UA_free(image->data);
+    return retval;
+}
+
+#endif
+
+/* Replaces a datatype index with the pointer into UA_TYPES. The index was
+   validated when the image was loaded. */
+static const UA_DataType *
+resolveType(const UA_DataType **type) {
+    uintptr_t index = (uintptr_t)*type;
+    if(index > 0 && index <= UA_TYPES_COUNT)
+        *type = &UA_TYPES[index - 1];
+    return *type;
+}
+
+static void
+resolveValue(void *p, const UA_DataType *type);
+
+static void
+resolveArray(void *array, size_t size, const UA_DataType *type) {
+    if(!array || array == UA_EMPTY_ARRAY_SENTINEL || type->fixedSize)
+        return;
+    uintptr_t ptr = (uintptr_t)array;
+    for(size_t i = 0; i < size; i++) {
+        resolveValue((void*)ptr, type);
+        ptr += type->memSize;
+    }
+}
+
+static void
+resolveVariant(UA_Variant *v) {
+    const UA_DataType *type = resolveType(&v->type);
+    if(!type)
+        return;
+    size_t size = v->arrayLength;
+    if(UA_Variant_isScalar(v))
+        size = 1;
+    resolveArray(v->data, size, type);
+}
+
+static void
+resolveValue(void *p, const UA_DataType *type) {
+    if(type->fixedSize)
+        return;
+    if(type->builtin) {
+        switch(type->typeIndex) {
+        case UA_TYPES_EXTENSIONOBJECT: {
+            UA_ExtensionObject *eo = p;
+            if(eo->encoding == UA_EXTENSIONOBJECT_DECODED_NODELETE)
+                resolveArray(eo->content.decoded.data, 1,
+                             resolveType(&eo->content.decoded.type));
+            return;
+        }
+        case UA_TYPES_DATAVALUE:
+            resolveVariant(&((UA_DataValue*)p)->value);
+            return;
+        case UA_TYPES_VARIANT:
+            resolveVariant(p);
+            return;
+        default:
+            return; /* no datatype pointers */
+        }
+    }
+
+    uintptr_t ptr = (uintptr_t)p;
+    for(size_t i = 0; i < type->membersSize; i++) {
+        const UA_DataTypeMember *member = &type->members[i];
+        const UA_DataType *typelists[2] = { UA_TYPES, &type[-type->typeIndex] };
+        const UA_DataType *memberType = &typelists[!member->namespaceZero][member->memberTypeIndex];
+        ptr += member->padding;
+        if(!member->isArray) {
+            resolveValue((void*)ptr, memberType);
+            ptr += memberType->memSize;
+        } else {
+            const size_t size = *((const size_t*)ptr);
+            ptr += sizeof(size_t);
+            resolveArray(*(void**)ptr, size, memberType);
+            ptr += sizeof(void*);
+        }
+    }
+}
+
+/* Called by the static layer before a node is accessed for the first time */
+static void
+resolveNode(void *handle, const UA_Node *node) {
+    if(node->nodeClass != UA_NODECLASS_VARIABLE &&
+       node->nodeClass != UA_NODECLASS_VARIABLETYPE)
+        return;
+    resolveVariant(&((UA_VariableNode*)(uintptr_t)node)->value.variant.value);
+}
+
+/* Nodes that are bound to the running application (data sources, value and
+   method callbacks, instance handles and lifecycle callbacks) */
+static UA_Boolean
+isBoundNode(const UA_Node *node) {
+    switch(node->nodeClass) {
+    case UA_NODECLASS_OBJECT:
+        return ((const UA_ObjectNode*)node)->instanceHandle != NULL;
+    case UA_NODECLASS_OBJECTTYPE: {
+        const UA_ObjectLifecycleManagement *olm =
+            &((const UA_ObjectTypeNode*)node)->lifecycleManagement;
+        return olm->constructor || olm->destructor;
+    }
+    case UA_NODECLASS_METHOD: {
+        const UA_MethodNode *m = (const UA_MethodNode*)node;
+        return m->methodHandle || m->attachedMethod;
+    }
+    case UA_NODECLASS_VARIABLE:
+    case UA_NODECLASS_VARIABLETYPE: {
+        const UA_VariableNode *v = (const UA_VariableNode*)node;
+        if(v->valueSource == UA_VALUESOURCE_DATASOURCE)
+            return true;
+        return v->value.variant.callback.onRead || v->value.variant.callback.onWrite;
+    }
+    default:
+        return false;
+    }
+}
+
+/* Bound nodes are kept if the image contains a node with the same NodeId */
+static UA_StatusCode
+keepBoundNodes(UA_NodeStore *ns, const UA_Node * const *nodes, size_t nodesSize,
+               UA_Node ***kept, size_t *keptSize) {
+    *kept = NULL;
+    *keptSize = 0;
+    for(size_t i = 0; i < nodesSize; i++) {
+        const UA_Node *node = UA_NodeStore_get(ns, &nodes[i]->nodeId);
+        if(!node || !isBoundNode(node))
+            continue;
+        UA_Node **k = UA_realloc(*kept, (*keptSize + 1) * sizeof(UA_Node*));
+        if(!k)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        *kept = k;
+        UA_Node *copy = UA_NodeStore_newNode(ns, node->nodeClass);
+        if(!copy)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        UA_StatusCode retval = UA_Node_copyAnyNodeClass(node, copy);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_NodeStore_deleteNode(ns, copy);
+            return retval;
+        }
+        k[*keptSize] = copy;
+        (*keptSize)++;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/* The namespace indices of the image refer to its namespace array. The arrays
+   have to agree on the common prefix. Returns copies of the namespaces that
+   are only in the image. */
+static UA_StatusCode
+matchNamespaces(const UA_String *stored, size_t storedSize, const UA_String *namespaces,
+                size_t namespacesSize, UA_String **added, size_t *addedSize) {
+    *added = NULL;
+    *addedSize = 0;
+    for(size_t i = 0; i < storedSize && i < namespacesSize; i++) {
+        if(!UA_String_equal(&stored[i], &namespaces[i]))
+            return UA_STATUSCODE_BADINVALIDSTATE;
+    }
+    if(storedSize <= namespacesSize)
+        return UA_STATUSCODE_GOOD;
+    *addedSize = storedSize - namespacesSize;
+    return UA_Array_copy(&stored[namespacesSize], *addedSize, (void**)added,
+                         &UA_TYPES[UA_TYPES_STRING]);
+}
+
+UA_StatusCode
+UA_NodeStore_loadSnapshot(UA_NodeStore *ns, const char *path,
+                          UA_String **namespaces, size_t *namespacesSize) {
+    SnapshotImage *image = UA_malloc(sizeof(SnapshotImage));
+    if(!image)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    SnapshotHeader h;
+    UA_StatusCode retval = mapImage(path, image, &h);
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_free(image);
+        return retval;
+    }
+
+    const UA_String *stored = (const UA_String*)&image->data[h.namespacesOffset];
+    UA_String *added;
+    size_t addedSize;
+    retval = matchNamespaces(stored, (size_t)h.namespacesSize, *namespaces,
+                             *namespacesSize, &added, &addedSize);
+    if(retval == UA_STATUSCODE_GOOD && addedSize > 0) {
+        UA_String *ns2 = UA_realloc(*namespaces,
+                                    (*namespacesSize + addedSize) * sizeof(UA_String));
+        if(ns2)
+            *namespaces = ns2;
+        else
+            retval = UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_Array_delete(added, addedSize, &UA_TYPES[UA_TYPES_STRING]);
+        releaseImage(image);
+        return retval;
+    }
+
+    const UA_Node * const *nodes = (const UA_Node * const *)&image->data[h.nodesOffset];
+    size_t nodesSize = (size_t)h.nodesSize;
+    UA_Node **kept;
+    size_t keptSize;
+    retval = keepBoundNodes(ns, nodes, nodesSize, &kept, &keptSize);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = UA_NodeStore_linkStatic(ns, nodes, nodesSize, resolveNode,
+                                         releaseImage, image);
+    if(retval != UA_STATUSCODE_GOOD)
+        releaseImage(image);
+
+    /* Put the kept nodes on top of the image */
+    for(size_t i = 0; i < keptSize; i++) {
+        if(retval == UA_STATUSCODE_GOOD) {
+            UA_NodeStore_remove(ns, &kept[i]->nodeId);
+            retval = UA_NodeStore_insert(ns, kept[i]);
+        } else {
+            UA_NodeStore_deleteNode(ns, kept[i]);
+        }
+    }
+    UA_free(kept);
+
+    /* Append the namespaces that are only in the image */
+    if(retval == UA_STATUSCODE_GOOD) {
+        if(addedSize > 0)
+            memcpy(&(*namespaces)[*namespacesSize], added, addedSize * sizeof(UA_String));
+        *namespacesSize += addedSize;
+        UA_free(added);
+    } else {
+        UA_Array_delete(added, addedSize, &UA_TYPES[UA_TYPES_STRING]);
+    }
+    return retval;
+}
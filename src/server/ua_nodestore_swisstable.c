@@ -0,0 +1,664 @@
+#include "ua_nodestore.h"
+#include "ua_nodestore_hash.h"
+#include "ua_util.h"
+
+/* The nodestore is an open-addressing hash-map in the style of Google's
+ * "SwissTable". Besides the array of slots, the table holds one control byte
+ * per slot. The control byte is either EMPTY, DELETED or contains the upper 7
+ * bits of the hash of the node in the slot. The control bytes are probed in
+ * groups of eight with word-level parallelism (SWAR). So a lookup reads one
+ * word of control bytes and a single slot in the common case. Only slots whose
+ * control byte and full hash match are compared with the NodeId of the node.
+ *
+ * The table size is a power of two, so that the probe position is computed
+ * with a mask instead of a division. Groups are probed in triangular order,
+ * which visits every group once.
+ *
+ * Numeric NodeIds are mostly allocated densely from small integers (all of
+ * namespace zero, for example). For the first namespaces, such nodes are kept
+ * in an array indexed by the numeric identifier instead of the hash-map. The
+ * array grows as long as it stays at least a quarter full. Numeric identifiers
+ * beyond the array are stored in the hash-map. When the array grows, they are
+ * moved over. So a numeric identifier below the array size is never found in
+ * the hash-map and the lookup needs neither hashing nor comparison. */
+
+#define UA_NODESTORE_MINSIZE 64
+#define GROUPSIZE 8
+
+#define UA_NODESTORE_DENSE_NAMESPACES 8
+#define UA_NODESTORE_DENSE_MINSIZE 64
+#define UA_NODESTORE_DENSE_MAXSPARSE 1024 /* Arrays up to this size may be sparse */
+
+#define CTRL_EMPTY ((UA_Byte)0x80)
+#define CTRL_DELETED ((UA_Byte)0xFE)
+
+typedef struct UA_NodeStoreEntry {
+    struct UA_NodeStoreEntry *orig; // the version this is a copy from (or NULL)
+    UA_Node node;
+} UA_NodeStoreEntry;
+
+#include "ua_nodestore_slab.inc"
+#include "ua_nodestore_static.inc"
+
+/* The origin of editable copies of static nodes */
+static UA_NodeStoreEntry staticOrigin;
+
+typedef struct {
+    hash_t hash; /* stored to skip the NodeId comparison and for resizing */
+    UA_NodeStoreEntry *entry;
+} UA_NodeStoreSlot;
+
+typedef struct {
+    UA_NodeStoreEntry **entries; /* indexed by the numeric identifier */
+    UA_UInt32 size;
+    UA_UInt32 numeric; /* numeric nodes of the namespace, including hashed */
+    UA_UInt32 hashed; /* numeric nodes of the namespace in the hash-map */
+} UA_NodeStoreDense;
+
+struct UA_NodeStore {
+    UA_Byte *ctrl;
+    UA_NodeStoreSlot *slots;
+    UA_UInt32 size; /* number of slots, a power of two */
+    UA_UInt32 count; /* nodes in the hash-map */
+    UA_UInt32 deleted; /* tombstones also count towards the load factor */
+    UA_NodeStoreDense dense[UA_NODESTORE_DENSE_NAMESPACES];
+    UA_NodeStoreStatic statics;
+    UA_NodeSlabPool slabPools[UA_NODECLASSES];
+    UA_InternTable *interned;
+};
+
+/* The upper 7 bits of the hash are stored in the control byte. The lower
+   bits select the group where probing starts. */
+static UA_Byte h2(hash_t h) { return (UA_Byte)(h >> 25); }
+
+/**********************/
+/* Group-wise Probing */
+/**********************/
+
+typedef UA_UInt64 group_t;
+
+#define LSBS ((group_t)0x0101010101010101)
+#define MSBS ((group_t)0x8080808080808080)
+
+/* Load the control bytes of a group. The first control byte is the lowest
+   byte of the word, independent of the endianness. */
+static group_t
+groupLoad(const UA_Byte *ctrl) {
+    group_t g;
+    memcpy(&g, ctrl, sizeof(group_t));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    g = __builtin_bswap64(g);
+#endif
+    return g;
+}
+
+/* Sets the highest bit of every byte that equals b. Can have false positives
+   in bytes above a true match. They are sorted out by comparing the full
+   hash. */
+static group_t
+groupMatch(group_t g, UA_Byte b) {
+    group_t x = g ^ (LSBS * b);
+    return (x - LSBS) & ~x & MSBS;
+}
+
+/* EMPTY is the only control byte with the highest but not the second-lowest
+   bit set */
+static group_t
+groupMatchEmpty(group_t g) {
+    return g & (~g << 6) & MSBS;
+}
+
+static group_t
+groupMatchEmptyOrDeleted(group_t g) {
+    return g & MSBS;
+}
+
+/* Index of the lowest byte with the highest bit set */
+static UA_UInt32
+groupLowest(group_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (UA_UInt32)__builtin_ctzll(mask) >> 3;
+#else
+    UA_UInt32 i = 0;
+    while(!(mask & 0x80)) {
+        mask >>= 8;
+        i++;
+    }
+    return i;
+#endif
+}
+
+/* Returns true if an entry was found under the nodeid and sets slot to its
+   position. Otherwise, returns false and sets slot to the first free (empty or
+   deleted) position in the probe sequence. */
+static UA_Boolean
+findSlot(const UA_NodeStore *ns, const UA_NodeId *nodeid, hash_t h, UA_UInt32 *slot) {
+    UA_UInt32 groupMask = (ns->size / GROUPSIZE) - 1;
+    UA_UInt32 group = h & groupMask;
+    UA_Byte tag = h2(h);
+    UA_Boolean haveFree = false;
+    for(UA_UInt32 probe = 1; ; probe++) {
+        const UA_UInt32 base = group * GROUPSIZE;
+        group_t g = groupLoad(&ns->ctrl[base]);
+        for(group_t m = groupMatch(g, tag); m; m &= m - 1) {
+            UA_UInt32 i = base + groupLowest(m);
+            if(ns->slots[i].hash == h &&
+               UA_NodeId_equal(&ns->slots[i].entry->node.nodeId, nodeid)) {
+                *slot = i;
+                return true;
+            }
+        }
+        if(!haveFree) {
+            group_t avail = groupMatchEmptyOrDeleted(g);
+            if(avail) {
+                *slot = base + groupLowest(avail);
+                haveFree = true;
+            }
+        }
+        /* An empty slot terminates the probe sequence */
+        if(groupMatchEmpty(g))
+            return false;
+        group = (group + probe) & groupMask;
+    }
+}
+
+static void
+setSlot(UA_NodeStore *ns, UA_UInt32 slot, hash_t h, UA_NodeStoreEntry *entry) {
+    if(ns->ctrl[slot] == CTRL_DELETED)
+        ns->deleted--;
+    ns->ctrl[slot] = h2(h);
+    ns->slots[slot].hash = h;
+    ns->slots[slot].entry = entry;
+}
+
+static void
+clearSlot(UA_NodeStore *ns, UA_UInt32 slot) {
+    /* A group that never was full cannot be part of a longer probe sequence.
+       Then the slot can be marked as empty instead of deleted. */
+    UA_UInt32 base = slot & ~(UA_UInt32)(GROUPSIZE - 1);
+    if(groupMatchEmpty(groupLoad(&ns->ctrl[base]))) {
+        ns->ctrl[slot] = CTRL_EMPTY;
+    } else {
+        ns->ctrl[slot] = CTRL_DELETED;
+        ns->deleted++;
+    }
+    ns->count--;
+}
+
+/* Rehash into a table with an occupancy of 25-50%. Removes the tombstones. */
+static UA_StatusCode
+resize(UA_NodeStore *ns) {
+    UA_UInt32 nsize = UA_NODESTORE_MINSIZE;
+    while(nsize < ns->count * 2) {
+        if(nsize >= ((UA_UInt32)1 << 31))
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        nsize <<= 1;
+    }
+    UA_Byte *nctrl = UA_malloc(nsize);
+    UA_NodeStoreSlot *nslots = UA_malloc(nsize * sizeof(UA_NodeStoreSlot));
+    if(!nctrl || !nslots) {
+        UA_free(nctrl);
+        UA_free(nslots);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    memset(nctrl, CTRL_EMPTY, nsize);
+
+    UA_Byte *octrl = ns->ctrl;
+    UA_NodeStoreSlot *oslots = ns->slots;
+    UA_UInt32 osize = ns->size;
+    ns->ctrl = nctrl;
+    ns->slots = nslots;
+    ns->size = nsize;
+    ns->deleted = 0;
+
+    /* The nodes are known to be unique. Insert at the first free slot. */
+    UA_UInt32 groupMask = (nsize / GROUPSIZE) - 1;
+    for(UA_UInt32 i = 0; i < osize; i++) {
+        if(octrl[i] & CTRL_EMPTY)
+            continue;
+        hash_t h = oslots[i].hash;
+        UA_UInt32 group = h & groupMask;
+        for(UA_UInt32 probe = 1; ; probe++) {
+            group_t avail = groupMatchEmptyOrDeleted(groupLoad(&nctrl[group * GROUPSIZE]));
+            if(avail) {
+                setSlot(ns, group * GROUPSIZE + groupLowest(avail), h, oslots[i].entry);
+                break;
+            }
+            group = (group + probe) & groupMask;
+        }
+    }
+
+    UA_free(octrl);
+    UA_free(oslots);
+    return UA_STATUSCODE_GOOD;
+}
+
+/*****************************/
+/* Dense Numeric Identifiers */
+/*****************************/
+
+/* Returns the dense array of the namespace if the nodeid is numeric */
+static UA_NodeStoreDense *
+denseNamespace(UA_NodeStore *ns, const UA_NodeId *nodeid) {
+    if(nodeid->identifierType != UA_NODEIDTYPE_NUMERIC ||
+       nodeid->namespaceIndex >= UA_NODESTORE_DENSE_NAMESPACES)
+        return NULL;
+    return &ns->dense[nodeid->namespaceIndex];
+}
+
+/* Returns the position in the dense array if the nodeid is covered by it */
+static UA_NodeStoreEntry **
+denseSlot(UA_NodeStore *ns, const UA_NodeId *nodeid) {
+    UA_NodeStoreDense *d = denseNamespace(ns, nodeid);
+    if(!d || nodeid->identifier.numeric >= d->size)
+        return NULL;
+    return &d->entries[nodeid->identifier.numeric];
+}
+
+/* Grow the dense array to cover the nodeid, if it remains at least a quarter
+   full. The numeric nodes of the namespace that are now covered by the array
+   are moved out of the hash-map. On failure, the array keeps its size. */
+static void
+denseGrow(UA_NodeStore *ns, const UA_NodeId *nodeid) {
+    UA_NodeStoreDense *d = denseNamespace(ns, nodeid);
+    if(!d)
+        return;
+    UA_UInt32 id = nodeid->identifier.numeric;
+    UA_UInt32 nsize = d->size > 0 ? d->size : UA_NODESTORE_DENSE_MINSIZE;
+    while(nsize <= id) {
+        if(nsize >= ((UA_UInt32)1 << 30))
+            return;
+        nsize <<= 1;
+    }
+    if(nsize > UA_NODESTORE_DENSE_MAXSPARSE && nsize / 4 > d->numeric)
+        return;
+    UA_NodeStoreEntry **entries = UA_realloc(d->entries, nsize * sizeof(UA_NodeStoreEntry*));
+    if(!entries)
+        return;
+    memset(&entries[d->size], 0, (nsize - d->size) * sizeof(UA_NodeStoreEntry*));
+
+    for(UA_UInt32 i = 0; i < ns->size && d->hashed > 0; i++) {
+        if(ns->ctrl[i] & CTRL_EMPTY)
+            continue;
+        const UA_NodeId *n = &ns->slots[i].entry->node.nodeId;
+        if(n->identifierType != UA_NODEIDTYPE_NUMERIC ||
+           n->namespaceIndex != nodeid->namespaceIndex ||
+           n->identifier.numeric >= nsize)
+            continue;
+        entries[n->identifier.numeric] = ns->slots[i].entry;
+        clearSlot(ns, i);
+        d->hashed--;
+    }
+    d->entries = entries;
+    d->size = nsize;
+}
+
+static UA_NodeStoreEntry *
+findEntry(UA_NodeStore *ns, const UA_NodeId *nodeid) {
+    UA_NodeStoreEntry **dense = denseSlot(ns, nodeid);
+    if(dense)
+        return *dense;
+    UA_UInt32 slot;
+    if(!findSlot(ns, nodeid, UA_NodeId_hash(nodeid), &slot))
+        return NULL;
+    return ns->slots[slot].entry;
+}
+
+static UA_NodeStoreEntry * instantiateEntry(UA_NodeStore *ns, UA_NodeClass nodeClass) {
+    size_t size = sizeof(UA_NodeStoreEntry) - sizeof(UA_Node);
+    switch(nodeClass) {
+    case UA_NODECLASS_OBJECT:
+        size += sizeof(UA_ObjectNode);
+        break;
+    case UA_NODECLASS_VARIABLE:
+        size += sizeof(UA_VariableNode);
+        break;
+    case UA_NODECLASS_METHOD:
+        size += sizeof(UA_MethodNode);
+        break;
+    case UA_NODECLASS_OBJECTTYPE:
+        size += sizeof(UA_ObjectTypeNode);
+        break;
+    case UA_NODECLASS_VARIABLETYPE:
+        size += sizeof(UA_VariableTypeNode);
+        break;
+    case UA_NODECLASS_REFERENCETYPE:
+        size += sizeof(UA_ReferenceTypeNode);
+        break;
+    case UA_NODECLASS_DATATYPE:
+        size += sizeof(UA_DataTypeNode);
+        break;
+    case UA_NODECLASS_VIEW:
+        size += sizeof(UA_ViewNode);
+        break;
+    default:
+        return NULL;
+    }
+    UA_NodeStoreEntry *entry = slabAlloc(ns->slabPools, nodeClass, size);
+    if(!entry)
+        return NULL;
+    entry->node.nodeClass = nodeClass;
+    return entry;
+}
+
+static void deleteEntry(UA_NodeStore *ns, UA_NodeStoreEntry *entry) {
+    UA_Node_releaseInterned(&entry->node, ns->interned);
+    UA_Node_deleteMembersAnyNodeClass(&entry->node);
+    slabFree(entry);
+}
+
+/**********************/
+/* Exported functions */
+/**********************/
+
+UA_NodeStore * UA_NodeStore_new(void) {
+    UA_NodeStore *ns;
+    if(!(ns = UA_malloc(sizeof(UA_NodeStore))))
+        return NULL;
+    ns->size = UA_NODESTORE_MINSIZE;
+    ns->count = 0;
+    ns->deleted = 0;
+    memset(ns->dense, 0, sizeof(ns->dense));
+    memset(&ns->statics, 0, sizeof(ns->statics));
+    memset(ns->slabPools, 0, sizeof(ns->slabPools));
+    ns->interned = UA_InternTable_new();
+    ns->ctrl = UA_malloc(ns->size);
+    ns->slots = UA_malloc(ns->size * sizeof(UA_NodeStoreSlot));
+    if(!ns->interned || !ns->ctrl || !ns->slots) {
+        UA_InternTable_delete(ns->interned);
+        UA_free(ns->ctrl);
+        UA_free(ns->slots);
+        UA_free(ns);
+        return NULL;
+    }
+    memset(ns->ctrl, CTRL_EMPTY, ns->size);
+    return ns;
+}
+
+void UA_NodeStore_delete(UA_NodeStore *ns) {
+    for(UA_UInt32 i = 0; i < ns->size; i++) {
+        if(!(ns->ctrl[i] & CTRL_EMPTY))
+            deleteEntry(ns, ns->slots[i].entry);
+    }
+    for(size_t i = 0; i < UA_NODESTORE_DENSE_NAMESPACES; i++) {
+        UA_NodeStoreDense *d = &ns->dense[i];
+        for(UA_UInt32 j = 0; j < d->size; j++) {
+            if(d->entries[j])
+                deleteEntry(ns, d->entries[j]);
+        }
+        UA_free(d->entries);
+    }
+    staticDelete(&ns->statics);
+    slabPoolsDelete(ns->slabPools);
+    UA_InternTable_delete(ns->interned);
+    UA_free(ns->ctrl);
+    UA_free(ns->slots);
+    UA_free(ns);
+}
+
+UA_Node * UA_NodeStore_newNode(UA_NodeStore *ns, UA_NodeClass class) {
+    UA_NodeStoreEntry *entry = instantiateEntry(ns, class);
+    if(!entry)
+        return NULL;
+    return (UA_Node*)&entry->node;
+}
+
+void UA_NodeStore_deleteNode(UA_NodeStore *ns, UA_Node *node) {
+    deleteEntry(ns, container_of(node, UA_NodeStoreEntry, node));
+}
+
+UA_InternTable * UA_NodeStore_internTable(UA_NodeStore *ns) {
+    return ns->interned;
+}
+
+UA_StatusCode
+UA_NodeStore_getStatistics(UA_NodeStore *ns, UA_NodeClass nodeClass,
+                           UA_NodeStoreStatistics *stats) {
+    return slabStatistics(ns->slabPools, nodeClass, stats);
+}
+
+/* All nodes of the hash-map and the dense arrays. New numeric identifiers are
+   searched from there. So they do not start at one and collide with the
+   identifiers that are requested later on. */
+static UA_UInt32
+nodeCount(const UA_NodeStore *ns) {
+    UA_UInt32 count = ns->count;
+    for(size_t i = 0; i < UA_NODESTORE_DENSE_NAMESPACES; i++)
+        count += ns->dense[i].numeric - ns->dense[i].hashed;
+    return count;
+}
+
+UA_StatusCode UA_NodeStore_insert(UA_NodeStore *ns, UA_Node *node) {
+    UA_NodeStoreEntry *entry = container_of(node, UA_NodeStoreEntry, node);
+    UA_NodeId tempNodeid;
+    tempNodeid = node->nodeId;
+    tempNodeid.namespaceIndex = 0;
+    if(UA_NodeId_isNull(&tempNodeid)) {
+        if(node->nodeId.namespaceIndex == 0)
+            node->nodeId.namespaceIndex = 1;
+        /* find a free nodeid */
+        UA_UInt32 identifier = nodeCount(ns)+1; // start value
+        UA_UInt32 increase = 1 + 2 * (identifier % (ns->size / 2)); // odd, so that all ids are visited
+        while(true) {
+            node->nodeId.identifier.numeric = identifier;
+            if(!findEntry(ns, &node->nodeId) && !staticGet(&ns->statics, &node->nodeId))
+                break;
+            identifier += increase;
+        }
+    } else if(findEntry(ns, &node->nodeId) || staticGet(&ns->statics, &node->nodeId)) {
+        deleteEntry(ns, entry);
+        return UA_STATUSCODE_BADNODEIDEXISTS;
+    }
+
+    /* Numeric nodeids go to the dense array if it covers them (or can grow to
+       cover them) */
+    UA_NodeStoreDense *d = denseNamespace(ns, &node->nodeId);
+    UA_NodeStoreEntry **dense = NULL;
+    if(d) {
+        d->numeric++;
+        dense = denseSlot(ns, &node->nodeId);
+        if(!dense) {
+            denseGrow(ns, &node->nodeId);
+            dense = denseSlot(ns, &node->nodeId);
+        }
+    }
+    if(dense) {
+        UA_Node_intern(node, ns->interned);
+        *dense = entry;
+        return UA_STATUSCODE_GOOD;
+    }
+
+    /* Keep the load factor (including tombstones) below 7/8 */
+    if((ns->count + ns->deleted + 1) * 8 > ns->size * 7) {
+        if(resize(ns) != UA_STATUSCODE_GOOD) {
+            if(d)
+                d->numeric--;
+            deleteEntry(ns, entry);
+            return UA_STATUSCODE_BADINTERNALERROR;
+        }
+    }
+    UA_UInt32 slot;
+    hash_t h = UA_NodeId_hash(&node->nodeId);
+    findSlot(ns, &node->nodeId, h, &slot); /* We know this returns a free slot */
+    UA_Node_intern(node, ns->interned);
+    setSlot(ns, slot, h, entry);
+    ns->count++;
+    if(d)
+        d->hashed++;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode
+UA_NodeStore_replace(UA_NodeStore *ns, UA_Node *node) {
+    UA_NodeStoreEntry *newEntry = container_of(node, UA_NodeStoreEntry, node);
+    UA_Boolean *shadowed = staticFind(&ns->statics, &node->nodeId, NULL);
+    if(shadowed) {
+        if(newEntry->orig != &staticOrigin) {
+            deleteEntry(ns, newEntry);
+            return UA_STATUSCODE_BADINTERNALERROR;
+        }
+        /* Shadow the static node and store the replacement */
+        newEntry->orig = NULL;
+        *shadowed = true;
+        UA_StatusCode retval = UA_NodeStore_insert(ns, node);
+        if(retval != UA_STATUSCODE_GOOD)
+            *shadowed = false;
+        return retval;
+    }
+
+    UA_NodeStoreEntry **stored = denseSlot(ns, &node->nodeId);
+    if(!stored) {
+        UA_UInt32 slot;
+        if(findSlot(ns, &node->nodeId, UA_NodeId_hash(&node->nodeId), &slot))
+            stored = &ns->slots[slot].entry;
+    }
+    if(!stored || !*stored) {
+        deleteEntry(ns, newEntry);
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    }
+    if(*stored != newEntry->orig) {
+        deleteEntry(ns, newEntry);
+        return UA_STATUSCODE_BADINTERNALERROR; // the node was replaced since the copy was made
+    }
+    UA_Node_intern(node, ns->interned);
+    deleteEntry(ns, *stored);
+    *stored = newEntry;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* A NodeId is either stored in the hash-map (or dense array) or visible in a
+   static layer. Most lookups are for stored nodes, so the static layers are
+   searched only after a miss. */
+const UA_Node * UA_NodeStore_get(UA_NodeStore *ns, const UA_NodeId *nodeid) {
+    UA_NodeStoreEntry *entry = findEntry(ns, nodeid);
+    if(entry)
+        return (const UA_Node*)&entry->node;
+    return staticGet(&ns->statics, nodeid);
+}
+
+UA_Node * UA_NodeStore_getCopy(UA_NodeStore *ns, const UA_NodeId *nodeid) {
+    const UA_Node *node;
+    UA_NodeStoreEntry *entry = findEntry(ns, nodeid);
+    if(entry) {
+        node = &entry->node;
+    } else {
+        node = staticGet(&ns->statics, nodeid);
+        if(!node)
+            return NULL;
+        entry = &staticOrigin;
+    }
+    UA_NodeStoreEntry *new = instantiateEntry(ns, node->nodeClass);
+    if(!new)
+        return NULL;
+    if(UA_Node_copyAnyNodeClass(node, &new->node) != UA_STATUSCODE_GOOD) {
+        deleteEntry(ns, new);
+        return NULL;
+    }
+    new->orig = entry;
+    return &new->node;
+}
+
+UA_StatusCode
+UA_NodeStore_linkStatic(UA_NodeStore *ns, const UA_Node * const *nodes, size_t nodesSize,
+                        UA_NodeStore_resolveStatic resolve, UA_NodeStore_releaseStatic release,
+                        void *handle) {
+    UA_StatusCode retval = staticLink(&ns->statics, nodes, nodesSize, resolve, release, handle);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+
+    /* Remove the nodes that are replaced by the new layer */
+    const UA_NodeStoreStaticLayer *l = &ns->statics.layers[ns->statics.layersSize - 1];
+    for(size_t i = 0; i < UA_NODESTORE_DENSE_NAMESPACES; i++) {
+        UA_NodeStoreDense *d = &ns->dense[i];
+        for(UA_UInt32 j = 0; j < d->size; j++) {
+            if(!d->entries[j] || staticIndex(l, &d->entries[j]->node.nodeId) == l->nodesSize)
+                continue;
+            deleteEntry(ns, d->entries[j]);
+            d->entries[j] = NULL;
+            d->numeric--;
+        }
+    }
+    for(UA_UInt32 i = 0; i < ns->size; i++) {
+        if(ns->ctrl[i] & CTRL_EMPTY)
+            continue;
+        UA_NodeStoreEntry *entry = ns->slots[i].entry;
+        if(staticIndex(l, &entry->node.nodeId) == l->nodesSize)
+            continue;
+        UA_NodeStoreDense *d = denseNamespace(ns, &entry->node.nodeId);
+        if(d) {
+            d->numeric--;
+            d->hashed--;
+        }
+        deleteEntry(ns, entry);
+        clearSlot(ns, i);
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_Boolean UA_NodeStore_isStatic(UA_NodeStore *ns, const UA_Node *node) {
+    return staticContains(&ns->statics, node);
+}
+
+UA_StatusCode UA_NodeStore_remove(UA_NodeStore *ns, const UA_NodeId *nodeid) {
+    UA_Boolean *shadowed = staticFind(&ns->statics, nodeid, NULL);
+    if(shadowed) {
+        *shadowed = true;
+        return UA_STATUSCODE_GOOD;
+    }
+
+    UA_NodeStoreDense *d = denseNamespace(ns, nodeid);
+    UA_NodeStoreEntry **dense = denseSlot(ns, nodeid);
+    if(dense) {
+        if(!*dense)
+            return UA_STATUSCODE_BADNODEIDUNKNOWN;
+        deleteEntry(ns, *dense);
+        *dense = NULL;
+        d->numeric--;
+        return UA_STATUSCODE_GOOD;
+    }
+
+    UA_UInt32 slot;
+    if(!findSlot(ns, nodeid, UA_NodeId_hash(nodeid), &slot))
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    deleteEntry(ns, ns->slots[slot].entry);
+    clearSlot(ns, slot);
+    if(d) {
+        d->numeric--;
+        d->hashed--;
+    }
+    /* Downsize the hashmap if it is very empty */
+    if(ns->count * 8 < ns->size && ns->size > UA_NODESTORE_MINSIZE)
+        resize(ns); // this can fail. we just continue with the bigger hashmap.
+    return UA_STATUSCODE_GOOD;
+}
+
+void UA_NodeStore_iterate(UA_NodeStore *ns, UA_NodeStore_nodeVisitor visitor, void *context) {
+    UA_NodeStore_iteratePartition(ns, 0, 1, visitor, context);
+}
+
+void UA_NodeStore_iteratePartition(UA_NodeStore *ns, size_t partition, size_t partitions,
+                                   UA_NodeStore_nodeVisitor visitor, void *context) {
+    if(partition >= partitions)
+        return;
+    staticIterate(&ns->statics, partition, partitions, visitor, context);
+    size_t begin, end;
+    for(size_t i = 0; i < UA_NODESTORE_DENSE_NAMESPACES; i++) {
+        UA_NodeStoreDense *d = &ns->dense[i];
+        partitionRange(d->size, partition, partitions, &begin, &end);
+        for(size_t j = begin; j < end; j++) {
+            if(d->entries[j])
+                visitor(context, (UA_Node*)&d->entries[j]->node);
+        }
+    }
+    partitionRange(ns->size, partition, partitions, &begin, &end);
+    for(size_t i = begin; i < end; i++) {
+        if(!(ns->ctrl[i] & CTRL_EMPTY))
+            visitor(context, (UA_Node*)&ns->slots[i].entry->node);
+    }
+}
+
+void UA_NodeStore_iterateParallel(UA_NodeStore *ns, size_t partitions,
+                                  UA_NodeStore_nodeVisitor visitor, void **contexts) {
+    for(size_t i = 0; i < partitions; i++)
+        UA_NodeStore_iteratePartition(ns, i, partitions, visitor, contexts[i]);
+}
@@ -489,7 +489,8 @@ processMSG(UA_Connection *connection, UA_Server *server, const UA_ByteString *ms
     /* Decode the request */
     void *request = UA_alloca(requestType->memSize);
     size_t oldpos = *pos;
-    retval = UA_decodeBinary(&bytes, pos, request, requestType);
+    retval = UA_decodeBinary(&bytes, pos, request, requestType,
+                             server->config.customDataTypesSize, server->config.customDataTypes);
     if(retval != UA_STATUSCODE_GOOD) {
         sendError(channel, &bytes, oldpos, sequenceHeader.requestId, retval);
         return;
@@ -22,6 +22,64 @@ typedef struct UA_ExternalNamespace {
 } UA_ExternalNamespace;
 #endif
 
+/**
+ * Subtype Hierarchy
+ * -----------------
+ * The server caches the transitive closure of the HasSubtype hierarchy below
+ * the roots of the reference, data, object and variable types. Every type gets
+ * a dense index and a bitmap of its (indirect) subtypes. So testing whether a
+ * reference type is relevant for a Browse is a hash lookup and a bit test.
+ *
+ * The cache is built on the first use. New subtypes are added incrementally in
+ * the single-threaded server. Removing a type or a HasSubtype reference (and
+ * every change with multithreading) invalidates the cache. */
+typedef struct UA_SubtypeCache UA_SubtypeCache;
+
+/* The set of relevant types of a Browse or a path element */
+typedef struct {
+    UA_NodeStore *nodestore;
+    const UA_NodeId *root;
+    UA_Boolean includeSubtypes;
+    const UA_SubtypeCache *cache;
+    const UA_UInt64 *subtypes; /* bitmap of the root, NULL if the root is not indexed */
+} UA_SubtypeSet;
+
+/* The set is valid within the current (rcu) critical section */
+void UA_Server_getSubtypes(UA_Server *server, const UA_NodeId *root,
+                           UA_Boolean includeSubtypes, UA_SubtypeSet *set);
+
+UA_Boolean UA_SubtypeSet_contains(const UA_SubtypeSet *set, const UA_NodeId *type);
+
+/* Called when a HasSubtype reference was added */
+void UA_Server_addSubtype(UA_Server *server, const UA_NodeId *supertype, const UA_NodeId *subtype);
+
+void UA_Server_invalidateSubtypes(UA_Server *server);
+
+/* Frees the cache right away when the server is deleted */
+void UA_Server_deleteSubtypes(UA_Server *server);
+
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+/**
+ * Monitored Items
+ * ---------------
+ * The monitored items are indexed by the node they monitor. Writing an
+ * attribute samples the items on it right away, instead of comparing every
+ * item in every publishing interval. */
+typedef struct UA_MonitoredItemIndex UA_MonitoredItemIndex;
+
+/* Called when an attribute of the node was written. Service_Write_single and
+ * the UA_Server_setVariableNode_* functions notify the items. Code that changes
+ * an attribute in another way (with UA_Server_editNode or in the nodestore)
+ * has to call it as well. Otherwise, the items miss the change until the
+ * value is written again. Only values from a data source or with an onRead
+ * callback are polled. */
+void UA_Server_notifyMonitoredItems(UA_Server *server, const UA_NodeId *nodeId,
+                                    UA_UInt32 attributeId);
+
+/* Called after the sessions are deleted */
+void UA_Server_deleteMonitoredItemIndex(UA_Server *server);
+#endif
+
 #ifdef UA_ENABLE_MULTITHREADING
 typedef struct {
     UA_Server *server;
@@ -45,6 +103,16 @@ struct UA_Server {
 
     /* Address Space */
     UA_NodeStore *nodestore;
+    UA_SubtypeCache *subtypes; /* built on demand, NULL if invalidated */
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    UA_MonitoredItemIndex *monitoredItems; /* NULL until the first item is created */
+    size_t retransmissionBytes; /* retained notifications of all subscriptions */
+    UA_ByteString sampleBuffer; /* reused to encode the samples of monitored items */
+    size_t sampleBufferCapacity;
+# ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_t sampleBufferMutex;
+# endif
+#endif
 
     size_t namespacesSize;
     UA_String *namespaces;
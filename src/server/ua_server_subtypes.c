@@ -0,0 +1,282 @@
+#include "ua_server_internal.h"
+#include "ua_nodestore_hash.h"
+
+struct UA_SubtypeCache {
+    size_t typesSize;
+    size_t typesCapacity; /* a multiple of 64 */
+    UA_NodeId *types;
+    size_t slotsSize; /* a power of two, more than twice the capacity */
+    size_t *slots; /* index + 1 of the type, zero marks an empty slot */
+    UA_UInt64 *rows; /* typesCapacity / 64 words per type. Bit j of row i is set
+                        if type j is type i or a (indirect) subtype of it. */
+};
+
+static const UA_UInt32 subtypeRoots[] = {UA_NS0ID_REFERENCES, UA_NS0ID_BASEDATATYPE,
+                                         UA_NS0ID_BASEOBJECTTYPE, UA_NS0ID_BASEVARIABLETYPE};
+
+static const UA_NodeId nodeIdHasSubtype = {0, UA_NODEIDTYPE_NUMERIC, {UA_NS0ID_HASSUBTYPE}};
+
+#define SUBTYPES_WORDS(cache) ((cache)->typesCapacity / 64)
+#define SUBTYPES_ROW(cache, i) (&(cache)->rows[(i) * SUBTYPES_WORDS(cache)])
+#define SUBTYPES_BIT(row, j) (((row)[(j) / 64] >> ((j) % 64)) & 1)
+
+static void
+deleteCache(UA_SubtypeCache *cache) {
+    if(!cache)
+        return;
+    UA_Array_delete(cache->types, cache->typesSize, &UA_TYPES[UA_TYPES_NODEID]);
+    UA_free(cache->slots);
+    UA_free(cache->rows);
+    UA_free(cache);
+}
+
+/* Returns the slot of the type or the empty slot where it would be inserted */
+static size_t *
+subtypeSlot(const UA_SubtypeCache *cache, const UA_NodeId *type) {
+    size_t mask = cache->slotsSize - 1;
+    size_t s = UA_NodeId_hash(type) & mask;
+    while(cache->slots[s] != 0 && !UA_NodeId_equal(&cache->types[cache->slots[s] - 1], type))
+        s = (s + 1) & mask;
+    return &cache->slots[s];
+}
+
+/* Returns the index of the type or typesSize if not found */
+static size_t
+subtypeIndex(const UA_SubtypeCache *cache, const UA_NodeId *type) {
+    size_t slot = *subtypeSlot(cache, type);
+    return slot == 0 ? cache->typesSize : slot - 1;
+}
+
+static UA_StatusCode
+resizeCache(UA_SubtypeCache *cache, size_t capacity) {
+    size_t slotsSize = 4;
+    while(slotsSize <= capacity * 2)
+        slotsSize *= 2;
+    UA_NodeId *types = UA_realloc(cache->types, capacity * sizeof(UA_NodeId));
+    if(!types)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    cache->types = types;
+    size_t *slots = UA_calloc(slotsSize, sizeof(size_t));
+    if(!slots)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    UA_free(cache->slots);
+    cache->slots = slots;
+    cache->slotsSize = slotsSize;
+    cache->typesCapacity = capacity;
+    for(size_t i = 0; i < cache->typesSize; i++)
+        *subtypeSlot(cache, &cache->types[i]) = i + 1;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Adds the type if it is not yet indexed. The capacity has to suffice. */
+static UA_StatusCode
+addType(UA_SubtypeCache *cache, const UA_NodeId *type) {
+    size_t *slot = subtypeSlot(cache, type);
+    if(*slot != 0)
+        return UA_STATUSCODE_GOOD;
+    UA_StatusCode retval = UA_NodeId_copy(type, &cache->types[cache->typesSize]);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    cache->typesSize++;
+    *slot = cache->typesSize;
+    return UA_STATUSCODE_GOOD;
+}
+
+static const UA_NodeReferenceKind *
+findSubtypeReferences(UA_NodeStore *ns, const UA_NodeId *type) {
+    const UA_Node *node = UA_NodeStore_get(ns, type);
+    if(!node)
+        return NULL;
+    return UA_Node_findReferenceKind(node, &nodeIdHasSubtype, false);
+}
+
+/* Index the types below the roots in breadth-first order. Then, the bitmaps of
+   the subtypes are merged into their supertypes until nothing changes. For a
+   tree, the reverse breadth-first order needs a single pass. */
+static UA_SubtypeCache *
+buildCache(UA_NodeStore *ns) {
+    UA_SubtypeCache *cache = UA_calloc(1, sizeof(UA_SubtypeCache));
+    if(!cache)
+        return NULL;
+    UA_StatusCode retval = resizeCache(cache, 64);
+    for(size_t i = 0; i < sizeof(subtypeRoots) / sizeof(UA_UInt32) &&
+            retval == UA_STATUSCODE_GOOD; i++) {
+        UA_NodeId root = UA_NODEID_NUMERIC(0, subtypeRoots[i]);
+        if(UA_NodeStore_get(ns, &root))
+            retval = addType(cache, &root);
+    }
+    for(size_t i = 0; i < cache->typesSize && retval == UA_STATUSCODE_GOOD; i++) {
+        const UA_NodeReferenceKind *rk = findSubtypeReferences(ns, &cache->types[i]);
+        for(size_t j = 0; rk && j < rk->targetIdsSize && retval == UA_STATUSCODE_GOOD; j++) {
+            if(cache->typesSize == cache->typesCapacity)
+                retval = resizeCache(cache, cache->typesCapacity * 2);
+            if(retval == UA_STATUSCODE_GOOD)
+                retval = addType(cache, &rk->targetIds[j].nodeId);
+        }
+    }
+
+    /* leave room for the types added later on */
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = resizeCache(cache, ((cache->typesSize + cache->typesSize / 4) / 64 + 1) * 64);
+    if(retval == UA_STATUSCODE_GOOD) {
+        cache->rows = UA_calloc(cache->typesCapacity * SUBTYPES_WORDS(cache), sizeof(UA_UInt64));
+        if(!cache->rows)
+            retval = UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    if(retval != UA_STATUSCODE_GOOD) {
+        deleteCache(cache);
+        return NULL;
+    }
+
+    size_t words = SUBTYPES_WORDS(cache);
+    for(size_t i = 0; i < cache->typesSize; i++)
+        SUBTYPES_ROW(cache, i)[i / 64] |= (UA_UInt64)1 << (i % 64);
+    UA_Boolean changed;
+    do {
+        changed = false;
+        for(size_t i = cache->typesSize; i > 0; i--) {
+            UA_UInt64 *row = SUBTYPES_ROW(cache, i - 1);
+            const UA_NodeReferenceKind *rk = findSubtypeReferences(ns, &cache->types[i - 1]);
+            for(size_t j = 0; rk && j < rk->targetIdsSize; j++) {
+                size_t k = subtypeIndex(cache, &rk->targetIds[j].nodeId);
+                if(k == cache->typesSize)
+                    continue;
+                const UA_UInt64 *sub = SUBTYPES_ROW(cache, k);
+                for(size_t w = 0; w < words; w++) {
+                    if((row[w] | sub[w]) == row[w])
+                        continue;
+                    row[w] |= sub[w];
+                    changed = true;
+                }
+            }
+        }
+    } while(changed);
+    return cache;
+}
+
+#ifdef UA_ENABLE_MULTITHREADING
+static void
+deleteCacheDelayed(UA_Server *server, void *cache) {
+    deleteCache(cache);
+}
+#endif
+
+void UA_Server_invalidateSubtypes(UA_Server *server) {
+#ifdef UA_ENABLE_MULTITHREADING
+    UA_SubtypeCache *cache = uatomic_xchg(&server->subtypes, NULL);
+    if(cache)
+        UA_Server_delayedCallback(server, deleteCacheDelayed, cache);
+#else
+    UA_Server_deleteSubtypes(server);
+#endif
+}
+
+void UA_Server_deleteSubtypes(UA_Server *server) {
+    deleteCache(server->subtypes);
+    server->subtypes = NULL;
+}
+
+void
+UA_Server_addSubtype(UA_Server *server, const UA_NodeId *supertype, const UA_NodeId *subtype) {
+#ifdef UA_ENABLE_MULTITHREADING
+    /* the cache is immutable for concurrent readers */
+    UA_Server_invalidateSubtypes(server);
+#else
+    UA_SubtypeCache *cache = server->subtypes;
+    if(!cache)
+        return;
+    size_t p = subtypeIndex(cache, supertype);
+    if(p == cache->typesSize)
+        return; /* not below the roots */
+    size_t c = subtypeIndex(cache, subtype);
+    if(c == cache->typesSize) {
+        /* index a new leaf type */
+        const UA_NodeReferenceKind *rk = findSubtypeReferences(server->nodestore, subtype);
+        if((rk && rk->targetIdsSize > 0) || cache->typesSize == cache->typesCapacity ||
+           addType(cache, subtype) != UA_STATUSCODE_GOOD) {
+            UA_Server_invalidateSubtypes(server);
+            return;
+        }
+        SUBTYPES_ROW(cache, c)[c / 64] |= (UA_UInt64)1 << (c % 64);
+    }
+
+    /* the supertype and everything above inherit the subtypes */
+    size_t words = SUBTYPES_WORDS(cache);
+    const UA_UInt64 *sub = SUBTYPES_ROW(cache, c);
+    for(size_t i = 0; i < cache->typesSize; i++) {
+        UA_UInt64 *row = SUBTYPES_ROW(cache, i);
+        if(!SUBTYPES_BIT(row, p))
+            continue;
+        for(size_t w = 0; w < words; w++)
+            row[w] |= sub[w];
+    }
+#endif
+}
+
+void
+UA_Server_getSubtypes(UA_Server *server, const UA_NodeId *root,
+                      UA_Boolean includeSubtypes, UA_SubtypeSet *set) {
+    set->nodestore = server->nodestore;
+    set->root = root;
+    set->includeSubtypes = includeSubtypes;
+    set->cache = NULL;
+    set->subtypes = NULL;
+    if(!includeSubtypes)
+        return;
+
+#ifdef UA_ENABLE_MULTITHREADING
+    UA_SubtypeCache *cache = uatomic_read(&server->subtypes);
+    if(!cache) {
+        UA_SubtypeCache *built = buildCache(server->nodestore);
+        if(built) {
+            cache = uatomic_cmpxchg(&server->subtypes, NULL, built);
+            if(cache)
+                deleteCache(built); /* another thread was faster */
+            else
+                cache = built;
+        }
+    }
+#else
+    if(!server->subtypes)
+        server->subtypes = buildCache(server->nodestore);
+    UA_SubtypeCache *cache = server->subtypes;
+#endif
+    if(!cache)
+        return;
+    set->cache = cache;
+    size_t i = subtypeIndex(cache, root);
+    if(i < cache->typesSize)
+        set->subtypes = SUBTYPES_ROW(cache, i);
+}
+
+/* Walk up the hierarchy for types that are not indexed */
+static UA_Boolean
+isSubtypeUncached(UA_NodeStore *ns, const UA_NodeId *type, const UA_NodeId *root, size_t depth) {
+    if(UA_NodeId_equal(type, root))
+        return true;
+    if(depth == 0)
+        return false; /* cyclic hierarchy */
+    const UA_Node *node = UA_NodeStore_get(ns, type);
+    if(!node)
+        return false;
+    const UA_NodeReferenceKind *rk = UA_Node_findReferenceKind(node, &nodeIdHasSubtype, true);
+    for(size_t i = 0; rk && i < rk->targetIdsSize; i++) {
+        if(isSubtypeUncached(ns, &rk->targetIds[i].nodeId, root, depth - 1))
+            return true;
+    }
+    return false;
+}
+
+UA_Boolean
+UA_SubtypeSet_contains(const UA_SubtypeSet *set, const UA_NodeId *type) {
+    if(UA_NodeId_equal(type, set->root))
+        return true;
+    if(!set->includeSubtypes)
+        return false;
+    if(set->subtypes) {
+        /* all subtypes of an indexed type are indexed */
+        size_t i = subtypeIndex(set->cache, type);
+        return i < set->cache->typesSize && SUBTYPES_BIT(set->subtypes, i);
+    }
+    return isSubtypeUncached(set->nodestore, type, set->root, 64);
+}
@@ -413,15 +413,17 @@ void Service_Read(UA_Server *server, UA_Session *session, const UA_ReadRequest *
 		UA_Variant_setArray(&variant, expireArray, request->nodesToReadSize, &UA_TYPES[UA_TYPES_DATETIME]);
 
 		size_t offset = 0;
+		size_t capacity = 0;
 		UA_ByteString str;
-        UA_ByteString_allocBuffer(&str, 65536);
-        UA_StatusCode retval = UA_encodeBinary(&variant, &UA_TYPES[UA_TYPES_VARIANT], &str, &offset);
+        UA_ByteString_init(&str);
+        UA_StatusCode retval = UA_encodeBinaryGrow(&variant, &UA_TYPES[UA_TYPES_VARIANT], &str,
+                                                   &capacity, &offset);
         UA_Array_delete(expireArray, request->nodesToReadSize, &UA_TYPES[UA_TYPES_DATETIME]);
         if(retval == UA_STATUSCODE_GOOD){
-            additionalHeader.content.encoded.body.data = str.data;
-            additionalHeader.content.encoded.body.length = offset;
+            additionalHeader.content.encoded.body = str;
             response->responseHeader.additionalHeader = additionalHeader;
-        }
+        } else
+            UA_ByteString_deleteMembers(&str);
     }
 #endif
 }
@@ -438,20 +440,21 @@ UA_StatusCode UA_Server_editNode(UA_Server *server, UA_Session *session, const U
         const UA_Node *node = UA_NodeStore_get(server->nodestore, nodeId);
         if(!node)
             return UA_STATUSCODE_BADNODEIDUNKNOWN;
-        UA_Node *editNode = (UA_Node*)(uintptr_t)node; // dirty cast. use only here.
-        retval = callback(server, session, editNode, data);
-        return retval;
-#else
+        /* Static nodes are read-only. They are replaced by an edited copy. */
+        if(!UA_NodeStore_isStatic(server->nodestore, node)) {
+            UA_Node *editNode = (UA_Node*)(uintptr_t)node; // dirty cast. use only here.
+            return callback(server, session, editNode, data);
+        }
+#endif
         UA_Node *copy = UA_NodeStore_getCopy(server->nodestore, nodeId);
         if(!copy)
             return UA_STATUSCODE_BADOUTOFMEMORY;
         retval = callback(server, session, copy, data);
         if(retval != UA_STATUSCODE_GOOD) {
-            UA_NodeStore_deleteNode(copy);
+            UA_NodeStore_deleteNode(server->nodestore, copy);
             return retval;
         }
         retval = UA_NodeStore_replace(server->nodestore, copy);
-#endif
     } while(retval != UA_STATUSCODE_GOOD);
     return UA_STATUSCODE_GOOD;
 }
@@ -681,14 +684,25 @@ CopyAttributeIntoNode(UA_Server *server, UA_Session *session,
 		break;
 	}
     if(attr_type) {
+        UA_InternTable *interned = UA_NodeStore_internTable(server->nodestore);
+        if(target == &node->browseName)
+            UA_String_releaseInterned(&node->browseName.name, interned);
         UA_deleteMembers(target, attr_type);
         retval = UA_copy(value, target, attr_type);
+        if(target == &node->browseName)
+            UA_String_intern(&node->browseName.name, interned);
     }
     return retval;
 }
 
 UA_StatusCode Service_Write_single(UA_Server *server, UA_Session *session, const UA_WriteValue *wvalue) {
-    return UA_Server_editNode(server, session, &wvalue->nodeId, (UA_EditNodeCallback)CopyAttributeIntoNode, wvalue);
+    UA_StatusCode retval = UA_Server_editNode(server, session, &wvalue->nodeId,
+                                              (UA_EditNodeCallback)CopyAttributeIntoNode, wvalue);
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    if(retval == UA_STATUSCODE_GOOD)
+        UA_Server_notifyMonitoredItems(server, &wvalue->nodeId, wvalue->attributeId);
+#endif
+    return retval;
 }
 
 void Service_Write(UA_Server *server, UA_Session *session, const UA_WriteRequest *request,
@@ -5,18 +5,18 @@ static const UA_VariableNode *
 getArgumentsVariableNode(UA_Server *server, const UA_MethodNode *ofMethod,
                          UA_String withBrowseName) {
     UA_NodeId hasProperty = UA_NODEID_NUMERIC(0, UA_NS0ID_HASPROPERTY);
-    for(size_t i = 0; i < ofMethod->referencesSize; i++) {
-        if(ofMethod->references[i].isInverse == false && 
-            UA_NodeId_equal(&hasProperty, &ofMethod->references[i].referenceTypeId)) {
-            const UA_Node *refTarget =
-                UA_NodeStore_get(server->nodestore, &ofMethod->references[i].targetId.nodeId);
-            if(!refTarget)
-                continue;
-            if(refTarget->nodeClass == UA_NODECLASS_VARIABLE && 
-                refTarget->browseName.namespaceIndex == 0 &&
-                UA_String_equal(&withBrowseName, &refTarget->browseName.name)) {
-                return (const UA_VariableNode*) refTarget;
-            }
+    const UA_NodeReferenceKind *rk =
+        UA_Node_findReferenceKind((const UA_Node*)ofMethod, &hasProperty, false);
+    if(!rk)
+        return NULL;
+    for(size_t i = 0; i < rk->targetIdsSize; i++) {
+        const UA_Node *refTarget = UA_NodeStore_get(server->nodestore, &rk->targetIds[i].nodeId);
+        if(!refTarget)
+            continue;
+        if(refTarget->nodeClass == UA_NODECLASS_VARIABLE && 
+            refTarget->browseName.namespaceIndex == 0 &&
+            UA_String_equal(&withBrowseName, &refTarget->browseName.name)) {
+            return (const UA_VariableNode*) refTarget;
         }
     }
     return NULL;
@@ -131,16 +131,13 @@ Service_Call_single(UA_Server *server, UA_Session *session, const UA_CallMethodR
     /* Verify method/object relations */
     // Object must have a hasComponent reference (or any inherited referenceType from sayd reference) 
     // to be valid for a methodCall...
+    // FIXME: Not checking any subtypes of HasComponent at the moment
     result->statusCode = UA_STATUSCODE_BADMETHODINVALID;
-    for(size_t i = 0; i < withObject->referencesSize; i++) {
-        if(withObject->references[i].referenceTypeId.identifier.numeric == UA_NS0ID_HASCOMPONENT) {
-            // FIXME: Not checking any subtypes of HasComponent at the moment
-            if(UA_NodeId_equal(&withObject->references[i].targetId.nodeId, &methodCalled->nodeId)) {
-                result->statusCode = UA_STATUSCODE_GOOD;
-                break;
-            }
-        }
-    }
+    const UA_NodeId hasComponent = UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT);
+    const UA_NodeReferenceKind *rk =
+        UA_Node_findReferenceKind((const UA_Node*)withObject, &hasComponent, false);
+    if(rk && UA_NodeReferenceKind_findTarget(rk, &methodCalled->nodeId) < rk->targetIdsSize)
+        result->statusCode = UA_STATUSCODE_GOOD;
     if(result->statusCode != UA_STATUSCODE_GOOD)
         return;
         
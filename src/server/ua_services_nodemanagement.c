@@ -1,5 +1,6 @@
 #include "ua_server_internal.h"
 #include "ua_services.h"
+#include "ua_nodestore_hash.h"
 
 /************/
 /* Add Node */
@@ -11,14 +12,14 @@ Service_AddNodes_existing(UA_Server *server, UA_Session *session, UA_Node *node,
                           UA_AddNodesResult *result) {
     if(node->nodeId.namespaceIndex >= server->namespacesSize) {
         result->statusCode = UA_STATUSCODE_BADNODEIDINVALID;
-        UA_NodeStore_deleteNode(node);
+        UA_NodeStore_deleteNode(server->nodestore, node);
         return;
     }
 
     const UA_Node *parent = UA_NodeStore_get(server->nodestore, parentNodeId);
     if(!parent) {
         result->statusCode = UA_STATUSCODE_BADPARENTNODEIDINVALID;
-        UA_NodeStore_deleteNode(node);
+        UA_NodeStore_deleteNode(server->nodestore, node);
         return;
     }
 
@@ -26,19 +27,19 @@ Service_AddNodes_existing(UA_Server *server, UA_Session *session, UA_Node *node,
         (const UA_ReferenceTypeNode *)UA_NodeStore_get(server->nodestore, referenceTypeId);
     if(!referenceType) {
         result->statusCode = UA_STATUSCODE_BADREFERENCETYPEIDINVALID;
-        UA_NodeStore_deleteNode(node);
+        UA_NodeStore_deleteNode(server->nodestore, node);
         return;
     }
 
     if(referenceType->nodeClass != UA_NODECLASS_REFERENCETYPE) {
         result->statusCode = UA_STATUSCODE_BADREFERENCETYPEIDINVALID;
-        UA_NodeStore_deleteNode(node);
+        UA_NodeStore_deleteNode(server->nodestore, node);
         return;
     }
 
     if(referenceType->isAbstract == true) {
         result->statusCode = UA_STATUSCODE_BADREFERENCENOTALLOWED;
-        UA_NodeStore_deleteNode(node);
+        UA_NodeStore_deleteNode(server->nodestore, node);
         return;
     }
 
@@ -118,15 +119,11 @@ copyExistingVariable(UA_Server *server, UA_Session *session, const UA_NodeId *va
     UA_AddNodesItem_deleteMembers(&item);
 
     // now instantiate the variable for all hastypedefinition references
-    for(size_t i = 0; i < node->referencesSize; i++) {
-        UA_ReferenceNode *rn = &node->references[i];
-        if(rn->isInverse)
-            continue;
-        const UA_NodeId hasTypeDef = UA_NODEID_NUMERIC(0, UA_NS0ID_HASTYPEDEFINITION);
-        if(!UA_NodeId_equal(&rn->referenceTypeId, &hasTypeDef))
-            continue;
-        instantiateVariableNode(server, session, &res.addedNodeId, &rn->targetId.nodeId, instantiationCallback);
-    }
+    const UA_NodeId hasTypeDef = UA_NODEID_NUMERIC(0, UA_NS0ID_HASTYPEDEFINITION);
+    const UA_NodeReferenceKind *rk = UA_Node_findReferenceKind((const UA_Node*)node, &hasTypeDef, false);
+    for(size_t i = 0; rk && i < rk->targetIdsSize; i++)
+        instantiateVariableNode(server, session, &res.addedNodeId, &rk->targetIds[i].nodeId,
+                                instantiationCallback);
     
     if (instantiationCallback != NULL)
       instantiationCallback->method(res.addedNodeId, node->nodeId, instantiationCallback->handle);
@@ -175,15 +172,11 @@ copyExistingObject(UA_Server *server, UA_Session *session, const UA_NodeId *vari
     UA_AddNodesItem_deleteMembers(&item);
 
     // now instantiate the object for all hastypedefinition references
-    for(size_t i = 0; i < node->referencesSize; i++) {
-        UA_ReferenceNode *rn = &node->references[i];
-        if(rn->isInverse)
-            continue;
-        const UA_NodeId hasTypeDef = UA_NODEID_NUMERIC(0, UA_NS0ID_HASTYPEDEFINITION);
-        if(!UA_NodeId_equal(&rn->referenceTypeId, &hasTypeDef))
-            continue;
-        instantiateObjectNode(server, session, &res.addedNodeId, &rn->targetId.nodeId, instantiationCallback);
-    }
+    const UA_NodeId hasTypeDef = UA_NODEID_NUMERIC(0, UA_NS0ID_HASTYPEDEFINITION);
+    const UA_NodeReferenceKind *rk = UA_Node_findReferenceKind((const UA_Node*)node, &hasTypeDef, false);
+    for(size_t i = 0; rk && i < rk->targetIdsSize; i++)
+        instantiateObjectNode(server, session, &res.addedNodeId, &rk->targetIds[i].nodeId,
+                              instantiationCallback);
     
     if (instantiationCallback != NULL)
       instantiationCallback->method(res.addedNodeId, node->nodeId, instantiationCallback->handle);
@@ -319,8 +312,8 @@ copyStandardAttributes(UA_Node *node, const UA_AddNodesItem *item, const UA_Node
 }
 
 static UA_Node *
-variableNodeFromAttributes(const UA_AddNodesItem *item, const UA_VariableAttributes *attr) {
-    UA_VariableNode *vnode = UA_NodeStore_newVariableNode();
+variableNodeFromAttributes(UA_NodeStore *ns, const UA_AddNodesItem *item, const UA_VariableAttributes *attr) {
+    UA_VariableNode *vnode = UA_NodeStore_newVariableNode(ns);
     if(!vnode)
         return NULL;
     UA_StatusCode retval = copyStandardAttributes((UA_Node*)vnode, item, (const UA_NodeAttributes*)attr);
@@ -332,29 +325,29 @@ variableNodeFromAttributes(const UA_AddNodesItem *item, const UA_VariableAttribu
     vnode->valueRank = attr->valueRank;
     retval |= UA_Variant_copy(&attr->value, &vnode->value.variant.value);
     if(retval != UA_STATUSCODE_GOOD) {
-        UA_NodeStore_deleteNode((UA_Node*)vnode);
+        UA_NodeStore_deleteNode(ns, (UA_Node*)vnode);
         return NULL;
     }
     return (UA_Node*)vnode;
 }
 
 static UA_Node *
-objectNodeFromAttributes(const UA_AddNodesItem *item, const UA_ObjectAttributes *attr) {
-    UA_ObjectNode *onode = UA_NodeStore_newObjectNode();
+objectNodeFromAttributes(UA_NodeStore *ns, const UA_AddNodesItem *item, const UA_ObjectAttributes *attr) {
+    UA_ObjectNode *onode = UA_NodeStore_newObjectNode(ns);
     if(!onode)
         return NULL;
     UA_StatusCode retval = copyStandardAttributes((UA_Node*)onode, item, (const UA_NodeAttributes*)attr);
     onode->eventNotifier = attr->eventNotifier;
     if(retval != UA_STATUSCODE_GOOD) {
-        UA_NodeStore_deleteNode((UA_Node*)onode);
+        UA_NodeStore_deleteNode(ns, (UA_Node*)onode);
         return NULL;
     }
     return (UA_Node*)onode;
 }
 
 static UA_Node *
-referenceTypeNodeFromAttributes(const UA_AddNodesItem *item, const UA_ReferenceTypeAttributes *attr) {
-    UA_ReferenceTypeNode *rtnode = UA_NodeStore_newReferenceTypeNode();
+referenceTypeNodeFromAttributes(UA_NodeStore *ns, const UA_AddNodesItem *item, const UA_ReferenceTypeAttributes *attr) {
+    UA_ReferenceTypeNode *rtnode = UA_NodeStore_newReferenceTypeNode(ns);
     if(!rtnode)
         return NULL;
     UA_StatusCode retval = copyStandardAttributes((UA_Node*)rtnode, item, (const UA_NodeAttributes*)attr);
@@ -362,29 +355,29 @@ referenceTypeNodeFromAttributes(const UA_AddNodesItem *item, const UA_ReferenceT
     rtnode->symmetric = attr->symmetric;
     retval |= UA_LocalizedText_copy(&attr->inverseName, &rtnode->inverseName);
     if(retval != UA_STATUSCODE_GOOD) {
-        UA_NodeStore_deleteNode((UA_Node*)rtnode);
+        UA_NodeStore_deleteNode(ns, (UA_Node*)rtnode);
         return NULL;
     }
     return (UA_Node*)rtnode;
 }
 
 static UA_Node *
-objectTypeNodeFromAttributes(const UA_AddNodesItem *item, const UA_ObjectTypeAttributes *attr) {
-    UA_ObjectTypeNode *otnode = UA_NodeStore_newObjectTypeNode();
+objectTypeNodeFromAttributes(UA_NodeStore *ns, const UA_AddNodesItem *item, const UA_ObjectTypeAttributes *attr) {
+    UA_ObjectTypeNode *otnode = UA_NodeStore_newObjectTypeNode(ns);
     if(!otnode)
         return NULL;
     UA_StatusCode retval = copyStandardAttributes((UA_Node*)otnode, item, (const UA_NodeAttributes*)attr);
     otnode->isAbstract = attr->isAbstract;
     if(retval != UA_STATUSCODE_GOOD) {
-        UA_NodeStore_deleteNode((UA_Node*)otnode);
+        UA_NodeStore_deleteNode(ns, (UA_Node*)otnode);
         return NULL;
     }
     return (UA_Node*)otnode;
 }
 
 static UA_Node *
-variableTypeNodeFromAttributes(const UA_AddNodesItem *item, const UA_VariableTypeAttributes *attr) {
-    UA_VariableTypeNode *vtnode = UA_NodeStore_newVariableTypeNode();
+variableTypeNodeFromAttributes(UA_NodeStore *ns, const UA_AddNodesItem *item, const UA_VariableTypeAttributes *attr) {
+    UA_VariableTypeNode *vtnode = UA_NodeStore_newVariableTypeNode(ns);
     if(!vtnode)
         return NULL;
     UA_StatusCode retval = copyStandardAttributes((UA_Node*)vtnode, item, (const UA_NodeAttributes*)attr);
@@ -394,112 +387,104 @@ variableTypeNodeFromAttributes(const UA_AddNodesItem *item, const UA_VariableTyp
     // array dimensions are taken from the value
     vtnode->isAbstract = attr->isAbstract;
     if(retval != UA_STATUSCODE_GOOD) {
-        UA_NodeStore_deleteNode((UA_Node*)vtnode);
+        UA_NodeStore_deleteNode(ns, (UA_Node*)vtnode);
         return NULL;
     }
     return (UA_Node*)vtnode;
 }
 
 static UA_Node *
-viewNodeFromAttributes(const UA_AddNodesItem *item, const UA_ViewAttributes *attr) {
-    UA_ViewNode *vnode = UA_NodeStore_newViewNode();
+viewNodeFromAttributes(UA_NodeStore *ns, const UA_AddNodesItem *item, const UA_ViewAttributes *attr) {
+    UA_ViewNode *vnode = UA_NodeStore_newViewNode(ns);
     if(!vnode)
         return NULL;
     UA_StatusCode retval = copyStandardAttributes((UA_Node*)vnode, item, (const UA_NodeAttributes*)attr);
     vnode->containsNoLoops = attr->containsNoLoops;
     vnode->eventNotifier = attr->eventNotifier;
     if(retval != UA_STATUSCODE_GOOD) {
-        UA_NodeStore_deleteNode((UA_Node*)vnode);
+        UA_NodeStore_deleteNode(ns, (UA_Node*)vnode);
         return NULL;
     }
     return (UA_Node*)vnode;
 }
 
 static UA_Node *
-dataTypeNodeFromAttributes(const UA_AddNodesItem *item, const UA_DataTypeAttributes *attr) {
-    UA_DataTypeNode *dtnode = UA_NodeStore_newDataTypeNode();
+dataTypeNodeFromAttributes(UA_NodeStore *ns, const UA_AddNodesItem *item, const UA_DataTypeAttributes *attr) {
+    UA_DataTypeNode *dtnode = UA_NodeStore_newDataTypeNode(ns);
     if(!dtnode)
         return NULL;
     UA_StatusCode retval = copyStandardAttributes((UA_Node*)dtnode, item, (const UA_NodeAttributes*)attr);
     dtnode->isAbstract = attr->isAbstract;
     if(retval != UA_STATUSCODE_GOOD) {
-        UA_NodeStore_deleteNode((UA_Node*)dtnode);
+        UA_NodeStore_deleteNode(ns, (UA_Node*)dtnode);
         return NULL;
     }
     return (UA_Node*)dtnode;
 }
 
-void Service_AddNodes_single(UA_Server *server, UA_Session *session, const UA_AddNodesItem *item,
-                             UA_AddNodesResult *result, UA_InstantiationCallback *instantiationCallback) {
+/* Creates the node from the attributes in the item */
+static UA_StatusCode
+nodeFromAddNodesItem(UA_NodeStore *ns, const UA_AddNodesItem *item, UA_Node **outNode) {
     if(item->nodeAttributes.encoding < UA_EXTENSIONOBJECT_DECODED ||
-       !item->nodeAttributes.content.decoded.type) {
-        result->statusCode = UA_STATUSCODE_BADNODEATTRIBUTESINVALID;
-        return;
-    }
-    
-    /* create the node */
+       !item->nodeAttributes.content.decoded.type)
+        return UA_STATUSCODE_BADNODEATTRIBUTESINVALID;
+
     UA_Node *node;
     switch(item->nodeClass) {
     case UA_NODECLASS_OBJECT:
-        if(item->nodeAttributes.content.decoded.type != &UA_TYPES[UA_TYPES_OBJECTATTRIBUTES]) {
-            result->statusCode = UA_STATUSCODE_BADNODEATTRIBUTESINVALID;
-            return;
-        }
-        node = objectNodeFromAttributes(item, item->nodeAttributes.content.decoded.data);
+        if(item->nodeAttributes.content.decoded.type != &UA_TYPES[UA_TYPES_OBJECTATTRIBUTES])
+            return UA_STATUSCODE_BADNODEATTRIBUTESINVALID;
+        node = objectNodeFromAttributes(ns, item, item->nodeAttributes.content.decoded.data);
         break;
     case UA_NODECLASS_VARIABLE:
-        if(item->nodeAttributes.content.decoded.type != &UA_TYPES[UA_TYPES_VARIABLEATTRIBUTES]) {
-            result->statusCode = UA_STATUSCODE_BADNODEATTRIBUTESINVALID;
-            return;
-        }
-        node = variableNodeFromAttributes(item, item->nodeAttributes.content.decoded.data);
+        if(item->nodeAttributes.content.decoded.type != &UA_TYPES[UA_TYPES_VARIABLEATTRIBUTES])
+            return UA_STATUSCODE_BADNODEATTRIBUTESINVALID;
+        node = variableNodeFromAttributes(ns, item, item->nodeAttributes.content.decoded.data);
         break;
     case UA_NODECLASS_OBJECTTYPE:
-        if(item->nodeAttributes.content.decoded.type != &UA_TYPES[UA_TYPES_OBJECTTYPEATTRIBUTES]) {
-            result->statusCode = UA_STATUSCODE_BADNODEATTRIBUTESINVALID;
-            return;
-        }
-        node = objectTypeNodeFromAttributes(item, item->nodeAttributes.content.decoded.data);
+        if(item->nodeAttributes.content.decoded.type != &UA_TYPES[UA_TYPES_OBJECTTYPEATTRIBUTES])
+            return UA_STATUSCODE_BADNODEATTRIBUTESINVALID;
+        node = objectTypeNodeFromAttributes(ns, item, item->nodeAttributes.content.decoded.data);
         break;
     case UA_NODECLASS_VARIABLETYPE:
-        if(item->nodeAttributes.content.decoded.type != &UA_TYPES[UA_TYPES_VARIABLETYPEATTRIBUTES]) {
-            result->statusCode = UA_STATUSCODE_BADNODEATTRIBUTESINVALID;
-            return;
-        }
-        node = variableTypeNodeFromAttributes(item, item->nodeAttributes.content.decoded.data);
+        if(item->nodeAttributes.content.decoded.type != &UA_TYPES[UA_TYPES_VARIABLETYPEATTRIBUTES])
+            return UA_STATUSCODE_BADNODEATTRIBUTESINVALID;
+        node = variableTypeNodeFromAttributes(ns, item, item->nodeAttributes.content.decoded.data);
         break;
     case UA_NODECLASS_REFERENCETYPE:
-        if(item->nodeAttributes.content.decoded.type != &UA_TYPES[UA_TYPES_REFERENCETYPEATTRIBUTES]) {
-            result->statusCode = UA_STATUSCODE_BADNODEATTRIBUTESINVALID;
-            return;
-        }
-        node = referenceTypeNodeFromAttributes(item, item->nodeAttributes.content.decoded.data);
+        if(item->nodeAttributes.content.decoded.type != &UA_TYPES[UA_TYPES_REFERENCETYPEATTRIBUTES])
+            return UA_STATUSCODE_BADNODEATTRIBUTESINVALID;
+        node = referenceTypeNodeFromAttributes(ns, item, item->nodeAttributes.content.decoded.data);
         break;
     case UA_NODECLASS_DATATYPE:
-        if(item->nodeAttributes.content.decoded.type != &UA_TYPES[UA_TYPES_DATATYPEATTRIBUTES]) {
-            result->statusCode = UA_STATUSCODE_BADNODEATTRIBUTESINVALID;
-            return;
-        }
-        node = dataTypeNodeFromAttributes(item, item->nodeAttributes.content.decoded.data);
+        if(item->nodeAttributes.content.decoded.type != &UA_TYPES[UA_TYPES_DATATYPEATTRIBUTES])
+            return UA_STATUSCODE_BADNODEATTRIBUTESINVALID;
+        node = dataTypeNodeFromAttributes(ns, item, item->nodeAttributes.content.decoded.data);
         break;
     case UA_NODECLASS_VIEW:
-        if(item->nodeAttributes.content.decoded.type != &UA_TYPES[UA_TYPES_VIEWATTRIBUTES]) {
-            result->statusCode = UA_STATUSCODE_BADNODEATTRIBUTESINVALID;
-            return;
-        }
-        node = viewNodeFromAttributes(item, item->nodeAttributes.content.decoded.data);
+        if(item->nodeAttributes.content.decoded.type != &UA_TYPES[UA_TYPES_VIEWATTRIBUTES])
+            return UA_STATUSCODE_BADNODEATTRIBUTESINVALID;
+        node = viewNodeFromAttributes(ns, item, item->nodeAttributes.content.decoded.data);
         break;
     case UA_NODECLASS_METHOD:
     case UA_NODECLASS_UNSPECIFIED:
     default:
-        result->statusCode = UA_STATUSCODE_BADNODECLASSINVALID;
-        return;
+        return UA_STATUSCODE_BADNODECLASSINVALID;
     }
 
-    if(!node) {
-        result->statusCode = UA_STATUSCODE_BADOUTOFMEMORY;
+    if(!node)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    *outNode = node;
+    return UA_STATUSCODE_GOOD;
+}
+
+void Service_AddNodes_single(UA_Server *server, UA_Session *session, const UA_AddNodesItem *item,
+                             UA_AddNodesResult *result, UA_InstantiationCallback *instantiationCallback) {
+    /* create the node */
+    UA_Node *node = NULL;
+    result->statusCode = nodeFromAddNodesItem(server->nodestore, item, &node);
+    if(result->statusCode != UA_STATUSCODE_GOOD)
         return;
-    }
 
     /* add it to the server */
     Service_AddNodes_existing(server, session, node, &item->parentNodeId.nodeId,
@@ -606,7 +591,7 @@ UA_Server_addDataSourceVariableNode(UA_Server *server, const UA_NodeId requested
         return result.statusCode;
     }
 
-    UA_VariableNode *node = UA_NodeStore_newVariableNode();
+    UA_VariableNode *node = UA_NodeStore_newVariableNode(server->nodestore);
     if(!node) {
         UA_AddNodesItem_deleteMembers(&item);
         UA_VariableAttributes_deleteMembers(&attrCopy);
@@ -664,7 +649,7 @@ UA_Server_addMethodNode(UA_Server *server, const UA_NodeId requestedNewNodeId,
         return result.statusCode;
     }
 
-    UA_MethodNode *node = UA_NodeStore_newMethodNode();
+    UA_MethodNode *node = UA_NodeStore_newMethodNode(server->nodestore);
     if(!node) {
         result.statusCode = UA_STATUSCODE_BADOUTOFMEMORY;
         UA_AddNodesItem_deleteMembers(&item);
@@ -692,7 +677,7 @@ UA_Server_addMethodNode(UA_Server *server, const UA_NodeId requestedNewNodeId,
     parent.nodeId = result.addedNodeId;
     
     const UA_NodeId hasproperty = UA_NODEID_NUMERIC(0, UA_NS0ID_HASPROPERTY);
-    UA_VariableNode *inputArgumentsVariableNode = UA_NodeStore_newVariableNode();
+    UA_VariableNode *inputArgumentsVariableNode = UA_NodeStore_newVariableNode(server->nodestore);
     inputArgumentsVariableNode->nodeId.namespaceIndex = result.addedNodeId.namespaceIndex;
     inputArgumentsVariableNode->browseName = UA_QUALIFIEDNAME_ALLOC(0, "InputArguments");
     inputArgumentsVariableNode->displayName = UA_LOCALIZEDTEXT_ALLOC("en_US", "InputArguments");
@@ -709,7 +694,7 @@ UA_Server_addMethodNode(UA_Server *server, const UA_NodeId requestedNewNodeId,
     UA_AddNodesResult_deleteMembers(&inputAddRes);
     
     /* create OutputArguments */
-    UA_VariableNode *outputArgumentsVariableNode  = UA_NodeStore_newVariableNode();
+    UA_VariableNode *outputArgumentsVariableNode  = UA_NodeStore_newVariableNode(server->nodestore);
     outputArgumentsVariableNode->nodeId.namespaceIndex = result.addedNodeId.namespaceIndex;
     outputArgumentsVariableNode->browseName  = UA_QUALIFIEDNAME_ALLOC(0, "OutputArguments");
     outputArgumentsVariableNode->displayName = UA_LOCALIZEDTEXT_ALLOC("en_US", "OutputArguments");
@@ -741,21 +726,8 @@ UA_Server_addMethodNode(UA_Server *server, const UA_NodeId requestedNewNodeId,
 /* Adds a one-way reference to the local nodestore */
 static UA_StatusCode
 addOneWayReference(UA_Server *server, UA_Session *session, UA_Node *node, const UA_AddReferencesItem *item) {
-	size_t i = node->referencesSize;
-    size_t refssize = (i+1) | 3; // so the realloc is not necessary every time
-	UA_ReferenceNode *new_refs = UA_realloc(node->references, sizeof(UA_ReferenceNode) * refssize);
-	if(!new_refs)
-		return UA_STATUSCODE_BADOUTOFMEMORY;
-    node->references = new_refs;
-    UA_ReferenceNode_init(&new_refs[i]);
-    UA_StatusCode retval = UA_NodeId_copy(&item->referenceTypeId, &new_refs[i].referenceTypeId);
-    retval |= UA_ExpandedNodeId_copy(&item->targetNodeId, &new_refs[i].targetId);
-    new_refs[i].isInverse = !item->isForward;
-    if(retval == UA_STATUSCODE_GOOD) 
-        node->referencesSize = i+1;
-    else
-        UA_ReferenceNode_deleteMembers(&new_refs[i]);
-	return retval;
+    return UA_Node_addReference(node, &item->referenceTypeId, &item->targetNodeId, !item->isForward,
+                                UA_NodeStore_internTable(server->nodestore));
 }
 
 UA_StatusCode
@@ -779,6 +751,13 @@ Service_AddReferences_single(UA_Server *server, UA_Session *session, const UA_Ad
                                 (UA_EditNodeCallback)addOneWayReference, &secondItem);
 
     // todo: remove reference if the second direction failed
+    const UA_NodeId hasSubtype = UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
+    if(retval == UA_STATUSCODE_GOOD && UA_NodeId_equal(&item->referenceTypeId, &hasSubtype)) {
+        if(item->isForward)
+            UA_Server_addSubtype(server, &item->sourceNodeId, &item->targetNodeId.nodeId);
+        else
+            UA_Server_addSubtype(server, &item->targetNodeId.nodeId, &item->sourceNodeId);
+    }
     return retval;
 } 
 
@@ -850,9 +829,16 @@ Service_DeleteNodes_single(UA_Server *server, UA_Session *session, const UA_Node
         delItem.deleteBidirectional = false;
         delItem.targetNodeId.nodeId = *nodeId;
         for(size_t i = 0; i < node->referencesSize; i++) {
-            delItem.sourceNodeId = node->references[i].targetId.nodeId;
-            delItem.isForward = node->references[i].isInverse;
-            Service_DeleteReferences_single(server, session, &delItem);
+            const UA_NodeReferenceKind *rk = &node->references[i];
+            delItem.referenceTypeId = rk->referenceTypeId;
+            delItem.isForward = rk->isInverse;
+            for(size_t j = 0; j < rk->targetIdsSize; j++) {
+                /* the node itself is not edited during the iteration */
+                if(UA_NodeId_equal(&rk->targetIds[j].nodeId, nodeId))
+                    continue;
+                delItem.sourceNodeId = rk->targetIds[j].nodeId;
+                Service_DeleteReferences_single(server, session, &delItem);
+            }
         }
     }
 
@@ -887,6 +873,10 @@ Service_DeleteNodes_single(UA_Server *server, UA_Session *session, const UA_Node
         UA_BrowseResult_deleteMembers(&result);
     }
     
+    /* the subtype hierarchy changes */
+    if(node->nodeClass == UA_NODECLASS_REFERENCETYPE || node->nodeClass == UA_NODECLASS_DATATYPE ||
+       node->nodeClass == UA_NODECLASS_OBJECTTYPE || node->nodeClass == UA_NODECLASS_VARIABLETYPE)
+        UA_Server_invalidateSubtypes(server);
     return UA_NodeStore_remove(server->nodestore, nodeId);
 }
 
@@ -916,29 +906,8 @@ void Service_DeleteNodes(UA_Server *server, UA_Session *session, const UA_Delete
 static UA_StatusCode
 deleteOneWayReference(UA_Server *server, UA_Session *session, UA_Node *node,
                       const UA_DeleteReferencesItem *item) {
-    UA_Boolean edited = false;
-    for(size_t i = node->referencesSize - 1; ; i--) {
-        if(i > node->referencesSize)
-            break; /* underflow after i == 0 */
-        if(!UA_NodeId_equal(&item->targetNodeId.nodeId, &node->references[i].targetId.nodeId))
-            continue;
-        if(!UA_NodeId_equal(&item->referenceTypeId, &node->references[i].referenceTypeId))
-            continue;
-        if(item->isForward == node->references[i].isInverse)
-            continue;
-        /* move the last entry to override the current position */
-        UA_ReferenceNode_deleteMembers(&node->references[i]);
-        node->references[i] = node->references[node->referencesSize-1];
-        node->referencesSize--;
-        edited = true;
-        break;
-    }
-    if(!edited)
-        return UA_STATUSCODE_UNCERTAINREFERENCENOTDELETED;
-    /* we removed the last reference */
-    if(node->referencesSize == 0 && node->references)
-        UA_free(node->references);
-    return UA_STATUSCODE_GOOD;;
+    return UA_Node_deleteReference(node, &item->referenceTypeId, &item->targetNodeId.nodeId,
+                                   !item->isForward, UA_NodeStore_internTable(server->nodestore));
 }
 
 UA_StatusCode
@@ -946,10 +915,14 @@ Service_DeleteReferences_single(UA_Server *server, UA_Session *session,
                                 const UA_DeleteReferencesItem *item) {
     UA_StatusCode retval = UA_Server_editNode(server, session, &item->sourceNodeId,
                                               (UA_EditNodeCallback)deleteOneWayReference, item);
+    const UA_NodeId hasSubtype = UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
+    if(retval == UA_STATUSCODE_GOOD && UA_NodeId_equal(&item->referenceTypeId, &hasSubtype))
+        UA_Server_invalidateSubtypes(server);
     if(!item->deleteBidirectional || item->targetNodeId.serverIndex != 0)
         return retval;
     UA_DeleteReferencesItem secondItem;
     UA_DeleteReferencesItem_init(&secondItem);
+    secondItem.referenceTypeId = item->referenceTypeId;
     secondItem.isForward = !item->isForward;
     secondItem.sourceNodeId = item->targetNodeId.nodeId;
     secondItem.targetNodeId.nodeId = item->sourceNodeId;
@@ -12,7 +12,7 @@ void Service_CreateSubscription(UA_Server *server, UA_Session *session,
                                 const UA_CreateSubscriptionRequest *request,
                                 UA_CreateSubscriptionResponse *response) {
     response->subscriptionId = UA_Session_getUniqueSubscriptionID(session);
-    UA_Subscription *newSubscription = UA_Subscription_new(response->subscriptionId);
+    UA_Subscription *newSubscription = UA_Subscription_new(session, response->subscriptionId);
     if(!newSubscription) {
         response->responseHeader.serviceResult = UA_STATUSCODE_BADOUTOFMEMORY;
         return;
@@ -49,6 +49,65 @@ void Service_CreateSubscription(UA_Server *server, UA_Session *session,
     UA_Session_addSubscription(session, newSubscription);    
 }
 
+/* The EURange property of an analog item */
+static const UA_Range *
+findEURange(UA_Server *server, const UA_Node *target) {
+    const UA_NodeId hasProperty = UA_NODEID_NUMERIC(0, UA_NS0ID_HASPROPERTY);
+    const UA_NodeReferenceKind *rk = UA_Node_findReferenceKind(target, &hasProperty, false);
+    UA_String euRange = UA_STRING("EURange");
+    for(size_t i = 0; rk && i < rk->targetIdsSize; i++) {
+        const UA_Node *property = UA_NodeStore_get(server->nodestore, &rk->targetIds[i].nodeId);
+        if(!property || property->nodeClass != UA_NODECLASS_VARIABLE ||
+           !UA_String_equal(&property->browseName.name, &euRange))
+            continue;
+        const UA_VariableNode *vn = (const UA_VariableNode*)property;
+        if(vn->valueSource != UA_VALUESOURCE_VARIANT ||
+           !UA_Variant_isScalar(&vn->value.variant.value) ||
+           vn->value.variant.value.type != &UA_TYPES[UA_TYPES_RANGE])
+            return NULL;
+        return (const UA_Range*)vn->value.variant.value.data;
+    }
+    return NULL;
+}
+
+static UA_StatusCode
+setDataChangeFilter(UA_Server *server, UA_MonitoredItem *mon, const UA_Node *target,
+                    const UA_ExtensionObject *filter) {
+    if(filter->encoding == UA_EXTENSIONOBJECT_ENCODED_NOBODY)
+        return UA_STATUSCODE_GOOD;
+    if(filter->encoding < UA_EXTENSIONOBJECT_DECODED ||
+       filter->content.decoded.type != &UA_TYPES[UA_TYPES_DATACHANGEFILTER])
+        return UA_STATUSCODE_BADMONITOREDITEMFILTERUNSUPPORTED;
+    if(mon->attributeID != UA_ATTRIBUTEID_VALUE)
+        return UA_STATUSCODE_BADFILTERNOTALLOWED;
+
+    const UA_DataChangeFilter *dcf = filter->content.decoded.data;
+    if(dcf->trigger > UA_DATACHANGETRIGGER_STATUSVALUETIMESTAMP)
+        return UA_STATUSCODE_BADMONITOREDITEMFILTERINVALID;
+    mon->trigger = dcf->trigger;
+    switch(dcf->deadbandType) {
+    case UA_DEADBANDTYPE_NONE:
+        break;
+    case UA_DEADBANDTYPE_ABSOLUTE:
+        if(dcf->deadbandValue < 0.0)
+            return UA_STATUSCODE_BADDEADBANDFILTERINVALID;
+        mon->deadband = dcf->deadbandValue;
+        break;
+    case UA_DEADBANDTYPE_PERCENT: {
+        if(dcf->deadbandValue < 0.0 || dcf->deadbandValue > 100.0)
+            return UA_STATUSCODE_BADDEADBANDFILTERINVALID;
+        const UA_Range *range = findEURange(server, target);
+        if(!range)
+            return UA_STATUSCODE_BADFILTERNOTALLOWED;
+        mon->deadband = dcf->deadbandValue / 100.0 * (range->high - range->low);
+        break;
+    }
+    default:
+        return UA_STATUSCODE_BADDEADBANDFILTERINVALID;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
 static void
 createMonitoredItems(UA_Server *server, UA_Session *session, UA_Subscription *sub,
                      const UA_MonitoredItemCreateRequest *request, UA_MonitoredItemCreateResult *result) {
@@ -67,7 +126,7 @@ createMonitoredItems(UA_Server *server, UA_Session *session, UA_Subscription *su
     UA_StatusCode retval = UA_NodeId_copy(&target->nodeId, &newMon->monitoredNodeId);
     if(retval != UA_STATUSCODE_GOOD) {
         result->statusCode = UA_STATUSCODE_BADOUTOFMEMORY;
-        MonitoredItem_delete(newMon);
+        MonitoredItem_delete(server, newMon);
         return;
     }
 
@@ -86,16 +145,36 @@ createMonitoredItems(UA_Server *server, UA_Session *session, UA_Subscription *su
                                request->requestedParameters.queueSize,
                                result->revisedQueueSize);
     newMon->queueSize = (UA_BoundedUInt32) {
-        .max=(result->revisedQueueSize) + 1,
-        .min=0, .current=0 };
+        .max=0, .min=0, .current=0 };
+    retval = MonitoredItem_setQueueSize(newMon, result->revisedQueueSize + 1);
+    if(retval != UA_STATUSCODE_GOOD) {
+        result->statusCode = retval;
+        MonitoredItem_delete(server, newMon);
+        return;
+    }
 
     newMon->attributeID = request->itemToMonitor.attributeId;
     newMon->monitoredItemType = MONITOREDITEM_TYPE_CHANGENOTIFY;
     newMon->discardOldest = request->requestedParameters.discardOldest;
+    retval = setDataChangeFilter(server, newMon, target, &request->requestedParameters.filter);
+    if(retval != UA_STATUSCODE_GOOD) {
+        result->statusCode = retval;
+        MonitoredItem_delete(server, newMon);
+        return;
+    }
+
+    /* writes to the node notify the item */
+    retval = MonitoredItem_register(server, newMon, target);
+    if(retval != UA_STATUSCODE_GOOD) {
+        result->statusCode = retval;
+        MonitoredItem_delete(server, newMon);
+        return;
+    }
     LIST_INSERT_HEAD(&sub->MonitoredItems, newMon, listEntry);
+    newMon->subscription = sub;
 
-    // todo: add a job that samples the value (for fixed intervals)
-    // todo: add a pointer to the monitoreditem to the variable, so that events get propagated
+    /* queue the initial value */
+    MonitoredItem_QueuePushDataValue(server, newMon);
 }
 
 void Service_CreateMonitoredItems(UA_Server *server, UA_Session *session,
@@ -126,95 +205,80 @@ void Service_CreateMonitoredItems(UA_Server *server, UA_Session *session,
 void
 Service_Publish(UA_Server *server, UA_Session *session, const UA_PublishRequest *request,
                 UA_UInt32 requestId) {
-    UA_PublishResponse response;
-    UA_PublishResponse_init(&response);
-    response.responseHeader.requestHandle = request->requestHeader.requestHandle;
-    response.responseHeader.timestamp = UA_DateTime_now();
+    UA_PublishResponseEntry *entry = UA_malloc(sizeof(UA_PublishResponseEntry));
+    if(!entry)
+        return;
+    entry->requestId = requestId;
+    entry->maxTime = 0;
+    if(request->requestHeader.timeoutHint > 0)
+        entry->maxTime = UA_DateTime_now() +
+            (UA_DateTime)request->requestHeader.timeoutHint * UA_MSEC_TO_DATETIME;
+    UA_PublishResponse *response = &entry->response;
+    UA_PublishResponse_init(response);
+    response->responseHeader.requestHandle = request->requestHeader.requestHandle;
+    response->responseHeader.timestamp = UA_DateTime_now();
+
+    // Without subscriptions, the request would never be answered
+    if(LIST_EMPTY(&session->serverSubscriptions)) {
+        response->responseHeader.serviceResult = UA_STATUSCODE_BADNOSUBSCRIPTION;
+        UA_Session_sendPublishResponse(session, entry);
+        return;
+    }
     
     // Delete Acknowledged Subscription Messages
-    response.resultsSize = request->subscriptionAcknowledgementsSize;
-    response.results = UA_calloc(response.resultsSize, sizeof(UA_StatusCode));
+    if(request->subscriptionAcknowledgementsSize > 0) {
+        response->results = UA_Array_new(request->subscriptionAcknowledgementsSize,
+                                         &UA_TYPES[UA_TYPES_STATUSCODE]);
+        if(!response->results) {
+            response->responseHeader.serviceResult = UA_STATUSCODE_BADOUTOFMEMORY;
+            UA_Session_sendPublishResponse(session, entry);
+            return;
+        }
+        response->resultsSize = request->subscriptionAcknowledgementsSize;
+    }
     for(size_t i = 0; i < request->subscriptionAcknowledgementsSize; i++) {
-        response.results[i] = UA_STATUSCODE_GOOD;
         UA_UInt32 sid = request->subscriptionAcknowledgements[i].subscriptionId;
         UA_Subscription *sub = UA_Session_getSubscriptionByID(session, sid);
         if(!sub) {
-            response.results[i] = UA_STATUSCODE_BADSUBSCRIPTIONIDINVALID;
+            response->results[i] = UA_STATUSCODE_BADSUBSCRIPTIONIDINVALID;
             continue;
         }
-        UA_UInt32 sn = request->subscriptionAcknowledgements[i].sequenceNumber;
-        if(Subscription_deleteUnpublishedNotification(sn, false, sub) == 0)
-            response.results[i] = UA_STATUSCODE_BADSEQUENCENUMBERINVALID;
+        response->results[i] =
+            Subscription_acknowledge(server, sub, request->subscriptionAcknowledgements[i].sequenceNumber);
     }
-    
-    UA_Boolean have_response = false;
 
-    // See if any new data is available
+    // Make room by answering the oldest request
+    UA_DateTime now = UA_DateTime_now();
+    UA_Session_expirePublishRequests(session, now);
+    if(session->responseQueueSize >= server->config.maxPublishRequestsPerSession) {
+        UA_PublishResponseEntry *oldest = TAILQ_FIRST(&session->responseQueue);
+        if(!oldest) {
+            response->responseHeader.serviceResult = UA_STATUSCODE_BADTOOMANYPUBLISHREQUESTS;
+            UA_Session_sendPublishResponse(session, entry);
+            return;
+        }
+        TAILQ_REMOVE(&session->responseQueue, oldest, listEntry);
+        session->responseQueueSize--;
+        oldest->response.responseHeader.timestamp = now;
+        oldest->response.responseHeader.serviceResult = UA_STATUSCODE_BADTOOMANYPUBLISHREQUESTS;
+        UA_Session_sendPublishResponse(session, oldest);
+    }
+    TAILQ_INSERT_TAIL(&session->responseQueue, entry, listEntry);
+    session->responseQueueSize++;
+
+    // Late subscriptions answer right away. Otherwise, the request waits for
+    // the next notification or keep-alive of a subscription.
     UA_Subscription *sub;
     LIST_FOREACH(sub, &session->serverSubscriptions, listEntry) {
         if(sub->timedUpdateIsRegistered == false) {
-            // FIXME: We are forcing a value update for monitored items. This should be done by the event system.
-            // NOTE:  There is a clone of this functionality in the Subscription_timedUpdateNotificationsJob
-            UA_MonitoredItem *mon;
-            LIST_FOREACH(mon, &sub->MonitoredItems, listEntry)
-                MonitoredItem_QueuePushDataValue(server, mon);
-            
             // FIXME: We are forcing notification updates for the subscription. This
             // should be done by a timed work item.
-            Subscription_updateNotifications(sub);
-        }
-        
-        if(sub->unpublishedNotificationsSize == 0)
-            continue;
-        
-        // This subscription has notifications in its queue (top NotificationMessage exists in the queue). 
-        // Due to republish, we need to check if there are any unplublished notifications first ()
-        UA_unpublishedNotification *notification = NULL;
-        LIST_FOREACH(notification, &sub->unpublishedNotifications, listEntry) {
-            if (notification->publishedOnce == false)
-                break;
-        }
-        if (notification == NULL)
-            continue;
-    
-        // We found an unpublished notification message in this subscription, which we will now publish.
-        response.subscriptionId = sub->subscriptionID;
-        Subscription_copyNotificationMessage(&response.notificationMessage, notification);
-        // Mark this notification as published
-        notification->publishedOnce = true;
-        if(notification->notification.sequenceNumber > sub->sequenceNumber) {
-            // If this is a keepalive message, its seqNo is the next seqNo to be used for an actual msg.
-            response.availableSequenceNumbersSize = 0;
-            // .. and must be deleted
-            Subscription_deleteUnpublishedNotification(sub->sequenceNumber + 1, false, sub);
-        } else {
-            response.availableSequenceNumbersSize = sub->unpublishedNotificationsSize;
-            response.availableSequenceNumbers = Subscription_getAvailableSequenceNumbers(sub);
-        }	  
-        have_response = true;
-    }
-    
-    if(!have_response) {
-        // FIXME: At this point, we would return nothing and "queue" the publish
-        // request, but currently we need to return something to the client. If no
-        // subscriptions have notifications, force one to generate a keepalive so we
-        // don't return an empty message
-        sub = LIST_FIRST(&session->serverSubscriptions);
-        if(sub) {
-            response.subscriptionId = sub->subscriptionID;
-            sub->keepAliveCount.current=sub->keepAliveCount.min;
-            Subscription_generateKeepAlive(sub);
-            Subscription_copyNotificationMessage(&response.notificationMessage,
-                                                 LIST_FIRST(&sub->unpublishedNotifications));
-            Subscription_deleteUnpublishedNotification(sub->sequenceNumber + 1, false, sub);
+            Subscription_updateNotifications(server, sub);
         }
+        while(Subscription_publish(server, sub)) {}
+        if(TAILQ_EMPTY(&session->responseQueue))
+            break;
     }
-    
-    UA_SecureChannel *channel = session->channel;
-    if(channel)
-        UA_SecureChannel_sendBinaryMessage(channel, requestId, &response,
-                                           &UA_TYPES[UA_TYPES_PUBLISHRESPONSE]);
-    UA_PublishResponse_deleteMembers(&response);
 }
 
 void
@@ -285,7 +349,7 @@ void Service_DeleteMonitoredItems(UA_Server *server, UA_Session *session,
 
     for(size_t i = 0; i < request->monitoredItemIdsSize; i++)
         response->results[i] =
-            UA_Session_deleteMonitoredItem(session, sub->subscriptionID,
+            UA_Session_deleteMonitoredItem(server, session, sub->subscriptionID,
                                            request->monitoredItemIds[i]);
 }
 
@@ -297,30 +361,15 @@ void Service_Republish(UA_Server *server, UA_Session *session, const UA_Republis
         return;
     }
     
-    // Find the notification in question
-    UA_unpublishedNotification *notification;
-    LIST_FOREACH(notification, &sub->unpublishedNotifications, listEntry) {
-        if(notification->notification.sequenceNumber == request->retransmitSequenceNumber)
-            break;
-    }
-    if(!notification) {
-      response->responseHeader.serviceResult = UA_STATUSCODE_BADSEQUENCENUMBERINVALID;
+    // Find the notification in question. By spec, it has to be in the
+    // retransmission queue, i.e. it was sent before.
+    UA_unpublishedNotification *notification =
+        Subscription_getNotification(sub, request->retransmitSequenceNumber);
+    if(!notification || request->retransmitSequenceNumber >= sub->unsentSequenceNumber) {
+      response->responseHeader.serviceResult = UA_STATUSCODE_BADMESSAGENOTAVAILABLE;
       return;
     }
     
-    // FIXME: By spec, this notification has to be in the "retransmit queue", i.e. publishedOnce must be
-    //        true. If this is not tested, the client just gets what he asks for... hence this part is
-    //        commented:
-    /* Check if the notification is in the published queue
-    if (notification->publishedOnce == false) {
-      response->responseHeader.serviceResult = UA_STATUSCODE_BADSUBSCRIPTIONIDINVALID;
-      return;
-    }
-    */
     // Retransmit 
     Subscription_copyNotificationMessage(&response->notificationMessage, notification);
-    // Mark this notification as published
-    notification->publishedOnce = true;
-    
-    return;
 }
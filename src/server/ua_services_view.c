@@ -2,7 +2,7 @@
 #include "ua_services.h"
 
 static UA_StatusCode
-fillReferenceDescription(UA_NodeStore *ns, const UA_Node *curr, UA_ReferenceNode *ref,
+fillReferenceDescription(UA_NodeStore *ns, const UA_Node *curr, const UA_NodeReferenceKind *ref,
                          UA_UInt32 mask, UA_ReferenceDescription *descr) {
     UA_ReferenceDescription_init(descr);
     UA_StatusCode retval = UA_NodeId_copy(&curr->nodeId, &descr->nodeId.nodeId);
@@ -18,13 +18,10 @@ fillReferenceDescription(UA_NodeStore *ns, const UA_Node *curr, UA_ReferenceNode
         retval |= UA_LocalizedText_copy(&curr->displayName, &descr->displayName);
     if(mask & UA_BROWSERESULTMASK_TYPEDEFINITION){
         if(curr->nodeClass == UA_NODECLASS_OBJECT || curr->nodeClass == UA_NODECLASS_VARIABLE) {
-            for(size_t i = 0; i < curr->referencesSize; i++) {
-                UA_ReferenceNode *refnode = &curr->references[i];
-                if(refnode->referenceTypeId.identifier.numeric != UA_NS0ID_HASTYPEDEFINITION)
-                    continue;
-                retval |= UA_ExpandedNodeId_copy(&refnode->targetId, &descr->typeDefinition);
-                break;
-            }
+            const UA_NodeId hasTypeDef = UA_NODEID_NUMERIC(0, UA_NS0ID_HASTYPEDEFINITION);
+            const UA_NodeReferenceKind *rk = UA_Node_findReferenceKind(curr, &hasTypeDef, false);
+            if(rk && rk->targetIdsSize > 0)
+                retval |= UA_ExpandedNodeId_copy(&rk->targetIds[0], &descr->typeDefinition);
         }
     }
     return retval;
@@ -32,8 +29,8 @@ fillReferenceDescription(UA_NodeStore *ns, const UA_Node *curr, UA_ReferenceNode
 
 #ifdef UA_ENABLE_EXTERNAL_NAMESPACES
 static const UA_Node *
-returnRelevantNodeExternal(UA_ExternalNodeStore *ens, const UA_BrowseDescription *descr,
-                           const UA_ReferenceNode *reference) {
+returnRelevantNodeExternal(UA_NodeStore *ns, UA_ExternalNodeStore *ens,
+                           const UA_BrowseDescription *descr, const UA_ExpandedNodeId *targetId) {
     /*	prepare a read request in the external nodestore	*/
     UA_ReadValueId *readValueIds = UA_Array_new(6,&UA_TYPES[UA_TYPES_READVALUEID]);
     UA_UInt32 *indices = UA_Array_new(6,&UA_TYPES[UA_TYPES_UINT32]);
@@ -41,7 +38,7 @@ returnRelevantNodeExternal(UA_ExternalNodeStore *ens, const UA_BrowseDescription
     UA_DataValue *readNodesResults = UA_Array_new(6,&UA_TYPES[UA_TYPES_DATAVALUE]);
     UA_DiagnosticInfo *diagnosticInfos = UA_Array_new(6,&UA_TYPES[UA_TYPES_DIAGNOSTICINFO]);
     for(UA_UInt32 i = 0; i < 6; i++) {
-        readValueIds[i].nodeId = reference->targetId.nodeId;
+        readValueIds[i].nodeId = targetId->nodeId;
         indices[i] = i;
     }
     readValueIds[0].attributeId = UA_ATTRIBUTEID_NODECLASS;
@@ -55,8 +52,8 @@ returnRelevantNodeExternal(UA_ExternalNodeStore *ens, const UA_BrowseDescription
                    indicesSize, readNodesResults, false, diagnosticInfos);
 
     /* create and fill a dummy nodeStructure */
-    UA_Node *node = (UA_Node*) UA_NodeStore_newObjectNode();
-    UA_NodeId_copy(&(reference->targetId.nodeId), &(node->nodeId));
+    UA_Node *node = (UA_Node*) UA_NodeStore_newObjectNode(ns);
+    UA_NodeId_copy(&targetId->nodeId, &(node->nodeId));
     if(readNodesResults[0].status == UA_STATUSCODE_GOOD)
         UA_NodeClass_copy((UA_NodeClass*)readNodesResults[0].value.data, &(node->nodeClass));
     if(readNodesResults[1].status == UA_STATUSCODE_GOOD)
@@ -74,118 +71,65 @@ returnRelevantNodeExternal(UA_ExternalNodeStore *ens, const UA_BrowseDescription
     UA_Array_delete(readNodesResults,6, &UA_TYPES[UA_TYPES_DATAVALUE]);
     UA_Array_delete(diagnosticInfos,6, &UA_TYPES[UA_TYPES_DIAGNOSTICINFO]);
     if(node && descr->nodeClassMask != 0 && (node->nodeClass & descr->nodeClassMask) == 0) {
-        UA_NodeStore_deleteNode(node);
+        UA_NodeStore_deleteNode(ns, node);
         return NULL;
     }
     return node;
 }
 #endif
 
-/* Tests if the node is relevant to the browse request and shall be returned. If
-   so, it is retrieved from the Nodestore. If not, null is returned. */
-static const UA_Node *
-returnRelevantNode(UA_Server *server, const UA_BrowseDescription *descr, UA_Boolean return_all,
-                   const UA_ReferenceNode *reference, const UA_NodeId *relevant, size_t relevant_count,
-                   UA_Boolean *isExternal) {
+/* Tests if the references of a kind are relevant to the browse request */
+static UA_Boolean
+relevantReferenceKind(const UA_BrowseDescription *descr, UA_Boolean return_all,
+                      const UA_NodeReferenceKind *rk, const UA_SubtypeSet *relevant) {
     /* reference in the right direction? */
-    if(reference->isInverse && descr->browseDirection == UA_BROWSEDIRECTION_FORWARD)
-        return NULL;
-    if(!reference->isInverse && descr->browseDirection == UA_BROWSEDIRECTION_INVERSE)
-        return NULL;
+    if(rk->isInverse && descr->browseDirection == UA_BROWSEDIRECTION_FORWARD)
+        return false;
+    if(!rk->isInverse && descr->browseDirection == UA_BROWSEDIRECTION_INVERSE)
+        return false;
 
     /* is the reference part of the hierarchy of references we look for? */
-    if(!return_all) {
-        UA_Boolean is_relevant = false;
-        for(size_t i = 0; i < relevant_count; i++) {
-            if(UA_NodeId_equal(&reference->referenceTypeId, &relevant[i])) {
-                is_relevant = true;
-                break;
-            }
-        }
-        if(!is_relevant)
-            return NULL;
-    }
+    if(return_all)
+        return true;
+    return UA_SubtypeSet_contains(relevant, &rk->referenceTypeId);
+}
 
+/* Returns the target node of a relevant reference if it matches the nodeclass
+   mask. If not, null is returned. */
+static const UA_Node *
+returnRelevantNode(UA_Server *server, const UA_BrowseDescription *descr,
+                   const UA_ExpandedNodeId *targetId, UA_Boolean *isExternal) {
 #ifdef UA_ENABLE_EXTERNAL_NAMESPACES
     /* return the node from an external namespace*/
 	for(size_t nsIndex = 0; nsIndex < server->externalNamespacesSize; nsIndex++) {
-		if(reference->targetId.nodeId.namespaceIndex != server->externalNamespaces[nsIndex].index)
+		if(targetId->nodeId.namespaceIndex != server->externalNamespaces[nsIndex].index)
 			continue;
         *isExternal = true;
-        return returnRelevantNodeExternal(&server->externalNamespaces[nsIndex].externalNodeStore,
-                                          descr, reference);
+        return returnRelevantNodeExternal(server->nodestore,
+                                          &server->externalNamespaces[nsIndex].externalNodeStore,
+                                          descr, targetId);
     }
 #endif
 
     /* return from the internal nodestore */
-    const UA_Node *node = UA_NodeStore_get(server->nodestore, &reference->targetId.nodeId);
+    const UA_Node *node = UA_NodeStore_get(server->nodestore, &targetId->nodeId);
     if(node && descr->nodeClassMask != 0 && (node->nodeClass & descr->nodeClassMask) == 0)
         return NULL;
     *isExternal = false;
     return node;
 }
 
-/**
- * We find all subtypes by a single iteration over the array. We start with an array with a single
- * root nodeid at the beginning. When we find relevant references, we add the nodeids to the back of
- * the array and increase the size. Since the hierarchy is not cyclic, we can safely progress in the
- * array to process the newly found referencetype nodeids (emulated recursion).
- */
+/* Checks the reference type of a browse request and prepares the set of
+   relevant reference types */
 static UA_StatusCode
-findSubTypes(UA_NodeStore *ns, const UA_NodeId *root, UA_NodeId **reftypes, size_t *reftypes_count) {
-    const UA_Node *node = UA_NodeStore_get(ns, root);
+relevantReferenceTypes(UA_Server *server, const UA_NodeId *referenceTypeId,
+                       UA_Boolean includeSubtypes, UA_SubtypeSet *relevant) {
+    const UA_Node *node = UA_NodeStore_get(server->nodestore, referenceTypeId);
     if(!node)
-        return UA_STATUSCODE_BADNOMATCH;
+        return includeSubtypes ? UA_STATUSCODE_BADNOMATCH : UA_STATUSCODE_BADREFERENCETYPEIDINVALID;
     if(node->nodeClass != UA_NODECLASS_REFERENCETYPE)
         return UA_STATUSCODE_BADREFERENCETYPEIDINVALID;
-
-    size_t results_size = 20; // probably too big, but saves mallocs
-    UA_NodeId *results = UA_malloc(sizeof(UA_NodeId) * results_size);
-    if(!results)
-        return UA_STATUSCODE_BADOUTOFMEMORY;
-
-    UA_StatusCode retval = UA_NodeId_copy(root, &results[0]);
-    if(retval != UA_STATUSCODE_GOOD) {
-        UA_free(results);
-        return retval;
-    }
-        
-    size_t idx = 0; // where are we currently in the array?
-    size_t last = 0; // where is the last element in the array?
-    do {
-        node = UA_NodeStore_get(ns, &results[idx]);
-        if(!node || node->nodeClass != UA_NODECLASS_REFERENCETYPE)
-            continue;
-        for(size_t i = 0; i < node->referencesSize; i++) {
-            if(node->references[i].referenceTypeId.identifier.numeric != UA_NS0ID_HASSUBTYPE ||
-               node->references[i].isInverse == true)
-                continue;
-
-            if(++last >= results_size) { // is the array big enough?
-                UA_NodeId *new_results = UA_realloc(results, sizeof(UA_NodeId) * results_size * 2);
-                if(!new_results) {
-                    retval = UA_STATUSCODE_BADOUTOFMEMORY;
-                    break;
-                }
-                results = new_results;
-                results_size *= 2;
-            }
-
-            retval = UA_NodeId_copy(&node->references[i].targetId.nodeId, &results[last]);
-            if(retval != UA_STATUSCODE_GOOD) {
-                last--; // for array_delete
-                break;
-            }
-        }
-    } while(++idx <= last && retval == UA_STATUSCODE_GOOD);
-
-    if(retval != UA_STATUSCODE_GOOD) {
-        UA_Array_delete(results, last, &UA_TYPES[UA_TYPES_NODEID]);
-        return retval;
-    }
-
-    *reftypes = results;
-    *reftypes_count = last + 1;
+    UA_Server_getSubtypes(server, referenceTypeId, includeSubtypes, relevant);
     return UA_STATUSCODE_GOOD;
 }
 
@@ -211,7 +155,6 @@ void
 Service_Browse_single(UA_Server *server, UA_Session *session, struct ContinuationPointEntry *cp,
                       const UA_BrowseDescription *descr, UA_UInt32 maxrefs, UA_BrowseResult *result) { 
     size_t referencesCount = 0;
-    size_t referencesIndex = 0;
     /* set the browsedescription if a cp is given */
     UA_UInt32 continuationIndex = 0;
     if(cp) {
@@ -229,83 +172,82 @@ Service_Browse_single(UA_Server *server, UA_Session *session, struct Continuatio
     }
     
     /* get the references that match the browsedescription */
-    size_t relevant_refs_size = 0;
-    UA_NodeId *relevant_refs = NULL;
+    UA_SubtypeSet relevant_refs;
     UA_Boolean all_refs = UA_NodeId_isNull(&descr->referenceTypeId);
     if(!all_refs) {
-        if(descr->includeSubtypes) {
-            result->statusCode = findSubTypes(server->nodestore, &descr->referenceTypeId,
-                                              &relevant_refs, &relevant_refs_size);
-            if(result->statusCode != UA_STATUSCODE_GOOD)
-                return;
-        } else {
-            const UA_Node *rootRef = UA_NodeStore_get(server->nodestore, &descr->referenceTypeId);
-            if(!rootRef || rootRef->nodeClass != UA_NODECLASS_REFERENCETYPE) {
-                result->statusCode = UA_STATUSCODE_BADREFERENCETYPEIDINVALID;
-                return;
-            }
-            relevant_refs = (UA_NodeId*)(uintptr_t)&descr->referenceTypeId;
-            relevant_refs_size = 1;
-        }
+        result->statusCode = relevantReferenceTypes(server, &descr->referenceTypeId,
+                                                    descr->includeSubtypes, &relevant_refs);
+        if(result->statusCode != UA_STATUSCODE_GOOD)
+            return;
     }
 
     /* get the node */
     const UA_Node *node = UA_NodeStore_get(server->nodestore, &descr->nodeId);
     if(!node) {
         result->statusCode = UA_STATUSCODE_BADNODEIDUNKNOWN;
-        if(!all_refs && descr->includeSubtypes)
-            UA_Array_delete(relevant_refs, relevant_refs_size, &UA_TYPES[UA_TYPES_NODEID]);
         return;
     }
 
-    /* if the node has no references, just return */
-    if(node->referencesSize <= 0) {
+    /* count the references of the relevant kinds */
+    size_t relevant_targets = 0;
+    for(size_t i = 0; i < node->referencesSize; i++) {
+        const UA_NodeReferenceKind *rk = &node->references[i];
+        if(relevantReferenceKind(descr, all_refs, rk, &relevant_refs))
+            relevant_targets += rk->targetIdsSize;
+    }
+
+    /* if the node has no relevant references, just return */
+    if(relevant_targets == 0) {
         result->referencesSize = 0;
-        if(!all_refs && descr->includeSubtypes)
-            UA_Array_delete(relevant_refs, relevant_refs_size, &UA_TYPES[UA_TYPES_NODEID]);
+        if(cp)
+            removeCp(cp, session);
         return;
     }
 
     /* how many references can we return at most? */
     size_t real_maxrefs = maxrefs;
-    if(real_maxrefs == 0)
-        real_maxrefs = node->referencesSize;
-    if(node->referencesSize <= 0)
-        real_maxrefs = 0;
-    else if(real_maxrefs > node->referencesSize)
-        real_maxrefs = node->referencesSize;
+    if(real_maxrefs == 0 || real_maxrefs > relevant_targets)
+        real_maxrefs = relevant_targets;
     result->references = UA_Array_new(real_maxrefs, &UA_TYPES[UA_TYPES_REFERENCEDESCRIPTION]);
     if(!result->references) {
         result->statusCode = UA_STATUSCODE_BADOUTOFMEMORY;
         goto cleanup;
     }
 
-    /* loop over the node's references */
+    /* loop over the targets of the relevant reference kinds */
     size_t skipped = 0;
     UA_Boolean isExternal = false;
+    UA_Boolean done = true;
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
-    for(; referencesIndex < node->referencesSize && referencesCount < real_maxrefs; referencesIndex++) {
-    	isExternal = false;
-    	const UA_Node *current =
-            returnRelevantNode(server, descr, all_refs, &node->references[referencesIndex],
-                               relevant_refs, relevant_refs_size, &isExternal);
-        if(!current)
+    for(size_t i = 0; i < node->referencesSize && done; i++) {
+        const UA_NodeReferenceKind *rk = &node->references[i];
+        if(!relevantReferenceKind(descr, all_refs, rk, &relevant_refs))
             continue;
+        for(size_t j = 0; j < rk->targetIdsSize; j++) {
+            if(referencesCount >= real_maxrefs) {
+                done = false;
+                break;
+            }
+            isExternal = false;
+            const UA_Node *current = returnRelevantNode(server, descr, &rk->targetIds[j], &isExternal);
+            if(!current)
+                continue;
 
-        if(skipped < continuationIndex) {
-            skipped++;
-        } else {
-            retval |= fillReferenceDescription(server->nodestore, current, &node->references[referencesIndex],
-                                               descr->resultMask, &result->references[referencesCount]);
-            referencesCount++;
-        }
+            if(skipped < continuationIndex) {
+                skipped++;
+            } else {
+                retval |= fillReferenceDescription(server->nodestore, current, rk, descr->resultMask,
+                                                   &result->references[referencesCount]);
+                referencesCount++;
+            }
 #ifdef UA_ENABLE_EXTERNAL_NAMESPACES
-        /* relevant_node returns a node malloced by the nodestore.
-           if it is external (there is no UA_Node_new function) */
-   //     if(isExternal == true)
-   //         UA_Node_deleteMembersAnyNodeClass(current);
-   //TODO something's wrong here...
+            /* relevant_node returns a node malloced by the nodestore.
+               if it is external (there is no UA_Node_new function) */
+       //     if(isExternal == true)
+       //         UA_Node_deleteMembersAnyNodeClass(current);
+       //TODO something's wrong here...
 #endif
+        }
     }
 
     result->referencesSize = referencesCount;
@@ -322,14 +264,12 @@ Service_Browse_single(UA_Server *server, UA_Session *session, struct Continuatio
     }
 
     cleanup:
-    if(!all_refs && descr->includeSubtypes)
-        UA_Array_delete(relevant_refs, relevant_refs_size, &UA_TYPES[UA_TYPES_NODEID]);
     if(result->statusCode != UA_STATUSCODE_GOOD)
         return;
 
     /* create, update, delete continuation points */
     if(cp) {
-        if(referencesIndex == node->referencesSize) {
+        if(done) {
             /* all done, remove a finished continuationPoint */
             removeCp(cp, session);
         } else {
@@ -337,7 +277,7 @@ Service_Browse_single(UA_Server *server, UA_Session *session, struct Continuatio
             cp->continuationIndex += (UA_UInt32)referencesCount;
             UA_ByteString_copy(&cp->identifier, &result->continuationPoint);
         }
-    } else if(maxrefs != 0 && referencesCount >= maxrefs) {
+    } else if(!done) {
         /* create a cp */
         if(session->availableContinuationPoints <= 0 ||
            !(cp = UA_malloc(sizeof(struct ContinuationPointEntry)))) {
@@ -460,37 +400,51 @@ void Service_BrowseNext(UA_Server *server, UA_Session *session, const UA_BrowseN
 /* TranslateBrowsePath */
 /***********************/
 
+static UA_StatusCode
+walkBrowsePathTargets(UA_Server *server, UA_Session *session, const UA_NodeReferenceKind *rk,
+                      const UA_RelativePath *path, size_t pathindex, UA_BrowsePathTarget **targets,
+                      size_t *targets_size, size_t *target_count);
+
+/* Follows the references of the relevant kinds only */
 static UA_StatusCode
 walkBrowsePath(UA_Server *server, UA_Session *session, const UA_Node *node, const UA_RelativePath *path,
                size_t pathindex, UA_BrowsePathTarget **targets, size_t *targets_size,
                size_t *target_count) {
     const UA_RelativePathElement *elem = &path->elements[pathindex];
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
-    UA_NodeId *reftypes = NULL;
-    size_t reftypes_count = 1; // all_refs or no subtypes => 1
+    UA_SubtypeSet reftypes;
     UA_Boolean all_refs = false;
     if(UA_NodeId_isNull(&elem->referenceTypeId))
         all_refs = true;
     else if(!elem->includeSubtypes)
-        reftypes = (UA_NodeId*)(uintptr_t)&elem->referenceTypeId; // ptr magic due to const cast
+        UA_Server_getSubtypes(server, &elem->referenceTypeId, false, &reftypes);
     else {
-        retval = findSubTypes(server->nodestore, &elem->referenceTypeId, &reftypes, &reftypes_count);
+        retval = relevantReferenceTypes(server, &elem->referenceTypeId, true, &reftypes);
         if(retval != UA_STATUSCODE_GOOD)
             return retval;
     }
 
     for(size_t i = 0; i < node->referencesSize && retval == UA_STATUSCODE_GOOD; i++) {
-        UA_Boolean match = all_refs;
-        for(size_t j = 0; j < reftypes_count && !match; j++) {
-            if(node->references[i].isInverse == elem->isInverse &&
-               UA_NodeId_equal(&node->references[i].referenceTypeId, &reftypes[j]))
-                match = true;
-        }
-        if(!match)
+        const UA_NodeReferenceKind *rk = &node->references[i];
+        if(rk->isInverse != elem->isInverse)
+            continue;
+        if(!all_refs && !UA_SubtypeSet_contains(&reftypes, &rk->referenceTypeId))
             continue;
+        retval = walkBrowsePathTargets(server, session, rk, path, pathindex,
+                                       targets, targets_size, target_count);
+    }
+    return retval;
+}
 
+static UA_StatusCode
+walkBrowsePathTargets(UA_Server *server, UA_Session *session, const UA_NodeReferenceKind *rk,
+                      const UA_RelativePath *path, size_t pathindex, UA_BrowsePathTarget **targets,
+                      size_t *targets_size, size_t *target_count) {
+    const UA_RelativePathElement *elem = &path->elements[pathindex];
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    for(size_t i = 0; i < rk->targetIdsSize && retval == UA_STATUSCODE_GOOD; i++) {
         // get the node, todo: expandednodeid
-        const UA_Node *next = UA_NodeStore_get(server->nodestore, &node->references[i].targetId.nodeId);
+        const UA_Node *next = UA_NodeStore_get(server->nodestore, &rk->targetIds[i].nodeId);
         if(!next)
             continue;
 
@@ -508,7 +462,7 @@ walkBrowsePath(UA_Server *server, UA_Session *session, const UA_Node *node, cons
             // add the browsetarget
             if(*target_count >= *targets_size) {
                 UA_BrowsePathTarget *newtargets;
-                newtargets = UA_realloc(targets, sizeof(UA_BrowsePathTarget) * (*targets_size) * 2);
+                newtargets = UA_realloc(*targets, sizeof(UA_BrowsePathTarget) * (*targets_size) * 2);
                 if(!newtargets) {
                     retval = UA_STATUSCODE_BADOUTOFMEMORY;
                     break;
@@ -526,9 +480,6 @@ walkBrowsePath(UA_Server *server, UA_Session *session, const UA_Node *node, cons
             *target_count += 1;
         }
     }
-
-    if(!all_refs && elem->includeSubtypes)
-        UA_Array_delete(reftypes, reftypes_count, &UA_TYPES[UA_TYPES_NODEID]);
     return retval;
 }
 
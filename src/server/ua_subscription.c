@@ -1,23 +1,221 @@
 #include "ua_subscription.h"
 #include "ua_server_internal.h"
 #include "ua_nodestore.h"
+#include "ua_nodestore_hash.h"
+#include "ua_types_encoding_binary.h"
+
+/*********************/
+/* Monitored Samples */
+/*********************/
+
+/* Takes a copy of the value with the current server timestamp and encodes it.
+   The encoding goes in a single pass into the sample buffer of the server. Only
+   the encoded bytes are copied into the sample. The caller holds the first
+   reference. */
+static UA_MonitoredSample *
+MonitoredSample_new(UA_Server *server, const UA_DataValue *value) {
+    UA_MonitoredSample *sample = UA_malloc(sizeof(UA_MonitoredSample));
+    if(!sample)
+        return NULL;
+    sample->refCount = 1;
+    UA_ByteString_init(&sample->encoded);
+    if(UA_DataValue_copy(value, &sample->value) != UA_STATUSCODE_GOOD) {
+        UA_free(sample);
+        return NULL;
+    }
+    sample->value.hasServerPicoseconds = false;
+    sample->value.hasServerTimestamp = true;
+    sample->value.serverTimestamp = UA_DateTime_now();
+    size_t offset = 0;
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_lock(&server->sampleBufferMutex);
+#endif
+    UA_StatusCode retval =
+        UA_encodeBinaryGrow(&sample->value, &UA_TYPES[UA_TYPES_DATAVALUE], &server->sampleBuffer,
+                            &server->sampleBufferCapacity, &offset);
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = UA_ByteString_allocBuffer(&sample->encoded, offset);
+    if(retval == UA_STATUSCODE_GOOD)
+        memcpy(sample->encoded.data, server->sampleBuffer.data, offset);
+#ifdef UA_ENABLE_MULTITHREADING
+    pthread_mutex_unlock(&server->sampleBufferMutex);
+#endif
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_ByteString_deleteMembers(&sample->encoded);
+        UA_DataValue_deleteMembers(&sample->value);
+        UA_free(sample);
+        return NULL;
+    }
+    return sample;
+}
+
+static void
+MonitoredSample_retain(UA_MonitoredSample *sample) {
+#ifdef UA_ENABLE_MULTITHREADING
+    uatomic_inc(&sample->refCount);
+#else
+    sample->refCount++;
+#endif
+}
+
+static void
+MonitoredSample_release(UA_MonitoredSample *sample) {
+#ifdef UA_ENABLE_MULTITHREADING
+    if(uatomic_sub_return(&sample->refCount, 1) > 0)
+        return;
+#else
+    if(--sample->refCount > 0)
+        return;
+#endif
+    UA_ByteString_deleteMembers(&sample->encoded);
+    UA_DataValue_deleteMembers(&sample->value);
+    UA_free(sample);
+}
+
+/************************/
+/* Retransmission Queue */
+/************************/
+
+#define RETRANSMISSION_SLOT(sub, seq) \
+    (&(sub)->retransmissionQueue[(seq) & ((sub)->retransmissionQueueCapacity - 1)])
+
+static void
+chargeRetransmissionBytes(UA_Server *server, UA_Subscription *sub, size_t size) {
+    sub->retransmissionQueueBytes += size;
+#ifdef UA_ENABLE_MULTITHREADING
+    uatomic_add(&server->retransmissionBytes, size);
+#else
+    server->retransmissionBytes += size;
+#endif
+}
+
+static void
+releaseRetransmissionBytes(UA_Server *server, UA_Subscription *sub, size_t size) {
+    sub->retransmissionQueueBytes -= size;
+#ifdef UA_ENABLE_MULTITHREADING
+    uatomic_sub(&server->retransmissionBytes, size);
+#else
+    server->retransmissionBytes -= size;
+#endif
+}
+
+UA_unpublishedNotification *
+Subscription_getNotification(UA_Subscription *sub, UA_UInt32 sequenceNumber) {
+    if(sequenceNumber < sub->firstSequenceNumber || sequenceNumber >= sub->sequenceNumber)
+        return NULL;
+    UA_unpublishedNotification *msg = RETRANSMISSION_SLOT(sub, sequenceNumber);
+    if(msg->notification.sequenceNumber != sequenceNumber)
+        return NULL;
+    return msg;
+}
+
+/* Empties the slot. The ring then starts at the next retained notification. */
+static void
+Subscription_removeNotification(UA_Server *server, UA_Subscription *sub,
+                                UA_unpublishedNotification *msg) {
+    releaseRetransmissionBytes(server, sub, msg->size);
+    UA_NotificationMessage_deleteMembers(&msg->notification);
+    msg->notification.sequenceNumber = 0;
+    msg->size = 0;
+    sub->unpublishedNotificationsSize--;
+    while(sub->firstSequenceNumber != sub->sequenceNumber &&
+          RETRANSMISSION_SLOT(sub, sub->firstSequenceNumber)->notification.sequenceNumber == 0)
+        sub->firstSequenceNumber++;
+    if(sub->unsentSequenceNumber < sub->firstSequenceNumber)
+        sub->unsentSequenceNumber = sub->firstSequenceNumber; // dropped before it was sent
+}
+
+UA_StatusCode
+Subscription_acknowledge(UA_Server *server, UA_Subscription *sub, UA_UInt32 sequenceNumber) {
+    UA_unpublishedNotification *msg = Subscription_getNotification(sub, sequenceNumber);
+    if(!msg || sequenceNumber >= sub->unsentSequenceNumber)
+        return UA_STATUSCODE_BADSEQUENCENUMBERINVALID;
+    Subscription_removeNotification(server, sub, msg);
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+resizeRetransmissionQueue(UA_Subscription *sub, UA_UInt32 capacity) {
+    UA_unpublishedNotification *queue = UA_calloc(capacity, sizeof(UA_unpublishedNotification));
+    if(!queue)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    for(UA_UInt32 seq = sub->firstSequenceNumber; seq != sub->sequenceNumber; seq++) {
+        UA_unpublishedNotification *msg = RETRANSMISSION_SLOT(sub, seq);
+        if(msg->notification.sequenceNumber != 0)
+            queue[seq & (capacity - 1)] = *msg;
+    }
+    UA_free(sub->retransmissionQueue);
+    sub->retransmissionQueue = queue;
+    sub->retransmissionQueueCapacity = capacity;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Moves the message into the retransmission queue with the next sequence
+   number. The oldest notifications are dropped to stay within the budgets of
+   the subscription and the server. The ring itself grows only within the
+   budget of the subscription. */
+static UA_StatusCode
+Subscription_retainNotification(UA_Server *server, UA_Subscription *sub,
+                                 UA_NotificationMessage *message) {
+    message->sequenceNumber = sub->sequenceNumber;
+    size_t size = UA_calcSizeBinary(message, &UA_TYPES[UA_TYPES_NOTIFICATIONMESSAGE]);
+    while(sub->unpublishedNotificationsSize > 0 &&
+          (sub->retransmissionQueueBytes + size > server->config.maxRetransmissionQueueBytes ||
+           server->retransmissionBytes + size > server->config.maxRetransmissionBytes))
+        Subscription_removeNotification(server, sub,
+                                        RETRANSMISSION_SLOT(sub, sub->firstSequenceNumber));
+
+    while(sub->sequenceNumber - sub->firstSequenceNumber >= sub->retransmissionQueueCapacity) {
+        UA_UInt32 capacity = sub->retransmissionQueueCapacity * 2;
+        if(capacity == 0) {
+            capacity = 8;
+        } else if(capacity * sizeof(UA_unpublishedNotification) >
+                  server->config.maxRetransmissionQueueBytes) {
+            Subscription_removeNotification(server, sub,
+                                            RETRANSMISSION_SLOT(sub, sub->firstSequenceNumber));
+            continue;
+        }
+        UA_StatusCode retval = resizeRetransmissionQueue(sub, capacity);
+        if(retval != UA_STATUSCODE_GOOD) {
+            UA_NotificationMessage_deleteMembers(message);
+            return retval;
+        }
+    }
+
+    UA_unpublishedNotification *msg = RETRANSMISSION_SLOT(sub, sub->sequenceNumber);
+    msg->notification = *message;
+    msg->size = size;
+    sub->sequenceNumber++;
+    sub->unpublishedNotificationsSize++;
+    chargeRetransmissionBytes(server, sub, size);
+    return UA_STATUSCODE_GOOD;
+}
 
 /****************/
 /* Subscription */
 /****************/
 
-UA_Subscription *UA_Subscription_new(UA_UInt32 subscriptionID) {
+UA_Subscription *UA_Subscription_new(UA_Session *session, UA_UInt32 subscriptionID) {
     UA_Subscription *new = UA_malloc(sizeof(UA_Subscription));
     if(!new)
         return NULL;
+    new->session = session;
     new->subscriptionID = subscriptionID;
     new->lastPublished  = 0;
     new->sequenceNumber = 1;
+    new->emptyIntervals = 0;
+    new->keepAlivePending = false;
     memset(&new->timedUpdateJobGuid, 0, sizeof(UA_Guid));
     new->timedUpdateIsRegistered = false;
     LIST_INIT(&new->MonitoredItems);
-    LIST_INIT(&new->unpublishedNotifications);
+    TAILQ_INIT(&new->pendingItems);
+    new->pendingSamples = 0;
+    new->retransmissionQueue = NULL;
+    new->retransmissionQueueCapacity = 0;
+    new->firstSequenceNumber = 1;
+    new->unsentSequenceNumber = 1;
     new->unpublishedNotificationsSize = 0;
+    new->retransmissionQueueBytes = 0;
     return new;
 }
 
@@ -30,11 +228,17 @@ void UA_Subscription_deleteMembers(UA_Subscription *subscription, UA_Server *ser
     UA_MonitoredItem *mon, *tmp_mon;
     LIST_FOREACH_SAFE(mon, &subscription->MonitoredItems, listEntry, tmp_mon) {
         LIST_REMOVE(mon, listEntry);
-        MonitoredItem_delete(mon);
+        MonitoredItem_delete(server, mon);
     }
     
     // Delete unpublished Notifications
-    Subscription_deleteUnpublishedNotification(0, true, subscription);
+    while(subscription->unpublishedNotificationsSize > 0)
+        Subscription_removeNotification(server, subscription,
+                                        RETRANSMISSION_SLOT(subscription,
+                                                            subscription->firstSequenceNumber));
+    UA_free(subscription->retransmissionQueue);
+    subscription->retransmissionQueue = NULL;
+    subscription->retransmissionQueueCapacity = 0;
     
     // Unhook/Unregister any timed work assiociated with this subscription
     if(subscription->timedUpdateIsRegistered) {
@@ -44,75 +248,93 @@ void UA_Subscription_deleteMembers(UA_Subscription *subscription, UA_Server *ser
 }
 
 void Subscription_generateKeepAlive(UA_Subscription *subscription) {
-    if(subscription->keepAliveCount.current > subscription->keepAliveCount.min &&
-       subscription->keepAliveCount.current <= subscription->keepAliveCount.max)
-        return;
-
-    UA_unpublishedNotification *msg = UA_calloc(1,sizeof(UA_unpublishedNotification));
-    if(!msg)
-        return;
-    msg->notification.notificationData = NULL;
-    // KeepAlive uses next message, but does not increment counter
-    msg->notification.sequenceNumber = subscription->sequenceNumber + 1;
-    msg->notification.publishTime    = UA_DateTime_now();
-    msg->notification.notificationDataSize = 0;
-    LIST_INSERT_HEAD(&subscription->unpublishedNotifications, msg, listEntry);
-    subscription->unpublishedNotificationsSize += 1;
-    subscription->keepAliveCount.current = subscription->keepAliveCount.max;
+    subscription->emptyIntervals = 0;
+    // The keep-alive is created when it is sent. It is not retained.
+    subscription->keepAlivePending = true;
 }
 
-void Subscription_updateNotifications(UA_Subscription *subscription) {
+/* The DataChangeNotification is encoded directly from the encoded samples.
+   Only the client handles are added. The queues are emptied only if the
+   notification was encoded. */
+static UA_StatusCode
+encodeDataChangeNotification(UA_Subscription *subscription, UA_UInt32 notifications,
+                             UA_ExtensionObject *dst) {
+    size_t size = sizeof(UA_Int32) * 2; // the lengths of both arrays
     UA_MonitoredItem *mon;
-    //MonitoredItem_queuedValue *queuedValue;
-    UA_unpublishedNotification *msg;
-    UA_UInt32 monItemsChangeT = 0, monItemsStatusT = 0, monItemsEventT = 0;
-    
+    TAILQ_FOREACH(mon, &subscription->pendingItems, pendingEntry) {
+        for(UA_UInt32 i = 0; i < mon->queueSize.current; i++)
+            size += sizeof(UA_UInt32) + MONITOREDITEM_QUEUED(mon, i)->encoded.length;
+    }
+
+    UA_ByteString body;
+    UA_StatusCode retval = UA_ByteString_allocBuffer(&body, size);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    size_t offset = 0;
+    UA_Int32 length = (UA_Int32)notifications;
+    retval = UA_encodeBinary(&length, &UA_TYPES[UA_TYPES_INT32], &body, &offset);
+    TAILQ_FOREACH(mon, &subscription->pendingItems, pendingEntry) {
+        for(UA_UInt32 i = 0; i < mon->queueSize.current && retval == UA_STATUSCODE_GOOD; i++) {
+            const UA_ByteString *encoded = &MONITOREDITEM_QUEUED(mon, i)->encoded;
+            retval = UA_encodeBinary(&mon->clientHandle, &UA_TYPES[UA_TYPES_UINT32], &body, &offset);
+            if(retval != UA_STATUSCODE_GOOD)
+                break;
+            memcpy(&body.data[offset], encoded->data, encoded->length);
+            offset += encoded->length;
+        }
+    }
+    length = -1; // no diagnostic infos
+    if(retval == UA_STATUSCODE_GOOD)
+        retval = UA_encodeBinary(&length, &UA_TYPES[UA_TYPES_INT32], &body, &offset);
+    if(retval != UA_STATUSCODE_GOOD) {
+        UA_ByteString_deleteMembers(&body);
+        return retval;
+    }
+
+    while((mon = TAILQ_FIRST(&subscription->pendingItems)))
+        MonitoredItem_ClearQueue(mon);
+    dst->encoding = UA_EXTENSIONOBJECT_ENCODED_BYTESTRING;
+    dst->content.encoded.typeId =
+        UA_NODEID_NUMERIC(0, UA_TYPES[UA_TYPES_DATACHANGENOTIFICATION].binaryEncodingId);
+    dst->content.encoded.body = body;
+    return UA_STATUSCODE_GOOD;
+}
+
+void Subscription_updateNotifications(UA_Server *server, UA_Subscription *subscription) {
     if(!subscription || subscription->lastPublished +
        (UA_UInt32)(subscription->publishingInterval * UA_MSEC_TO_DATETIME) > UA_DateTime_now())
         return;
     
-    // Make sure there is data to be published and establish which message types
-    // will need to be generated
-    LIST_FOREACH(mon, &subscription->MonitoredItems, listEntry) {
-        // Check if this MonitoredItems Queue holds data and how much data is held in total
-        if(!TAILQ_FIRST(&mon->queue))
-            continue;
-        if((mon->monitoredItemType & MONITOREDITEM_TYPE_CHANGENOTIFY) != 0)
-            monItemsChangeT+=mon->queueSize.current;
-	    else if((mon->monitoredItemType & MONITOREDITEM_TYPE_STATUSNOTIFY) != 0)
-            monItemsStatusT+=mon->queueSize.current;
-	    else if((mon->monitoredItemType & MONITOREDITEM_TYPE_EVENTNOTIFY)  != 0)
-            monItemsEventT+=mon->queueSize.current;
-    }
-    
-    // FIXME: This is hardcoded to 100 because it is not covered by the spec but we need to protect the server!
-    if(subscription->unpublishedNotificationsSize >= 10) {
-        // Remove last entry
-        Subscription_deleteUnpublishedNotification(0, true, subscription);
-    }
-    
-    if(monItemsChangeT == 0 && monItemsEventT == 0 && monItemsStatusT == 0) {
-        // Decrement KeepAlive
-        subscription->keepAliveCount.current--;
-        // +- Generate KeepAlive msg if counter overruns
-        if (subscription->keepAliveCount.current < subscription->keepAliveCount.min)
-          Subscription_generateKeepAlive(subscription);
-        
+    // The samples are counted when they are queued. Only data changes are
+    // queued so far.
+    UA_UInt32 monItemsChangeT = subscription->pendingSamples;
+    if(monItemsChangeT == 0) {
+        // Generate a KeepAlive msg after the revised max keepalive count of
+        // empty publishing intervals
+        subscription->emptyIntervals++;
+        if(subscription->emptyIntervals >= subscription->keepAliveCount.current)
+            Subscription_generateKeepAlive(subscription);
         return;
     }
+    subscription->emptyIntervals = 0;
+    // A keep-alive that was not sent yet is superseded by the notification
+    subscription->keepAlivePending = false;
     
-    msg = UA_calloc(1, sizeof(UA_unpublishedNotification));
-    msg->notification.sequenceNumber = subscription->sequenceNumber++;
-    msg->notification.publishTime = UA_DateTime_now();
+    UA_NotificationMessage message;
+    UA_NotificationMessage_init(&message);
+    message.publishTime = UA_DateTime_now();
     
     // NotificationData is an array of Change, Status and Event messages, each containing the appropriate
     // list of Queued values from all monitoredItems of that type
-    msg->notification.notificationDataSize = !!monItemsChangeT; // 1 if the pointer is not null, else 0
+    message.notificationDataSize = !!monItemsChangeT; // 1 if the pointer is not null, else 0
     // + ISNOTZERO(monItemsEventT) + ISNOTZERO(monItemsStatusT);
-    msg->notification.notificationData =
-        UA_Array_new(msg->notification.notificationDataSize, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT]);
+    message.notificationData =
+        UA_Array_new(message.notificationDataSize, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT]);
+    if(!message.notificationData)
+        return; // the queues are published in the next interval
     
-    for(size_t notmsgn = 0; notmsgn < msg->notification.notificationDataSize; notmsgn++) {
+    UA_StatusCode retval = UA_STATUSCODE_GOOD;
+    for(size_t notmsgn = 0; notmsgn < message.notificationDataSize; notmsgn++) {
         // Set the notification message type and encoding for each of 
         //   the three possible NotificationData Types
 
@@ -120,43 +342,35 @@ void Subscription_updateNotifications(UA_Subscription *subscription) {
         /* msg->notification->notificationData[notmsgn].typeId = UA_NODEID_NUMERIC(0, 811); */
       
         if(notmsgn == 0) {
-            UA_DataChangeNotification *changeNotification = UA_DataChangeNotification_new();
-            changeNotification->monitoredItems = UA_Array_new(monItemsChangeT, &UA_TYPES[UA_TYPES_MONITOREDITEMNOTIFICATION]);
-	
-            // Scan all monitoredItems in this subscription and have their queue transformed into an Array of
-            // the propper NotificationMessageType (Status, Change, Event)
-            monItemsChangeT = 0;
-            LIST_FOREACH(mon, &subscription->MonitoredItems, listEntry) {
-                if(mon->monitoredItemType != MONITOREDITEM_TYPE_CHANGENOTIFY || !TAILQ_FIRST(&mon->queue))
-                    continue;
-                // Note: Monitored Items might not return a queuedValue if there is a problem encoding it.
-                monItemsChangeT += MonitoredItem_QueueToDataChangeNotifications(&changeNotification->monitoredItems[monItemsChangeT], mon);
-                MonitoredItem_ClearQueue(mon);
-            }
-            changeNotification->monitoredItemsSize = monItemsChangeT;
-            msg->notification.notificationData[notmsgn].encoding = UA_EXTENSIONOBJECT_DECODED;
-            msg->notification.notificationData[notmsgn].content.decoded.type = &UA_TYPES[UA_TYPES_DATACHANGENOTIFICATION];
-            msg->notification.notificationData[notmsgn].content.decoded.data = changeNotification;
+            // The queues of all monitoredItems are spliced into the encoded
+            // DataChangeNotification and emptied
+            retval = encodeDataChangeNotification(subscription, monItemsChangeT,
+                                                  &message.notificationData[notmsgn]);
         } else if(notmsgn == 1) {
             // FIXME: Constructing a StatusChangeNotification is not implemented
         } else if(notmsgn == 2) {
             // FIXME: Constructing a EventListNotification is not implemented
         }
+        if(retval != UA_STATUSCODE_GOOD) {
+            // The queues are kept and published in the next interval
+            UA_NotificationMessage_deleteMembers(&message);
+            return;
+        }
     }
-    LIST_INSERT_HEAD(&subscription->unpublishedNotifications, msg, listEntry);
-    subscription->unpublishedNotificationsSize += 1;
+    Subscription_retainNotification(server, subscription, &message);
 }
 
-UA_UInt32 *Subscription_getAvailableSequenceNumbers(UA_Subscription *sub) {
-    UA_UInt32 *seqArray = UA_malloc(sizeof(UA_UInt32) * sub->unpublishedNotificationsSize);
+UA_UInt32 *Subscription_getAvailableSequenceNumbers(UA_Subscription *sub, size_t *size) {
+    *size = 0;
+    if(sub->firstSequenceNumber == sub->unsentSequenceNumber)
+        return NULL;
+    UA_UInt32 *seqArray =
+        UA_malloc(sizeof(UA_UInt32) * (sub->unsentSequenceNumber - sub->firstSequenceNumber));
     if(!seqArray)
         return NULL;
-  
-    int i = 0;
-    UA_unpublishedNotification *not;
-    LIST_FOREACH(not, &sub->unpublishedNotifications, listEntry) {
-        seqArray[i] = not->notification.sequenceNumber;
-        i++;
+    for(UA_UInt32 seq = sub->firstSequenceNumber; seq != sub->unsentSequenceNumber; seq++) {
+        if(RETRANSMISSION_SLOT(sub, seq)->notification.sequenceNumber == seq)
+            seqArray[(*size)++] = seq;
     }
     return seqArray;
 }
@@ -177,26 +391,9 @@ void Subscription_copyNotificationMessage(UA_NotificationMessage *dst, UA_unpubl
     UA_ExtensionObject_copy(latest->notificationData, dst->notificationData);
 }
 
-UA_UInt32 Subscription_deleteUnpublishedNotification(UA_UInt32 seqNo, UA_Boolean bDeleteAll, UA_Subscription *sub) {
-    UA_UInt32 deletedItems = 0;
-    UA_unpublishedNotification *not, *tmp;
-    LIST_FOREACH_SAFE(not, &sub->unpublishedNotifications, listEntry, tmp) {
-        if(!bDeleteAll && not->notification.sequenceNumber != seqNo)
-            continue;
-        LIST_REMOVE(not, listEntry);
-        sub->unpublishedNotificationsSize -= 1;
-        UA_NotificationMessage_deleteMembers(&not->notification);
-        UA_free(not);
-        deletedItems++;
-    }
-    return deletedItems;
-}
-
-
 static void Subscription_timedUpdateNotificationsJob(UA_Server *server, void *data) {
     // Timed-Worker/Job Version of updateNotifications
     UA_Subscription *sub = (UA_Subscription *) data;
-    UA_MonitoredItem *mon;
     
     if(!data || !server)
         return;
@@ -207,16 +404,53 @@ static void Subscription_timedUpdateNotificationsJob(UA_Server *server, void *da
     if(sub->subscriptionID == 0)
         return;
     
-    // FIXME: This should be done by the event system
-    LIST_FOREACH(mon, &sub->MonitoredItems, listEntry)
-        MonitoredItem_QueuePushDataValue(server, mon);
-    
-    Subscription_updateNotifications(sub);
+    Subscription_updateNotifications(server, sub);
+    UA_Session_expirePublishRequests(sub->session, UA_DateTime_now());
+    while(Subscription_publish(server, sub)) {}
+}
+
+UA_Boolean Subscription_publish(UA_Server *server, UA_Subscription *sub) {
+    UA_Session *session = sub->session;
+    UA_PublishResponseEntry *pre = TAILQ_FIRST(&session->responseQueue);
+    if(!pre)
+        return false;
+
+    // Send the oldest notification first. Otherwise, a keep-alive carries the
+    // sequence number of the next notification.
+    UA_NotificationMessage keepAlive;
+    UA_NotificationMessage *message = NULL;
+    if(sub->unsentSequenceNumber != sub->sequenceNumber) {
+        message = &RETRANSMISSION_SLOT(sub, sub->unsentSequenceNumber)->notification;
+        sub->unsentSequenceNumber++;
+    } else if(sub->keepAlivePending) {
+        UA_NotificationMessage_init(&keepAlive);
+        keepAlive.sequenceNumber = sub->sequenceNumber;
+        keepAlive.publishTime = UA_DateTime_now();
+        message = &keepAlive;
+        sub->keepAlivePending = false;
+    } else {
+        return false;
+    }
+
+    TAILQ_REMOVE(&session->responseQueue, pre, listEntry);
+    session->responseQueueSize--;
+    UA_PublishResponse *response = &pre->response;
+    response->responseHeader.timestamp = UA_DateTime_now();
+    response->subscriptionId = sub->subscriptionID;
+    response->moreNotifications = (sub->unsentSequenceNumber != sub->sequenceNumber);
+    UA_NotificationMessage_copy(message, &response->notificationMessage);
+    response->availableSequenceNumbers =
+        Subscription_getAvailableSequenceNumbers(sub, &response->availableSequenceNumbersSize);
+    UA_Session_sendPublishResponse(session, pre);
+    return true;
 }
 
 UA_StatusCode Subscription_registerUpdateJob(UA_Server *server, UA_Subscription *sub) {
-    if(sub->publishingInterval <= 5 ) 
-        return UA_STATUSCODE_BADNOTSUPPORTED;
+    /* Publish requests are answered by the job. The fastest repeated job runs
+       every 5ms. */
+    UA_UInt32 interval = (UA_UInt32)sub->publishingInterval;
+    if(interval < 5)
+        interval = 5;
 
     UA_Job job = (UA_Job) {.type = UA_JOBTYPE_METHODCALL,
                            .job.methodCall = {.method = Subscription_timedUpdateNotificationsJob,
@@ -224,8 +458,7 @@ UA_StatusCode Subscription_registerUpdateJob(UA_Server *server, UA_Subscription
     
     /* Practically enough, the client sends a uint32 in ms, which we store as
        datetime, which here is required in as uint32 in ms as the interval */
-    UA_StatusCode retval = UA_Server_addRepeatedJob(server, job,
-                                                    (UA_UInt32)sub->publishingInterval,
+    UA_StatusCode retval = UA_Server_addRepeatedJob(server, job, interval,
                                                     &sub->timedUpdateJobGuid);
     if(retval == UA_STATUSCODE_GOOD)
         sub->timedUpdateIsRegistered = true;
@@ -241,60 +474,427 @@ UA_StatusCode Subscription_unregisterUpdateJob(UA_Server *server, UA_Subscriptio
 /* MonitoredItem */
 /*****************/
 
+/* The monitored nodes are kept in a chained hash map. A node is in the map as
+   long as it has monitored items. */
+struct UA_MonitoredNode {
+    UA_MonitoredNode *next; // in the bucket
+    hash_t hash;
+    UA_NodeId nodeId;
+    LIST_HEAD(UA_ListOfNodeMonitoredItems, UA_MonitoredItem) items;
+};
+
+struct UA_SamplingGroup {
+    LIST_ENTRY(UA_SamplingGroup) listEntry;
+    UA_UInt32 samplingInterval; // [ms]
+    UA_Guid jobId;
+    UA_Boolean sampling; // the job is running, the group must not be removed
+    UA_UInt32 tick; // counts the samples of the group
+    size_t itemsSize;
+    size_t itemsCapacity;
+    UA_MonitoredItem **items;
+};
+
+struct UA_MonitoredItemIndex {
+    size_t nodesSize;
+    size_t bucketsSize; // a power of two
+    UA_MonitoredNode **buckets;
+    LIST_HEAD(UA_ListOfSamplingGroups, UA_SamplingGroup) samplingGroups;
+};
+
+static UA_MonitoredNode **
+findMonitoredNode(UA_MonitoredItemIndex *index, const UA_NodeId *nodeId, hash_t h) {
+    UA_MonitoredNode **entry = &index->buckets[h & (index->bucketsSize - 1)];
+    while(*entry && ((*entry)->hash != h || !UA_NodeId_equal(&(*entry)->nodeId, nodeId)))
+        entry = &(*entry)->next;
+    return entry;
+}
+
+static UA_StatusCode
+resizeMonitoredItemIndex(UA_MonitoredItemIndex *index, size_t bucketsSize) {
+    UA_MonitoredNode **buckets = UA_calloc(bucketsSize, sizeof(UA_MonitoredNode*));
+    if(!buckets)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    for(size_t i = 0; i < index->bucketsSize; i++) {
+        UA_MonitoredNode *mn = index->buckets[i];
+        while(mn) {
+            UA_MonitoredNode *next = mn->next;
+            UA_MonitoredNode **bucket = &buckets[mn->hash & (bucketsSize - 1)];
+            mn->next = *bucket;
+            *bucket = mn;
+            mn = next;
+        }
+    }
+    UA_free(index->buckets);
+    index->buckets = buckets;
+    index->bucketsSize = bucketsSize;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* The repeated jobs are deleted before the index */
+static void
+deleteSamplingGroup(UA_Server *server, UA_SamplingGroup *group) {
+    LIST_REMOVE(group, listEntry);
+    UA_Server_removeRepeatedJob(server, group->jobId);
+    UA_free(group->items);
+#ifdef UA_ENABLE_MULTITHREADING
+    /* the job might be dispatched already */
+    group->itemsSize = 0;
+    UA_Server_delayedFree(server, group);
+#else
+    UA_free(group);
+#endif
+}
+
+void UA_Server_deleteMonitoredItemIndex(UA_Server *server) {
+    UA_MonitoredItemIndex *index = server->monitoredItems;
+    if(!index)
+        return;
+    UA_SamplingGroup *group, *tmp_group;
+    LIST_FOREACH_SAFE(group, &index->samplingGroups, listEntry, tmp_group) {
+        for(size_t i = 0; i < group->itemsSize; i++)
+            group->items[i]->samplingGroup = NULL;
+        deleteSamplingGroup(server, group);
+    }
+    for(size_t i = 0; i < index->bucketsSize; i++) {
+        UA_MonitoredNode *mn = index->buckets[i];
+        while(mn) {
+            UA_MonitoredNode *next = mn->next;
+            UA_MonitoredItem *mon;
+            LIST_FOREACH(mon, &mn->items, nodeEntry)
+                mon->monitoredNode = NULL;
+            UA_NodeId_deleteMembers(&mn->nodeId);
+            UA_free(mn);
+            mn = next;
+        }
+    }
+    UA_free(index->buckets);
+    UA_free(index);
+    server->monitoredItems = NULL;
+}
+
+/* Values that are read from a data source or with a callback can change
+   without a write */
+static UA_Boolean
+isPolled(const UA_MonitoredItem *monitoredItem, const UA_Node *target) {
+    if(monitoredItem->attributeID != UA_ATTRIBUTEID_VALUE ||
+       target->nodeClass != UA_NODECLASS_VARIABLE)
+        return false;
+    const UA_VariableNode *vn = (const UA_VariableNode*)target;
+    return vn->valueSource != UA_VALUESOURCE_VARIANT ||
+        vn->value.variant.callback.onRead != NULL;
+}
+
+static void
+SamplingGroup_remove(UA_Server *server, UA_MonitoredItem *monitoredItem) {
+    UA_SamplingGroup *group = monitoredItem->samplingGroup;
+    if(!group)
+        return;
+    group->itemsSize--;
+    UA_MonitoredItem *last = group->items[group->itemsSize];
+    group->items[monitoredItem->samplingIndex] = last;
+    last->samplingIndex = monitoredItem->samplingIndex;
+    monitoredItem->samplingGroup = NULL;
+    if(group->itemsSize == 0 && !group->sampling)
+        deleteSamplingGroup(server, group);
+}
+
+static UA_Boolean sampleAttribute(UA_UInt32 attributeID, const UA_Node *target,
+                                  UA_DataValue *sample, UA_Boolean *borrowed);
+static void MonitoredItem_queueSample(UA_Server *server, UA_MonitoredItem *monitoredItem,
+                                      const UA_DataValue *sample, UA_MonitoredSample **shared);
+
+#define SAMPLES_TOGETHER(mon, group, attributeId) \
+    ((mon)->samplingGroup == (group) && (mon)->attributeID == (attributeId))
+
+/* The attribute is read once for all items of the group on the same node. A
+   data source is not asked more than once per sampling interval, regardless of
+   the number of sessions monitoring the node. */
+static void
+SamplingGroup_sampleNode(UA_Server *server, UA_SamplingGroup *group, UA_MonitoredItem *first) {
+    UA_MonitoredNode *mn = first->monitoredNode;
+    UA_UInt32 attributeId = first->attributeID;
+    UA_MonitoredItem *mon;
+    LIST_FOREACH(mon, &mn->items, nodeEntry) {
+        if(SAMPLES_TOGETHER(mon, group, attributeId))
+            mon->samplingTick = group->tick;
+    }
+
+    const UA_Node *target = UA_NodeStore_get(server->nodestore, &mn->nodeId);
+    if(!target)
+        return;
+    if(!isPolled(first, target)) {
+        /* the value source has changed. writes notify the items from now on */
+        LIST_FOREACH(mon, &mn->items, nodeEntry) {
+            if(SAMPLES_TOGETHER(mon, group, attributeId))
+                SamplingGroup_remove(server, mon);
+        }
+        return;
+    }
+
+    UA_DataValue sample;
+    UA_Boolean borrowed;
+    if(!sampleAttribute(attributeId, target, &sample, &borrowed))
+        return;
+    UA_MonitoredSample *shared = NULL;
+    LIST_FOREACH(mon, &mn->items, nodeEntry) {
+        if(SAMPLES_TOGETHER(mon, group, attributeId))
+            MonitoredItem_queueSample(server, mon, &sample, &shared);
+    }
+    if(shared)
+        MonitoredSample_release(shared);
+    if(!borrowed)
+        UA_DataValue_deleteMembers(&sample);
+}
+
+static void
+SamplingGroup_sample(UA_Server *server, void *data) {
+    UA_SamplingGroup *group = (UA_SamplingGroup*)data;
+    /* a dispatched job of a deleted group finds no items */
+    if(group->itemsSize == 0)
+        return;
+    group->sampling = true;
+    group->tick++;
+    /* backwards, so that an item that leaves the group during its sample does
+       not move an unsampled item into its place. Items that were sampled
+       together with an earlier item carry the tick of the group. */
+    for(size_t i = group->itemsSize; i > 0; i--) {
+        if(i > group->itemsSize)
+            continue;
+        UA_MonitoredItem *mon = group->items[i - 1];
+        if(mon->samplingTick != group->tick)
+            SamplingGroup_sampleNode(server, group, mon);
+    }
+    group->sampling = false;
+    /* all items have left the group during the sample */
+    if(group->itemsSize == 0)
+        deleteSamplingGroup(server, group);
+}
+
+static UA_SamplingGroup *
+getSamplingGroup(UA_Server *server, UA_UInt32 samplingInterval) {
+    /* the fastest repeated job runs every 5ms */
+    if(samplingInterval < 5)
+        samplingInterval = 5;
+    UA_MonitoredItemIndex *index = server->monitoredItems;
+    UA_SamplingGroup *group;
+    LIST_FOREACH(group, &index->samplingGroups, listEntry) {
+        if(group->samplingInterval == samplingInterval)
+            return group;
+    }
+    group = UA_calloc(1, sizeof(UA_SamplingGroup));
+    if(!group)
+        return NULL;
+    group->samplingInterval = samplingInterval;
+    UA_Job job = (UA_Job) {.type = UA_JOBTYPE_METHODCALL,
+                           .job.methodCall = {.method = SamplingGroup_sample,
+                                              .data = group} };
+    if(UA_Server_addRepeatedJob(server, job, samplingInterval, &group->jobId) != UA_STATUSCODE_GOOD) {
+        UA_free(group);
+        return NULL;
+    }
+    LIST_INSERT_HEAD(&index->samplingGroups, group, listEntry);
+    return group;
+}
+
+static UA_StatusCode
+SamplingGroup_add(UA_Server *server, UA_MonitoredItem *monitoredItem) {
+    UA_SamplingGroup *group = getSamplingGroup(server, monitoredItem->samplingInterval);
+    if(!group)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    if(group->itemsSize == group->itemsCapacity) {
+        size_t capacity = group->itemsCapacity == 0 ? 16 : group->itemsCapacity * 2;
+        UA_MonitoredItem **items = UA_realloc(group->items, capacity * sizeof(UA_MonitoredItem*));
+        if(!items) {
+            if(group->itemsSize == 0 && !group->sampling)
+                deleteSamplingGroup(server, group);
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+        group->items = items;
+        group->itemsCapacity = capacity;
+    }
+    monitoredItem->samplingGroup = group;
+    monitoredItem->samplingIndex = group->itemsSize;
+    monitoredItem->samplingTick = group->tick - 1;
+    group->items[group->itemsSize] = monitoredItem;
+    group->itemsSize++;
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+MonitoredItem_unregister(UA_Server *server, UA_MonitoredItem *monitoredItem) {
+    SamplingGroup_remove(server, monitoredItem);
+    UA_MonitoredNode *mn = monitoredItem->monitoredNode;
+    if(!mn)
+        return;
+    LIST_REMOVE(monitoredItem, nodeEntry);
+    monitoredItem->monitoredNode = NULL;
+    if(LIST_FIRST(&mn->items))
+        return;
+    UA_MonitoredItemIndex *index = server->monitoredItems;
+    UA_MonitoredNode **entry = findMonitoredNode(index, &mn->nodeId, mn->hash);
+    *entry = mn->next;
+    index->nodesSize--;
+    UA_NodeId_deleteMembers(&mn->nodeId);
+    UA_free(mn);
+}
+
+UA_StatusCode
+MonitoredItem_register(UA_Server *server, UA_MonitoredItem *monitoredItem, const UA_Node *target) {
+    UA_MonitoredItemIndex *index = server->monitoredItems;
+    if(!index) {
+        index = UA_calloc(1, sizeof(UA_MonitoredItemIndex));
+        if(!index)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        if(resizeMonitoredItemIndex(index, 64) != UA_STATUSCODE_GOOD) {
+            UA_free(index);
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+        LIST_INIT(&index->samplingGroups);
+        server->monitoredItems = index;
+    }
+
+    hash_t h = UA_NodeId_hash(&monitoredItem->monitoredNodeId);
+    UA_MonitoredNode **entry = findMonitoredNode(index, &monitoredItem->monitoredNodeId, h);
+    UA_MonitoredNode *mn = *entry;
+    if(!mn) {
+        /* grow at an average chain length of one. a failed resize leaves the
+           chains longer */
+        if(index->nodesSize >= index->bucketsSize &&
+           resizeMonitoredItemIndex(index, index->bucketsSize * 2) == UA_STATUSCODE_GOOD)
+            entry = findMonitoredNode(index, &monitoredItem->monitoredNodeId, h);
+        mn = UA_malloc(sizeof(UA_MonitoredNode));
+        if(!mn)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        if(UA_NodeId_copy(&monitoredItem->monitoredNodeId, &mn->nodeId) != UA_STATUSCODE_GOOD) {
+            UA_free(mn);
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        }
+        mn->hash = h;
+        LIST_INIT(&mn->items);
+        mn->next = NULL;
+        *entry = mn;
+        index->nodesSize++;
+    }
+    LIST_INSERT_HEAD(&mn->items, monitoredItem, nodeEntry);
+    monitoredItem->monitoredNode = mn;
+    if(!isPolled(monitoredItem, target))
+        return UA_STATUSCODE_GOOD;
+    UA_StatusCode retval = SamplingGroup_add(server, monitoredItem);
+    if(retval != UA_STATUSCODE_GOOD)
+        MonitoredItem_unregister(server, monitoredItem);
+    return retval;
+}
+
+void
+UA_Server_notifyMonitoredItems(UA_Server *server, const UA_NodeId *nodeId, UA_UInt32 attributeId) {
+    UA_MonitoredItemIndex *index = server->monitoredItems;
+    if(!index || index->nodesSize == 0)
+        return;
+    UA_MonitoredNode *mn = *findMonitoredNode(index, nodeId, UA_NodeId_hash(nodeId));
+    if(!mn)
+        return;
+    const UA_Node *target = UA_NodeStore_get(server->nodestore, nodeId);
+    if(!target)
+        return;
+
+    /* the written value is sampled once and compared by all items */
+    UA_DataValue sample;
+    UA_Boolean borrowed = true;
+    UA_Boolean sampled = false;
+    UA_MonitoredSample *shared = NULL;
+    UA_MonitoredItem *mon;
+    LIST_FOREACH(mon, &mn->items, nodeEntry) {
+        if(mon->attributeID != attributeId)
+            continue;
+        /* polled items are sampled by their group. The onRead callback of the
+           value might write the node itself. */
+        if(isPolled(mon, target)) {
+            if(!mon->samplingGroup)
+                SamplingGroup_add(server, mon);
+            continue;
+        }
+        SamplingGroup_remove(server, mon);
+        if(!sampled) {
+            if(!sampleAttribute(attributeId, target, &sample, &borrowed))
+                return;
+            sampled = true;
+        }
+        MonitoredItem_queueSample(server, mon, &sample, &shared);
+    }
+    if(shared)
+        MonitoredSample_release(shared);
+    if(sampled && !borrowed)
+        UA_DataValue_deleteMembers(&sample);
+}
+
 UA_MonitoredItem * UA_MonitoredItem_new() {
     UA_MonitoredItem *new = (UA_MonitoredItem *) UA_malloc(sizeof(UA_MonitoredItem));
+    if(!new)
+        return NULL;
+    new->subscription = NULL;
+    new->monitoredNode = NULL;
     new->queueSize   = (UA_BoundedUInt32) { .min = 0, .max = 0, .current = 0};
-    new->lastSampled = 0;
+    new->samplingGroup = NULL;
+    new->trigger = UA_DATACHANGETRIGGER_STATUSVALUE;
+    new->deadband = 0.0;
     // FIXME: This is currently hardcoded;
     new->monitoredItemType = MONITOREDITEM_TYPE_CHANGENOTIFY;
-    TAILQ_INIT(&new->queue);
+    new->queue = NULL;
+    new->queueStart = 0;
     UA_NodeId_init(&new->monitoredNodeId);
-    new->lastSampledValue.data = 0;
+    new->lastSample = NULL;
     return new;
 }
 
-void MonitoredItem_delete(UA_MonitoredItem *monitoredItem) {
+void MonitoredItem_delete(UA_Server *server, UA_MonitoredItem *monitoredItem) {
     // Delete Queued Data
     MonitoredItem_ClearQueue(monitoredItem);
-    // Remove from subscription list
-    LIST_REMOVE(monitoredItem, listEntry);
+    UA_free(monitoredItem->queue);
+    // Remove from the index of monitored nodes
+    MonitoredItem_unregister(server, monitoredItem);
     // Release comparison sample
-    if(monitoredItem->lastSampledValue.data != NULL) { 
-      UA_free(monitoredItem->lastSampledValue.data);
-    }
+    if(monitoredItem->lastSample)
+        MonitoredSample_release(monitoredItem->lastSample);
     
     UA_NodeId_deleteMembers(&(monitoredItem->monitoredNodeId));
     UA_free(monitoredItem);
 }
 
-UA_UInt32 MonitoredItem_QueueToDataChangeNotifications(UA_MonitoredItemNotification *dst,
-                                                 UA_MonitoredItem *monitoredItem) {
-    UA_UInt32 queueSize = 0;
-    MonitoredItem_queuedValue *queueItem;
-  
-    // Count instead of relying on the items current
-    TAILQ_FOREACH(queueItem, &monitoredItem->queue, listEntry) {
-        dst[queueSize].clientHandle = monitoredItem->clientHandle;
-        UA_DataValue_copy(&queueItem->value, &dst[queueSize].value);
-
-        dst[queueSize].value.hasServerPicoseconds = false;
-        dst[queueSize].value.hasServerTimestamp   = true;
-        dst[queueSize].value.serverTimestamp      = UA_DateTime_now();
-    
-        // Do not create variants with no type -> will make calcSizeBinary() segfault.
-        if(dst[queueSize].value.value.type)
-            queueSize++;
+UA_StatusCode MonitoredItem_setQueueSize(UA_MonitoredItem *monitoredItem, UA_UInt32 queueSize) {
+    if(queueSize == 0)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    UA_MonitoredSample **queue = UA_calloc(queueSize, sizeof(UA_MonitoredSample*));
+    if(!queue)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    // Keep the newest samples
+    UA_UInt32 current = monitoredItem->queueSize.current;
+    UA_UInt32 discarded = current > queueSize ? current - queueSize : 0;
+    for(UA_UInt32 i = 0; i < current; i++) {
+        UA_MonitoredSample *sample = MONITOREDITEM_QUEUED(monitoredItem, i);
+        if(i < discarded)
+            MonitoredSample_release(sample);
+        else
+            queue[i - discarded] = sample;
     }
-    return queueSize;
+    UA_free(monitoredItem->queue);
+    monitoredItem->queue = queue;
+    monitoredItem->queueStart = 0;
+    monitoredItem->queueSize.current = current - discarded;
+    if(monitoredItem->subscription)
+        monitoredItem->subscription->pendingSamples -= discarded;
+    monitoredItem->queueSize.max = queueSize;
+    return UA_STATUSCODE_GOOD;
 }
 
 void MonitoredItem_ClearQueue(UA_MonitoredItem *monitoredItem) {
-    MonitoredItem_queuedValue *val, *val_tmp;
-    TAILQ_FOREACH_SAFE(val, &monitoredItem->queue, listEntry, val_tmp) {
-        TAILQ_REMOVE(&monitoredItem->queue, val, listEntry);
-        UA_DataValue_deleteMembers(&val->value);
-        UA_free(val);
+    UA_Subscription *sub = monitoredItem->subscription;
+    if(sub && monitoredItem->queueSize.current > 0) {
+        sub->pendingSamples -= monitoredItem->queueSize.current;
+        TAILQ_REMOVE(&sub->pendingItems, monitoredItem, pendingEntry);
     }
+    for(UA_UInt32 i = 0; i < monitoredItem->queueSize.current; i++)
+        MonitoredSample_release(MONITOREDITEM_QUEUED(monitoredItem, i));
+    monitoredItem->queueStart = 0;
     monitoredItem->queueSize.current = 0;
 }
 
@@ -398,91 +998,160 @@ UA_Boolean MonitoredItem_CopyMonitoredValueToVariant(UA_UInt32 attributeID, cons
     return samplingError;
 }
 
-void MonitoredItem_QueuePushDataValue(UA_Server *server, UA_MonitoredItem *monitoredItem) {
-    UA_ByteString newValueAsByteString = { .length=0, .data=NULL };
-    size_t encodingOffset = 0;
-  
-    if(!monitoredItem || monitoredItem->lastSampled + monitoredItem->samplingInterval > UA_DateTime_now())
-        return;
-  
+static UA_Boolean
+numericValue(const void *data, size_t index, const UA_DataType *type, UA_Double *value) {
+    if(!type->builtin)
+        return false;
+    switch(type->typeIndex) {
+    case UA_TYPES_SBYTE: *value = ((const UA_SByte*)data)[index]; return true;
+    case UA_TYPES_BYTE: *value = ((const UA_Byte*)data)[index]; return true;
+    case UA_TYPES_INT16: *value = ((const UA_Int16*)data)[index]; return true;
+    case UA_TYPES_UINT16: *value = ((const UA_UInt16*)data)[index]; return true;
+    case UA_TYPES_INT32: *value = ((const UA_Int32*)data)[index]; return true;
+    case UA_TYPES_UINT32: *value = ((const UA_UInt32*)data)[index]; return true;
+    case UA_TYPES_INT64: *value = (UA_Double)((const UA_Int64*)data)[index]; return true;
+    case UA_TYPES_UINT64: *value = (UA_Double)((const UA_UInt64*)data)[index]; return true;
+    case UA_TYPES_FLOAT: *value = ((const UA_Float*)data)[index]; return true;
+    case UA_TYPES_DOUBLE: *value = ((const UA_Double*)data)[index]; return true;
+    default: return false;
+    }
+}
+
+/* A numeric value changes if an element moves by more than the deadband.
+   Other values are compared exactly. */
+static UA_Boolean
+valueChanged(const UA_Variant *last, const UA_Variant *sample, UA_Double deadband) {
+    if(deadband <= 0.0 || last->type != sample->type ||
+       last->arrayLength != sample->arrayLength || !sample->data)
+        return !UA_equal(last, sample, &UA_TYPES[UA_TYPES_VARIANT]);
+    size_t length = UA_Variant_isScalar(sample) ? 1 : sample->arrayLength;
+    for(size_t i = 0; i < length; i++) {
+        UA_Double a, b;
+        if(!numericValue(last->data, i, last->type, &a) ||
+           !numericValue(sample->data, i, sample->type, &b))
+            return !UA_equal(last, sample, &UA_TYPES[UA_TYPES_VARIANT]);
+        if(a - b > deadband || b - a > deadband)
+            return true;
+    }
+    return false;
+}
+
+/* The trigger of the data change filter decides whether the value and the
+   source timestamp are compared in addition to the status */
+static UA_Boolean
+sampleChanged(const UA_MonitoredItem *monitoredItem, const UA_DataValue *last,
+              const UA_DataValue *sample) {
+    UA_StatusCode lastStatus = last->hasStatus ? last->status : UA_STATUSCODE_GOOD;
+    UA_StatusCode sampleStatus = sample->hasStatus ? sample->status : UA_STATUSCODE_GOOD;
+    if(lastStatus != sampleStatus)
+        return true;
+    if(monitoredItem->trigger == UA_DATACHANGETRIGGER_STATUS)
+        return false;
+    if(monitoredItem->trigger == UA_DATACHANGETRIGGER_STATUSVALUETIMESTAMP &&
+       (last->hasSourceTimestamp != sample->hasSourceTimestamp ||
+        last->sourceTimestamp != sample->sourceTimestamp))
+        return true;
+    return valueChanged(&last->value, &sample->value, monitoredItem->deadband);
+}
+
+/* A value stored in the node is borrowed. It is compared in place and copied
+   only when it has changed. Returns false if the attribute could not be
+   sampled. */
+static UA_Boolean
+sampleAttribute(UA_UInt32 attributeID, const UA_Node *target,
+                UA_DataValue *sample, UA_Boolean *borrowed) {
+    UA_DataValue_init(sample);
+    *borrowed = false;
+    if(attributeID == UA_ATTRIBUTEID_VALUE && target->nodeClass == UA_NODECLASS_VARIABLE) {
+        const UA_VariableNode *vn = (const UA_VariableNode*)target;
+        if(vn->valueSource == UA_VALUESOURCE_VARIANT && !vn->value.variant.callback.onRead) {
+            sample->value = vn->value.variant.value;
+            sample->value.storageType = UA_VARIANT_DATA_NODELETE;
+            sample->hasValue = true;
+            *borrowed = true;
+            return true;
+        }
+    }
+    if(MonitoredItem_CopyMonitoredValueToVariant(attributeID, target, sample)) {
+        UA_DataValue_deleteMembers(sample);
+        return false;
+    }
+    return true;
+}
+
+/* The sample is queued if it differs from the last queued sample. The first
+   item to queue it creates the shared sample that the other items reference. */
+static void
+MonitoredItem_queueSample(UA_Server *server, UA_MonitoredItem *monitoredItem,
+                          const UA_DataValue *sample, UA_MonitoredSample **shared) {
     // FIXME: Actively suppress non change value based monitoring. There should be
     // another function to handle status and events.
     if(monitoredItem->monitoredItemType != MONITOREDITEM_TYPE_CHANGENOTIFY)
         return;
 
-    MonitoredItem_queuedValue *newvalue = UA_malloc(sizeof(MonitoredItem_queuedValue));
-    if(!newvalue)
+    if(!sample->value.type || (monitoredItem->lastSample &&
+                               !sampleChanged(monitoredItem, &monitoredItem->lastSample->value, sample)))
         return;
 
-    newvalue->listEntry.tqe_next = NULL;
-    newvalue->listEntry.tqe_prev = NULL;
-    UA_DataValue_init(&newvalue->value);
-
-    // Verify that the *Node being monitored is still valid
-    // Looking up the in the nodestore is only necessary if we suspect that it is changed during writes
-    // e.g. in multithreaded applications
-    const UA_Node *target = UA_NodeStore_get(server->nodestore, &monitoredItem->monitoredNodeId);
-    if(!target) {
-        UA_free(newvalue);
+    if(!monitoredItem->queue ||
+       (monitoredItem->queueSize.current >= monitoredItem->queueSize.max && !monitoredItem->discardOldest)) {
+        // We cannot remove the oldest value and theres no queue space left. We're done here.
         return;
     }
-  
-    UA_Boolean samplingError = MonitoredItem_CopyMonitoredValueToVariant(monitoredItem->attributeID, target,
-                                                                         &newvalue->value);
 
-    if(samplingError != false || !newvalue->value.value.type) {
-        UA_DataValue_deleteMembers(&newvalue->value);
-        UA_free(newvalue);
-        return;
+    if(!*shared) {
+        *shared = MonitoredSample_new(server, sample);
+        if(!*shared)
+            return;
     }
-  
+
+    // The sample is queued and kept for the comparison with the next sample
+    MonitoredSample_retain(*shared);
+    if(monitoredItem->lastSample)
+        MonitoredSample_release(monitoredItem->lastSample);
+    monitoredItem->lastSample = *shared;
+
+    UA_Subscription *sub = monitoredItem->subscription;
     if(monitoredItem->queueSize.current >= monitoredItem->queueSize.max) {
-        if(monitoredItem->discardOldest != true) {
-            // We cannot remove the oldest value and theres no queue space left. We're done here.
-            UA_DataValue_deleteMembers(&newvalue->value);
-            UA_free(newvalue);
-            return;
-        }
-        MonitoredItem_queuedValue *queueItem = TAILQ_LAST(&monitoredItem->queue, QueueOfQueueDataValues);
-        TAILQ_REMOVE(&monitoredItem->queue, queueItem, listEntry);
-        UA_free(queueItem);
+        // Overwrite the oldest slot
+        MonitoredSample_release(MONITOREDITEM_QUEUED(monitoredItem, 0));
+        monitoredItem->queueStart = (monitoredItem->queueStart + 1) % monitoredItem->queueSize.max;
         monitoredItem->queueSize.current--;
+    } else if(sub) {
+        if(monitoredItem->queueSize.current == 0)
+            TAILQ_INSERT_TAIL(&sub->pendingItems, monitoredItem, pendingEntry);
+        sub->pendingSamples++;
     }
-  
-    // encode the data to find if its different to the previous
-    size_t binsize = UA_calcSizeBinary(&newvalue->value, &UA_TYPES[UA_TYPES_DATAVALUE]);
-    UA_StatusCode retval = UA_ByteString_allocBuffer(&newValueAsByteString, binsize);
-    if(retval != UA_STATUSCODE_GOOD) {
-        UA_DataValue_deleteMembers(&newvalue->value);
-        UA_free(newvalue);
+    MonitoredSample_retain(*shared);
+    MONITOREDITEM_QUEUED(monitoredItem, monitoredItem->queueSize.current) = *shared;
+    monitoredItem->queueSize.current++;
+}
+
+void MonitoredItem_QueuePushDataValue(UA_Server *server, UA_MonitoredItem *monitoredItem) {
+    if(!monitoredItem)
         return;
-    }
-    
-    retval = UA_encodeBinary(&newvalue->value, &UA_TYPES[UA_TYPES_DATAVALUE], &newValueAsByteString, &encodingOffset);
-    if(retval != UA_STATUSCODE_GOOD) {
-        UA_ByteString_deleteMembers(&newValueAsByteString);
-        UA_DataValue_deleteMembers(&newvalue->value);
-        UA_free(newvalue);
+
+    // Verify that the *Node being monitored is still valid
+    // Looking up the in the nodestore is only necessary if we suspect that it is changed during writes
+    // e.g. in multithreaded applications
+    const UA_Node *target = UA_NodeStore_get(server->nodestore, &monitoredItem->monitoredNodeId);
+    if(!target)
         return;
-    }
-  
-    if(!monitoredItem->lastSampledValue.data) { 
-        UA_ByteString_copy(&newValueAsByteString, &monitoredItem->lastSampledValue);
-        TAILQ_INSERT_HEAD(&monitoredItem->queue, newvalue, listEntry);
-        monitoredItem->queueSize.current++;
-        monitoredItem->lastSampled = UA_DateTime_now();
-        UA_free(newValueAsByteString.data);
-    } else {
-        if(UA_String_equal(&newValueAsByteString, &monitoredItem->lastSampledValue) == true) {
-            UA_DataValue_deleteMembers(&newvalue->value);
-            UA_free(newvalue);
-            UA_String_deleteMembers(&newValueAsByteString);
-            return;
-        }
-        UA_ByteString_deleteMembers(&monitoredItem->lastSampledValue);
-        monitoredItem->lastSampledValue = newValueAsByteString;
-        TAILQ_INSERT_HEAD(&monitoredItem->queue, newvalue, listEntry);
-        monitoredItem->queueSize.current++;
-        monitoredItem->lastSampled = UA_DateTime_now();
-    }
+    // The value source of the node might have changed since the last sample
+    UA_Boolean polled = isPolled(monitoredItem, target);
+    if(polled && !monitoredItem->samplingGroup)
+        SamplingGroup_add(server, monitoredItem);
+    else if(!polled && monitoredItem->samplingGroup)
+        SamplingGroup_remove(server, monitoredItem);
+
+    UA_DataValue sample;
+    UA_Boolean borrowed;
+    if(!sampleAttribute(monitoredItem->attributeID, target, &sample, &borrowed))
+        return;
+    UA_MonitoredSample *shared = NULL;
+    MonitoredItem_queueSample(server, monitoredItem, &sample, &shared);
+    if(shared)
+        MonitoredSample_release(shared);
+    if(!borrowed)
+        UA_DataValue_deleteMembers(&sample);
 }
@@ -17,13 +17,23 @@ typedef enum {
     MONITOREDITEM_TYPE_EVENTNOTIFY = 4
 } UA_MONITOREDITEM_TYPE;
 
-typedef struct MonitoredItem_queuedValue {
-    UA_DataValue value;
-    TAILQ_ENTRY(MonitoredItem_queuedValue) listEntry;
-} MonitoredItem_queuedValue;
+typedef struct UA_MonitoredNode UA_MonitoredNode;
+typedef struct UA_SamplingGroup UA_SamplingGroup;
+
+/* A sample is shared by the queues of all items that took it at the same time.
+   It is encoded once and the bytes are reused in every notification. */
+typedef struct {
+    UA_UInt32 refCount;
+    UA_DataValue value; // with the server timestamp of the sample
+    UA_ByteString encoded; // the binary encoding of the value
+} UA_MonitoredSample;
 
 typedef struct UA_MonitoredItem {
     LIST_ENTRY(UA_MonitoredItem) listEntry;
+    UA_Subscription *subscription; // NULL until the item is added to the subscription
+    TAILQ_ENTRY(UA_MonitoredItem) pendingEntry; // while samples are queued
+    LIST_ENTRY(UA_MonitoredItem) nodeEntry; // the items of the same node
+    UA_MonitoredNode *monitoredNode; // NULL if the item is not registered
     UA_UInt32 itemId;
     UA_MONITOREDITEM_TYPE monitoredItemType;
     UA_UInt32 timestampsToReturn;
@@ -34,60 +44,108 @@ typedef struct UA_MonitoredItem {
     UA_UInt32 samplingInterval; // [ms]
     UA_BoundedUInt32 queueSize;
     UA_Boolean discardOldest;
-    UA_DateTime lastSampled;
-    UA_ByteString lastSampledValue;
+    UA_SamplingGroup *samplingGroup; // NULL if the item is not polled
+    size_t samplingIndex; // position in the sampling group
+    UA_UInt32 samplingTick; // the last sample of the group that included the item
+    UA_MonitoredSample *lastSample; // the last queued sample, compared with the next sample
+    UA_DataChangeTrigger trigger;
+    UA_Double deadband; // absolute, a percent deadband is converted with the EURange
     // FIXME: indexRange is ignored; array values default to element 0
     // FIXME: dataEncoding is hardcoded to UA binary
-    TAILQ_HEAD(QueueOfQueueDataValues, MonitoredItem_queuedValue) queue;
+    // Ring buffer of queueSize.max samples. queueSize.current samples are
+    // queued, starting with the oldest at queueStart.
+    UA_MonitoredSample **queue;
+    UA_UInt32 queueStart;
 } UA_MonitoredItem;
 
+#define MONITOREDITEM_QUEUED(mon, i) \
+    ((mon)->queue[((mon)->queueStart + (i)) % (mon)->queueSize.max])
+
 UA_MonitoredItem *UA_MonitoredItem_new(void);
-void MonitoredItem_delete(UA_MonitoredItem *monitoredItem);
+/* The item has to be removed from the subscription before */
+void MonitoredItem_delete(UA_Server *server, UA_MonitoredItem *monitoredItem);
 void MonitoredItem_QueuePushDataValue(UA_Server *server, UA_MonitoredItem *monitoredItem);
+/* Allocates the ring buffer. The newest samples are retained. */
+UA_StatusCode MonitoredItem_setQueueSize(UA_MonitoredItem *monitoredItem, UA_UInt32 queueSize);
 void MonitoredItem_ClearQueue(UA_MonitoredItem *monitoredItem);
 UA_Boolean MonitoredItem_CopyMonitoredValueToVariant(UA_UInt32 attributeID, const UA_Node *src,
                                                      UA_DataValue *dst);
-UA_UInt32 MonitoredItem_QueueToDataChangeNotifications(UA_MonitoredItemNotification *dst,
-                                                       UA_MonitoredItem *monitoredItem);
+
+/* Monitored items are indexed by the node they monitor. A write to the node
+   samples its items right away. Only the items on a value from a data source or
+   with an onRead callback are polled. They are grouped by sampling interval
+   across all sessions and every group is sampled by a single repeated job. */
+UA_StatusCode MonitoredItem_register(UA_Server *server, UA_MonitoredItem *monitoredItem,
+                                     const UA_Node *target);
 
 /****************/
 /* Subscription */
 /****************/
 
-typedef struct UA_unpublishedNotification {
-    UA_Boolean publishedOnce;
-    LIST_ENTRY(UA_unpublishedNotification) listEntry;
+/* A slot of the retransmission queue. Sequence number zero marks an empty
+   slot. */
+typedef struct {
+    size_t size; // the encoded bytes, counted against the budgets
     UA_NotificationMessage notification;
 } UA_unpublishedNotification;
 
 struct UA_Subscription {
     LIST_ENTRY(UA_Subscription) listEntry;
+    UA_Session *session;
     UA_BoundedUInt32 lifeTime;
     UA_BoundedUInt32 keepAliveCount;
+    UA_UInt32 emptyIntervals; // publishing intervals without a message to send
+    UA_Boolean keepAlivePending; // a keep-alive waits for a publish request
     UA_Double publishingInterval;     // [ms] 
     UA_DateTime lastPublished;
     UA_UInt32 subscriptionID;
     UA_UInt32 notificationsPerPublish;
     UA_Boolean publishingMode;
     UA_UInt32 priority;
-    UA_UInt32 sequenceNumber;
+    UA_UInt32 sequenceNumber; // of the next notification
     UA_Guid timedUpdateJobGuid;
     UA_Boolean timedUpdateIsRegistered;
-    LIST_HEAD(UA_ListOfUnpublishedNotifications, UA_unpublishedNotification) unpublishedNotifications;
+    // The notifications are retained until they are acknowledged. The ring is
+    // indexed by sequence number modulo its capacity (a power of two). It spans
+    // from the oldest retained notification to the next sequence number, the
+    // acknowledged notifications in between leave empty slots. The
+    // notifications from unsentSequenceNumber on were not sent yet.
+    UA_unpublishedNotification *retransmissionQueue;
+    UA_UInt32 retransmissionQueueCapacity;
+    UA_UInt32 firstSequenceNumber;
+    UA_UInt32 unsentSequenceNumber;
     size_t unpublishedNotificationsSize;
+    size_t retransmissionQueueBytes;
     LIST_HEAD(UA_ListOfUAMonitoredItems, UA_MonitoredItem) MonitoredItems;
+    // The items with queued samples in the order of their oldest sample, and
+    // the number of queued samples. They are maintained when samples are
+    // queued and cleared, so that a publishing interval visits only these
+    // items.
+    TAILQ_HEAD(UA_ListOfPendingMonitoredItems, UA_MonitoredItem) pendingItems;
+    UA_UInt32 pendingSamples;
 };
 
-UA_Subscription *UA_Subscription_new(UA_UInt32 subscriptionID);
+UA_Subscription *UA_Subscription_new(UA_Session *session, UA_UInt32 subscriptionID);
 void UA_Subscription_deleteMembers(UA_Subscription *subscription, UA_Server *server);
-void Subscription_updateNotifications(UA_Subscription *subscription);
-UA_UInt32 *Subscription_getAvailableSequenceNumbers(UA_Subscription *sub);
+void Subscription_updateNotifications(UA_Server *server, UA_Subscription *subscription);
+/* The sequence numbers of the notifications that were sent and not acknowledged */
+UA_UInt32 *Subscription_getAvailableSequenceNumbers(UA_Subscription *sub, size_t *size);
 void Subscription_generateKeepAlive(UA_Subscription *subscription);
-void Subscription_copyTopNotificationMessage(UA_NotificationMessage *dst, UA_Subscription *sub);
-UA_UInt32 Subscription_deleteUnpublishedNotification(UA_UInt32 seqNo, UA_Boolean bDeleteAll, UA_Subscription *sub);
+/* Returns the retained notification or NULL */
+UA_unpublishedNotification *
+Subscription_getNotification(UA_Subscription *sub, UA_UInt32 sequenceNumber);
+/* Removes a notification that was sent from the retransmission queue */
+UA_StatusCode Subscription_acknowledge(UA_Server *server, UA_Subscription *sub,
+                                       UA_UInt32 sequenceNumber);
 void Subscription_copyNotificationMessage(UA_NotificationMessage *dst, UA_unpublishedNotification *src);
 UA_StatusCode Subscription_createdUpdateJob(UA_Server *server, UA_Guid jobId, UA_Subscription *sub);
 UA_StatusCode Subscription_registerUpdateJob(UA_Server *server, UA_Subscription *sub);
 UA_StatusCode Subscription_unregisterUpdateJob(UA_Server *server, UA_Subscription *sub);
 
+/* Answers the oldest queued publish request of the session with the oldest
+   notification of the subscription that was not sent yet. Returns false if
+   there is no request or nothing to send. A subscription with notifications
+   but no request is late and answers the next publish request right away. */
+UA_Boolean Subscription_publish(UA_Server *server, UA_Subscription *sub);
+
 #endif /* UA_SUBSCRIPTION_H_ */
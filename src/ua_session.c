@@ -32,6 +32,8 @@ void UA_Session_init(UA_Session *session) {
 #ifdef UA_ENABLE_SUBSCRIPTIONS
     LIST_INIT(&session->serverSubscriptions);
     session->lastSubscriptionID = UA_UInt32_random();
+    TAILQ_INIT(&session->responseQueue);
+    session->responseQueueSize = 0;
 #endif
     session->availableContinuationPoints = MAXCONTINUATIONPOINTS;
     LIST_INIT(&session->continuationPoints);
@@ -58,6 +60,13 @@ void UA_Session_deleteMembersCleanup(UA_Session *session, UA_Server* server) {
         UA_Subscription_deleteMembers(currents, server);
         UA_free(currents);
     }
+    UA_PublishResponseEntry *entry, *tmp_entry;
+    TAILQ_FOREACH_SAFE(entry, &session->responseQueue, listEntry, tmp_entry) {
+        TAILQ_REMOVE(&session->responseQueue, entry, listEntry);
+        UA_PublishResponse_deleteMembers(&entry->response);
+        UA_free(entry);
+    }
+    session->responseQueueSize = 0;
 #endif
 }
 
@@ -79,8 +88,21 @@ UA_Session_deleteSubscription(UA_Server *server, UA_Session *session, UA_UInt32
     LIST_REMOVE(sub, listEntry);
     UA_Subscription_deleteMembers(sub, server);
     UA_free(sub);
+
+    /* Without subscriptions, the queued publish requests are never answered */
+    if(!LIST_EMPTY(&session->serverSubscriptions))
+        return UA_STATUSCODE_GOOD;
+    UA_DateTime now = UA_DateTime_now();
+    UA_PublishResponseEntry *entry;
+    while((entry = TAILQ_FIRST(&session->responseQueue))) {
+        TAILQ_REMOVE(&session->responseQueue, entry, listEntry);
+        session->responseQueueSize--;
+        entry->response.responseHeader.timestamp = now;
+        entry->response.responseHeader.serviceResult = UA_STATUSCODE_BADNOSUBSCRIPTION;
+        UA_Session_sendPublishResponse(session, entry);
+    }
     return UA_STATUSCODE_GOOD;
-} 
+}
 
 UA_Subscription *
 UA_Session_getSubscriptionByID(UA_Session *session, UA_UInt32 subscriptionID) {
@@ -94,7 +116,7 @@ UA_Session_getSubscriptionByID(UA_Session *session, UA_UInt32 subscriptionID) {
 
 
 UA_StatusCode
-UA_Session_deleteMonitoredItem(UA_Session *session, UA_UInt32 subscriptionID,
+UA_Session_deleteMonitoredItem(UA_Server *server, UA_Session *session, UA_UInt32 subscriptionID,
                                UA_UInt32 monitoredItemID) {
     UA_Subscription *sub = UA_Session_getSubscriptionByID(session, subscriptionID);
     if(!sub)
@@ -104,7 +126,7 @@ UA_Session_deleteMonitoredItem(UA_Session *session, UA_UInt32 subscriptionID,
     LIST_FOREACH_SAFE(mon, &sub->MonitoredItems, listEntry, tmp_mon) {
         if(mon->itemId == monitoredItemID) {
             LIST_REMOVE(mon, listEntry);
-            MonitoredItem_delete(mon);
+            MonitoredItem_delete(server, mon);
             return UA_STATUSCODE_GOOD;
         }
     }
@@ -116,4 +138,28 @@ UA_UInt32 UA_Session_getUniqueSubscriptionID(UA_Session *session) {
 }
 
 
+void
+UA_Session_sendPublishResponse(UA_Session *session, UA_PublishResponseEntry *entry) {
+    UA_SecureChannel *channel = session->channel;
+    if(channel)
+        UA_SecureChannel_sendBinaryMessage(channel, entry->requestId, &entry->response,
+                                           &UA_TYPES[UA_TYPES_PUBLISHRESPONSE]);
+    UA_PublishResponse_deleteMembers(&entry->response);
+    UA_free(entry);
+}
+
+void
+UA_Session_expirePublishRequests(UA_Session *session, UA_DateTime now) {
+    UA_PublishResponseEntry *entry, *tmp_entry;
+    TAILQ_FOREACH_SAFE(entry, &session->responseQueue, listEntry, tmp_entry) {
+        if(entry->maxTime == 0 || entry->maxTime > now)
+            continue;
+        TAILQ_REMOVE(&session->responseQueue, entry, listEntry);
+        session->responseQueueSize--;
+        entry->response.responseHeader.timestamp = now;
+        entry->response.responseHeader.serviceResult = UA_STATUSCODE_BADTIMEOUT;
+        UA_Session_sendPublishResponse(session, entry);
+    }
+}
+
 #endif
@@ -19,6 +19,15 @@ struct ContinuationPointEntry {
 struct UA_Subscription;
 typedef struct UA_Subscription UA_Subscription;
 
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+typedef struct UA_PublishResponseEntry {
+    TAILQ_ENTRY(UA_PublishResponseEntry) listEntry;
+    UA_UInt32 requestId;
+    UA_DateTime maxTime; // the request times out, 0 if it does not
+    UA_PublishResponse response;
+} UA_PublishResponseEntry;
+#endif
+
 struct UA_Session {
     UA_ApplicationDescription clientDescription;
     UA_Boolean        activated;
@@ -35,6 +44,8 @@ struct UA_Session {
 #ifdef UA_ENABLE_SUBSCRIPTIONS
     UA_UInt32 lastSubscriptionID;
     LIST_HEAD(UA_ListOfUASubscriptions, UA_Subscription) serverSubscriptions;
+    TAILQ_HEAD(UA_ListOfQueuedPublishResponses, UA_PublishResponseEntry) responseQueue;
+    UA_UInt32 responseQueueSize;
 #endif
 };
 
@@ -55,15 +66,26 @@ UA_Subscription *
 UA_Session_getSubscriptionByID(UA_Session *session, UA_UInt32 subscriptionID);
 
 UA_StatusCode
-UA_Session_deleteMonitoredItem(UA_Session *session, UA_UInt32 subscriptionID,
+UA_Session_deleteMonitoredItem(UA_Server *server, UA_Session *session, UA_UInt32 subscriptionID,
                                UA_UInt32 monitoredItemID);
 
+/* Answers the queued publish requests with BadNoSubscription when the last
+ * subscription of the session is deleted */
 UA_StatusCode
 UA_Session_deleteSubscription(UA_Server *server, UA_Session *session,
                               UA_UInt32 subscriptionID);
 
 UA_UInt32
 UA_Session_getUniqueSubscriptionID(UA_Session *session);
+
+/* Publish requests are queued until a subscription of the session has
+ * notifications or a keep-alive to send */
+void
+UA_Session_sendPublishResponse(UA_Session *session, UA_PublishResponseEntry *entry);
+
+/* Answer the queued publish requests that have timed out */
+void
+UA_Session_expirePublishRequests(UA_Session *session, UA_DateTime now);
 #endif
 
 
@@ -46,6 +46,8 @@ UA_String UA_String_fromChars(char const src[]) {
 UA_Boolean UA_String_equal(const UA_String *string1, const UA_String *string2) {
     if(string1->length != string2->length)
         return false;
+    if(string1->data == string2->data)
+        return true; /* interned strings */
     UA_Int32 is = memcmp((char const*)string1->data, (char const*)string2->data, string1->length);
     return (is == 0) ? true : false;
 }
@@ -797,6 +799,197 @@ void UA_delete(void *p, const UA_DataType *type) {
     UA_free(p);
 }
 
+/************/
+/* Equality */
+/************/
+
+static UA_Boolean equalNoInit(const void *p1, const void *p2, const UA_DataType *type);
+
+static UA_Boolean
+arrayEqual(const void *p1, const void *p2, size_t size, const UA_DataType *type) {
+    if(size == 0 || p1 == p2)
+        return true;
+    if(p1 <= UA_EMPTY_ARRAY_SENTINEL || p2 <= UA_EMPTY_ARRAY_SENTINEL)
+        return false;
+    if(type->overlayable)
+        return memcmp(p1, p2, type->memSize * size) == 0;
+    uintptr_t ptr1 = (uintptr_t)p1;
+    uintptr_t ptr2 = (uintptr_t)p2;
+    for(size_t i = 0; i < size; i++) {
+        if(!UA_equal((const void*)ptr1, (const void*)ptr2, type))
+            return false;
+        ptr1 += type->memSize;
+        ptr2 += type->memSize;
+    }
+    return true;
+}
+
+/* Floats are compared bitwise. So a NaN equals itself as on the binary stream. */
+static UA_Boolean equalFixedSize(const void *p1, const void *p2, const UA_DataType *type) {
+    return memcmp(p1, p2, type->memSize) == 0;
+}
+
+static UA_Boolean
+String_equal(const UA_String *s1, const UA_String *s2, const UA_DataType *_) {
+    return UA_String_equal(s1, s2);
+}
+
+static UA_Boolean
+NodeId_equal(const UA_NodeId *n1, const UA_NodeId *n2, const UA_DataType *_) {
+    return UA_NodeId_equal(n1, n2);
+}
+
+static UA_Boolean
+ExpandedNodeId_equal(const UA_ExpandedNodeId *e1, const UA_ExpandedNodeId *e2, const UA_DataType *_) {
+    return e1->serverIndex == e2->serverIndex && UA_NodeId_equal(&e1->nodeId, &e2->nodeId) &&
+        UA_String_equal(&e1->namespaceUri, &e2->namespaceUri);
+}
+
+static UA_Boolean
+LocalizedText_equal(const UA_LocalizedText *l1, const UA_LocalizedText *l2, const UA_DataType *_) {
+    return UA_String_equal(&l1->text, &l2->text) && UA_String_equal(&l1->locale, &l2->locale);
+}
+
+static UA_Boolean
+ExtensionObject_equal(const UA_ExtensionObject *e1, const UA_ExtensionObject *e2, const UA_DataType *_) {
+    /* decoded objects are equal regardless of the ownership of the content */
+    UA_Boolean decoded1 = e1->encoding >= UA_EXTENSIONOBJECT_DECODED;
+    UA_Boolean decoded2 = e2->encoding >= UA_EXTENSIONOBJECT_DECODED;
+    if(decoded1 != decoded2)
+        return false;
+    if(!decoded1)
+        return e1->encoding == e2->encoding &&
+            UA_NodeId_equal(&e1->content.encoded.typeId, &e2->content.encoded.typeId) &&
+            UA_ByteString_equal(&e1->content.encoded.body, &e2->content.encoded.body);
+    if(e1->content.decoded.type != e2->content.decoded.type)
+        return false;
+    if(!e1->content.decoded.data || !e2->content.decoded.data)
+        return e1->content.decoded.data == e2->content.decoded.data;
+    return UA_equal(e1->content.decoded.data, e2->content.decoded.data, e1->content.decoded.type);
+}
+
+static UA_Boolean
+Variant_equal(const UA_Variant *v1, const UA_Variant *v2, const UA_DataType *_) {
+    if(v1->type != v2->type || v1->arrayLength != v2->arrayLength ||
+       v1->arrayDimensionsSize != v2->arrayDimensionsSize)
+        return false;
+    if(!v1->type)
+        return true; /* empty variants */
+    if(UA_Variant_isScalar(v1) != UA_Variant_isScalar(v2))
+        return false;
+    size_t length = v1->arrayLength;
+    if(UA_Variant_isScalar(v1))
+        length = 1;
+    return arrayEqual(v1->data, v2->data, length, v1->type) &&
+        arrayEqual(v1->arrayDimensions, v2->arrayDimensions, v1->arrayDimensionsSize,
+                   &UA_TYPES[UA_TYPES_INT32]);
+}
+
+static UA_Boolean
+DataValue_equal(const UA_DataValue *d1, const UA_DataValue *d2, const UA_DataType *_) {
+    if(d1->hasValue != d2->hasValue || d1->hasStatus != d2->hasStatus ||
+       d1->hasSourceTimestamp != d2->hasSourceTimestamp ||
+       d1->hasServerTimestamp != d2->hasServerTimestamp ||
+       d1->hasSourcePicoseconds != d2->hasSourcePicoseconds ||
+       d1->hasServerPicoseconds != d2->hasServerPicoseconds)
+        return false;
+    if((d1->hasStatus && d1->status != d2->status) ||
+       (d1->hasSourceTimestamp && d1->sourceTimestamp != d2->sourceTimestamp) ||
+       (d1->hasServerTimestamp && d1->serverTimestamp != d2->serverTimestamp) ||
+       (d1->hasSourcePicoseconds && d1->sourcePicoseconds != d2->sourcePicoseconds) ||
+       (d1->hasServerPicoseconds && d1->serverPicoseconds != d2->serverPicoseconds))
+        return false;
+    return !d1->hasValue || Variant_equal(&d1->value, &d2->value, NULL);
+}
+
+static UA_Boolean
+DiagnosticInfo_equal(const UA_DiagnosticInfo *d1, const UA_DiagnosticInfo *d2, const UA_DataType *_) {
+    if(d1->hasSymbolicId != d2->hasSymbolicId || d1->hasNamespaceUri != d2->hasNamespaceUri ||
+       d1->hasLocalizedText != d2->hasLocalizedText || d1->hasLocale != d2->hasLocale ||
+       d1->hasAdditionalInfo != d2->hasAdditionalInfo ||
+       d1->hasInnerStatusCode != d2->hasInnerStatusCode ||
+       d1->hasInnerDiagnosticInfo != d2->hasInnerDiagnosticInfo)
+        return false;
+    if((d1->hasSymbolicId && d1->symbolicId != d2->symbolicId) ||
+       (d1->hasNamespaceUri && d1->namespaceUri != d2->namespaceUri) ||
+       (d1->hasLocalizedText && d1->localizedText != d2->localizedText) ||
+       (d1->hasLocale && d1->locale != d2->locale) ||
+       (d1->hasAdditionalInfo && !UA_String_equal(&d1->additionalInfo, &d2->additionalInfo)) ||
+       (d1->hasInnerStatusCode && d1->innerStatusCode != d2->innerStatusCode))
+        return false;
+    if(!d1->hasInnerDiagnosticInfo || !d1->innerDiagnosticInfo || !d2->innerDiagnosticInfo)
+        return !d1->hasInnerDiagnosticInfo || d1->innerDiagnosticInfo == d2->innerDiagnosticInfo;
+    return DiagnosticInfo_equal(d1->innerDiagnosticInfo, d2->innerDiagnosticInfo, NULL);
+}
+
+typedef UA_Boolean (*UA_equalSignature)(const void *p1, const void *p2, const UA_DataType *type);
+static const UA_equalSignature equalJumpTable[UA_BUILTIN_TYPES_COUNT + 1] = {
+    (UA_equalSignature)equalFixedSize, // Boolean
+    (UA_equalSignature)equalFixedSize, // SByte
+    (UA_equalSignature)equalFixedSize, // Byte
+    (UA_equalSignature)equalFixedSize, // Int16
+    (UA_equalSignature)equalFixedSize, // UInt16
+    (UA_equalSignature)equalFixedSize, // Int32
+    (UA_equalSignature)equalFixedSize, // UInt32
+    (UA_equalSignature)equalFixedSize, // Int64
+    (UA_equalSignature)equalFixedSize, // UInt64
+    (UA_equalSignature)equalFixedSize, // Float
+    (UA_equalSignature)equalFixedSize, // Double
+    (UA_equalSignature)String_equal, // String
+    (UA_equalSignature)equalFixedSize, // DateTime
+    (UA_equalSignature)equalFixedSize, // Guid
+    (UA_equalSignature)String_equal, // ByteString
+    (UA_equalSignature)String_equal, // XmlElement
+    (UA_equalSignature)NodeId_equal,
+    (UA_equalSignature)ExpandedNodeId_equal,
+    (UA_equalSignature)equalFixedSize, // StatusCode
+    (UA_equalSignature)equalNoInit, // QualifiedName
+    (UA_equalSignature)LocalizedText_equal,
+    (UA_equalSignature)ExtensionObject_equal,
+    (UA_equalSignature)DataValue_equal,
+    (UA_equalSignature)Variant_equal,
+    (UA_equalSignature)DiagnosticInfo_equal,
+    (UA_equalSignature)equalNoInit // all others
+};
+
+static UA_Boolean equalNoInit(const void *p1, const void *p2, const UA_DataType *type) {
+    uintptr_t ptr1 = (uintptr_t)p1;
+    uintptr_t ptr2 = (uintptr_t)p2;
+    UA_Byte membersSize = type->membersSize;
+    for(size_t i = 0; i < membersSize; i++) {
+        const UA_DataTypeMember *member = &type->members[i];
+        const UA_DataType *typelists[2] = { UA_TYPES, &type[-type->typeIndex] };
+        const UA_DataType *memberType = &typelists[!member->namespaceZero][member->memberTypeIndex];
+        ptr1 += member->padding;
+        ptr2 += member->padding;
+        if(!member->isArray) {
+            size_t fi = memberType->builtin ? memberType->typeIndex : UA_BUILTIN_TYPES_COUNT;
+            if(!equalJumpTable[fi]((const void*)ptr1, (const void*)ptr2, memberType))
+                return false;
+            ptr1 += memberType->memSize;
+            ptr2 += memberType->memSize;
+        } else {
+            const size_t size = *((const size_t*)ptr1);
+            if(size != *((const size_t*)ptr2))
+                return false;
+            ptr1 += sizeof(size_t);
+            ptr2 += sizeof(size_t);
+            if(!arrayEqual(*(void* const*)ptr1, *(void* const*)ptr2, size, memberType))
+                return false;
+            ptr1 += sizeof(void*);
+            ptr2 += sizeof(void*);
+        }
+    }
+    return true;
+}
+
+UA_Boolean UA_equal(const void *p1, const void *p2, const UA_DataType *type) {
+    if(type->overlayable)
+        return memcmp(p1, p2, type->memSize) == 0; /* no padding in between */
+    size_t fi = type->builtin ? type->typeIndex : UA_BUILTIN_TYPES_COUNT;
+    return equalJumpTable[fi](p1, p2, type);
+}
+
 /******************/
 /* Array Handling */
 /******************/
@@ -19,6 +19,11 @@ static const UA_calcSizeBinarySignature calcSizeBinaryJumpTable[UA_BUILTIN_TYPES
 
 UA_THREAD_LOCAL const UA_DataType *type; // used to pass the datatype into the jumptable
 
+/* Additional datatypes (outside of ns0) that are known to the decoding. They are
+   set for every call to UA_decodeBinary and looked up when decoding ExtensionObjects. */
+UA_THREAD_LOCAL size_t customTypesArraySize;
+UA_THREAD_LOCAL const UA_DataType *customTypesArray;
+
 /*****************/
 /* Integer Types */
 /*****************/
@@ -228,6 +233,40 @@ DateTime_decodeBinary(bufpos pos, bufend end, UA_DateTime *dst) {
 # define Float_decodeBinary UInt32_decodeBinary
 # define Double_encodeBinary UInt64_encodeBinary
 # define Double_decodeBinary UInt64_decodeBinary
+#elif UA_BINARY_IEEE754_FLOAT
+
+/* The floats are IEEE 754 but in the host byte order. Take the bit pattern and
+   encode it like the integers. */
+static UA_StatusCode
+Float_encodeBinary(UA_Float const *src, bufpos pos, bufend end) {
+    UA_UInt32 encoded;
+    memcpy(&encoded, src, sizeof(UA_UInt32));
+    return UInt32_encodeBinary(&encoded, pos, end);
+}
+
+static UA_StatusCode
+Float_decodeBinary(bufpos pos, bufend end, UA_Float *dst) {
+    UA_UInt32 decoded;
+    UA_StatusCode retval = UInt32_decodeBinary(pos, end, &decoded);
+    memcpy(dst, &decoded, sizeof(UA_Float));
+    return retval;
+}
+
+static UA_StatusCode
+Double_encodeBinary(UA_Double const *src, bufpos pos, bufend end) {
+    UA_UInt64 encoded;
+    memcpy(&encoded, src, sizeof(UA_UInt64));
+    return UInt64_encodeBinary(&encoded, pos, end);
+}
+
+static UA_StatusCode
+Double_decodeBinary(bufpos pos, bufend end, UA_Double *dst) {
+    UA_UInt64 decoded;
+    UA_StatusCode retval = UInt64_decodeBinary(pos, end, &decoded);
+    memcpy(dst, &decoded, sizeof(UA_Double));
+    return retval;
+}
+
 #else
 
 #include <math.h>
@@ -335,6 +374,89 @@ Double_decodeBinary(bufpos pos, bufend end, UA_Double *dst) {
 /* Array Handling */
 /******************/
 
+/* Numeric arrays that are not overlayable (e.g. on big-endian hosts) are
+   converted in a tight loop without the jump table and with a single bounds
+   check. The shift-based conversion is independent of the host byte order and
+   compiles down to (vectorized) byteswaps. Floats use the integer conversion
+   only if they are in the IEEE 754 format. */
+static UA_Boolean
+isNumericArrayType(const UA_DataType *contenttype) {
+    if(!contenttype->builtin)
+        return false;
+    switch(contenttype->typeIndex) {
+    case UA_TYPES_INT16:
+    case UA_TYPES_UINT16:
+    case UA_TYPES_INT32:
+    case UA_TYPES_UINT32:
+    case UA_TYPES_INT64:
+    case UA_TYPES_UINT64:
+    case UA_TYPES_DATETIME:
+    case UA_TYPES_STATUSCODE:
+        return true;
+    case UA_TYPES_FLOAT:
+    case UA_TYPES_DOUBLE:
+        return UA_BINARY_IEEE754_FLOAT;
+    default:
+        return false;
+    }
+}
+
+static void
+encodeNumericArray(const UA_Byte *UA_RESTRICT src, size_t length, UA_UInt16 memSize,
+                   UA_Byte *UA_RESTRICT dst) {
+    switch(memSize) {
+    case 2:
+        for(size_t i = 0; i < length; i++) {
+            UA_UInt16 v;
+            memcpy(&v, &src[i * 2], 2);
+            UA_encode16(v, &dst[i * 2]);
+        }
+        break;
+    case 4:
+        for(size_t i = 0; i < length; i++) {
+            UA_UInt32 v;
+            memcpy(&v, &src[i * 4], 4);
+            UA_encode32(v, &dst[i * 4]);
+        }
+        break;
+    default:
+        for(size_t i = 0; i < length; i++) {
+            UA_UInt64 v;
+            memcpy(&v, &src[i * 8], 8);
+            UA_encode64(v, &dst[i * 8]);
+        }
+        break;
+    }
+}
+
+static void
+decodeNumericArray(const UA_Byte *UA_RESTRICT src, size_t length, UA_UInt16 memSize,
+                   UA_Byte *UA_RESTRICT dst) {
+    switch(memSize) {
+    case 2:
+        for(size_t i = 0; i < length; i++) {
+            UA_UInt16 v;
+            UA_decode16(&src[i * 2], &v);
+            memcpy(&dst[i * 2], &v, 2);
+        }
+        break;
+    case 4:
+        for(size_t i = 0; i < length; i++) {
+            UA_UInt32 v;
+            UA_decode32(&src[i * 4], &v);
+            memcpy(&dst[i * 4], &v, 4);
+        }
+        break;
+    default:
+        for(size_t i = 0; i < length; i++) {
+            UA_UInt64 v;
+            UA_decode64(&src[i * 8], &v);
+            memcpy(&dst[i * 8], &v, 8);
+        }
+        break;
+    }
+}
+
 static UA_StatusCode
 Array_encodeBinary(const void *src, size_t length, const UA_DataType *contenttype, bufpos pos, bufend end) {
     UA_Int32 signed_length = -1;
@@ -356,6 +478,14 @@ Array_encodeBinary(const void *src, size_t length, const UA_DataType *contenttyp
         return retval;
     }
 
+    if(isNumericArrayType(contenttype)) {
+        if(end < *pos + (contenttype->memSize * length))
+            return UA_STATUSCODE_BADENCODINGERROR;
+        encodeNumericArray(src, length, contenttype->memSize, *pos);
+        (*pos) += contenttype->memSize * length;
+        return retval;
+    }
+
     uintptr_t ptr = (uintptr_t)src;
     size_t encode_index = contenttype->builtin ? contenttype->typeIndex : UA_BUILTIN_TYPES_COUNT;
     for(size_t i = 0; i < length && retval == UA_STATUSCODE_GOOD; i++) {
@@ -388,14 +518,29 @@ Array_decodeBinary(bufpos pos, bufend end, UA_Int32 signed_length, void *UA_REST
         return UA_STATUSCODE_BADOUTOFMEMORY;
 
     if(contenttype->overlayable) {
-        if(end < *pos + (contenttype->memSize * length))
+        if(end < *pos + (contenttype->memSize * length)) {
+            UA_free(*dst);
+            *dst = NULL;
             return UA_STATUSCODE_BADDECODINGERROR;
+        }
         memcpy(*dst, *pos, contenttype->memSize * length);
         (*pos) += contenttype->memSize * length;
         *out_length = length;
         return UA_STATUSCODE_GOOD;
     }
 
+    if(isNumericArrayType(contenttype)) {
+        if(end < *pos + (contenttype->memSize * length)) {
+            UA_free(*dst);
+            *dst = NULL;
+            return UA_STATUSCODE_BADDECODINGERROR;
+        }
+        decodeNumericArray(*pos, length, contenttype->memSize, *dst);
+        (*pos) += contenttype->memSize * length;
+        *out_length = length;
+        return UA_STATUSCODE_GOOD;
+    }
+
     uintptr_t ptr = (uintptr_t)*dst;
     size_t decode_index = contenttype->builtin ? contenttype->typeIndex : UA_BUILTIN_TYPES_COUNT;
     for(size_t i = 0; i < length; i++) {
@@ -673,6 +818,13 @@ LocalizedText_decodeBinary(bufpos pos, bufend end, UA_LocalizedText *dst) {
 }
 
 /* ExtensionObject */
+static UA_UInt32
+binaryEncodingId(const UA_DataType *t) {
+    if(t->binaryEncodingId != 0)
+        return t->binaryEncodingId;
+    return t->typeId.identifier.numeric + UA_ENCODINGOFFSET_BINARY;
+}
+
 static UA_StatusCode
 ExtensionObject_encodeBinary(UA_ExtensionObject const *src, bufpos pos, bufend end) {
     UA_StatusCode retval;
@@ -683,7 +835,7 @@ ExtensionObject_encodeBinary(UA_ExtensionObject const *src, bufpos pos, bufend e
         UA_NodeId typeId = src->content.decoded.type->typeId;
         if(typeId.identifierType != UA_NODEIDTYPE_NUMERIC)
             return UA_STATUSCODE_BADENCODINGERROR;
-        typeId.identifier.numeric += UA_ENCODINGOFFSET_BINARY;
+        typeId.identifier.numeric = binaryEncodingId(src->content.decoded.type);
         encoding = UA_EXTENSIONOBJECT_ENCODED_BYTESTRING;
         retval = NodeId_encodeBinary(&typeId, pos, end);
         retval |= Byte_encodeBinary(&encoding, pos, end);
@@ -711,14 +863,58 @@ ExtensionObject_encodeBinary(UA_ExtensionObject const *src, bufpos pos, bufend e
     return retval;
 }
 
-static UA_StatusCode findDataType(const UA_NodeId *typeId, const UA_DataType **findtype) {
-    for(size_t i = 0; i < UA_TYPES_COUNT; i++) {
-        if(UA_NodeId_equal(typeId, &UA_TYPES[i].typeId)) {
-            *findtype = &UA_TYPES[i];
-            return UA_STATUSCODE_GOOD;
+/* Returns the datatype with the given binary encoding id or NULL. The ns0 types
+   are found with a binary search over the generated index sorted by encoding
+   id. Custom types are looked up in the array passed to UA_decodeBinary. */
+static const UA_DataType *
+findDataTypeByBinaryEncoding(const UA_NodeId *encodingId) {
+    if(encodingId->identifierType != UA_NODEIDTYPE_NUMERIC ||
+       encodingId->identifier.numeric == 0)
+        return NULL;
+    UA_UInt32 numeric = encodingId->identifier.numeric;
+    if(encodingId->namespaceIndex == 0) {
+        size_t lower = 0;
+        size_t upper = UA_TYPES_COUNT;
+        while(lower < upper) {
+            size_t middle = lower + ((upper - lower) / 2);
+            const UA_DataType *t = &UA_TYPES[UA_TYPES_SORTED[middle]];
+            if(t->binaryEncodingId < numeric)
+                lower = middle + 1;
+            else if(t->binaryEncodingId > numeric)
+                upper = middle;
+            else
+                return t;
         }
     }
-    return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    for(size_t i = 0; i < customTypesArraySize; i++) {
+        const UA_DataType *t = &customTypesArray[i];
+        if(t->typeId.namespaceIndex == encodingId->namespaceIndex &&
+           t->typeId.identifierType == UA_NODEIDTYPE_NUMERIC &&
+           binaryEncodingId(t) == numeric)
+            return t;
+    }
+    return NULL;
+}
+
+/* Decodes the length-prefixed body of an ExtensionObject with a known type. The
+   decoder must consume exactly the encoded length. */
+static UA_StatusCode
+decodeExtensionObjectBody(bufpos pos, bufend end, void *dst, const UA_DataType *bodyType) {
+    UA_Int32 length = 0;
+    UA_StatusCode retval = Int32_decodeBinary(pos, end, &length);
+    if(retval != UA_STATUSCODE_GOOD)
+        return retval;
+    if(length < 0 || (uintptr_t)(end - *pos) < (uintptr_t)length)
+        return UA_STATUSCODE_BADDECODINGERROR;
+    UA_Byte *bodyEnd = *pos + length;
+    size_t decode_index = bodyType->builtin ? bodyType->typeIndex : UA_BUILTIN_TYPES_COUNT;
+    type = bodyType;
+    retval = decodeBinaryJumpTable[decode_index](pos, bodyEnd, dst);
+    if(retval == UA_STATUSCODE_GOOD && *pos != bodyEnd) {
+        UA_deleteMembers(dst, bodyType);
+        retval = UA_STATUSCODE_BADDECODINGERROR;
+    }
+    return retval;
 }
 
 static UA_StatusCode
@@ -728,8 +924,6 @@ ExtensionObject_decodeBinary(bufpos pos, bufend end, UA_ExtensionObject *dst) {
     UA_NodeId_init(&typeId);
     UA_StatusCode retval = NodeId_decodeBinary(pos, end, &typeId);
     retval |= Byte_decodeBinary(pos, end, &encoding);
-    if(typeId.namespaceIndex != 0 || typeId.identifierType != UA_NODEIDTYPE_NUMERIC)
-        retval = UA_STATUSCODE_BADDECODINGERROR;
     if(retval != UA_STATUSCODE_GOOD) {
         UA_NodeId_deleteMembers(&typeId);
         return retval;
@@ -746,22 +940,15 @@ ExtensionObject_decodeBinary(bufpos pos, bufend end, UA_ExtensionObject *dst) {
     } else {
         /* try to decode the content */
         type = NULL;
-        UA_assert(typeId.identifier.byteString.data == NULL); //helping clang analyzer, typeId is numeric
-        UA_assert(typeId.identifier.string.data == NULL); //helping clang analyzer, typeId is numeric
-        typeId.identifier.numeric -= UA_ENCODINGOFFSET_BINARY;
-        findDataType(&typeId, &type);
+        if(encoding == UA_EXTENSIONOBJECT_ENCODED_BYTESTRING)
+            type = findDataTypeByBinaryEncoding(&typeId);
         if(type) {
-            /* UA_Int32 length = 0; */
-            /* retval |= Int32_decodeBinary(pos, end, &length); */
-            /* if(retval != UA_STATUSCODE_GOOD) */
-            /*     return retval; */
-            (*pos) += 4; // jump over the length
+            UA_NodeId_deleteMembers(&typeId);
             dst->content.decoded.data = UA_new(type);
-            size_t decode_index = type->builtin ? type->typeIndex : UA_BUILTIN_TYPES_COUNT;
             if(dst->content.decoded.data) {
                 dst->content.decoded.type = type;
                 dst->encoding = UA_EXTENSIONOBJECT_DECODED;
-                retval = decodeBinaryJumpTable[decode_index](pos, end, dst->content.decoded.data);
+                retval = decodeExtensionObjectBody(pos, end, dst->content.decoded.data, type);
             } else
                 retval = UA_STATUSCODE_BADOUTOFMEMORY;
         } else {
@@ -812,7 +999,7 @@ Variant_encodeBinary(UA_Variant const *src, bufpos pos, bufend end) {
         typeId = src->type->typeId;
         if(typeId.identifierType != UA_NODEIDTYPE_NUMERIC)
             return UA_STATUSCODE_BADINTERNALERROR;
-        typeId.identifier.numeric += UA_ENCODINGOFFSET_BINARY;
+        typeId.identifier.numeric = binaryEncodingId(src->type);
     }
     UA_StatusCode retval = Byte_encodeBinary(&encodingByte, pos, end);
 
@@ -858,8 +1045,9 @@ Variant_encodeBinary(UA_Variant const *src, bufpos pos, bufend end) {
     return retval;
 }
 
-/* The resulting variant always has the storagetype UA_VARIANT_DATA. Currently,
- we only support ns0 types (todo: attach typedescriptions to datatypenodes) */
+/* The resulting variant always has the storagetype UA_VARIANT_DATA. Structures
+ wrapped in an extensionobject are unpacked if the type is found in ns0 or among
+ the custom types passed to UA_decodeBinary. */
 static UA_StatusCode
 Variant_decodeBinary(bufpos pos, bufend end, UA_Variant *dst) {
     UA_Byte encodingByte;
@@ -901,18 +1089,25 @@ Variant_decodeBinary(bufpos pos, bufend end, UA_Variant *dst) {
         }
 
         /* search for the datatype. use extensionobject if nothing is found */
-        dst->type = &UA_TYPES[UA_TYPES_EXTENSIONOBJECT];
-        if(typeId.namespaceIndex == 0 && eo_encoding == UA_EXTENSIONOBJECT_ENCODED_BYTESTRING &&
-           findDataType(&typeId, &dst->type) == UA_STATUSCODE_GOOD)
+        dst->type = NULL;
+        if(eo_encoding == UA_EXTENSIONOBJECT_ENCODED_BYTESTRING)
+            dst->type = findDataTypeByBinaryEncoding(&typeId);
+        UA_Boolean unwrap = (dst->type != NULL);
+        if(!unwrap) {
+            dst->type = &UA_TYPES[UA_TYPES_EXTENSIONOBJECT];
             *pos = old_pos;
+        }
         UA_NodeId_deleteMembers(&typeId);
 
         /* decode the type */
         dst->data = UA_calloc(1, dst->type->memSize);
         if(dst->data) {
-            size_t decode_index = dst->type->builtin ? dst->type->typeIndex : UA_BUILTIN_TYPES_COUNT;
-            type = dst->type;
-            retval = decodeBinaryJumpTable[decode_index](pos, end, dst->data);
+            if(unwrap) {
+                retval = decodeExtensionObjectBody(pos, end, dst->data, dst->type);
+            } else {
+                type = dst->type;
+                retval = decodeBinaryJumpTable[UA_TYPES_EXTENSIONOBJECT](pos, end, dst->data);
+            }
             if(retval != UA_STATUSCODE_GOOD) {
                 UA_free(dst->data);
                 dst->data = NULL;
@@ -1080,6 +1275,17 @@ UA_encodeBinaryInternal(const void *src, bufpos pos, bufend end) {
     const UA_DataType *typelists[2] = { UA_TYPES, &localtype[-localtype->typeIndex] };
     for(size_t i = 0; i < membersSize; i++) {
         const UA_DataTypeMember *member = &localtype->members[i];
+        if(member->overlayableRun > 0) {
+            /* Members with identical layout in memory and on the stream */
+            ptr += member->padding;
+            if(*pos + member->overlayableBytes > end)
+                return UA_STATUSCODE_BADENCODINGERROR;
+            memcpy(*pos, (const void*)ptr, member->overlayableBytes);
+            *pos += member->overlayableBytes;
+            ptr += member->overlayableBytes;
+            i += (size_t)(member->overlayableRun - 1);
+            continue;
+        }
         type = &typelists[!member->namespaceZero][member->memberTypeIndex];
         if(!member->isArray) {
             ptr += member->padding;
@@ -1136,6 +1342,40 @@ UA_StatusCode UA_encodeBinary(const void *src, const UA_DataType *localtype, UA_
     return retval;
 }
 
+UA_StatusCode
+UA_encodeBinaryGrow(const void *src, const UA_DataType *localtype, UA_ByteString *dst,
+                    size_t *capacity, size_t *offset) {
+    size_t oldOffset = *offset;
+    UA_StatusCode retval;
+    if(*capacity > oldOffset) {
+        dst->length = *capacity;
+        retval = UA_encodeBinary(src, localtype, dst, offset);
+        if(retval == UA_STATUSCODE_GOOD) {
+            dst->length = *offset;
+            return retval;
+        }
+        *offset = oldOffset;
+    }
+
+    /* The buffer was too small (or the encoding failed for another reason) */
+    size_t length = oldOffset + UA_calcSizeBinary((void*)(uintptr_t)src, localtype);
+    if(length <= *capacity) {
+        dst->length = oldOffset;
+        return UA_STATUSCODE_BADENCODINGERROR;
+    }
+    UA_Byte *data = UA_realloc(dst->data, length);
+    if(!data) {
+        dst->length = oldOffset;
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    dst->data = data;
+    dst->length = length;
+    *capacity = length;
+    retval = UA_encodeBinary(src, localtype, dst, offset);
+    dst->length = *offset;
+    return retval;
+}
+
 static UA_StatusCode
 UA_decodeBinaryInternal(bufpos pos, bufend end, void *dst) {
     uintptr_t ptr = (uintptr_t)dst;
@@ -1145,6 +1385,19 @@ UA_decodeBinaryInternal(bufpos pos, bufend end, void *dst) {
     const UA_DataType *typelists[2] = { UA_TYPES, &localtype[-localtype->typeIndex] };
     for(size_t i = 0; i < membersSize; i++) {
         const UA_DataTypeMember *member = &localtype->members[i];
+        if(member->overlayableRun > 0) {
+            /* Members with identical layout in memory and on the stream */
+            ptr += member->padding;
+            if(*pos + member->overlayableBytes > end) {
+                retval = UA_STATUSCODE_BADDECODINGERROR;
+                break;
+            }
+            memcpy((void*)ptr, *pos, member->overlayableBytes);
+            *pos += member->overlayableBytes;
+            ptr += member->overlayableBytes;
+            i += (size_t)(member->overlayableRun - 1);
+            continue;
+        }
         type = &typelists[!member->namespaceZero][member->memberTypeIndex];
         if(!member->isArray) {
             ptr += member->padding;
@@ -1197,11 +1450,14 @@ static const UA_decodeBinarySignature decodeBinaryJumpTable[UA_BUILTIN_TYPES_COU
 };
 
 UA_StatusCode
-UA_decodeBinary(const UA_ByteString *src, size_t *offset, void *dst, const UA_DataType *localtype) {
+UA_decodeBinary(const UA_ByteString *src, size_t *offset, void *dst, const UA_DataType *localtype,
+                size_t customTypesSize, const UA_DataType *customTypes) {
     memset(dst, 0, localtype->memSize); // init
     UA_Byte *pos = &src->data[*offset];
     UA_Byte *end = &src->data[src->length];
     type = localtype;
+    customTypesArraySize = customTypesSize;
+    customTypesArray = customTypes;
     UA_StatusCode retval = UA_decodeBinaryInternal(&pos, end, dst);
     *offset = (size_t)(pos - src->data) / sizeof(UA_Byte);
     return retval;
@@ -1296,8 +1552,9 @@ ExtensionObject_calcSizeBinary(const UA_ExtensionObject *src, UA_DataType *_) {
             return 0;
         s += NodeId_calcSizeBinary(&src->content.decoded.type->typeId, NULL);
         s += 4; // length
-        size_t encode_index = type->builtin ? type->typeIndex : UA_BUILTIN_TYPES_COUNT;
-        s += calcSizeBinaryJumpTable[encode_index](src->content.decoded.data, src->content.decoded.type);
+        const UA_DataType *contenttype = src->content.decoded.type;
+        size_t encode_index = contenttype->builtin ? contenttype->typeIndex : UA_BUILTIN_TYPES_COUNT;
+        s += calcSizeBinaryJumpTable[encode_index](src->content.decoded.data, contenttype);
     } else {
         s += NodeId_calcSizeBinary(&src->content.encoded.typeId, NULL);
         switch (src->encoding) {
@@ -1432,6 +1689,12 @@ size_t UA_calcSizeBinary(void *p, const UA_DataType *contenttype) {
     const UA_DataType *typelists[2] = { UA_TYPES, &contenttype[-contenttype->typeIndex] };
     for(size_t i = 0; i < membersSize; i++) {
         const UA_DataTypeMember *member = &contenttype->members[i];
+        if(member->overlayableRun > 0) {
+            ptr += member->padding + member->overlayableBytes;
+            s += member->overlayableBytes;
+            i += (size_t)(member->overlayableRun - 1);
+            continue;
+        }
         const UA_DataType *membertype = &typelists[!member->namespaceZero][member->memberTypeIndex];
         if(!member->isArray) {
             ptr += member->padding;
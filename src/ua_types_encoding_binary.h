@@ -6,8 +6,20 @@
 UA_StatusCode UA_encodeBinary(const void *src, const UA_DataType *type, UA_ByteString *dst,
                               size_t *offset) UA_FUNC_ATTR_WARN_UNUSED_RESULT;
 
+/* Encodes in a single pass into a growable buffer, starting at *offset. The
+   buffer is either empty or heap-allocated with *capacity bytes. Only if the
+   buffer overflows, it is enlarged to the required size and the encoding is
+   repeated. So the buffer can be reused to encode without any sizing pass in
+   the steady state. Afterwards, dst->length is the encoded length (*offset)
+   and the allocated size remains in *capacity. */
+UA_StatusCode UA_encodeBinaryGrow(const void *src, const UA_DataType *type, UA_ByteString *dst,
+                                  size_t *capacity, size_t *offset) UA_FUNC_ATTR_WARN_UNUSED_RESULT;
+
+/* The custom types are used to look up the content of ExtensionObjects that are
+   not defined in ns0. They can be NULL (with size 0). */
 UA_StatusCode UA_decodeBinary(const UA_ByteString *src, size_t *offset, void *dst,
-                              const UA_DataType *type) UA_FUNC_ATTR_WARN_UNUSED_RESULT;
+                              const UA_DataType *type, size_t customTypesSize,
+                              const UA_DataType *customTypes) UA_FUNC_ATTR_WARN_UNUSED_RESULT;
 
 size_t UA_calcSizeBinary(void *p, const UA_DataType *type);
 
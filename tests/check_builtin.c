@@ -866,6 +866,141 @@ START_TEST(UA_Double_encodeShallWorkOnExample)
    }
 END_TEST
 
+typedef struct {
+    size_t valuesSize;
+    void *values;
+} NumericArrayStruct;
+
+/* Encode numeric arrays with a copy of the type description that is not
+   overlayable. This takes the same path as on big-endian hosts. */
+START_TEST(UA_NumericArray_encodeNotOverlayableShallMatchOverlayable) {
+    /* Non-overlayable copies of the builtin types and a structure with an array
+       member of one of them. Decoding the structure goes through the
+       non-overlayable array decoding. */
+    UA_DataType slowTypes[UA_TYPES_DOUBLE + 2];
+    memcpy(slowTypes, UA_TYPES, sizeof(UA_DataType) * (UA_TYPES_DOUBLE + 1));
+    for(size_t i = 0; i <= UA_TYPES_DOUBLE; i++)
+        slowTypes[i].overlayable = false;
+    UA_DataTypeMember arrayMember = {.namespaceZero = false, .padding = 0, .isArray = true};
+    UA_DataType *arrayStruct = &slowTypes[UA_TYPES_DOUBLE + 1];
+    memset(arrayStruct, 0, sizeof(UA_DataType));
+    arrayStruct->typeIndex = UA_TYPES_DOUBLE + 1;
+    arrayStruct->memSize = sizeof(NumericArrayStruct);
+    arrayStruct->membersSize = 1;
+    arrayStruct->members = &arrayMember;
+
+    UA_Int16 i16[5] = {1, -2, 300, -400, UA_INT16_MAX};
+    UA_UInt64 u64[3] = {1, 0x0102030405060708ULL, 0xFFFFFFFFFFFFFFFFULL};
+    UA_Float f[4] = {-6.5f, 0.0f, 1e-20f, 3.4e38f};
+    UA_Double d[4] = {-6.5, 1.0, -2.0, 2147483648.0};
+    void *arrays[4] = {i16, u64, f, d};
+    size_t lengths[4] = {5, 3, 4, 4};
+    UA_UInt16 typeIndices[4] = {UA_TYPES_INT16, UA_TYPES_UINT64, UA_TYPES_FLOAT, UA_TYPES_DOUBLE};
+
+    for(size_t i = 0; i < 4; i++) {
+        UA_DataType slowType = UA_TYPES[typeIndices[i]];
+        slowType.overlayable = false;
+        UA_Variant fast, slow;
+        UA_Variant_setArray(&fast, arrays[i], lengths[i], &UA_TYPES[typeIndices[i]]);
+        UA_Variant_setArray(&slow, arrays[i], lengths[i], &slowType);
+
+        UA_Byte fastData[64], slowData[64];
+        UA_ByteString fastBuf = {64, fastData};
+        UA_ByteString slowBuf = {64, slowData};
+        size_t fastPos = 0, slowPos = 0;
+        UA_StatusCode retval = UA_Variant_encodeBinary(&fast, &fastBuf, &fastPos);
+        retval |= UA_Variant_encodeBinary(&slow, &slowBuf, &slowPos);
+        ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+        ck_assert_uint_eq(fastPos, slowPos);
+        ck_assert_int_eq(memcmp(fastData, slowData, fastPos), 0);
+
+        /* too small buffer */
+        UA_ByteString smallBuf = {slowPos - 1, slowData};
+        slowPos = 0;
+        retval = UA_Variant_encodeBinary(&slow, &smallBuf, &slowPos);
+        ck_assert_int_eq(retval, UA_STATUSCODE_BADENCODINGERROR);
+
+        /* decode back */
+        UA_Variant decoded;
+        size_t decodePos = 0;
+        fastBuf.length = fastPos;
+        retval = UA_Variant_decodeBinary(&fastBuf, &decodePos, &decoded);
+        ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+        ck_assert_uint_eq(decoded.arrayLength, lengths[i]);
+        ck_assert_int_eq(memcmp(decoded.data, arrays[i], lengths[i] * UA_TYPES[typeIndices[i]].memSize), 0);
+
+        /* decode back with the non-overlayable type. skip the variant
+           encoding byte to get to the array. */
+        arrayMember.memberTypeIndex = typeIndices[i];
+        NumericArrayStruct slowDecoded;
+        decodePos = 1;
+        retval = UA_decodeBinary(&fastBuf, &decodePos, &slowDecoded, arrayStruct, 0, NULL);
+        ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+        ck_assert_uint_eq(decodePos, fastPos);
+        ck_assert_uint_eq(slowDecoded.valuesSize, lengths[i]);
+        ck_assert_int_eq(memcmp(slowDecoded.values, decoded.data,
+                                lengths[i] * UA_TYPES[typeIndices[i]].memSize), 0);
+        UA_deleteMembers(&slowDecoded, arrayStruct);
+        UA_Variant_deleteMembers(&decoded);
+    }
+}
+END_TEST
+
+START_TEST(UA_encodeBinaryGrowShallGrowAndReuseBuffer) {
+    // given
+    UA_String longString = UA_STRING("a string that is longer than the initial buffer");
+    UA_String shortString = UA_STRING("short");
+    UA_ByteString buf;
+    UA_ByteString_allocBuffer(&buf, 8);
+    size_t capacity = 8;
+
+    // when
+    size_t offset = 2;
+    UA_StatusCode retval = UA_encodeBinaryGrow(&longString, &UA_TYPES[UA_TYPES_STRING], &buf,
+                                               &capacity, &offset);
+
+    // then
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(offset, 2 + 4 + longString.length);
+    ck_assert_uint_eq(buf.length, offset);
+    ck_assert_uint_eq(capacity, offset);
+    ck_assert_int_eq(memcmp(&buf.data[6], longString.data, longString.length), 0);
+
+    // when the buffer is large enough, it is not reallocated and keeps its capacity
+    UA_Byte *data = buf.data;
+    size_t oldCapacity = capacity;
+    for(size_t i = 0; i < 2; i++) {
+        offset = 0;
+        retval = UA_encodeBinaryGrow(&shortString, &UA_TYPES[UA_TYPES_STRING], &buf,
+                                     &capacity, &offset);
+        ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+        ck_assert_uint_eq(offset, 4 + shortString.length);
+        ck_assert_uint_eq(buf.length, offset);
+        ck_assert_uint_eq(capacity, oldCapacity);
+        ck_assert_ptr_eq(buf.data, data);
+        ck_assert_int_eq(memcmp(&buf.data[4], shortString.data, shortString.length), 0);
+    }
+
+    // the long string still fits without reallocation
+    offset = 0;
+    retval = UA_encodeBinaryGrow(&longString, &UA_TYPES[UA_TYPES_STRING], &buf,
+                                 &capacity, &offset);
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_ptr_eq(buf.data, data);
+    UA_ByteString_deleteMembers(&buf);
+
+    // an empty buffer is allocated
+    UA_ByteString_init(&buf);
+    capacity = 0;
+    offset = 0;
+    retval = UA_encodeBinaryGrow(&shortString, &UA_TYPES[UA_TYPES_STRING], &buf,
+                                 &capacity, &offset);
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(offset, 4 + shortString.length);
+    UA_ByteString_deleteMembers(&buf);
+}
+END_TEST
+
 START_TEST(UA_String_encodeShallWorkOnExample) {
     // given
     UA_String src;
@@ -953,6 +1088,56 @@ START_TEST(UA_DataValue_encodeShallWorkOnExampleWithoutVariant) {
 }
 END_TEST
 
+START_TEST(UA_ResponseHeader_encodeDecodeShallWorkOnExample) {
+    // given
+    UA_ResponseHeader src;
+    UA_ResponseHeader_init(&src);
+    src.timestamp = 0x0102030405060708;
+    src.requestHandle = 0x090A0B0C;
+    src.serviceResult = UA_STATUSCODE_BADINTERNALERROR;
+
+    UA_Byte data[32];
+    UA_ByteString dst = { sizeof(data), data };
+    size_t pos = 0;
+
+    // when
+    UA_StatusCode retval = UA_ResponseHeader_encodeBinary(&src, &dst, &pos);
+
+    // then the leading integers are encoded in one run (little endian)
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(pos, 8+4+4+1+4+3);
+    ck_assert_uint_eq(pos, UA_calcSizeBinary(&src, &UA_TYPES[UA_TYPES_RESPONSEHEADER]));
+    ck_assert_int_eq(dst.data[0], 0x08);
+    ck_assert_int_eq(dst.data[7], 0x01);
+    ck_assert_int_eq(dst.data[8], 0x0C);
+    ck_assert_int_eq(dst.data[11], 0x09);
+    ck_assert_int_eq(dst.data[15], 0x80);
+    ck_assert_int_eq(dst.data[16], 0x00); // empty diagnosticinfo
+
+    // when decoding
+    UA_ResponseHeader decoded;
+    size_t offset = 0;
+    dst.length = pos;
+    retval = UA_ResponseHeader_decodeBinary(&dst, &offset, &decoded);
+
+    // then
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(offset, pos);
+    ck_assert(decoded.timestamp == src.timestamp);
+    ck_assert_uint_eq(decoded.requestHandle, src.requestHandle);
+    ck_assert_uint_eq(decoded.serviceResult, src.serviceResult);
+    UA_ResponseHeader_deleteMembers(&decoded);
+
+    // when the run is truncated
+    offset = 0;
+    dst.length = 10;
+    retval = UA_ResponseHeader_decodeBinary(&dst, &offset, &decoded);
+
+    // then
+    ck_assert_int_eq(retval, UA_STATUSCODE_BADDECODINGERROR);
+}
+END_TEST
+
 START_TEST(UA_DataValue_encodeShallWorkOnExampleWithVariant) {
     // given
     UA_DataValue src;
@@ -1473,6 +1658,336 @@ START_TEST(UA_ExtensionObject_encodeDecodeShallWorkOnExtensionObject) {
 }
 END_TEST
 
+START_TEST(UA_ExtensionObject_calcSizeShallMatchEncodedLength) {
+    // given a decoded structure with array members inside an extensionobject
+    UA_DataChangeNotification dcn;
+    UA_DataChangeNotification_init(&dcn);
+    UA_MonitoredItemNotification items[2];
+    UA_MonitoredItemNotification_init(&items[0]);
+    UA_MonitoredItemNotification_init(&items[1]);
+    items[0].clientHandle = 1;
+    items[1].clientHandle = 2;
+    dcn.monitoredItems = items;
+    dcn.monitoredItemsSize = 2;
+    UA_ExtensionObject eo;
+    UA_ExtensionObject_init(&eo);
+    eo.encoding = UA_EXTENSIONOBJECT_DECODED;
+    eo.content.decoded.type = &UA_TYPES[UA_TYPES_DATACHANGENOTIFICATION];
+    eo.content.decoded.data = &dcn;
+
+    // when a builtin type was encoded before
+    UA_Byte data[256];
+    UA_ByteString dst = { .data = data, .length = sizeof(data) };
+    size_t pos = 0;
+    UA_Int32 i = 42;
+    UA_StatusCode retval = UA_encodeBinary(&i, &UA_TYPES[UA_TYPES_INT32], &dst, &pos);
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    size_t size = UA_calcSizeBinary(&eo, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT]);
+    pos = 0;
+    retval = UA_encodeBinary(&eo, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT], &dst, &pos);
+
+    // then
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(size, pos);
+}
+END_TEST
+
+/* A custom structure in namespace 2 for the decoding of extensionobjects */
+typedef struct {
+    UA_Int32 x;
+    UA_Int32 y;
+} CustomPoint;
+
+static UA_DataTypeMember CustomPoint_members[2] = {
+    { .memberTypeIndex = UA_TYPES_INT32,
+#ifdef UA_ENABLE_TYPENAMES
+      .memberName = "x",
+#endif
+      .namespaceZero = true, .padding = 0, .isArray = false },
+    { .memberTypeIndex = UA_TYPES_INT32,
+#ifdef UA_ENABLE_TYPENAMES
+      .memberName = "y",
+#endif
+      .namespaceZero = true,
+      .padding = offsetof(CustomPoint, y) - offsetof(CustomPoint, x) - sizeof(UA_Int32),
+      .isArray = false } };
+
+/* The second type has a binary encoding id that does not follow the typeId */
+static const UA_DataType CustomTypes[2] = {
+    { .typeId = {.namespaceIndex = 2, .identifierType = UA_NODEIDTYPE_NUMERIC, .identifier.numeric = 1},
+      .typeIndex = 0,
+#ifdef UA_ENABLE_TYPENAMES
+      .typeName = "CustomPoint",
+#endif
+      .memSize = sizeof(CustomPoint), .builtin = false, .fixedSize = true, .overlayable = false,
+      .membersSize = 2, .members = CustomPoint_members },
+    { .typeId = {.namespaceIndex = 2, .identifierType = UA_NODEIDTYPE_NUMERIC, .identifier.numeric = 2},
+      .binaryEncodingId = 5001,
+      .typeIndex = 1,
+#ifdef UA_ENABLE_TYPENAMES
+      .typeName = "CustomPointExplicit",
+#endif
+      .memSize = sizeof(CustomPoint), .builtin = false, .fixedSize = true, .overlayable = false,
+      .membersSize = 2, .members = CustomPoint_members } };
+
+START_TEST(UA_ExtensionObject_decodeCustomTypeShallDecodeContent) {
+    // given
+    CustomPoint p = {.x = 3, .y = -4};
+    UA_ExtensionObject eo;
+    UA_ExtensionObject_init(&eo);
+    eo.encoding = UA_EXTENSIONOBJECT_DECODED_NODELETE;
+    eo.content.decoded.type = &CustomTypes[0];
+    eo.content.decoded.data = &p;
+    UA_Byte data[64];
+    UA_ByteString buf = {.length = 64, .data = data};
+    size_t pos = 0;
+    UA_StatusCode retval = UA_ExtensionObject_encodeBinary(&eo, &buf, &pos);
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    buf.length = pos;
+
+    // when
+    UA_ExtensionObject dst;
+    size_t dstPos = 0;
+    retval = UA_decodeBinary(&buf, &dstPos, &dst, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT], 2, CustomTypes);
+
+    // then
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(dstPos, pos);
+    ck_assert_int_eq(dst.encoding, UA_EXTENSIONOBJECT_DECODED);
+    ck_assert_ptr_eq(dst.content.decoded.type, &CustomTypes[0]);
+    ck_assert_int_eq(((CustomPoint*)dst.content.decoded.data)->x, 3);
+    ck_assert_int_eq(((CustomPoint*)dst.content.decoded.data)->y, -4);
+    UA_ExtensionObject_deleteMembers(&dst);
+}
+END_TEST
+
+START_TEST(UA_ExtensionObject_decodeUnknownCustomTypeShallKeepByteString) {
+    // given
+    CustomPoint p = {.x = 3, .y = -4};
+    UA_ExtensionObject eo;
+    UA_ExtensionObject_init(&eo);
+    eo.encoding = UA_EXTENSIONOBJECT_DECODED_NODELETE;
+    eo.content.decoded.type = &CustomTypes[0];
+    eo.content.decoded.data = &p;
+    UA_Byte data[64];
+    UA_ByteString buf = {.length = 64, .data = data};
+    size_t pos = 0;
+    UA_StatusCode retval = UA_ExtensionObject_encodeBinary(&eo, &buf, &pos);
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    buf.length = pos;
+
+    // when
+    UA_ExtensionObject dst;
+    size_t dstPos = 0;
+    retval = UA_ExtensionObject_decodeBinary(&buf, &dstPos, &dst);
+
+    // then
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(dstPos, pos);
+    ck_assert_int_eq(dst.encoding, UA_EXTENSIONOBJECT_ENCODED_BYTESTRING);
+    ck_assert_int_eq(dst.content.encoded.typeId.namespaceIndex, 2);
+    ck_assert_int_eq(dst.content.encoded.typeId.identifier.numeric, 1 + UA_ENCODINGOFFSET_BINARY);
+    ck_assert_uint_eq(dst.content.encoded.body.length, 8);
+
+    /* the encoded extensionobject is reencoded unchanged */
+    UA_Byte data2[64];
+    UA_ByteString buf2 = {.length = 64, .data = data2};
+    size_t pos2 = 0;
+    retval = UA_ExtensionObject_encodeBinary(&dst, &buf2, &pos2);
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(pos2, pos);
+    ck_assert_int_eq(memcmp(data, data2, pos), 0);
+    UA_ExtensionObject_deleteMembers(&dst);
+}
+END_TEST
+
+START_TEST(UA_ExtensionObject_decodeCustomTypeShallUseBinaryEncodingId) {
+    // given
+    CustomPoint p = {.x = 5, .y = 6};
+    UA_ExtensionObject eo;
+    UA_ExtensionObject_init(&eo);
+    eo.encoding = UA_EXTENSIONOBJECT_DECODED_NODELETE;
+    eo.content.decoded.type = &CustomTypes[1];
+    eo.content.decoded.data = &p;
+    UA_Byte data[64];
+    UA_ByteString buf = {.length = 64, .data = data};
+    size_t pos = 0;
+    UA_StatusCode retval = UA_ExtensionObject_encodeBinary(&eo, &buf, &pos);
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    buf.length = pos;
+
+    // when
+    UA_ExtensionObject raw;
+    size_t rawPos = 0;
+    retval = UA_ExtensionObject_decodeBinary(&buf, &rawPos, &raw);
+    UA_ExtensionObject dst;
+    size_t dstPos = 0;
+    UA_StatusCode retval2 =
+        UA_decodeBinary(&buf, &dstPos, &dst, &UA_TYPES[UA_TYPES_EXTENSIONOBJECT], 2, CustomTypes);
+
+    // then
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_int_eq(raw.encoding, UA_EXTENSIONOBJECT_ENCODED_BYTESTRING);
+    ck_assert_int_eq(raw.content.encoded.typeId.identifier.numeric, 5001);
+    ck_assert_int_eq(retval2, UA_STATUSCODE_GOOD);
+    ck_assert_int_eq(dst.encoding, UA_EXTENSIONOBJECT_DECODED);
+    ck_assert_ptr_eq(dst.content.decoded.type, &CustomTypes[1]);
+    ck_assert_int_eq(((CustomPoint*)dst.content.decoded.data)->x, 5);
+    ck_assert_int_eq(((CustomPoint*)dst.content.decoded.data)->y, 6);
+    UA_ExtensionObject_deleteMembers(&raw);
+    UA_ExtensionObject_deleteMembers(&dst);
+}
+END_TEST
+
+START_TEST(UA_ExtensionObject_decodeShallRejectWrongBodyLength) {
+    // given
+    CustomPoint p = {.x = 3, .y = -4};
+    UA_Variant src;
+    UA_Variant_setScalar(&src, &p, &CustomTypes[0]);
+    UA_ExtensionObject eo;
+    UA_ExtensionObject_init(&eo);
+    eo.encoding = UA_EXTENSIONOBJECT_DECODED_NODELETE;
+    eo.content.decoded.type = &CustomTypes[0];
+    eo.content.decoded.data = &p;
+
+    for(size_t i = 0; i < 2; i++) {
+        UA_Byte data[64];
+        UA_ByteString buf = {.length = 64, .data = data};
+        size_t pos = 0;
+        UA_StatusCode retval;
+        if(i == 0)
+            retval = UA_ExtensionObject_encodeBinary(&eo, &buf, &pos);
+        else
+            retval = UA_Variant_encodeBinary(&src, &buf, &pos);
+        ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+        /* the body of two Int32 is preceded by its length */
+        ck_assert_int_eq(data[pos - 12], 8);
+        data[pos] = 0;
+        buf.length = pos + 1;
+
+        for(UA_Byte length = 7; length <= 9; length += 2) {
+            // when
+            data[pos - 12] = length;
+            size_t dstPos = 0;
+            if(i == 0) {
+                UA_ExtensionObject dst;
+                retval = UA_decodeBinary(&buf, &dstPos, &dst,
+                                         &UA_TYPES[UA_TYPES_EXTENSIONOBJECT], 2, CustomTypes);
+            } else {
+                UA_Variant dst;
+                retval = UA_decodeBinary(&buf, &dstPos, &dst,
+                                         &UA_TYPES[UA_TYPES_VARIANT], 2, CustomTypes);
+            }
+
+            // then
+            ck_assert_int_eq(retval, UA_STATUSCODE_BADDECODINGERROR);
+        }
+    }
+}
+END_TEST
+
+START_TEST(UA_Variant_decodeStructureShallUnwrapExtensionObject) {
+    // given
+    UA_ReadValueId rvi;
+    UA_ReadValueId_init(&rvi);
+    rvi.nodeId = UA_NODEID_NUMERIC(1, 42);
+    rvi.attributeId = UA_ATTRIBUTEID_VALUE;
+    CustomPoint p = {.x = 7, .y = 8};
+    UA_Variant src[2];
+    UA_Variant_setScalar(&src[0], &rvi, &UA_TYPES[UA_TYPES_READVALUEID]);
+    UA_Variant_setScalar(&src[1], &p, &CustomTypes[0]);
+
+    for(size_t i = 0; i < 2; i++) {
+        UA_Byte data[128];
+        UA_ByteString buf = {.length = 128, .data = data};
+        size_t pos = 0;
+        UA_StatusCode retval = UA_Variant_encodeBinary(&src[i], &buf, &pos);
+        ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+        buf.length = pos;
+
+        // when
+        UA_Variant dst;
+        size_t dstPos = 0;
+        retval = UA_decodeBinary(&buf, &dstPos, &dst, &UA_TYPES[UA_TYPES_VARIANT], 2, CustomTypes);
+
+        // then
+        ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+        ck_assert_uint_eq(dstPos, pos);
+        ck_assert_ptr_eq(dst.type, src[i].type);
+        ck_assert(UA_Variant_isScalar(&dst));
+        UA_Variant_deleteMembers(&dst);
+    }
+}
+END_TEST
+
+START_TEST(UA_Variant_equalShallCompareArrays) {
+    // given
+    UA_Int32 a1[3] = {1, 2, 3};
+    UA_Int32 a2[3] = {1, 2, 4};
+    UA_Variant v1, v2;
+    UA_Variant_setArrayCopy(&v1, a1, 3, &UA_TYPES[UA_TYPES_INT32]);
+    UA_Variant_setArrayCopy(&v2, a1, 3, &UA_TYPES[UA_TYPES_INT32]);
+    UA_Variant scalar;
+    UA_Variant_setScalar(&scalar, a1, &UA_TYPES[UA_TYPES_INT32]);
+
+    // then
+    ck_assert(UA_equal(&v1, &v2, &UA_TYPES[UA_TYPES_VARIANT]));
+    ck_assert(!UA_equal(&v1, &scalar, &UA_TYPES[UA_TYPES_VARIANT]));
+    ((UA_Int32*)v2.data)[2] = a2[2];
+    ck_assert(!UA_equal(&v1, &v2, &UA_TYPES[UA_TYPES_VARIANT]));
+    UA_Variant_deleteMembers(&v2);
+    UA_Variant_setArrayCopy(&v2, a1, 2, &UA_TYPES[UA_TYPES_INT32]);
+    ck_assert(!UA_equal(&v1, &v2, &UA_TYPES[UA_TYPES_VARIANT]));
+
+    // finally
+    UA_Variant_deleteMembers(&v1);
+    UA_Variant_deleteMembers(&v2);
+}
+END_TEST
+
+START_TEST(UA_equalShallCompareStructures) {
+    // given
+    UA_ApplicationDescription d1, d2;
+    UA_ApplicationDescription_init(&d1);
+    d1.applicationUri = UA_STRING_ALLOC("urn:test");
+    d1.applicationName = UA_LOCALIZEDTEXT_ALLOC("en_US", "Test");
+    d1.discoveryUrls = UA_Array_new(1, &UA_TYPES[UA_TYPES_STRING]);
+    d1.discoveryUrls[0] = UA_STRING_ALLOC("opc.tcp://localhost:4840");
+    d1.discoveryUrlsSize = 1;
+    UA_ApplicationDescription_copy(&d1, &d2);
+
+    // then
+    ck_assert(UA_equal(&d1, &d2, &UA_TYPES[UA_TYPES_APPLICATIONDESCRIPTION]));
+    d2.discoveryUrls[0].data[0] = 'x';
+    ck_assert(!UA_equal(&d1, &d2, &UA_TYPES[UA_TYPES_APPLICATIONDESCRIPTION]));
+    d2.discoveryUrls[0].data[0] = 'o';
+    d2.applicationType = UA_APPLICATIONTYPE_CLIENT;
+    ck_assert(!UA_equal(&d1, &d2, &UA_TYPES[UA_TYPES_APPLICATIONDESCRIPTION]));
+
+    // finally
+    UA_ApplicationDescription_deleteMembers(&d1);
+    UA_ApplicationDescription_deleteMembers(&d2);
+}
+END_TEST
+
+START_TEST(UA_DataValue_equalShallIgnoreUnsetFields) {
+    // given
+    UA_Double value = 1.5;
+    UA_DataValue d1, d2;
+    UA_DataValue_init(&d1);
+    UA_DataValue_init(&d2);
+    UA_Variant_setScalar(&d1.value, &value, &UA_TYPES[UA_TYPES_DOUBLE]);
+    UA_Variant_setScalar(&d2.value, &value, &UA_TYPES[UA_TYPES_DOUBLE]);
+    d1.hasValue = d2.hasValue = true;
+    d1.sourceTimestamp = 4; /* not set */
+
+    // then
+    ck_assert(UA_equal(&d1, &d2, &UA_TYPES[UA_TYPES_DATAVALUE]));
+    d1.hasSourceTimestamp = d2.hasSourceTimestamp = true;
+    ck_assert(!UA_equal(&d1, &d2, &UA_TYPES[UA_TYPES_DATAVALUE]));
+}
+END_TEST
+
 static Suite *testSuite_builtin(void) {
     Suite *s = suite_create("Built-in Data Types 62541-6 Table 1");
 
@@ -1504,6 +2019,11 @@ static Suite *testSuite_builtin(void) {
     tcase_add_test(tc_decode, UA_Variant_decodeWithArrayFlagSetShallSetVTAndAllocateMemoryForArray);
     tcase_add_test(tc_decode, UA_Variant_decodeWithOutDeleteMembersShallFailInCheckMem);
     tcase_add_test(tc_decode, UA_Variant_decodeWithTooSmallSourceShallReturnWithError);
+    tcase_add_test(tc_decode, UA_ExtensionObject_decodeCustomTypeShallDecodeContent);
+    tcase_add_test(tc_decode, UA_ExtensionObject_decodeUnknownCustomTypeShallKeepByteString);
+    tcase_add_test(tc_decode, UA_ExtensionObject_decodeCustomTypeShallUseBinaryEncodingId);
+    tcase_add_test(tc_decode, UA_ExtensionObject_decodeShallRejectWrongBodyLength);
+    tcase_add_test(tc_decode, UA_Variant_decodeStructureShallUnwrapExtensionObject);
     suite_add_tcase(s, tc_decode);
 
     TCase *tc_encode = tcase_create("encode");
@@ -1518,11 +2038,15 @@ static Suite *testSuite_builtin(void) {
     tcase_add_test(tc_encode, UA_Int64_encodeShallEncodeLittleEndian);
     tcase_add_test(tc_encode, UA_Float_encodeShallWorkOnExample);
     tcase_add_test(tc_encode, UA_Double_encodeShallWorkOnExample);
+    tcase_add_test(tc_encode, UA_NumericArray_encodeNotOverlayableShallMatchOverlayable);
+    tcase_add_test(tc_encode, UA_encodeBinaryGrowShallGrowAndReuseBuffer);
     tcase_add_test(tc_encode, UA_String_encodeShallWorkOnExample);
     tcase_add_test(tc_encode, UA_ExpandedNodeId_encodeShallWorkOnExample);
     tcase_add_test(tc_encode, UA_DataValue_encodeShallWorkOnExampleWithoutVariant);
     tcase_add_test(tc_encode, UA_DataValue_encodeShallWorkOnExampleWithVariant);
+    tcase_add_test(tc_encode, UA_ResponseHeader_encodeDecodeShallWorkOnExample);
     tcase_add_test(tc_encode, UA_ExtensionObject_encodeDecodeShallWorkOnExtensionObject);
+    tcase_add_test(tc_encode, UA_ExtensionObject_calcSizeShallMatchEncodedLength);
     suite_add_tcase(s, tc_encode);
 
     TCase *tc_convert = tcase_create("convert");
@@ -1546,6 +2070,12 @@ static Suite *testSuite_builtin(void) {
     tcase_add_test(tc_copy, UA_LocalizedText_copycstringShallWorkOnInputExample);
     tcase_add_test(tc_copy, UA_DataValue_copyShallWorkOnInputExample);
     suite_add_tcase(s, tc_copy);
+
+    TCase *tc_equal = tcase_create("equal");
+    tcase_add_test(tc_equal, UA_Variant_equalShallCompareArrays);
+    tcase_add_test(tc_equal, UA_equalShallCompareStructures);
+    tcase_add_test(tc_equal, UA_DataValue_equalShallIgnoreUnsetFields);
+    suite_add_tcase(s, tc_equal);
     return s;
 }
 
@@ -14,17 +14,17 @@
 
 int zeroCnt = 0;
 int visitCnt = 0;
-static void checkZeroVisitor(const UA_Node* node) {
+static void checkZeroVisitor(void *context, const UA_Node* node) {
 	visitCnt++;
 	if (node == NULL) zeroCnt++;
 }
 
-static void printVisitor(const UA_Node* node) {
+static void printVisitor(void *context, const UA_Node* node) {
 	printf("%d\n", node->nodeId.identifier.numeric);
 }
 
-static UA_Node* createNode(UA_Int16 nsid, UA_Int32 id) {
-	UA_Node *p = (UA_Node *)UA_NodeStore_newVariableNode();
+static UA_Node* createNode(UA_NodeStore *ns, UA_Int16 nsid, UA_Int32 id) {
+	UA_Node *p = (UA_Node *)UA_NodeStore_newVariableNode(ns);
 	p->nodeId.identifierType = UA_NODEIDTYPE_NUMERIC;
 	p->nodeId.namespaceIndex = nsid;
 	p->nodeId.identifier.numeric = id;
@@ -34,7 +34,7 @@ static UA_Node* createNode(UA_Int16 nsid, UA_Int32 id) {
 
 START_TEST(replaceExistingNode) {
 	UA_NodeStore *ns = UA_NodeStore_new();
-	UA_Node* n1 = createNode(0,2253);
+	UA_Node* n1 = createNode(ns, 0,2253);
 	UA_NodeStore_insert(ns, n1);
     UA_NodeId in1 = UA_NODEID_NUMERIC(0, 2253);
 	UA_Node* n2 = UA_NodeStore_getCopy(ns, &in1);
@@ -48,7 +48,7 @@ END_TEST
 
 START_TEST(replaceOldNode) {
 	UA_NodeStore *ns = UA_NodeStore_new();
-	UA_Node* n1 = createNode(0,2253);
+	UA_Node* n1 = createNode(ns, 0,2253);
 	UA_NodeStore_insert(ns, n1);
     UA_NodeId in1 = UA_NODEID_NUMERIC(0,2253);
 	UA_Node* n2 = UA_NodeStore_getCopy(ns, &in1);
@@ -72,7 +72,7 @@ START_TEST(findNodeInUA_NodeStoreWithSingleEntry) {
 #endif
 	// given
 	UA_NodeStore *ns = UA_NodeStore_new();
-	UA_Node* n1 = createNode(0,2253);
+	UA_Node* n1 = createNode(ns, 0,2253);
 	UA_NodeStore_insert(ns, n1);
     UA_NodeId in1 = UA_NODEID_NUMERIC(0,2253);
 	const UA_Node* nr = UA_NodeStore_get(ns, &in1);
@@ -93,7 +93,7 @@ START_TEST(failToFindNodeInOtherUA_NodeStore) {
 	// given
 	UA_NodeStore *ns = UA_NodeStore_new();
 
-	UA_Node* n1 = createNode(0,2255);
+	UA_Node* n1 = createNode(ns, 0,2255);
     UA_NodeStore_insert(ns, n1);
 
 	// when
@@ -115,17 +115,17 @@ START_TEST(findNodeInUA_NodeStoreWithSeveralEntries) {
 #endif
 	// given
 	UA_NodeStore *ns = UA_NodeStore_new();
-	UA_Node* n1 = createNode(0,2253);
+	UA_Node* n1 = createNode(ns, 0,2253);
     UA_NodeStore_insert(ns, n1);
-	UA_Node* n2 = createNode(0,2255);
+	UA_Node* n2 = createNode(ns, 0,2255);
     UA_NodeStore_insert(ns, n2);
-	UA_Node* n3 = createNode(0,2257);
+	UA_Node* n3 = createNode(ns, 0,2257);
     UA_NodeStore_insert(ns, n3);
-	UA_Node* n4 = createNode(0,2200);
+	UA_Node* n4 = createNode(ns, 0,2200);
     UA_NodeStore_insert(ns, n4);
-	UA_Node* n5 = createNode(0,1);
+	UA_Node* n5 = createNode(ns, 0,1);
     UA_NodeStore_insert(ns, n5);
-	UA_Node* n6 = createNode(0,12);
+	UA_Node* n6 = createNode(ns, 0,12);
     UA_NodeStore_insert(ns, n6);
 
 	// when
@@ -147,23 +147,23 @@ START_TEST(iterateOverUA_NodeStoreShallNotVisitEmptyNodes) {
 #endif
 	// given
 	UA_NodeStore *ns = UA_NodeStore_new();
-	UA_Node* n1 = createNode(0,2253);
+	UA_Node* n1 = createNode(ns, 0,2253);
     UA_NodeStore_insert(ns, n1);
-	UA_Node* n2 = createNode(0,2255);
+	UA_Node* n2 = createNode(ns, 0,2255);
     UA_NodeStore_insert(ns, n2);
-	UA_Node* n3 = createNode(0,2257);
+	UA_Node* n3 = createNode(ns, 0,2257);
     UA_NodeStore_insert(ns, n3);
-	UA_Node* n4 = createNode(0,2200);
+	UA_Node* n4 = createNode(ns, 0,2200);
     UA_NodeStore_insert(ns, n4);
-	UA_Node* n5 = createNode(0,1);
+	UA_Node* n5 = createNode(ns, 0,1);
     UA_NodeStore_insert(ns, n5);
-	UA_Node* n6 = createNode(0,12);
+	UA_Node* n6 = createNode(ns, 0,12);
     UA_NodeStore_insert(ns, n6);
 
 	// when
 	zeroCnt = 0;
 	visitCnt = 0;
-	UA_NodeStore_iterate(ns,checkZeroVisitor);
+	UA_NodeStore_iterate(ns,checkZeroVisitor, NULL);
 	// then
 	ck_assert_int_eq(zeroCnt, 0);
 	ck_assert_int_eq(visitCnt, 6);
@@ -184,16 +184,16 @@ START_TEST(findNodeInExpandedNamespace) {
 	UA_Node* n;
 	UA_Int32 i=0;
 	for (; i<200; i++) {
-		n = createNode(0,i);
+		n = createNode(ns, 0,i);
         UA_NodeStore_insert(ns, n);
 	}
 	// when
-	UA_Node *n2 = createNode(0,25);
+	UA_Node *n2 = createNode(ns, 0,25);
 	const UA_Node* nr = UA_NodeStore_get(ns,&n2->nodeId);
 	// then
 	ck_assert_int_eq(nr->nodeId.identifier.numeric,n2->nodeId.identifier.numeric);
 	// finally
-    UA_NodeStore_deleteNode(n2);
+    UA_NodeStore_deleteNode(ns, n2);
 	UA_NodeStore_delete(ns);
 #ifdef UA_ENABLE_MULTITHREADING
 	rcu_unregister_thread();
@@ -210,13 +210,13 @@ START_TEST(iterateOverExpandedNamespaceShallNotVisitEmptyNodes) {
     UA_Node* n;
 	UA_Int32 i=0;
 	for (; i<200; i++) {
-		n = createNode(0,i);
+		n = createNode(ns, 0,i);
         UA_NodeStore_insert(ns, n);
 	}
 	// when
 	zeroCnt = 0;
 	visitCnt = 0;
-	UA_NodeStore_iterate(ns,checkZeroVisitor);
+	UA_NodeStore_iterate(ns,checkZeroVisitor, NULL);
 	// then
 	ck_assert_int_eq(zeroCnt, 0);
 	ck_assert_int_eq(visitCnt, 200);
@@ -234,15 +234,15 @@ START_TEST(failToFindNonExistantNodeInUA_NodeStoreWithSeveralEntries) {
 #endif
 	// given
 	UA_NodeStore *ns = UA_NodeStore_new();
-	UA_Node* n1 = createNode(0,2253);
+	UA_Node* n1 = createNode(ns, 0,2253);
     UA_NodeStore_insert(ns, n1);
-	UA_Node* n2 = createNode(0,2255);
+	UA_Node* n2 = createNode(ns, 0,2255);
     UA_NodeStore_insert(ns, n2);
-	UA_Node* n3 = createNode(0,2257);
+	UA_Node* n3 = createNode(ns, 0,2257);
     UA_NodeStore_insert(ns, n3);
-	UA_Node* n4 = createNode(0,2200);
+	UA_Node* n4 = createNode(ns, 0,2200);
     UA_NodeStore_insert(ns, n4);
-	UA_Node* n5 = createNode(0,1);
+	UA_Node* n5 = createNode(ns, 0,1);
     UA_NodeStore_insert(ns, n5);
 
     UA_NodeId id = UA_NODEID_NUMERIC(0, 12);
@@ -259,6 +259,585 @@ START_TEST(failToFindNonExistantNodeInUA_NodeStoreWithSeveralEntries) {
 }
 END_TEST
 
+START_TEST(findNodesAfterRemovingOtherNodes) {
+#ifdef UA_ENABLE_MULTITHREADING
+   	rcu_register_thread();
+#endif
+	// given a nodestore that was resized several times
+	UA_NodeStore *ns = UA_NodeStore_new();
+	for(UA_Int32 i = 1; i <= 1000; i++)
+		ck_assert_int_eq(UA_NodeStore_insert(ns, createNode(ns, 1, i)), UA_STATUSCODE_GOOD);
+
+	// when every other node is removed
+	UA_NodeId id = UA_NODEID_NUMERIC(1, 0);
+	for(UA_UInt32 i = 1; i <= 1000; i += 2) {
+		id.identifier.numeric = i;
+		ck_assert_int_eq(UA_NodeStore_remove(ns, &id), UA_STATUSCODE_GOOD);
+	}
+
+	// then the remaining nodes are found and the removed are not
+	for(UA_UInt32 i = 1; i <= 1000; i++) {
+		id.identifier.numeric = i;
+		const UA_Node *n = UA_NodeStore_get(ns, &id);
+		if(i % 2)
+			ck_assert_ptr_eq(n, NULL);
+		else
+			ck_assert_uint_eq(n->nodeId.identifier.numeric, i);
+	}
+
+	// and nodes with a null nodeid get fresh numeric nodeids
+	for(UA_Int32 i = 0; i < 100; i++)
+		ck_assert_int_eq(UA_NodeStore_insert(ns, createNode(ns, 1, 0)), UA_STATUSCODE_GOOD);
+	visitCnt = 0;
+	zeroCnt = 0;
+	UA_NodeStore_iterate(ns, checkZeroVisitor, NULL);
+	ck_assert_int_eq(zeroCnt, 0);
+	ck_assert_int_eq(visitCnt, 600);
+
+	// finally
+	UA_NodeStore_delete(ns);
+#ifdef UA_ENABLE_MULTITHREADING
+	rcu_unregister_thread();
+#endif
+}
+END_TEST
+
+START_TEST(findNodesInDenseAndSparseRanges) {
+#ifdef UA_ENABLE_MULTITHREADING
+   	rcu_register_thread();
+#endif
+	// given nodes far beyond the dense numeric range and in other namespaces
+	UA_NodeStore *ns = UA_NodeStore_new();
+	ck_assert_int_eq(UA_NodeStore_insert(ns, createNode(ns, 1, 3000)), UA_STATUSCODE_GOOD);
+	ck_assert_int_eq(UA_NodeStore_insert(ns, createNode(ns, 1, 5000000)), UA_STATUSCODE_GOOD);
+	ck_assert_int_eq(UA_NodeStore_insert(ns, createNode(ns, 200, 5)), UA_STATUSCODE_GOOD);
+
+	// when the range fills up to them
+	for(UA_Int32 i = 1; i <= 2000; i++)
+		ck_assert_int_eq(UA_NodeStore_insert(ns, createNode(ns, 1, i)), UA_STATUSCODE_GOOD);
+
+	// then all nodes are found exactly once
+	UA_NodeId id = UA_NODEID_NUMERIC(1, 3000);
+	ck_assert_int_eq(UA_NodeStore_insert(ns, createNode(ns, 1, 3000)), UA_STATUSCODE_BADNODEIDEXISTS);
+	ck_assert_ptr_ne(UA_NodeStore_get(ns, &id), NULL);
+	id.identifier.numeric = 5000000;
+	ck_assert_ptr_ne(UA_NodeStore_get(ns, &id), NULL);
+	id.identifier.numeric = 2001;
+	ck_assert_ptr_eq(UA_NodeStore_get(ns, &id), NULL);
+	id.identifier.numeric = 1234;
+	const UA_Node *n = UA_NodeStore_get(ns, &id);
+	ck_assert_uint_eq(n->nodeId.identifier.numeric, 1234);
+	UA_NodeId other = UA_NODEID_NUMERIC(200, 5);
+	ck_assert_ptr_ne(UA_NodeStore_get(ns, &other), NULL);
+	visitCnt = 0;
+	UA_NodeStore_iterate(ns, checkZeroVisitor, NULL);
+	ck_assert_int_eq(visitCnt, 2003);
+
+	// and can be replaced and removed
+	UA_Node *copy = UA_NodeStore_getCopy(ns, &id);
+	ck_assert_int_eq(UA_NodeStore_replace(ns, copy), UA_STATUSCODE_GOOD);
+	ck_assert_ptr_eq(UA_NodeStore_get(ns, &id), copy);
+	ck_assert_int_eq(UA_NodeStore_remove(ns, &id), UA_STATUSCODE_GOOD);
+	ck_assert_int_eq(UA_NodeStore_remove(ns, &id), UA_STATUSCODE_BADNODEIDUNKNOWN);
+	ck_assert_ptr_eq(UA_NodeStore_get(ns, &id), NULL);
+
+	// finally
+	UA_NodeStore_delete(ns);
+#ifdef UA_ENABLE_MULTITHREADING
+	rcu_unregister_thread();
+#endif
+}
+END_TEST
+
+START_TEST(assignedIdentifiersShallFollowTheStoredNodes) {
+#ifdef UA_ENABLE_MULTITHREADING
+   	rcu_register_thread();
+#endif
+	// given the nodes of a namespace zero in the dense range
+	UA_NodeStore *ns = UA_NodeStore_new();
+	for(UA_Int32 i = 1; i <= 100; i++)
+		ck_assert_int_eq(UA_NodeStore_insert(ns, createNode(ns, 0, i)), UA_STATUSCODE_GOOD);
+
+	// when a node without an identifier is inserted in namespace one
+	UA_Node *n = createNode(ns, 1, 0);
+	ck_assert_int_eq(UA_NodeStore_insert(ns, n), UA_STATUSCODE_GOOD);
+
+	// then the small identifiers remain free for the nodes requesting them
+#ifndef UA_ENABLE_MULTITHREADING
+	ck_assert_uint_gt(n->nodeId.identifier.numeric, 100);
+#endif
+	ck_assert_int_eq(UA_NodeStore_insert(ns, createNode(ns, 1, 50)), UA_STATUSCODE_GOOD);
+
+	// finally
+	UA_NodeStore_delete(ns);
+#ifdef UA_ENABLE_MULTITHREADING
+	rcu_unregister_thread();
+#endif
+}
+END_TEST
+
+/* Counts the visits of the nodes with a numeric identifier below 4000 */
+static void countVisitor(void *context, const UA_Node *node) {
+	UA_UInt32 *visits = context;
+	ck_assert_uint_lt(node->nodeId.identifier.numeric, 4000);
+	visits[node->nodeId.identifier.numeric]++;
+}
+
+START_TEST(iterateInPartitionsShallVisitEveryNodeOnce) {
+#ifdef UA_ENABLE_MULTITHREADING
+   	rcu_register_thread();
+	rcu_read_lock();
+#endif
+	// given nodes in the dense range, in the hash table and removed ones
+	UA_NodeStore *ns = UA_NodeStore_new();
+	for(UA_Int32 i = 1; i < 4000; i++)
+		ck_assert_int_eq(UA_NodeStore_insert(ns, createNode(ns, (UA_Int16)(i % 3), i)), UA_STATUSCODE_GOOD);
+	for(UA_Int32 i = 1; i < 4000; i += 7) {
+		UA_NodeId id = UA_NODEID_NUMERIC((UA_UInt16)(i % 3), (UA_UInt32)i);
+		ck_assert_int_eq(UA_NodeStore_remove(ns, &id), UA_STATUSCODE_GOOD);
+	}
+
+	// when iterating in five partitions with a counter array each
+	enum { partitions = 5 };
+	UA_UInt32 *visits[partitions];
+	void *contexts[partitions];
+	for(size_t p = 0; p < partitions; p++) {
+		visits[p] = calloc(4000, sizeof(UA_UInt32));
+		contexts[p] = visits[p];
+	}
+	UA_NodeStore_iterateParallel(ns, partitions, countVisitor, contexts);
+
+	// then every remaining node is visited in exactly one partition
+	for(UA_UInt32 i = 1; i < 4000; i++) {
+		UA_UInt32 total = 0;
+		for(size_t p = 0; p < partitions; p++)
+			total += visits[p][i];
+		ck_assert_uint_eq(total, (i - 1) % 7 == 0 ? 0 : 1);
+	}
+
+	// and nothing is visited without partitions or outside of them
+	UA_NodeStore_iterateParallel(ns, 0, countVisitor, NULL);
+	UA_NodeStore_iteratePartition(ns, 0, 0, countVisitor, NULL);
+	UA_NodeStore_iteratePartition(ns, partitions, partitions, countVisitor, NULL);
+
+	// finally
+	for(size_t p = 0; p < partitions; p++)
+		free(visits[p]);
+	UA_NodeStore_delete(ns);
+#ifdef UA_ENABLE_MULTITHREADING
+	rcu_read_unlock();
+	rcu_unregister_thread();
+#endif
+}
+END_TEST
+
+START_TEST(overlayLinkedStaticNodes) {
+#ifndef UA_ENABLE_MULTITHREADING
+	// given
+	static const UA_ObjectNode staticNode1 = {
+		.nodeId = {0, UA_NODEIDTYPE_NUMERIC, {1}}, .nodeClass = UA_NODECLASS_OBJECT};
+	static const UA_ObjectNode staticNode2 = {
+		.nodeId = {0, UA_NODEIDTYPE_NUMERIC, {7}}, .nodeClass = UA_NODECLASS_OBJECT};
+	static const UA_Node * const staticNodes[2] = {
+		(const UA_Node*)&staticNode1, (const UA_Node*)&staticNode2};
+	UA_NodeStore *ns = UA_NodeStore_new();
+	UA_NodeStore_insert(ns, createNode(ns, 0, 2));
+	ck_assert_int_eq(UA_NodeStore_linkStatic(ns, staticNodes, 2, NULL, NULL, NULL), UA_STATUSCODE_GOOD);
+	UA_NodeId id1 = UA_NODEID_NUMERIC(0, 1);
+	UA_NodeId id7 = UA_NODEID_NUMERIC(0, 7);
+
+	// then
+	ck_assert_ptr_eq(UA_NodeStore_get(ns, &id1), (const UA_Node*)&staticNode1);
+	ck_assert(UA_NodeStore_isStatic(ns, UA_NodeStore_get(ns, &id7)));
+	visitCnt = 0;
+	UA_NodeStore_iterate(ns, checkZeroVisitor, NULL);
+	ck_assert_int_eq(visitCnt, 3);
+	ck_assert_int_eq(UA_NodeStore_insert(ns, createNode(ns, 0, 7)), UA_STATUSCODE_BADNODEIDEXISTS);
+
+	// and a replaced node shadows the static node
+	UA_Node *copy = UA_NodeStore_getCopy(ns, &id1);
+	copy->writeMask = 1;
+	ck_assert_int_eq(UA_NodeStore_replace(ns, copy), UA_STATUSCODE_GOOD);
+	const UA_Node *replaced = UA_NodeStore_get(ns, &id1);
+	ck_assert_ptr_eq(replaced, copy);
+	ck_assert(!UA_NodeStore_isStatic(ns, replaced));
+	ck_assert_int_eq(staticNode1.writeMask, 0);
+
+	// and a removed static node is hidden
+	ck_assert_int_eq(UA_NodeStore_remove(ns, &id7), UA_STATUSCODE_GOOD);
+	ck_assert_ptr_eq(UA_NodeStore_get(ns, &id7), NULL);
+	ck_assert_int_eq(UA_NodeStore_remove(ns, &id7), UA_STATUSCODE_BADNODEIDUNKNOWN);
+	visitCnt = 0;
+	UA_NodeStore_iterate(ns, checkZeroVisitor, NULL);
+	ck_assert_int_eq(visitCnt, 2);
+
+	// finally
+	UA_NodeStore_delete(ns);
+#endif
+}
+END_TEST
+
+START_TEST(laterStaticLayersShallOverrideNodes) {
+#ifndef UA_ENABLE_MULTITHREADING
+	// given
+	static const UA_ObjectNode lower = {
+		.nodeId = {0, UA_NODEIDTYPE_NUMERIC, {1}}, .nodeClass = UA_NODECLASS_OBJECT};
+	static const UA_ObjectNode upper = {
+		.nodeId = {0, UA_NODEIDTYPE_NUMERIC, {1}}, .nodeClass = UA_NODECLASS_OBJECT};
+	static const UA_ObjectNode unsorted = {
+		.nodeId = {0, UA_NODEIDTYPE_NUMERIC, {0}}, .nodeClass = UA_NODECLASS_OBJECT};
+	static const UA_Node * const lowerNodes[1] = {(const UA_Node*)&lower};
+	static const UA_Node * const upperNodes[2] = {(const UA_Node*)&upper, (const UA_Node*)&unsorted};
+	UA_NodeStore *ns = UA_NodeStore_new();
+	UA_NodeId id1 = UA_NODEID_NUMERIC(0, 1);
+
+	// when
+	ck_assert_int_eq(UA_NodeStore_linkStatic(ns, lowerNodes, 1, NULL, NULL, NULL), UA_STATUSCODE_GOOD);
+	ck_assert_int_eq(UA_NodeStore_linkStatic(ns, upperNodes, 2, NULL, NULL, NULL),
+	                 UA_STATUSCODE_BADINVALIDARGUMENT);
+	ck_assert_int_eq(UA_NodeStore_linkStatic(ns, upperNodes, 1, NULL, NULL, NULL), UA_STATUSCODE_GOOD);
+
+	// then
+	ck_assert_ptr_eq(UA_NodeStore_get(ns, &id1), (const UA_Node*)&upper);
+	visitCnt = 0;
+	UA_NodeStore_iterate(ns, checkZeroVisitor, NULL);
+	ck_assert_int_eq(visitCnt, 1);
+	ck_assert_int_eq(UA_NodeStore_remove(ns, &id1), UA_STATUSCODE_GOOD);
+	ck_assert_ptr_eq(UA_NodeStore_get(ns, &id1), NULL);
+
+	// finally
+	UA_NodeStore_delete(ns);
+#endif
+}
+END_TEST
+
+#ifdef UA_ENABLE_NODESTORE_SNAPSHOT
+static UA_StatusCode
+boundMethod(void *methodHandle, const UA_NodeId objectId, size_t inputSize,
+            const UA_Variant *input, size_t outputSize, UA_Variant *output) {
+	return UA_STATUSCODE_GOOD;
+}
+
+static void writeTestSnapshot(const char *path) {
+	UA_NodeStore *ns = UA_NodeStore_new();
+	UA_VariableNode *v = UA_NodeStore_newVariableNode(ns);
+	v->nodeId = UA_NODEID_STRING_ALLOC(1, "the.answer");
+	v->nodeClass = UA_NODECLASS_VARIABLE;
+	v->browseName = UA_QUALIFIEDNAME_ALLOC(1, "the answer");
+	v->displayName = UA_LOCALIZEDTEXT_ALLOC("en_US", "the answer");
+	UA_Int32 values[3] = {42, 43, 44};
+	UA_Variant_setArrayCopy(&v->value.variant.value, values, 3, &UA_TYPES[UA_TYPES_INT32]);
+	UA_NodeId organizes = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+	UA_ExpandedNodeId objects = UA_EXPANDEDNODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
+	UA_Node_addReference((UA_Node*)v, &organizes, &objects, true, UA_NodeStore_internTable(ns));
+	UA_NodeStore_insert(ns, (UA_Node*)v);
+	UA_NodeStore_insert(ns, createNode(ns, 1, 7));
+	UA_MethodNode *m = UA_NodeStore_newMethodNode(ns);
+	m->nodeId = UA_NODEID_NUMERIC(1, 8);
+	m->nodeClass = UA_NODECLASS_METHOD;
+	UA_NodeStore_insert(ns, (UA_Node*)m);
+	UA_String namespaces[2] = {UA_STRING("http://opcfoundation.org/UA/"), UA_STRING("urn:test")};
+	ck_assert_int_eq(UA_NodeStore_writeSnapshot(ns, path, namespaces, 2), UA_STATUSCODE_GOOD);
+	UA_NodeStore_delete(ns);
+}
+#endif
+
+START_TEST(snapshotShallRestoreNodes) {
+#ifdef UA_ENABLE_NODESTORE_SNAPSHOT
+#ifdef UA_ENABLE_MULTITHREADING
+	rcu_register_thread();
+#endif
+	// given
+	writeTestSnapshot("check_nodestore.snapshot");
+	UA_NodeStore *ns = UA_NodeStore_new();
+	UA_MethodNode *m = UA_NodeStore_newMethodNode(ns);
+	m->nodeId = UA_NODEID_NUMERIC(1, 8);
+	m->nodeClass = UA_NODECLASS_METHOD;
+	m->attachedMethod = boundMethod;
+	UA_NodeStore_insert(ns, (UA_Node*)m);
+	UA_String *namespaces = UA_String_new();
+	*namespaces = UA_STRING_ALLOC("http://opcfoundation.org/UA/");
+	size_t namespacesSize = 1;
+
+	// when
+	ck_assert_int_eq(UA_NodeStore_loadSnapshot(ns, "check_nodestore.snapshot", &namespaces,
+	                                           &namespacesSize), UA_STATUSCODE_GOOD);
+
+	// then
+	UA_NodeId id = UA_NODEID_STRING(1, "the.answer");
+	const UA_VariableNode *loaded = (const UA_VariableNode*)UA_NodeStore_get(ns, &id);
+	ck_assert_ptr_ne(loaded, NULL);
+	ck_assert(UA_NodeStore_isStatic(ns, (const UA_Node*)loaded));
+	UA_String name = UA_STRING("the answer");
+	ck_assert(UA_String_equal(&loaded->browseName.name, &name));
+	ck_assert(UA_String_equal(&loaded->displayName.text, &name));
+	ck_assert_ptr_eq(loaded->value.variant.value.type, &UA_TYPES[UA_TYPES_INT32]);
+	ck_assert_uint_eq(loaded->value.variant.value.arrayLength, 3);
+	ck_assert_int_eq(((UA_Int32*)loaded->value.variant.value.data)[2], 44);
+	ck_assert_uint_eq(loaded->referencesSize, 1);
+	ck_assert_uint_eq(loaded->references->targetIds[0].nodeId.identifier.numeric, UA_NS0ID_OBJECTSFOLDER);
+
+	// and the namespaces of the image are added
+	ck_assert_uint_eq(namespacesSize, 2);
+	UA_String uri = UA_STRING("urn:test");
+	ck_assert(UA_String_equal(&namespaces[1], &uri));
+
+	// and bound nodes are kept
+	UA_NodeId methodId = UA_NODEID_NUMERIC(1, 8);
+	const UA_MethodNode *method = (const UA_MethodNode*)UA_NodeStore_get(ns, &methodId);
+	ck_assert(!UA_NodeStore_isStatic(ns, (const UA_Node*)method));
+	ck_assert(method->attachedMethod == boundMethod);
+
+	// and modified nodes are copied
+	UA_VariableNode *copy = (UA_VariableNode*)UA_NodeStore_getCopy(ns, &id);
+	((UA_Int32*)copy->value.variant.value.data)[2] = 45;
+	ck_assert_int_eq(UA_NodeStore_replace(ns, (UA_Node*)copy), UA_STATUSCODE_GOOD);
+	ck_assert_ptr_eq(UA_NodeStore_get(ns, &id), copy);
+	ck_assert_int_eq(((UA_Int32*)loaded->value.variant.value.data)[2], 44);
+
+	// and a second mapping of the image is relocated
+	UA_NodeStore *ns2 = UA_NodeStore_new();
+	ck_assert_int_eq(UA_NodeStore_loadSnapshot(ns2, "check_nodestore.snapshot", &namespaces,
+	                                           &namespacesSize), UA_STATUSCODE_GOOD);
+	ck_assert_uint_eq(namespacesSize, 2);
+	const UA_VariableNode *loaded2 = (const UA_VariableNode*)UA_NodeStore_get(ns2, &id);
+	ck_assert_ptr_ne(loaded2, loaded);
+	ck_assert(UA_String_equal(&loaded2->browseName.name, &name));
+	ck_assert_ptr_eq(loaded2->value.variant.value.type, &UA_TYPES[UA_TYPES_INT32]);
+	ck_assert_int_eq(((UA_Int32*)loaded2->value.variant.value.data)[2], 44);
+
+	// finally
+	UA_Array_delete(namespaces, namespacesSize, &UA_TYPES[UA_TYPES_STRING]);
+	UA_NodeStore_delete(ns2);
+	UA_NodeStore_delete(ns);
+	remove("check_nodestore.snapshot");
+#ifdef UA_ENABLE_MULTITHREADING
+	rcu_unregister_thread();
+#endif
+#endif
+}
+END_TEST
+
+START_TEST(snapshotShallRejectInvalidImages) {
+#ifdef UA_ENABLE_NODESTORE_SNAPSHOT
+#ifdef UA_ENABLE_MULTITHREADING
+	rcu_register_thread();
+#endif
+	// given
+	writeTestSnapshot("check_nodestore.snapshot");
+	UA_NodeStore *ns = UA_NodeStore_new();
+	UA_String *namespaces = (UA_String*)UA_Array_new(2, &UA_TYPES[UA_TYPES_STRING]);
+	namespaces[0] = UA_STRING_ALLOC("http://opcfoundation.org/UA/");
+	namespaces[1] = UA_STRING_ALLOC("urn:other");
+	size_t namespacesSize = 2;
+	UA_NodeId id = UA_NODEID_STRING(1, "the.answer");
+
+	// when the namespaces differ
+	ck_assert_int_eq(UA_NodeStore_loadSnapshot(ns, "check_nodestore.snapshot", &namespaces,
+	                                           &namespacesSize), UA_STATUSCODE_BADINVALIDSTATE);
+
+	// then
+	ck_assert_uint_eq(namespacesSize, 2);
+	ck_assert_ptr_eq(UA_NodeStore_get(ns, &id), NULL);
+
+	// when a pointer is missing in the relocation table
+	FILE *f = fopen("check_nodestore.snapshot", "r+b");
+	ck_assert_ptr_ne(f, NULL);
+	UA_UInt64 baseRelocsSize;
+	fseek(f, 56, SEEK_SET);
+	ck_assert_uint_eq(fread(&baseRelocsSize, sizeof(UA_UInt64), 1, f), 1);
+	baseRelocsSize--;
+	fseek(f, 56, SEEK_SET);
+	ck_assert_uint_eq(fwrite(&baseRelocsSize, sizeof(UA_UInt64), 1, f), 1);
+	fclose(f);
+	namespacesSize = 1;
+
+	// then
+	ck_assert_int_eq(UA_NodeStore_loadSnapshot(ns, "check_nodestore.snapshot", &namespaces,
+	                                           &namespacesSize), UA_STATUSCODE_BADDECODINGERROR);
+	ck_assert_uint_eq(namespacesSize, 1);
+	ck_assert_ptr_eq(UA_NodeStore_get(ns, &id), NULL);
+
+	// finally
+	UA_Array_delete(namespaces, 2, &UA_TYPES[UA_TYPES_STRING]);
+	UA_NodeStore_delete(ns);
+	remove("check_nodestore.snapshot");
+#ifdef UA_ENABLE_MULTITHREADING
+	rcu_unregister_thread();
+#endif
+#endif
+}
+END_TEST
+
+START_TEST(referencesShallBeGroupedByType) {
+	// given
+	UA_NodeStore *ns = UA_NodeStore_new();
+	UA_InternTable *interned = UA_NodeStore_internTable(ns);
+	UA_Node *node = createNode(ns, 1, 1);
+	UA_NodeId organizes = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+	UA_NodeId hasComponent = UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT);
+	UA_ExpandedNodeId target;
+	UA_ExpandedNodeId_init(&target);
+	target.nodeId = UA_NODEID_NUMERIC(1, 0);
+
+	// when
+	for(UA_UInt32 i = 0; i < 100; i++) {
+		target.nodeId.identifier.numeric = 1000 + i;
+		ck_assert_int_eq(UA_Node_addReference(node, &organizes, &target, false, interned), UA_STATUSCODE_GOOD);
+	}
+	target.nodeId.identifier.numeric = 1000;
+	ck_assert_int_eq(UA_Node_addReference(node, &hasComponent, &target, false, interned), UA_STATUSCODE_GOOD);
+	ck_assert_int_eq(UA_Node_addReference(node, &organizes, &target, true, interned), UA_STATUSCODE_GOOD);
+
+	// then
+	ck_assert_uint_eq(node->referencesSize, 3);
+	ck_assert_int_eq(UA_Node_addReference(node, &organizes, &target, false, interned),
+	                 UA_STATUSCODE_BADDUPLICATEREFERENCENOTALLOWED);
+	const UA_NodeReferenceKind *rk = UA_Node_findReferenceKind(node, &organizes, false);
+	ck_assert_uint_eq(rk->targetIdsSize, 100);
+	ck_assert_ptr_ne(rk->targetIndex, NULL);
+
+	// and the index follows removals
+	for(UA_UInt32 i = 0; i < 100; i += 2) {
+		UA_NodeId id = UA_NODEID_NUMERIC(1, 1000 + i);
+		ck_assert_int_eq(UA_Node_deleteReference(node, &organizes, &id, false, interned), UA_STATUSCODE_GOOD);
+		ck_assert_int_eq(UA_Node_deleteReference(node, &organizes, &id, false, interned),
+		                 UA_STATUSCODE_UNCERTAINREFERENCENOTDELETED);
+	}
+	UA_Node *copy = (UA_Node*)UA_NodeStore_newVariableNode(ns);
+	ck_assert_int_eq(UA_Node_copyAnyNodeClass(node, copy), UA_STATUSCODE_GOOD);
+	rk = UA_Node_findReferenceKind(copy, &organizes, false);
+	ck_assert_uint_eq(rk->targetIdsSize, 50);
+	for(UA_UInt32 i = 0; i < 100; i++) {
+		UA_NodeId id = UA_NODEID_NUMERIC(1, 1000 + i);
+		size_t pos = UA_NodeReferenceKind_findTarget(rk, &id);
+		if(i % 2 == 0) {
+			ck_assert_uint_eq(pos, rk->targetIdsSize);
+		} else {
+			ck_assert_uint_lt(pos, rk->targetIdsSize);
+			ck_assert(UA_NodeId_equal(&rk->targetIds[pos].nodeId, &id));
+		}
+	}
+
+	// and empty kinds are removed
+	ck_assert_int_eq(UA_Node_deleteReference(node, &hasComponent, &target.nodeId, false, interned),
+	                 UA_STATUSCODE_GOOD);
+	ck_assert_uint_eq(node->referencesSize, 2);
+	ck_assert_ptr_eq(UA_Node_findReferenceKind(node, &hasComponent, false), NULL);
+
+	// finally
+	UA_NodeStore_deleteNode(ns, copy);
+	UA_NodeStore_deleteNode(ns, node);
+	UA_NodeStore_delete(ns);
+}
+END_TEST
+
+START_TEST(statisticsShallCountNodesPerNodeClass) {
+#ifndef UA_ENABLE_MULTITHREADING
+	// given
+	UA_NodeStoreStatistics stats;
+	UA_NodeStore *ns = UA_NodeStore_new();
+	UA_NodeStore *other = UA_NodeStore_new();
+	UA_NodeStore_insert(other, createNode(other, 1, 1));
+
+	// when
+	for(UA_Int32 i = 1; i <= 1000; i++)
+		UA_NodeStore_insert(ns, createNode(ns, 1, i));
+	UA_NodeStore_getStatistics(ns, UA_NODECLASS_VARIABLE, &stats);
+
+	// then
+	ck_assert_uint_eq(stats.nodes, 1000);
+	ck_assert_uint_ge(stats.capacity, stats.nodes);
+	ck_assert_uint_gt(stats.slabs, 1);
+	ck_assert_uint_ge(stats.bytes, 1000 * sizeof(UA_VariableNode));
+	UA_NodeStore_getStatistics(ns, UA_NODECLASS_OBJECT, &stats);
+	ck_assert_uint_eq(stats.nodes, 0);
+
+	// and the other nodestore counts only its own nodes
+	UA_NodeStore_getStatistics(other, UA_NODECLASS_VARIABLE, &stats);
+	ck_assert_uint_eq(stats.nodes, 1);
+	ck_assert_uint_eq(stats.slabs, 1);
+
+	// and the slabs are released with the nodes, except for one spare
+	for(UA_Int32 i = 1; i <= 1000; i++) {
+		UA_NodeId id = UA_NODEID_NUMERIC(1, (UA_UInt32)i);
+		UA_NodeStore_remove(ns, &id);
+	}
+	UA_NodeStore_getStatistics(ns, UA_NODECLASS_VARIABLE, &stats);
+	ck_assert_uint_eq(stats.nodes, 0);
+	ck_assert_uint_eq(stats.slabs, 1);
+
+	// and the spare slab is reused at the slab boundary
+	for(size_t i = 0; i < 10; i++) {
+		UA_Node *n = UA_NodeStore_newNode(ns, UA_NODECLASS_VARIABLE);
+		UA_NodeStore_deleteNode(ns, n);
+	}
+	UA_NodeStore_getStatistics(ns, UA_NODECLASS_VARIABLE, &stats);
+	ck_assert_uint_eq(stats.slabs, 1);
+	ck_assert_int_eq(UA_NodeStore_getStatistics(ns, (UA_NodeClass)3, &stats),
+	                 UA_STATUSCODE_BADNODECLASSINVALID);
+	UA_NodeStore_delete(ns);
+	UA_NodeStore_delete(other);
+#endif
+}
+END_TEST
+
+START_TEST(equalStringsShallBeStoredOnce) {
+#ifndef UA_ENABLE_MULTITHREADING
+	// given
+	UA_NodeStore *ns = UA_NodeStore_new();
+	UA_InternTable *interned = UA_NodeStore_internTable(ns);
+	UA_Node* n1 = createNode(ns, 1, 1);
+	n1->browseName = UA_QUALIFIEDNAME_ALLOC(1, "Temperature");
+	UA_Node* n2 = (UA_Node *)UA_NodeStore_newVariableNode(ns);
+	n2->nodeId = UA_NODEID_STRING_ALLOC(1, "Temperature");
+	n2->browseName = UA_QUALIFIEDNAME_ALLOC(1, "Temperature");
+
+	// when
+	UA_NodeStore_insert(ns, n1);
+	UA_NodeStore_insert(ns, n2);
+
+	// then
+	ck_assert_uint_eq(UA_InternTable_count(interned), 1);
+	ck_assert_ptr_eq(n1->browseName.name.data, n2->browseName.name.data);
+	ck_assert_ptr_eq(n2->nodeId.identifier.string.data, n2->browseName.name.data);
+	UA_NodeId id2 = UA_NODEID_STRING(1, "Temperature");
+	ck_assert_ptr_eq(UA_NodeStore_get(ns, &id2), n2);
+
+	// and every nodestore has its own table
+	UA_NodeStore *other = UA_NodeStore_new();
+	UA_Node* n3 = createNode(other, 1, 1);
+	n3->browseName = UA_QUALIFIEDNAME_ALLOC(1, "Temperature");
+	UA_NodeStore_insert(other, n3);
+	ck_assert_uint_eq(UA_InternTable_count(UA_NodeStore_internTable(other)), 1);
+	ck_assert_ptr_ne(n3->browseName.name.data, n1->browseName.name.data);
+	UA_NodeStore_delete(other);
+	ck_assert_uint_eq(UA_InternTable_count(interned), 1);
+
+	// and the references added to an edited copy are interned once
+	UA_Node *copy = UA_NodeStore_getCopy(ns, &id2);
+	UA_NodeId organizes = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+	UA_ExpandedNodeId target = UA_EXPANDEDNODEID_STRING(1, "Temperature");
+	ck_assert_int_eq(UA_Node_addReference(copy, &organizes, &target, false, interned),
+	                 UA_STATUSCODE_GOOD);
+	ck_assert_int_eq(UA_NodeStore_replace(ns, copy), UA_STATUSCODE_GOOD);
+	ck_assert_uint_eq(UA_InternTable_count(interned), 1);
+	ck_assert_ptr_eq(copy->references->targetIds[0].nodeId.identifier.string.data,
+	                 n1->browseName.name.data);
+
+	// and the string outlives the removal of one node
+	UA_NodeId id1 = UA_NODEID_NUMERIC(1, 1);
+	UA_NodeStore_remove(ns, &id1);
+	UA_String expected = UA_STRING("Temperature");
+	ck_assert(UA_String_equal(&copy->browseName.name, &expected));
+	ck_assert(UA_String_equal(&copy->references->targetIds[0].nodeId.identifier.string, &expected));
+	UA_NodeStore_remove(ns, &id2);
+	ck_assert_uint_eq(UA_InternTable_count(interned), 0);
+	UA_NodeStore_delete(ns);
+#endif
+}
+END_TEST
+
 /************************************/
 /* Performance Profiling Test Cases */
 /************************************/
@@ -299,7 +878,7 @@ START_TEST(profileGetDelete) {
 	UA_NodeStore *ns = UA_NodeStore_new();
 	UA_Node *n;
 	for (int i=0; i<N; i++) {
-		n = createNode(0,i);
+		n = createNode(ns, 0,i);
         UA_NodeStore_insert(ns, n);
 	}
 	clock_t begin, end;
@@ -346,17 +925,37 @@ static Suite * namespace_suite (void) {
 	tcase_add_test (tc_find, findNodeInExpandedNamespace);
 	tcase_add_test (tc_find, failToFindNonExistantNodeInUA_NodeStoreWithSeveralEntries);
 	tcase_add_test (tc_find, failToFindNodeInOtherUA_NodeStore);
+	tcase_add_test (tc_find, assignedIdentifiersShallFollowTheStoredNodes);
 	suite_add_tcase (s, tc_find);
 
 	TCase *tc_replace = tcase_create("Replace");
 	tcase_add_test (tc_replace, replaceExistingNode);
 	tcase_add_test (tc_replace, replaceOldNode);
+	tcase_add_test (tc_replace, overlayLinkedStaticNodes);
+	tcase_add_test (tc_replace, laterStaticLayersShallOverrideNodes);
+	tcase_add_test (tc_replace, snapshotShallRestoreNodes);
+	tcase_add_test (tc_replace, snapshotShallRejectInvalidImages);
 	suite_add_tcase (s, tc_replace);
 
 	TCase* tc_iterate = tcase_create ("Iterate");
 	tcase_add_test (tc_iterate, iterateOverUA_NodeStoreShallNotVisitEmptyNodes);
 	tcase_add_test (tc_iterate, iterateOverExpandedNamespaceShallNotVisitEmptyNodes);
+	tcase_add_test (tc_iterate, iterateInPartitionsShallVisitEveryNodeOnce);
 	suite_add_tcase (s, tc_iterate);
+
+	TCase* tc_remove = tcase_create ("Remove");
+	tcase_add_test (tc_remove, findNodesAfterRemovingOtherNodes);
+	tcase_add_test (tc_remove, findNodesInDenseAndSparseRanges);
+	suite_add_tcase (s, tc_remove);
+
+	TCase* tc_references = tcase_create ("References");
+	tcase_add_test (tc_references, referencesShallBeGroupedByType);
+	suite_add_tcase (s, tc_references);
+
+	TCase* tc_statistics = tcase_create ("Statistics");
+	tcase_add_test (tc_statistics, statisticsShallCountNodesPerNodeClass);
+	tcase_add_test (tc_statistics, equalStringsShallBeStoredOnce);
+	suite_add_tcase (s, tc_statistics);
 	
 	/* TCase* tc_profile = tcase_create ("Profile"); */
 	/* tcase_add_test (tc_profile, profileGetDelete); */
@@ -121,8 +121,8 @@ static UA_Server* makeTestSequence(void) {
 	return server;
 }
 
-static UA_VariableNode* makeCompareSequence(void) {
-	UA_VariableNode *node = UA_NodeStore_newVariableNode();
+static UA_VariableNode* makeCompareSequence(UA_Server *server) {
+	UA_VariableNode *node = UA_NodeStore_newVariableNode(server->nodestore);
 
 	UA_Int32 myInteger = 42;
 	UA_Variant_setScalarCopy(&node->value.variant.value, &myInteger, &UA_TYPES[UA_TYPES_INT32]);
@@ -254,15 +254,15 @@ START_TEST(ReadSingleAttributeDisplayNameWithoutTimestamp) {
     Service_Read_single(server, &adminSession, UA_TIMESTAMPSTORETURN_NEITHER, &rReq.nodesToRead[0], &resp);
     UA_LocalizedText* respval = (UA_LocalizedText*) resp.value.data;
     const UA_LocalizedText comp = UA_LOCALIZEDTEXT("locale", "the answer");
-    UA_VariableNode* compNode = makeCompareSequence();
+    UA_VariableNode* compNode = makeCompareSequence(server);
     ck_assert_int_eq(0, resp.value.arrayLength);
     ck_assert_ptr_eq(&UA_TYPES[UA_TYPES_LOCALIZEDTEXT], resp.value.type);
     ck_assert(UA_String_equal(&comp.text, &respval->text));
     ck_assert(UA_String_equal(&compNode->displayName.locale, &respval->locale));
-    UA_Server_delete(server);
     UA_ReadRequest_deleteMembers(&rReq);
     UA_DataValue_deleteMembers(&resp);
-    UA_NodeStore_deleteNode((UA_Node*)compNode);
+    UA_NodeStore_deleteNode(server->nodestore, (UA_Node*)compNode);
+    UA_Server_delete(server);
 } END_TEST
 
 START_TEST(ReadSingleAttributeDescriptionWithoutTimestamp) {
@@ -277,14 +277,14 @@ START_TEST(ReadSingleAttributeDescriptionWithoutTimestamp) {
     rReq.nodesToRead[0].attributeId = UA_ATTRIBUTEID_DESCRIPTION;
     Service_Read_single(server, &adminSession, UA_TIMESTAMPSTORETURN_NEITHER, &rReq.nodesToRead[0], &resp);
     UA_LocalizedText* respval = (UA_LocalizedText*) resp.value.data;
-    UA_VariableNode* compNode = makeCompareSequence();
+    UA_VariableNode* compNode = makeCompareSequence(server);
     ck_assert_int_eq(0, resp.value.arrayLength);
     ck_assert_ptr_eq(&UA_TYPES[UA_TYPES_LOCALIZEDTEXT], resp.value.type);
     ck_assert(UA_String_equal(&compNode->description.locale, &respval->locale));
     ck_assert(UA_String_equal(&compNode->description.text, &respval->text));
     UA_ReadRequest_deleteMembers(&rReq);
     UA_DataValue_deleteMembers(&resp);
-    UA_NodeStore_deleteNode((UA_Node*)compNode);
+    UA_NodeStore_deleteNode(server->nodestore, (UA_Node*)compNode);
     UA_Server_delete(server);
 } END_TEST
 
@@ -538,14 +538,14 @@ START_TEST(ReadSingleAttributeMinimumSamplingIntervalWithoutTimestamp) {
     rReq.nodesToRead[0].attributeId = UA_ATTRIBUTEID_MINIMUMSAMPLINGINTERVAL;
     Service_Read_single(server, &adminSession, UA_TIMESTAMPSTORETURN_NEITHER, &rReq.nodesToRead[0], &resp);
     UA_Double* respval = (UA_Double*) resp.value.data;
-    UA_VariableNode *compNode = makeCompareSequence();
+    UA_VariableNode *compNode = makeCompareSequence(server);
     UA_Double comp = (UA_Double) compNode->minimumSamplingInterval;
     ck_assert_int_eq(0, resp.value.arrayLength);
     ck_assert_ptr_eq(&UA_TYPES[UA_TYPES_DOUBLE], resp.value.type);
     ck_assert(*respval == comp);
     UA_DataValue_deleteMembers(&resp);
     UA_ReadRequest_deleteMembers(&rReq);
-    UA_NodeStore_deleteNode((UA_Node*)compNode);
+    UA_NodeStore_deleteNode(server->nodestore, (UA_Node*)compNode);
     UA_Server_delete(server);
 } END_TEST
 
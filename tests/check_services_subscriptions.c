@@ -0,0 +1,732 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+#include "server/ua_services.h"
+#include "server/ua_server_internal.h"
+#include "server/ua_subscription.h"
+#include "ua_nodeids.h"
+#include "ua_types.h"
+#include "ua_types_encoding_binary.h"
+#include "ua_config_standard.h"
+
+static UA_Int32 readCounter;
+
+static UA_StatusCode
+readCount(void *handle, const UA_NodeId nodeid, UA_Boolean sourceTimeStamp,
+          const UA_NumericRange *range, UA_DataValue *dataValue) {
+    readCounter++;
+    UA_Variant_setScalarCopy(&dataValue->value, &readCounter, &UA_TYPES[UA_TYPES_INT32]);
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_Server *
+makeTestServer(void) {
+    UA_Server *server = UA_Server_new(UA_ServerConfig_standard);
+
+    UA_VariableAttributes vattr;
+    UA_VariableAttributes_init(&vattr);
+    UA_Int32 myInteger = 42;
+    UA_Variant_setScalar(&vattr.value, &myInteger, &UA_TYPES[UA_TYPES_INT32]);
+    vattr.displayName = UA_LOCALIZEDTEXT("locale","the answer");
+    UA_Server_addVariableNode(server, UA_NODEID_STRING(1, "the.answer"),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                              UA_QUALIFIEDNAME(1, "the answer"), UA_NODEID_NULL,
+                              vattr, NULL, NULL);
+
+    UA_VariableAttributes_init(&vattr);
+    vattr.displayName = UA_LOCALIZEDTEXT("locale","counter");
+    UA_DataSource counterDataSource = (UA_DataSource) {.handle = NULL, .read = readCount, .write = NULL};
+    UA_Server_addDataSourceVariableNode(server, UA_NODEID_STRING(1, "counter"),
+                                        UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                        UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                        UA_QUALIFIEDNAME(1, "counter"), UA_NODEID_NULL,
+                                        vattr, counterDataSource, NULL);
+
+    /* an analog item with an engineering unit range */
+    UA_VariableAttributes_init(&vattr);
+    UA_Double temperature = 20.0;
+    UA_Variant_setScalar(&vattr.value, &temperature, &UA_TYPES[UA_TYPES_DOUBLE]);
+    vattr.displayName = UA_LOCALIZEDTEXT("locale","temperature");
+    UA_Server_addVariableNode(server, UA_NODEID_STRING(1, "temperature"),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                              UA_QUALIFIEDNAME(1, "temperature"), UA_NODEID_NULL,
+                              vattr, NULL, NULL);
+    UA_VariableAttributes_init(&vattr);
+    UA_Range range = {.low = 0.0, .high = 200.0};
+    UA_Variant_setScalar(&vattr.value, &range, &UA_TYPES[UA_TYPES_RANGE]);
+    vattr.displayName = UA_LOCALIZEDTEXT("locale","EURange");
+    UA_Server_addVariableNode(server, UA_NODEID_STRING(1, "temperature.EURange"),
+                              UA_NODEID_STRING(1, "temperature"),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_HASPROPERTY),
+                              UA_QUALIFIEDNAME(0, "EURange"), UA_NODEID_NULL,
+                              vattr, NULL, NULL);
+    return server;
+}
+
+static UA_Subscription *
+createSubscription(UA_Server *server, UA_Session *session) {
+    UA_CreateSubscriptionRequest request;
+    UA_CreateSubscriptionRequest_init(&request);
+    request.requestedPublishingInterval = 100;
+    request.requestedLifetimeCount = 100;
+    request.requestedMaxKeepAliveCount = 10;
+    request.publishingEnabled = true;
+    UA_CreateSubscriptionResponse response;
+    UA_CreateSubscriptionResponse_init(&response);
+    Service_CreateSubscription(server, session, &request, &response);
+    UA_Subscription *sub = UA_Session_getSubscriptionByID(session, response.subscriptionId);
+    UA_CreateSubscriptionResponse_deleteMembers(&response);
+    return sub;
+}
+
+static UA_StatusCode
+createFilteredItem(UA_Server *server, UA_Session *session, UA_Subscription *sub,
+                   const UA_NodeId nodeId, UA_Double samplingInterval, UA_UInt32 queueSize,
+                   UA_DataChangeFilter *filter, UA_MonitoredItem **mon) {
+    UA_MonitoredItemCreateRequest item;
+    UA_MonitoredItemCreateRequest_init(&item);
+    item.itemToMonitor.nodeId = nodeId;
+    item.itemToMonitor.attributeId = UA_ATTRIBUTEID_VALUE;
+    item.monitoringMode = UA_MONITORINGMODE_REPORTING;
+    item.requestedParameters.samplingInterval = samplingInterval;
+    item.requestedParameters.queueSize = queueSize;
+    item.requestedParameters.discardOldest = true;
+    if(filter) {
+        item.requestedParameters.filter.encoding = UA_EXTENSIONOBJECT_DECODED_NODELETE;
+        item.requestedParameters.filter.content.decoded.type = &UA_TYPES[UA_TYPES_DATACHANGEFILTER];
+        item.requestedParameters.filter.content.decoded.data = filter;
+    }
+
+    UA_CreateMonitoredItemsRequest request;
+    UA_CreateMonitoredItemsRequest_init(&request);
+    request.subscriptionId = sub->subscriptionID;
+    request.itemsToCreate = &item;
+    request.itemsToCreateSize = 1;
+    UA_CreateMonitoredItemsResponse response;
+    UA_CreateMonitoredItemsResponse_init(&response);
+    Service_CreateMonitoredItems(server, session, &request, &response);
+    ck_assert_uint_eq(response.resultsSize, 1);
+    UA_StatusCode retval = response.results[0].statusCode;
+    UA_UInt32 itemId = response.results[0].monitoredItemId;
+    UA_CreateMonitoredItemsResponse_deleteMembers(&response);
+
+    LIST_FOREACH(*mon, &sub->MonitoredItems, listEntry) {
+        if((*mon)->itemId == itemId)
+            break;
+    }
+    return retval;
+}
+
+static UA_MonitoredItem *
+createMonitoredItem(UA_Server *server, UA_Session *session, UA_Subscription *sub,
+                    const UA_NodeId nodeId, UA_Double samplingInterval, UA_UInt32 queueSize) {
+    UA_MonitoredItem *mon;
+    ck_assert_uint_eq(createFilteredItem(server, session, sub, nodeId, samplingInterval,
+                                         queueSize, NULL, &mon), UA_STATUSCODE_GOOD);
+    return mon;
+}
+
+static void
+writeInteger(UA_Server *server, const UA_NodeId nodeId, UA_Int32 value) {
+    UA_Variant v;
+    UA_Variant_setScalar(&v, &value, &UA_TYPES[UA_TYPES_INT32]);
+    ck_assert_uint_eq(UA_Server_writeValue(server, nodeId, v), UA_STATUSCODE_GOOD);
+}
+
+/* The notification message as the client decodes it */
+static void
+decodeNotification(const UA_unpublishedNotification *msg, UA_NotificationMessage *decoded) {
+    UA_ByteString buf;
+    ck_assert_uint_eq(UA_ByteString_allocBuffer(&buf, 65536), UA_STATUSCODE_GOOD);
+    size_t offset = 0;
+    ck_assert_uint_eq(UA_encodeBinary(&msg->notification, &UA_TYPES[UA_TYPES_NOTIFICATIONMESSAGE],
+                                      &buf, &offset), UA_STATUSCODE_GOOD);
+    buf.length = offset;
+    offset = 0;
+    ck_assert_uint_eq(UA_decodeBinary(&buf, &offset, decoded, &UA_TYPES[UA_TYPES_NOTIFICATIONMESSAGE],
+                                      0, NULL), UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(offset, buf.length);
+    UA_ByteString_deleteMembers(&buf);
+    ck_assert_uint_eq(decoded->notificationDataSize, 1);
+    ck_assert_ptr_eq(decoded->notificationData[0].content.decoded.type,
+                     &UA_TYPES[UA_TYPES_DATACHANGENOTIFICATION]);
+}
+
+START_TEST(WrittenItemsAreSampled) {
+    UA_Server *server = makeTestServer();
+    UA_Session session;
+    UA_Session_init(&session);
+    UA_Subscription *sub = createSubscription(server, &session);
+    ck_assert_ptr_ne(sub, NULL);
+    UA_NodeId nodeId = UA_NODEID_STRING(1, "the.answer");
+    UA_MonitoredItem *mon = createMonitoredItem(server, &session, sub, nodeId, 100, 10);
+    ck_assert_ptr_ne(mon, NULL);
+    ck_assert_ptr_eq(mon->samplingGroup, NULL);
+
+    /* the initial value */
+    ck_assert_uint_eq(mon->queueSize.current, 1);
+
+    /* an unchanged value is not sampled again */
+    MonitoredItem_QueuePushDataValue(server, mon);
+    ck_assert_uint_eq(mon->queueSize.current, 1);
+
+    /* a write is sampled at once */
+    writeInteger(server, nodeId, 43);
+    ck_assert_uint_eq(mon->queueSize.current, 2);
+    UA_MonitoredSample *latest = MONITOREDITEM_QUEUED(mon, mon->queueSize.current - 1);
+    ck_assert_int_eq(*(UA_Int32*)latest->value.value.data, 43);
+
+    /* writing the same value does not add a sample */
+    writeInteger(server, nodeId, 43);
+    ck_assert_uint_eq(mon->queueSize.current, 2);
+
+    UA_Session_deleteMembersCleanup(&session, server);
+    UA_Server_delete(server);
+}
+END_TEST
+
+START_TEST(DataSourceItemsArePolled) {
+    UA_Server *server = makeTestServer();
+    UA_Session session;
+    UA_Session_init(&session);
+    UA_Subscription *sub = createSubscription(server, &session);
+    UA_MonitoredItem *mon = createMonitoredItem(server, &session, sub,
+                                                UA_NODEID_STRING(1, "counter"), 100, 10);
+    ck_assert_ptr_ne(mon, NULL);
+    ck_assert_ptr_ne(mon->samplingGroup, NULL);
+
+    UA_Int32 reads = readCounter;
+    MonitoredItem_QueuePushDataValue(server, mon);
+    ck_assert_int_gt(readCounter, reads);
+    ck_assert_uint_eq(mon->queueSize.current, 2);
+
+    UA_Session_deleteMembersCleanup(&session, server);
+    UA_Server_delete(server);
+}
+END_TEST
+
+START_TEST(DeletedItemsAreNotNotified) {
+    UA_Server *server = makeTestServer();
+    UA_Session session;
+    UA_Session_init(&session);
+    UA_Subscription *sub = createSubscription(server, &session);
+    UA_NodeId nodeId = UA_NODEID_STRING(1, "the.answer");
+    UA_MonitoredItem *first = createMonitoredItem(server, &session, sub, nodeId, 100, 10);
+    UA_MonitoredItem *second = createMonitoredItem(server, &session, sub, nodeId, 100, 10);
+    ck_assert_ptr_eq(first->monitoredNode, second->monitoredNode);
+
+    ck_assert_uint_eq(UA_Session_deleteMonitoredItem(server, &session, sub->subscriptionID,
+                                                     first->itemId), UA_STATUSCODE_GOOD);
+    writeInteger(server, nodeId, 44);
+    ck_assert_uint_eq(second->queueSize.current, 2);
+    ck_assert_uint_eq(sub->pendingSamples, 2);
+
+    /* the node is no longer monitored */
+    ck_assert_uint_eq(UA_Session_deleteSubscription(server, &session, sub->subscriptionID),
+                      UA_STATUSCODE_GOOD);
+    writeInteger(server, nodeId, 45);
+
+    UA_Session_deleteMembersCleanup(&session, server);
+    UA_Server_delete(server);
+}
+END_TEST
+
+START_TEST(FullQueueDiscardsOldest) {
+    UA_Server *server = makeTestServer();
+    UA_Session session;
+    UA_Session_init(&session);
+    UA_Subscription *sub = createSubscription(server, &session);
+    UA_NodeId nodeId = UA_NODEID_STRING(1, "the.answer");
+    UA_MonitoredItem *mon = createMonitoredItem(server, &session, sub, nodeId, 100, 2);
+    UA_UInt32 capacity = mon->queueSize.max;
+
+    for(UA_Int32 i = 0; i < 5; i++)
+        writeInteger(server, nodeId, 100 + i);
+    ck_assert_uint_eq(mon->queueSize.current, capacity);
+    ck_assert_uint_eq(sub->pendingSamples, capacity);
+    ck_assert_ptr_eq(TAILQ_FIRST(&sub->pendingItems), mon);
+
+    /* the notification holds the newest samples, the oldest first */
+    Subscription_updateNotifications(server, sub);
+    ck_assert_uint_eq(mon->queueSize.current, 0);
+    ck_assert_uint_eq(sub->pendingSamples, 0);
+    ck_assert(TAILQ_EMPTY(&sub->pendingItems));
+    UA_unpublishedNotification *msg = Subscription_getNotification(sub, sub->sequenceNumber - 1);
+    ck_assert_ptr_ne(msg, NULL);
+    UA_NotificationMessage decoded;
+    decodeNotification(msg, &decoded);
+    UA_DataChangeNotification *dcn = decoded.notificationData[0].content.decoded.data;
+    ck_assert_uint_eq(dcn->monitoredItemsSize, capacity);
+    for(size_t i = 0; i < capacity; i++) {
+        UA_Int32 expected = 105 - (UA_Int32)capacity + (UA_Int32)i;
+        ck_assert_int_eq(*(UA_Int32*)dcn->monitoredItems[i].value.value.data, expected);
+    }
+    UA_NotificationMessage_deleteMembers(&decoded);
+
+    UA_Session_deleteMembersCleanup(&session, server);
+    UA_Server_delete(server);
+}
+END_TEST
+
+START_TEST(SamplesAreEncodedOnce) {
+    UA_Server *server = makeTestServer();
+    UA_Session session;
+    UA_Session_init(&session);
+    UA_Subscription *sub = createSubscription(server, &session);
+    UA_Subscription *other = createSubscription(server, &session);
+    UA_NodeId nodeId = UA_NODEID_STRING(1, "the.answer");
+    UA_MonitoredItem *first = createMonitoredItem(server, &session, sub, nodeId, 100, 10);
+    UA_MonitoredItem *second = createMonitoredItem(server, &session, other, nodeId, 100, 10);
+    first->clientHandle = 1;
+    second->clientHandle = 2;
+    writeInteger(server, nodeId, 43);
+    ck_assert_ptr_eq(MONITOREDITEM_QUEUED(first, 1), MONITOREDITEM_QUEUED(second, 1));
+
+    /* only the client handles differ */
+    Subscription_updateNotifications(server, sub);
+    Subscription_updateNotifications(server, other);
+    UA_NotificationMessage decoded;
+    decodeNotification(Subscription_getNotification(other, other->sequenceNumber - 1), &decoded);
+    UA_DataChangeNotification *dcn = decoded.notificationData[0].content.decoded.data;
+    ck_assert_uint_eq(dcn->monitoredItemsSize, 2);
+    ck_assert_uint_eq(dcn->monitoredItems[1].clientHandle, 2);
+    ck_assert_int_eq(*(UA_Int32*)dcn->monitoredItems[1].value.value.data, 43);
+    ck_assert(dcn->monitoredItems[1].value.hasServerTimestamp);
+    UA_NotificationMessage_deleteMembers(&decoded);
+
+    UA_Session_deleteMembersCleanup(&session, server);
+    UA_Server_delete(server);
+}
+END_TEST
+
+START_TEST(PolledItemsShareSamplingGroups) {
+    UA_Server *server = makeTestServer();
+    UA_Session session;
+    UA_Session_init(&session);
+    UA_Subscription *sub = createSubscription(server, &session);
+    UA_Subscription *other = createSubscription(server, &session);
+    UA_NodeId nodeId = UA_NODEID_STRING(1, "counter");
+    UA_MonitoredItem *first = createMonitoredItem(server, &session, sub, nodeId, 100, 10);
+    UA_MonitoredItem *second = createMonitoredItem(server, &session, other, nodeId, 100, 10);
+    UA_MonitoredItem *faster = createMonitoredItem(server, &session, other, nodeId, 50, 10);
+    ck_assert_ptr_ne(first->samplingGroup, NULL);
+    ck_assert_ptr_eq(first->samplingGroup, second->samplingGroup);
+    ck_assert_ptr_ne(first->samplingGroup, faster->samplingGroup);
+
+    /* the group outlives the deleted subscription */
+    ck_assert_uint_eq(UA_Session_deleteSubscription(server, &session, sub->subscriptionID),
+                      UA_STATUSCODE_GOOD);
+    ck_assert_ptr_ne(second->samplingGroup, NULL);
+    UA_Int32 reads = readCounter;
+    MonitoredItem_QueuePushDataValue(server, second);
+    ck_assert_int_gt(readCounter, reads);
+
+    UA_Session_deleteMembersCleanup(&session, server);
+    UA_Server_delete(server);
+}
+END_TEST
+
+START_TEST(SharedNodesAreReadOnce) {
+    UA_Server *server = makeTestServer();
+    UA_Session session;
+    UA_Session_init(&session);
+    UA_Subscription *sub = createSubscription(server, &session);
+    UA_Subscription *other = createSubscription(server, &session);
+    UA_NodeId nodeId = UA_NODEID_STRING(1, "counter");
+    UA_MonitoredItem *first = createMonitoredItem(server, &session, sub, nodeId, 5, 100);
+    UA_MonitoredItem *second = createMonitoredItem(server, &session, other, nodeId, 5, 100);
+    UA_UInt32 firstQueued = first->queueSize.current;
+    UA_UInt32 secondQueued = second->queueSize.current;
+
+    /* run the sampling job a few times, well within the publishing interval */
+    UA_Int32 reads = readCounter;
+    UA_DateTime end = UA_DateTime_nowMonotonic() + 30 * UA_MSEC_TO_DATETIME;
+    while(UA_DateTime_nowMonotonic() < end)
+        UA_Server_run_iterate(server, false);
+    UA_Int32 samples = readCounter - reads;
+    ck_assert_int_gt(samples, 0);
+
+    /* every read of the data source reached both items */
+    ck_assert_uint_eq(first->queueSize.current - firstQueued, (UA_UInt32)samples);
+    ck_assert_uint_eq(second->queueSize.current - secondQueued, (UA_UInt32)samples);
+
+    UA_Session_deleteMembersCleanup(&session, server);
+    UA_Server_delete(server);
+}
+END_TEST
+
+static void
+writeDouble(UA_Server *server, const UA_NodeId nodeId, UA_Double value) {
+    UA_Variant v;
+    UA_Variant_setScalar(&v, &value, &UA_TYPES[UA_TYPES_DOUBLE]);
+    ck_assert_uint_eq(UA_Server_writeValue(server, nodeId, v), UA_STATUSCODE_GOOD);
+}
+
+START_TEST(AbsoluteDeadbandFiltersSmallChanges) {
+    UA_Server *server = makeTestServer();
+    UA_Session session;
+    UA_Session_init(&session);
+    UA_Subscription *sub = createSubscription(server, &session);
+    UA_NodeId nodeId = UA_NODEID_STRING(1, "temperature");
+    UA_DataChangeFilter filter;
+    UA_DataChangeFilter_init(&filter);
+    filter.trigger = UA_DATACHANGETRIGGER_STATUSVALUE;
+    filter.deadbandType = UA_DEADBANDTYPE_ABSOLUTE;
+    filter.deadbandValue = 0.5;
+    UA_MonitoredItem *mon;
+    ck_assert_uint_eq(createFilteredItem(server, &session, sub, nodeId, 100, 10, &filter, &mon),
+                      UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(mon->queueSize.current, 1);
+
+    /* compared with the last queued value, not with the last write */
+    writeDouble(server, nodeId, 20.3);
+    ck_assert_uint_eq(mon->queueSize.current, 1);
+    writeDouble(server, nodeId, 20.6);
+    ck_assert_uint_eq(mon->queueSize.current, 2);
+    writeDouble(server, nodeId, 20.9);
+    ck_assert_uint_eq(mon->queueSize.current, 2);
+    writeDouble(server, nodeId, 20.0);
+    ck_assert_uint_eq(mon->queueSize.current, 3);
+
+    UA_Session_deleteMembersCleanup(&session, server);
+    UA_Server_delete(server);
+}
+END_TEST
+
+START_TEST(PercentDeadbandUsesEURange) {
+    UA_Server *server = makeTestServer();
+    UA_Session session;
+    UA_Session_init(&session);
+    UA_Subscription *sub = createSubscription(server, &session);
+    UA_NodeId nodeId = UA_NODEID_STRING(1, "temperature");
+    UA_DataChangeFilter filter;
+    UA_DataChangeFilter_init(&filter);
+    filter.trigger = UA_DATACHANGETRIGGER_STATUSVALUE;
+    filter.deadbandType = UA_DEADBANDTYPE_PERCENT;
+    filter.deadbandValue = 1.0;
+    UA_MonitoredItem *mon;
+    ck_assert_uint_eq(createFilteredItem(server, &session, sub, nodeId, 100, 10, &filter, &mon),
+                      UA_STATUSCODE_GOOD);
+    ck_assert(mon->deadband > 1.99 && mon->deadband < 2.01);
+    writeDouble(server, nodeId, 21.0);
+    ck_assert_uint_eq(mon->queueSize.current, 1);
+    writeDouble(server, nodeId, 23.0);
+    ck_assert_uint_eq(mon->queueSize.current, 2);
+
+    /* without an EURange */
+    ck_assert_uint_eq(createFilteredItem(server, &session, sub, UA_NODEID_STRING(1, "the.answer"),
+                                         100, 10, &filter, &mon), UA_STATUSCODE_BADFILTERNOTALLOWED);
+
+    UA_Session_deleteMembersCleanup(&session, server);
+    UA_Server_delete(server);
+}
+END_TEST
+
+START_TEST(StatusTriggerIgnoresValues) {
+    UA_Server *server = makeTestServer();
+    UA_Session session;
+    UA_Session_init(&session);
+    UA_Subscription *sub = createSubscription(server, &session);
+    UA_NodeId nodeId = UA_NODEID_STRING(1, "the.answer");
+    UA_DataChangeFilter filter;
+    UA_DataChangeFilter_init(&filter);
+    filter.trigger = UA_DATACHANGETRIGGER_STATUS;
+    UA_MonitoredItem *mon;
+    ck_assert_uint_eq(createFilteredItem(server, &session, sub, nodeId, 100, 10, &filter, &mon),
+                      UA_STATUSCODE_GOOD);
+    writeInteger(server, nodeId, 43);
+    ck_assert_uint_eq(mon->queueSize.current, 1);
+
+    UA_Session_deleteMembersCleanup(&session, server);
+    UA_Server_delete(server);
+}
+END_TEST
+
+static void
+publish(UA_Server *server, UA_Session *session, UA_UInt32 timeoutHint) {
+    UA_PublishRequest request;
+    UA_PublishRequest_init(&request);
+    request.requestHeader.timeoutHint = timeoutHint;
+    Service_Publish(server, session, &request, 0);
+}
+
+START_TEST(PublishRequestsAreQueued) {
+    UA_Server *server = makeTestServer();
+    UA_Session session;
+    UA_Session_init(&session);
+
+    /* answered right away without a subscription */
+    publish(server, &session, 0);
+    ck_assert_uint_eq(session.responseQueueSize, 0);
+
+    /* nothing to send yet */
+    UA_Subscription *sub = createSubscription(server, &session);
+    publish(server, &session, 0);
+    publish(server, &session, 0);
+    ck_assert_uint_eq(session.responseQueueSize, 2);
+
+    /* the initial value answers one request */
+    createMonitoredItem(server, &session, sub, UA_NODEID_STRING(1, "the.answer"), 100, 10);
+    Subscription_updateNotifications(server, sub);
+    ck_assert(Subscription_publish(server, sub));
+    ck_assert(!Subscription_publish(server, sub));
+    ck_assert_uint_eq(session.responseQueueSize, 1);
+
+    /* a keep-alive after the max keepalive count of empty intervals */
+    for(UA_UInt32 i = 1; i < sub->keepAliveCount.current; i++)
+        Subscription_updateNotifications(server, sub);
+    ck_assert(!Subscription_publish(server, sub));
+    Subscription_updateNotifications(server, sub);
+    ck_assert(Subscription_publish(server, sub));
+    ck_assert_uint_eq(session.responseQueueSize, 0);
+
+    UA_Session_deleteMembersCleanup(&session, server);
+    UA_Server_delete(server);
+}
+END_TEST
+
+START_TEST(LateSubscriptionsAnswerRightAway) {
+    UA_Server *server = makeTestServer();
+    UA_Session session;
+    UA_Session_init(&session);
+    UA_Subscription *sub = createSubscription(server, &session);
+    createMonitoredItem(server, &session, sub, UA_NODEID_STRING(1, "the.answer"), 100, 10);
+    Subscription_updateNotifications(server, sub);
+    ck_assert(!Subscription_publish(server, sub));
+
+    publish(server, &session, 0);
+    ck_assert_uint_eq(session.responseQueueSize, 0);
+
+    UA_Session_deleteMembersCleanup(&session, server);
+    UA_Server_delete(server);
+}
+END_TEST
+
+START_TEST(PublishRequestsAreLimited) {
+    UA_Server *server = makeTestServer();
+    UA_Session session;
+    UA_Session_init(&session);
+    createSubscription(server, &session);
+    UA_UInt32 max = server->config.maxPublishRequestsPerSession;
+    for(UA_UInt32 i = 0; i < max + 2; i++)
+        publish(server, &session, 0);
+    ck_assert_uint_eq(session.responseQueueSize, max);
+
+    /* requests with a timeout hint expire */
+    publish(server, &session, 1000);
+    ck_assert_uint_eq(session.responseQueueSize, max);
+    UA_Session_expirePublishRequests(&session, UA_DateTime_now() + 2 * UA_SEC_TO_DATETIME);
+    ck_assert_uint_eq(session.responseQueueSize, max - 1);
+
+    UA_Session_deleteMembersCleanup(&session, server);
+    UA_Server_delete(server);
+}
+END_TEST
+
+/* Records the service results of the publish responses sent to the client */
+static UA_StatusCode sentResults[8];
+static size_t sentResultsSize;
+
+static UA_StatusCode
+getSendBuffer(UA_Connection *connection, size_t length, UA_ByteString *buf) {
+    return UA_ByteString_allocBuffer(buf, length);
+}
+
+static void
+releaseSendBuffer(UA_Connection *connection, UA_ByteString *buf) {
+    UA_ByteString_deleteMembers(buf);
+}
+
+static UA_StatusCode
+recordPublishResponse(UA_Connection *connection, UA_ByteString *buf) {
+    size_t offset = 24; // after the headers
+    UA_NodeId typeId;
+    UA_PublishResponse response;
+    ck_assert_uint_eq(UA_decodeBinary(buf, &offset, &typeId, &UA_TYPES[UA_TYPES_NODEID], 0, NULL),
+                      UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(typeId.identifier.numeric,
+                      UA_TYPES[UA_TYPES_PUBLISHRESPONSE].typeId.identifier.numeric + UA_ENCODINGOFFSET_BINARY);
+    ck_assert_uint_eq(UA_decodeBinary(buf, &offset, &response, &UA_TYPES[UA_TYPES_PUBLISHRESPONSE],
+                                      0, NULL), UA_STATUSCODE_GOOD);
+    ck_assert_uint_lt(sentResultsSize, 8);
+    sentResults[sentResultsSize++] = response.responseHeader.serviceResult;
+    UA_PublishResponse_deleteMembers(&response);
+    UA_ByteString_deleteMembers(buf);
+    return UA_STATUSCODE_GOOD;
+}
+
+START_TEST(DeletingTheLastSubscriptionAnswersPublishRequests) {
+    UA_Server *server = makeTestServer();
+    UA_Connection connection;
+    memset(&connection, 0, sizeof(UA_Connection));
+    connection.state = UA_CONNECTION_ESTABLISHED;
+    connection.localConf = UA_ConnectionConfig_standard;
+    connection.remoteConf = UA_ConnectionConfig_standard;
+    connection.getSendBuffer = getSendBuffer;
+    connection.releaseSendBuffer = releaseSendBuffer;
+    connection.send = recordPublishResponse;
+    UA_SecureChannel channel;
+    UA_SecureChannel_init(&channel);
+    channel.connection = &connection;
+    UA_Session session;
+    UA_Session_init(&session);
+    UA_SecureChannel_attachSession(&channel, &session);
+    sentResultsSize = 0;
+
+    UA_Subscription *sub = createSubscription(server, &session);
+    UA_Subscription *other = createSubscription(server, &session);
+    publish(server, &session, 0);
+    publish(server, &session, 0);
+    ck_assert_uint_eq(session.responseQueueSize, 2);
+
+    /* the requests remain queued for the other subscription */
+    ck_assert_uint_eq(UA_Session_deleteSubscription(server, &session, sub->subscriptionID),
+                      UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(session.responseQueueSize, 2);
+    ck_assert_uint_eq(sentResultsSize, 0);
+
+    /* deleting the last subscription answers them */
+    ck_assert_uint_eq(UA_Session_deleteSubscription(server, &session, other->subscriptionID),
+                      UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(session.responseQueueSize, 0);
+    ck_assert_uint_eq(sentResultsSize, 2);
+    ck_assert_uint_eq(sentResults[0], UA_STATUSCODE_BADNOSUBSCRIPTION);
+    ck_assert_uint_eq(sentResults[1], UA_STATUSCODE_BADNOSUBSCRIPTION);
+
+    UA_Session_deleteMembersCleanup(&session, server);
+    UA_SecureChannel_deleteMembersCleanup(&channel);
+    UA_Server_delete(server);
+}
+END_TEST
+
+START_TEST(AcknowledgedNotificationsAreRemoved) {
+    UA_Server *server = makeTestServer();
+    UA_Session session;
+    UA_Session_init(&session);
+    UA_Subscription *sub = createSubscription(server, &session);
+    UA_NodeId nodeId = UA_NODEID_STRING(1, "the.answer");
+    createMonitoredItem(server, &session, sub, nodeId, 100, 10);
+    Subscription_updateNotifications(server, sub);
+    for(UA_Int32 i = 0; i < 3; i++) {
+        writeInteger(server, nodeId, 100 + i);
+        Subscription_updateNotifications(server, sub);
+    }
+    ck_assert_uint_eq(sub->unpublishedNotificationsSize, 4);
+    for(size_t i = 0; i < 3; i++)
+        publish(server, &session, 0);
+    ck_assert_uint_eq(sub->unsentSequenceNumber, 4);
+
+    /* acknowledged out of order */
+    ck_assert_uint_eq(Subscription_acknowledge(server, sub, 2), UA_STATUSCODE_GOOD);
+    ck_assert_ptr_eq(Subscription_getNotification(sub, 2), NULL);
+    ck_assert_uint_eq(Subscription_acknowledge(server, sub, 2), UA_STATUSCODE_BADSEQUENCENUMBERINVALID);
+    ck_assert_uint_eq(sub->firstSequenceNumber, 1);
+    ck_assert_uint_eq(Subscription_acknowledge(server, sub, 1), UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(sub->firstSequenceNumber, 3);
+
+    /* only sent notifications are acknowledged and republished */
+    ck_assert_uint_eq(Subscription_acknowledge(server, sub, 4), UA_STATUSCODE_BADSEQUENCENUMBERINVALID);
+    UA_RepublishRequest request;
+    UA_RepublishRequest_init(&request);
+    request.subscriptionId = sub->subscriptionID;
+    request.retransmitSequenceNumber = 3;
+    UA_RepublishResponse response;
+    UA_RepublishResponse_init(&response);
+    Service_Republish(server, &session, &request, &response);
+    ck_assert_uint_eq(response.responseHeader.serviceResult, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(response.notificationMessage.sequenceNumber, 3);
+    UA_RepublishResponse_deleteMembers(&response);
+    UA_RepublishResponse_init(&response);
+    request.retransmitSequenceNumber = 4;
+    Service_Republish(server, &session, &request, &response);
+    ck_assert_uint_eq(response.responseHeader.serviceResult, UA_STATUSCODE_BADMESSAGENOTAVAILABLE);
+    UA_RepublishResponse_deleteMembers(&response);
+
+    UA_Session_deleteMembersCleanup(&session, server);
+    ck_assert_uint_eq(server->retransmissionBytes, 0);
+    UA_Server_delete(server);
+}
+END_TEST
+
+START_TEST(RetransmissionQueueIsBounded) {
+    UA_Server *server = makeTestServer();
+    server->config.maxRetransmissionQueueBytes = 512;
+    server->config.maxRetransmissionBytes = 768;
+    UA_Session session;
+    UA_Session_init(&session);
+    UA_Subscription *sub = createSubscription(server, &session);
+    UA_Subscription *other = createSubscription(server, &session);
+    UA_NodeId nodeId = UA_NODEID_STRING(1, "the.answer");
+    createMonitoredItem(server, &session, sub, nodeId, 100, 10);
+    createMonitoredItem(server, &session, other, nodeId, 100, 10);
+
+    /* nothing is acknowledged. the oldest notifications are dropped. */
+    for(UA_Int32 i = 0; i < 100; i++) {
+        writeInteger(server, nodeId, i);
+        Subscription_updateNotifications(server, sub);
+        Subscription_updateNotifications(server, other);
+        ck_assert_uint_le(sub->retransmissionQueueBytes, 512);
+        ck_assert_uint_le(server->retransmissionBytes, 768);
+    }
+    ck_assert_uint_eq(server->retransmissionBytes,
+                      sub->retransmissionQueueBytes + other->retransmissionQueueBytes);
+    ck_assert_uint_gt(sub->firstSequenceNumber, 1);
+    ck_assert_uint_le(sub->retransmissionQueueCapacity * sizeof(UA_unpublishedNotification), 512);
+    ck_assert_ptr_ne(Subscription_getNotification(sub, sub->sequenceNumber - 1), NULL);
+    ck_assert_ptr_eq(Subscription_getNotification(sub, sub->firstSequenceNumber - 1), NULL);
+
+    /* the unsent notifications that were dropped are skipped */
+    publish(server, &session, 0);
+    ck_assert(sub->unsentSequenceNumber == sub->firstSequenceNumber + 1 ||
+              other->unsentSequenceNumber == other->firstSequenceNumber + 1);
+
+    UA_Session_deleteMembersCleanup(&session, server);
+    ck_assert_uint_eq(server->retransmissionBytes, 0);
+    UA_Server_delete(server);
+}
+END_TEST
+
+static Suite * testSuite_services_subscriptions(void) {
+    Suite *s = suite_create("services_subscriptions");
+    TCase *tc_monitoredItems = tcase_create("monitoredItems");
+    tcase_add_test(tc_monitoredItems, WrittenItemsAreSampled);
+    tcase_add_test(tc_monitoredItems, DataSourceItemsArePolled);
+    tcase_add_test(tc_monitoredItems, DeletedItemsAreNotNotified);
+    tcase_add_test(tc_monitoredItems, FullQueueDiscardsOldest);
+    tcase_add_test(tc_monitoredItems, SamplesAreEncodedOnce);
+    tcase_add_test(tc_monitoredItems, PolledItemsShareSamplingGroups);
+    tcase_add_test(tc_monitoredItems, SharedNodesAreReadOnce);
+    suite_add_tcase(s, tc_monitoredItems);
+    TCase *tc_filter = tcase_create("filter");
+    tcase_add_test(tc_filter, AbsoluteDeadbandFiltersSmallChanges);
+    tcase_add_test(tc_filter, PercentDeadbandUsesEURange);
+    tcase_add_test(tc_filter, StatusTriggerIgnoresValues);
+    suite_add_tcase(s, tc_filter);
+    TCase *tc_publish = tcase_create("publish");
+    tcase_add_test(tc_publish, PublishRequestsAreQueued);
+    tcase_add_test(tc_publish, LateSubscriptionsAnswerRightAway);
+    tcase_add_test(tc_publish, PublishRequestsAreLimited);
+    tcase_add_test(tc_publish, DeletingTheLastSubscriptionAnswersPublishRequests);
+    suite_add_tcase(s, tc_publish);
+    TCase *tc_retransmission = tcase_create("retransmission");
+    tcase_add_test(tc_retransmission, AcknowledgedNotificationsAreRemoved);
+    tcase_add_test(tc_retransmission, RetransmissionQueueIsBounded);
+    suite_add_tcase(s, tc_retransmission);
+    return s;
+}
+
+int main(void) {
+    int number_failed = 0;
+    Suite *s = testSuite_services_subscriptions();
+    SRunner *sr = srunner_create(s);
+    srunner_set_fork_status(sr, CK_NOFORK);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed += srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -2,6 +2,8 @@
 #include <stdlib.h>
 
 #include "ua_types.h"
+#include "ua_server.h"
+#include "ua_config_standard.h"
 #include "server/ua_services.h"
 #include "check.h"
 
@@ -27,11 +29,69 @@
 }
 END_TEST */
 
+static size_t
+browseObjectsFolder(UA_Server *server, UA_NodeId referenceTypeId, UA_Boolean includeSubtypes) {
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
+    bd.referenceTypeId = referenceTypeId;
+    bd.includeSubtypes = includeSubtypes;
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    UA_BrowseResult br = UA_Server_browse(server, 0, &bd);
+    ck_assert_int_eq(br.statusCode, UA_STATUSCODE_GOOD);
+    size_t count = br.referencesSize;
+    UA_BrowseResult_deleteMembers(&br);
+    return count;
+}
+
+START_TEST(Service_Browse_SubtypesFollowHierarchyChanges) {
+    UA_Server *server = UA_Server_new(UA_ServerConfig_standard);
+    const UA_NodeId hierarchical = UA_NODEID_NUMERIC(0, UA_NS0ID_HIERARCHICALREFERENCES);
+    const UA_NodeId hasSubtype = UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE);
+    size_t before = browseObjectsFolder(server, hierarchical, true);
+    ck_assert_uint_gt(before, 0);
+
+    /* a new reference type below the cached hierarchy */
+    UA_ReferenceTypeAttributes refattr;
+    UA_ReferenceTypeAttributes_init(&refattr);
+    refattr.displayName = UA_LOCALIZEDTEXT("en_US", "MyReference");
+    UA_NodeId myRef = UA_NODEID_NUMERIC(1, 5000);
+    UA_StatusCode retval =
+        UA_Server_addReferenceTypeNode(server, myRef, hierarchical, hasSubtype,
+                                       UA_QUALIFIEDNAME(1, "MyReference"), refattr, NULL, NULL);
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+
+    UA_ObjectAttributes objattr;
+    UA_ObjectAttributes_init(&objattr);
+    objattr.displayName = UA_LOCALIZEDTEXT("en_US", "MyObject");
+    retval = UA_Server_addObjectNode(server, UA_NODEID_NUMERIC(1, 5001),
+                                     UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER), myRef,
+                                     UA_QUALIFIEDNAME(1, "MyObject"),
+                                     UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE), objattr, NULL, NULL);
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(browseObjectsFolder(server, hierarchical, true), before + 1);
+    ck_assert_uint_eq(browseObjectsFolder(server, hierarchical, false), 0);
+    ck_assert_uint_eq(browseObjectsFolder(server, myRef, false), 1);
+
+    /* the reference type is no longer hierarchical */
+    retval = UA_Server_deleteReference(server, hierarchical, hasSubtype, true,
+                                       UA_EXPANDEDNODEID_NUMERIC(1, 5000), true);
+    ck_assert_int_eq(retval, UA_STATUSCODE_GOOD);
+    ck_assert_uint_eq(browseObjectsFolder(server, hierarchical, true), before);
+    ck_assert_uint_eq(browseObjectsFolder(server, myRef, true), 1);
+
+    UA_Server_delete(server);
+}
+END_TEST
+
 static Suite* testSuite_Service_TranslateBrowsePathsToNodeIds(void) {
 	Suite *s = suite_create("Service_TranslateBrowsePathsToNodeIds");
 	TCase *tc_core = tcase_create("Core");
 	//tcase_add_test(tc_core, Service_TranslateBrowsePathsToNodeIds_SmokeTest);
 	suite_add_tcase(s,tc_core);
+	TCase *tc_browse = tcase_create("Browse");
+	tcase_add_test(tc_browse, Service_Browse_SubtypesFollowHierarchyChanges);
+	suite_add_tcase(s,tc_browse);
 	return s;
 }
 
@@ -55,6 +55,8 @@ class StructMember(object):
         self.name = name
         self.memberType = memberType
         self.isArray = isArray
+        self.overlayableRun = "0" # C-expressions for the run of overlayable
+        self.overlayableBytes = "0" # members starting here (see StructType)
 
 class Type(object):
     def __init__(self, outname, xml):
@@ -79,9 +81,12 @@ class Type(object):
         if self.name in typedescriptions:
             description = typedescriptions[self.name]
             typeid = "{.namespaceIndex = %s, .identifierType = UA_NODEIDTYPE_NUMERIC, .identifier.numeric = %s}" % (description.namespaceid, description.nodeid)
+            binaryencodingid = description.binaryencodingid
         else:
             typeid = "{.namespaceIndex = 0, .identifierType = UA_NODEIDTYPE_NUMERIC, .identifier.numeric = 0}"
+            binaryencodingid = "0"
         return "{ .typeId = " + typeid + \
+            ",\n  .binaryEncodingId = " + binaryencodingid + \
             ",\n  .typeIndex = " + self.typeIndex + \
             ",\n#ifdef UA_ENABLE_TYPENAMES\n  .typeName = \"%s\",\n#endif\n" % self.name + \
             "  .memSize = sizeof(UA_" + self.name + ")" + \
@@ -111,6 +116,8 @@ class Type(object):
                     m += " - sizeof(void*),\n"
                 else:
                     m += " - sizeof(UA_%s),\n" % before.memberType.name
+            m += "    .overlayableRun = %s,\n" % member.overlayableRun
+            m += "    .overlayableBytes = %s,\n" % member.overlayableBytes
             m += "    .isArray = " + ("true" if member.isArray else "false")
             members += m + "\n  },"
             before = member
@@ -133,7 +140,7 @@ class Type(object):
 
     def encoding_h(self):
         enc = "static UA_INLINE UA_StatusCode UA_%s_encodeBinary(const UA_%s *src, UA_ByteString *dst, size_t *offset) { return UA_encodeBinary(src, %s, dst, offset); }\n"
-        enc += "static UA_INLINE UA_StatusCode UA_%s_decodeBinary(const UA_ByteString *src, size_t *offset, UA_%s *dst) { return UA_decodeBinary(src, offset, dst, %s); }"
+        enc += "static UA_INLINE UA_StatusCode UA_%s_decodeBinary(const UA_ByteString *src, size_t *offset, UA_%s *dst) { return UA_decodeBinary(src, offset, dst, %s, 0, NULL); }"
         return enc % tuple(list(itertools.chain(*itertools.repeat([self.name, self.name, self.datatype_ptr()], 2))))
 
 class BuiltinType(Type):
@@ -221,6 +228,49 @@ class StructType(Type):
             if "false" in self.overlayable:
                 self.overlayable = "false"
             before = m
+        self.computeOverlayableRuns()
+
+    def runCandidate(self, m):
+        "Can the member be part of a run that is memcpy'd to/from the binary stream?"
+        # Booleans are normalized to true/false during decoding
+        return not m.isArray and m.memberType.fixed_size == "true" and \
+            m.memberType.overlayable != "false" and m.memberType.name != "Boolean"
+
+    def computeOverlayableRuns(self):
+        """Consecutive members that have an identical layout in memory and on
+        the binary stream are de- and encoded with a single memcpy. Whether the
+        layout matches depends on the architecture. So the run length is a
+        C-expression that tries the longest run first and falls back to
+        shorter ones."""
+        for i, start in enumerate(self.members):
+            span = []
+            for m in self.members[i:]:
+                if not self.runCandidate(m):
+                    break
+                span.append(m)
+            runs = []
+            for k in range(len(span), 0, -1):
+                conditions = []
+                for j, m in enumerate(span[:k]):
+                    overlayable = "(" + m.memberType.overlayable + ")"
+                    if m.memberType.overlayable != "true" and overlayable not in conditions:
+                        conditions.append(overlayable)
+                    if j > 0:
+                        conditions.append("offsetof(UA_%s, %s) == offsetof(UA_%s, %s) + sizeof(UA_%s)" % \
+                                          (self.name, m.name, self.name, span[j-1].name, span[j-1].memberType.name))
+                last = span[k-1]
+                if k == 1:
+                    length = "sizeof(UA_%s)" % start.memberType.name
+                else:
+                    length = "offsetof(UA_%s, %s) + sizeof(UA_%s) - offsetof(UA_%s, %s)" % \
+                             (self.name, last.name, last.memberType.name, self.name, start.name)
+                runs.append((" && ".join(conditions) if conditions else "true", k, length))
+                if not conditions:
+                    break # shorter runs are never tried
+            if not runs:
+                continue
+            start.overlayableRun = "".join(["(%s) ? %s : " % (c, k) for (c, k, _) in runs]) + "0"
+            start.overlayableBytes = "".join(["(%s) ? (%s) : " % (c, l) for (c, _, l) in runs]) + "0"
 
     def typedef_h(self):
         if len(self.members) == 0:
@@ -294,13 +344,14 @@ class TypeDescription(object):
         self.name = name
         self.nodeid = nodeid
         self.namespaceid = namespaceid
+        self.binaryencodingid = "0"
 
 def parseTypeDescriptions(filename, namespaceid):
     definitions = {}
     with open(filename) as f:
         input_str = f.read()
     input_str = input_str.replace('\r','')
-    rows = map(lambda x:tuple(x.split(',')), input_str.split('\n'))
+    rows = list(map(lambda x:tuple(x.split(',')), input_str.split('\n')))
     for index, row in enumerate(rows):
         if len(row) < 3:
             continue
@@ -316,6 +367,14 @@ def parseTypeDescriptions(filename, namespaceid):
             definitions[row[0]] = TypeDescription(row[0], "6", namespaceid) # enumerations look like int32 on the wire
         else:
             definitions[row[0]] = TypeDescription(row[0], row[1], namespaceid)
+    # the nodeids of the binary encodings do not always follow the datatype
+    # nodeid with a fixed offset
+    for row in rows:
+        if len(row) < 3 or row[2] != "Object" or not row[0].endswith("_Encoding_DefaultBinary"):
+            continue
+        name = row[0][:-len("_Encoding_DefaultBinary")]
+        if name in definitions and type(types.get(name)) != EnumerationType:
+            definitions[name].binaryencodingid = row[1]
     return definitions
 
 ###############################
@@ -394,6 +453,10 @@ extern "C" {
 
 printh("#define " + outname.upper() + "_COUNT %s" % (str(len(selected_types))))
 printh("extern UA_EXPORT const UA_DataType " + outname.upper() + "[" + outname.upper() + "_COUNT];")
+printh("")
+printh("/* Indices into " + outname.upper() + " sorted by the numeric binaryEncodingId. Used for the\n" + \
+       " * binary search when decoding ExtensionObjects. */")
+printh("extern const UA_UInt16 " + outname.upper() + "_SORTED[" + outname.upper() + "_COUNT];")
 
 printc('''/* Generated from ''' + inname + ''' with script ''' + sys.argv[0] + '''
  * on host ''' + platform.uname()[1] + ''' by user ''' + getpass.getuser() + \
@@ -430,9 +493,14 @@ else:
     values = types.values()
 
 i = 0
+sortedIndices = []
 for t in values:
     if not t.name in selected_types:
         continue
+    if t.name in typedescriptions:
+        sortedIndices.append((int(typedescriptions[t.name].binaryencodingid), i))
+    else:
+        sortedIndices.append((0, i))
     # Header
     printh("\n/**\n * " +  t.name)
     printh(" * " + "-" * len(t.name))
@@ -462,6 +530,10 @@ printh('''
 
 printc("};\n")
 
+sortedIndices.sort()
+printc("const UA_UInt16 %s_SORTED[%s_COUNT] = {" % (outname.upper(), outname.upper()))
+printc(",\n".join(map(lambda x: "    %s" % x[1], sortedIndices)) + "};\n")
+
 fh.close()
 fc.close()
 fe.close()
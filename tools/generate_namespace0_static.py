@@ -0,0 +1,173 @@
+from __future__ import print_function
+import sys
+import platform
+import getpass
+import time
+import argparse
+
+parser = argparse.ArgumentParser()
+parser.add_argument('nodeids', help='path/to/NodeIds.csv')
+parser.add_argument('nodes', help='path/to/namespace0_static.csv')
+parser.add_argument('outfile', help='outfile w/o extension')
+args = parser.parse_args()
+
+# symbolic name -> numeric identifier
+nodeids = {"HasModelParent": 50}
+for line in open(args.nodeids):
+    row = line.strip().split(',')
+    if len(row) >= 2 and row[0] != "":
+        nodeids[row[0]] = int(row[1])
+
+nodeclasses = {"Object": ("UA_ObjectNode", "UA_NODECLASS_OBJECT"),
+               "ObjectType": ("UA_ObjectTypeNode", "UA_NODECLASS_OBJECTTYPE"),
+               "VariableType": ("UA_VariableTypeNode", "UA_NODECLASS_VARIABLETYPE"),
+               "ReferenceType": ("UA_ReferenceTypeNode", "UA_NODECLASS_REFERENCETYPE"),
+               "DataType": ("UA_DataTypeNode", "UA_NODECLASS_DATATYPE")}
+
+class Node(object):
+    def __init__(self, nodeclass, name, browsename, attributes):
+        if not nodeclass in nodeclasses:
+            raise Exception("Unknown NodeClass " + nodeclass)
+        self.nodeclass = nodeclass
+        self.name = name
+        self.browsename = browsename
+        self.references = [] # (referencetype, isInverse, target)
+        self.abstract = "Abstract" in attributes
+        self.symmetric = "Symmetric" in attributes
+        self.inversename = None
+        for a in attributes:
+            if a.startswith("InverseName="):
+                self.inversename = a[len("InverseName="):]
+
+def lookup(name):
+    if not name in nodeids:
+        raise Exception("Unknown NodeId " + name)
+    return name
+
+nodes = {}
+order = []
+def addReference(source, reftype, target):
+    nodes[source].references.append((reftype, False, target))
+    nodes[target].references.append((reftype, True, source))
+
+for line in open(args.nodes):
+    line = line.strip()
+    if line == "" or line.startswith("#"):
+        continue
+    row = line.split(',')
+    if row[0] == "Reference":
+        addReference(lookup(row[1]), lookup(row[2]), lookup(row[3]))
+        continue
+    name = lookup(row[1])
+    attributes = row[5].split() if len(row) > 5 else []
+    nodes[name] = Node(row[0], name, row[2], attributes)
+    order.append(name)
+    if len(row) > 4 and row[3] != "":
+        nodes[name].references.append((lookup(row[4]), True, lookup(row[3])))
+        nodes[row[3]].references.append((row[4], False, name))
+
+# The nodestore finds the static nodes with a binary search
+order.sort(key=lambda n: nodeids[n])
+
+outname = args.outfile.split("/")[-1]
+fh = open(args.outfile + ".h", 'w')
+fc = open(args.outfile + ".c", 'w')
+def printh(string):
+    print(string, end='\n', file=fh)
+def printc(string):
+    print(string, end='\n', file=fc)
+
+def header(filename):
+    return '''/**********************************************************
+ * %s -- do not modify
+ **********************************************************
+ * Generated from %s with script %s
+ * on host %s by user %s at %s
+ **********************************************************/\n''' % (
+     filename, args.nodes, sys.argv[0], platform.uname()[1], getpass.getuser(),
+     time.strftime("%Y-%m-%d %I:%M:%S"))
+
+printh(header(outname + ".h"))
+printh('''#ifndef %s_H_
+#define %s_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "server/ua_nodes.h"
+
+/* The static nodes of namespace zero, sorted by their numeric NodeId */
+#define UA_NAMESPACE0_STATIC_COUNT %s
+extern const UA_Node * const UA_NAMESPACE0_STATIC[UA_NAMESPACE0_STATIC_COUNT];
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* %s_H_ */''' % (outname.upper(), outname.upper(), len(order), outname.upper()))
+
+printc(header(outname + ".c"))
+printc('''#include "%s.h"
+#include "ua_nodeids.h"
+
+#define NS0_NUMERIC(ID) {.namespaceIndex = 0, .identifierType = UA_NODEIDTYPE_NUMERIC, .identifier.numeric = ID}
+#define NS0_STRING(S) {sizeof(S) - 1, (UA_Byte*)S}
+#define NS0_NAMES(NAME) .browseName = {0, NS0_STRING(NAME)}, \\
+        .displayName = {NS0_STRING("en_US"), NS0_STRING(NAME)}, \\
+        .description = {NS0_STRING("en_US"), NS0_STRING(NAME)}
+#define NS0_TARGET(ID) {.nodeId = NS0_NUMERIC(ID)}
+#define NS0_REFERENCES(TYPE, INVERSE, TARGETS) \\
+    {.referenceTypeId = NS0_NUMERIC(TYPE), .isInverse = INVERSE, \\
+     .targetIdsSize = sizeof(TARGETS) / sizeof(UA_ExpandedNodeId), .targetIds = TARGETS}
+
+/* The references are never modified. They are not const since the nodes point
+   to them with a mutable pointer. */''' % outname)
+
+def symbol(name):
+    return "UA_NS0ID_" + name.upper()
+
+for name in order:
+    n = nodes[name]
+    printc("")
+    # group the references by type and direction
+    kinds = [] # (referencetype, isInverse, targets)
+    for (reftype, inverse, target) in n.references:
+        kind = next((k for k in kinds if k[0] == reftype and k[1] == inverse), None)
+        if not kind:
+            kind = (reftype, inverse, [])
+            kinds.append(kind)
+        kind[2].append(target)
+    for (i, k) in enumerate(kinds):
+        printc("static UA_ExpandedNodeId ns0_%s_targets%d[%d] = {" % (name, i, len(k[2])) +
+               ", ".join(["NS0_TARGET(%s)" % symbol(t) for t in k[2]]) + "};")
+    if kinds:
+        printc("static UA_NodeReferenceKind ns0_%s_references[%d] = {" % (name, len(kinds)))
+        printc(",\n".join(["    NS0_REFERENCES(%s, %s, ns0_%s_targets%d)" %
+                           (symbol(k[0]), "true" if k[1] else "false", name, i)
+                           for (i, k) in enumerate(kinds)]) + "};")
+    (ctype, nodeclass) = nodeclasses[n.nodeclass]
+    printc("static const %s ns0_%s = {" % (ctype, name))
+    printc("    .nodeId = NS0_NUMERIC(%s), .nodeClass = %s," % (symbol(name), nodeclass))
+    printc("    NS0_NAMES(\"%s\")," % n.browsename)
+    if kinds:
+        printc("    .referencesSize = %d, .references = ns0_%s_references," % (len(kinds), name))
+    if n.nodeclass == "ReferenceType":
+        printc("    .isAbstract = %s, .symmetric = %s," % ("true" if n.abstract else "false",
+                                                         "true" if n.symmetric else "false"))
+        if n.inversename:
+            printc("    .inverseName = {NS0_STRING(\"en_US\"), NS0_STRING(\"%s\")}," % n.inversename)
+    elif n.nodeclass == "VariableType":
+        printc("    .isAbstract = %s, .valueSource = UA_VALUESOURCE_VARIANT," % ("true" if n.abstract else "false"))
+        printc("    .value.variant.value = {.type = &UA_TYPES[UA_TYPES_VARIANT]},")
+    elif n.nodeclass == "ObjectType":
+        printc("    .isAbstract = %s," % ("true" if n.abstract else "false"))
+    printc("};")
+
+printc("\nconst UA_Node * const UA_NAMESPACE0_STATIC[UA_NAMESPACE0_STATIC_COUNT] = {")
+printc(",\n".join(["    (const UA_Node*)&ns0_%s" % name for name in order]) + "};")
+
+printc("\n#undef NS0_NUMERIC\n#undef NS0_STRING\n#undef NS0_NAMES\n#undef NS0_TARGET\n#undef NS0_REFERENCES")
+
+fh.close()
+fc.close()
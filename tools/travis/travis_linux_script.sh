@@ -101,6 +101,12 @@ else
 	make -j8
 	cd .. && rm build -rf
 
+	echo "Compile with the generated namespace 0 and run the unit tests"
+	mkdir -p build && cd build
+	cmake -DUA_ENABLE_GENERATE_NAMESPACE0=ON -DUA_BUILD_UNIT_TESTS=ON -DUA_BUILD_EXAMPLESERVER=ON ..
+	make -j8 && make test ARGS="-V"
+	cd .. && rm build -rf
+
 	#this run inclides full examples and methodcalls
 	echo "Debug build and unit tests (64 bit)"
 	mkdir -p build && cd build